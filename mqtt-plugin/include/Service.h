@@ -3,18 +3,20 @@
 //
 #include <memory>
 #include <functional>
+#include <map>
 #include <mutex>
+#include <set>
 
 //
 #include "configuration/Server.h"
 #include "subscription/Subscription.h"
 #include "publish/Publish.h"
+#include "publish/FlowControl.h"
+#include "transport/Transport.h"
+#include "capture/CaptureWriter.h"
 #include "Types.h"
 #include "fmt/core.h"
 
-//
-#include "mqtt/async_client.h"
-
 namespace plugin::mqtt
 {
     using namespace ::mqtt;
@@ -22,7 +24,7 @@ namespace plugin::mqtt
     /**
      * @brief Providing MQTT Service to Publishers and Subscribers
      */
-    class Service : public virtual callback
+    class Service
     {
     public:
         using Timesource = std::function<Timestamp(void)>;
@@ -32,7 +34,20 @@ namespace plugin::mqtt
         ~Service();
 
         /**
-         * @brief Establish a connection to the broker based on the given configuration
+         * @brief Set the Transport used to connect to the broker, must be set before connecting
+         * Uses the flow control of the transport if the connection is shared with other services
+         * @param transport
+         */
+        void setTransport(Transport::Pointer transport);
+
+        /**
+         * @brief Capture all messages arriving while processing to a file, disabled if null
+         * @param capture
+         */
+        void setCapture(capture::CaptureWriter::Pointer capture);
+
+        /**
+         * @brief Establish a connection to the broker using the transport
          */
         void connect();
 
@@ -61,16 +76,29 @@ namespace plugin::mqtt
 
         /**
          * @brief Add a subscription to the service
+         * While processing, the subscription is prepared and its topic subscribed right away
          * @param sub
          */
         void addSubscription(Subscription::Pointer sub);
 
+        /**
+         * @brief Remove a subscription from the service and unsubscribe from its topic, all other topics stay subscribed
+         * @param topic
+         */
+        void removeSubscription(const std::string &topic);
+
         /**
          * @brief Add a publish-handler to the service
          * @param pub
          */
         void addPublishHandler(Publish::Pointer pub);
 
+        /**
+         * @brief Remove a publish-handler, its buffered payloads are discarded
+         * @param topic
+         */
+        void removePublishHandler(const std::string &topic);
+
         /**
          * @brief Get access to the internal lock to prevent changes in internal buffers
          * @return std::mutex&
@@ -79,11 +107,13 @@ namespace plugin::mqtt
 
         /**
          * @brief Prepare the service and its Channels for processing
+         * Subscribes to the topics of all active subscriptions
          */
         void prepareProcessing();
 
         /**
          * @brief Give the service and its Channels a chance to finalize processing
+         * Unsubscribes from all topics until processing is prepared again
          */
         void stopProcessing();
 
@@ -95,9 +125,23 @@ namespace plugin::mqtt
 
         /**
          * @brief Iterate over all publish handlers and send out payloads if any
+         * Payloads are sent as long as the congestion window of the flow control permits, remaining payloads
+         * stay buffered within the publish handlers until the next call
          */
         void publish();
 
+        /**
+         * @brief Get the measurements of the publish flow control
+         * @return FlowControl::Statistics
+         */
+        FlowControl::Statistics getFlowStatistics() const;
+
+        /**
+         * @brief Get the capture writer, set before connecting
+         * @return capture::CaptureWriter::Pointer null if capturing is disabled
+         */
+        capture::CaptureWriter::Pointer getCapture() const;
+
     private:
         /**
          * @brief Enable sampling
@@ -109,34 +153,51 @@ namespace plugin::mqtt
          */
         void disable();
 
+        /**
+         * @brief Subscribe to topics of active subscriptions while sampling is enabled, unsubscribe from all others
+         * Requires the internal lock to be held
+         */
+        void updateSubscriptions();
+
         /**
          * @brief (Re)connecting success callback
          * @param tok
          */
-        void connected(const std::string &cause) override;
+        void connected(const std::string &cause);
 
         /**
          * @brief Callback indicatiSubscriptionng connection-loss. An automatic reconnect will be triggered
          * @param cause
          */
-        void connection_lost(const std::string &cause) override;
+        void connection_lost(const std::string &cause);
 
         /**
          * @brief Callback indicating async message arived
          * @param msg
          */
-        void message_arrived(const_message_ptr msg) override;
+        void message_arrived(const_message_ptr msg);
 
-        std::unique_ptr<async_client> m_client;
+        capture::CaptureWriter::Pointer m_capture;
         config::Server::Pointer m_server_configuration;
-        connect_options m_options;
         Timesource m_timesource;
         std::mutex m_mtx;
-        bool m_enable;
+        bool m_enable = false;
         Timestamp m_start;
 
+        // Holds a reference to the process-wide trace while processing
+        bool m_tracing = false;
+
+        // Shared with pending delivery callbacks, which might complete once the Service has been destroyed
+        std::shared_ptr<FlowControl> m_flow_control = std::make_shared<FlowControl>();
+
         // Map Subscription Object to Topics
         std::map<std::string, Subscription::Pointer> m_subscriptions;
         std::map<std::string, Publish::Pointer> m_publish_handlers;
+
+        // Topics currently subscribed at the broker
+        std::set<std::string> m_subscribed;
+
+        // Declared last to be destroyed first, pending callbacks of the transport use all other members
+        Transport::Pointer m_transport;
     };
 }
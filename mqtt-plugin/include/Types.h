@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <variant>
 #include <optional>
+#include <vector>
 
 //
 #include "nlohmann/json.hpp"
@@ -41,7 +42,17 @@ namespace plugin::mqtt
         Integer,
         String
     };
-    using value_t = std::variant<std::string, int, double>;
+    // A sample of a vector channel is a single array of numbers
+    using value_t = std::variant<std::string, int, double, std::vector<double>>;
+
+    // Native type of the samples of a sync stream
+    enum class SampleType
+    {
+        Int16,
+        Int32,
+        Float32,
+        Float64
+    };
 
     enum class SamplingModes
     {
@@ -49,6 +60,25 @@ namespace plugin::mqtt
         Sync
     };
 
+    enum class GapFill
+    {
+        NaN,
+        Hold,
+        Linear
+    };
+
+    enum class ChannelLayout
+    {
+        Columnar,
+        Interleaved
+    };
+
+    enum class PayloadFormat
+    {
+        TextJson,
+        CborSync
+    };
+
     enum class Operation
     {
         Publish,
@@ -58,10 +88,10 @@ namespace plugin::mqtt
     struct Sample
     {
         Sample() = default;
-        Sample(const value_t v, Timestamp t)
+        Sample(value_t v, Timestamp t)
         {
             time = t;
-            push_back(v);
+            push_back(std::move(v));
         }
 
         Sample(std::vector<value_t> v, Timestamp t)
@@ -73,14 +103,14 @@ namespace plugin::mqtt
         template <typename T>
         T pop_back()
         {
-            auto value = values.back();
+            auto value = std::get<T>(std::move(values.back()));
             values.pop_back();
-            return std::get<T>(value);
+            return value;
         }
 
         void push_back(value_t value)
         {
-            values.push_back(value);
+            values.push_back(std::move(value));
         }
 
         template <typename T>
@@ -127,6 +157,27 @@ namespace plugin::mqtt
         }
     }
 
+    inline void from_json(const json &j, GapFill &g)
+    {
+        std::string str = j;
+        if (str == "nan")
+        {
+            g = GapFill::NaN;
+        }
+        else if (str == "hold")
+        {
+            g = GapFill::Hold;
+        }
+        else if (str == "linear")
+        {
+            g = GapFill::Linear;
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown gap-fill policy.");
+        }
+    }
+
     inline void from_json(const json &j, Datatype &d)
     {
         std::string str = j;
@@ -147,4 +198,63 @@ namespace plugin::mqtt
             throw std::invalid_argument("Unknwon datatype.");
         }
     }
+
+    inline void from_json(const json &j, SampleType &t)
+    {
+        std::string str = j;
+        if (str == "int16")
+        {
+            t = SampleType::Int16;
+        }
+        else if (str == "int32")
+        {
+            t = SampleType::Int32;
+        }
+        else if (str == "float32")
+        {
+            t = SampleType::Float32;
+        }
+        else if (str == "float64")
+        {
+            t = SampleType::Float64;
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown sample-type.");
+        }
+    }
+
+    inline void from_json(const json &j, ChannelLayout &l)
+    {
+        std::string str = j;
+        if (str == "columnar")
+        {
+            l = ChannelLayout::Columnar;
+        }
+        else if (str == "interleaved")
+        {
+            l = ChannelLayout::Interleaved;
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown channel-layout.");
+        }
+    }
+
+    inline void from_json(const json &j, PayloadFormat &f)
+    {
+        std::string str = j;
+        if (str == "text/json")
+        {
+            f = PayloadFormat::TextJson;
+        }
+        else if (str == "cbor/json/sync")
+        {
+            f = PayloadFormat::CborSync;
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown payload-format.");
+        }
+    }
 }
@@ -0,0 +1,77 @@
+#pragma once
+
+//
+#include "capture/Record.h"
+
+//
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace plugin::mqtt::capture
+{
+    /**
+     * @brief Append records to a capture file using a background thread
+     * Writing never blocks the caller, records are dropped if the writer cannot keep up
+     */
+    class CaptureWriter
+    {
+    public:
+        using Pointer = std::shared_ptr<CaptureWriter>;
+
+        /**
+         * @brief Create the capture file and start the writer
+         * @param path
+         * @param max_pending_bytes Records are dropped while more bytes are waiting to be written
+         */
+        CaptureWriter(const std::string &path, std::size_t max_pending_bytes = 64 * 1024 * 1024);
+
+        /**
+         * @brief Write all pending records and close the file
+         */
+        ~CaptureWriter();
+
+        /**
+         * @brief Queue a record for writing
+         * @param kind
+         * @param timestamp Oxygen host time
+         * @param topic
+         * @param payload
+         */
+        void write(RecordKind kind, const Timestamp &timestamp, const std::string &topic, const std::string &payload);
+
+        /**
+         * @brief Block until all queued records have been written to the file
+         */
+        void flush();
+
+        /**
+         * @brief Get the number of records dropped because the writer could not keep up
+         * @return std::uint64_t
+         */
+        std::uint64_t getDropped() const;
+
+    private:
+        void run();
+
+        std::ofstream m_file;
+        const std::size_t m_max_pending_bytes;
+        const std::chrono::steady_clock::time_point m_start;
+
+        std::mutex m_mtx;
+        std::condition_variable m_cv;
+        std::vector<Record> m_pending;
+        std::size_t m_pending_bytes;
+        std::uint64_t m_queued;
+        std::uint64_t m_written;
+        bool m_stop;
+        std::atomic<std::uint64_t> m_dropped;
+
+        std::thread m_thread;
+    };
+}
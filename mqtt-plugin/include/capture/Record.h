@@ -0,0 +1,184 @@
+#pragma once
+
+//
+#include "Types.h"
+
+//
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+namespace plugin::mqtt::capture
+{
+    /**
+     * Capture files start with a magic and a version, followed by records until the end of the file.
+     * All integers are little-endian, a record is laid out as:
+     *   u8 kind | u64 arrival (ns since capture start) | u64 ticks | f64 frequency | u32 size | topic | u32 size | payload
+     */
+    constexpr char MAGIC[8] = {'M', 'Q', 'T', 'T', 'C', 'A', 'P', '\0'};
+    constexpr std::uint32_t VERSION = 1;
+
+    enum class RecordKind : std::uint8_t
+    {
+        // A message arrived on a subscribed topic
+        Message = 0,
+
+        // Processing has been started, the timestamp is the start of sampling
+        Start = 1
+    };
+
+    struct Record
+    {
+        RecordKind kind;
+
+        // Arrival in nanoseconds since the capture has been started
+        std::uint64_t arrival;
+
+        // Oxygen host time on arrival
+        Timestamp timestamp;
+
+        std::string topic;
+        std::string payload;
+    };
+
+    namespace details
+    {
+        inline void writeU64(std::ostream &os, std::uint64_t value)
+        {
+            char bytes[8];
+            for (int n = 0; n < 8; ++n)
+            {
+                bytes[n] = static_cast<char>((value >> (8 * n)) & 0xff);
+            }
+            os.write(bytes, sizeof(bytes));
+        }
+
+        inline void writeU32(std::ostream &os, std::uint32_t value)
+        {
+            char bytes[4];
+            for (int n = 0; n < 4; ++n)
+            {
+                bytes[n] = static_cast<char>((value >> (8 * n)) & 0xff);
+            }
+            os.write(bytes, sizeof(bytes));
+        }
+
+        inline void writeString(std::ostream &os, const std::string &value)
+        {
+            writeU32(os, static_cast<std::uint32_t>(value.size()));
+            os.write(value.data(), value.size());
+        }
+
+        inline std::uint64_t readU64(std::istream &is)
+        {
+            unsigned char bytes[8];
+            if (!is.read(reinterpret_cast<char *>(bytes), sizeof(bytes)))
+                throw std::runtime_error("Capture file is truncated.");
+
+            std::uint64_t value = 0;
+            for (int n = 0; n < 8; ++n)
+            {
+                value |= static_cast<std::uint64_t>(bytes[n]) << (8 * n);
+            }
+            return value;
+        }
+
+        inline std::uint32_t readU32(std::istream &is)
+        {
+            unsigned char bytes[4];
+            if (!is.read(reinterpret_cast<char *>(bytes), sizeof(bytes)))
+                throw std::runtime_error("Capture file is truncated.");
+
+            std::uint32_t value = 0;
+            for (int n = 0; n < 4; ++n)
+            {
+                value |= static_cast<std::uint32_t>(bytes[n]) << (8 * n);
+            }
+            return value;
+        }
+
+        inline std::string readString(std::istream &is)
+        {
+            std::string value(readU32(is), '\0');
+            if (!is.read(value.data(), value.size()))
+                throw std::runtime_error("Capture file is truncated.");
+            return value;
+        }
+    }
+
+    /**
+     * @brief Write the file header
+     * @param os
+     */
+    inline void writeHeader(std::ostream &os)
+    {
+        os.write(MAGIC, sizeof(MAGIC));
+        details::writeU32(os, VERSION);
+    }
+
+    /**
+     * @brief Read and check the file header
+     * @param is
+     */
+    inline void readHeader(std::istream &is)
+    {
+        char magic[sizeof(MAGIC)];
+        if (!is.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+            throw std::runtime_error("Not a capture file.");
+
+        if (details::readU32(is) != VERSION)
+            throw std::runtime_error("Capture file version is not supported.");
+    }
+
+    /**
+     * @brief Append a record
+     * @param os
+     * @param record
+     */
+    inline void writeRecord(std::ostream &os, const Record &record)
+    {
+        std::uint64_t frequency;
+        static_assert(sizeof(frequency) == sizeof(record.timestamp.frequency));
+        std::memcpy(&frequency, &record.timestamp.frequency, sizeof(frequency));
+
+        const char kind = static_cast<char>(record.kind);
+        os.write(&kind, 1);
+        details::writeU64(os, record.arrival);
+        details::writeU64(os, record.timestamp.ticks);
+        details::writeU64(os, frequency);
+        details::writeString(os, record.topic);
+        details::writeString(os, record.payload);
+    }
+
+    /**
+     * @brief Read the next record
+     * @param is
+     * @param record
+     * @return false at the end of the file
+     */
+    inline bool readRecord(std::istream &is, Record &record)
+    {
+        char kind;
+        if (!is.read(&kind, 1))
+            return false;
+
+        if (kind != static_cast<char>(RecordKind::Message) && kind != static_cast<char>(RecordKind::Start))
+            throw std::runtime_error("Capture file is corrupt.");
+
+        record.kind = static_cast<RecordKind>(kind);
+        record.arrival = details::readU64(is);
+
+        const auto ticks = details::readU64(is);
+        const auto frequency_bits = details::readU64(is);
+        double frequency;
+        std::memcpy(&frequency, &frequency_bits, sizeof(frequency));
+        record.timestamp = Timestamp(ticks, frequency);
+
+        record.topic = details::readString(is);
+        record.payload = details::readString(is);
+        return true;
+    }
+}
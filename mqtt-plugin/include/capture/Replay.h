@@ -0,0 +1,71 @@
+#pragma once
+
+//
+#include "capture/Record.h"
+#include "transport/LoopbackTransport.h"
+
+//
+#include <atomic>
+#include <fstream>
+#include <functional>
+
+namespace plugin::mqtt::capture
+{
+    /**
+     * @brief Feed a capture file back through the loopback transport
+     * The Oxygen host time of each record is provided as time source, hence payloads are decoded as they were on capture
+     */
+    class Replay
+    {
+    public:
+        enum class Speed
+        {
+            // Keep the captured arrival times
+            Realtime,
+
+            // Inject all messages without any delay
+            Unlimited
+        };
+
+        struct Statistics
+        {
+            std::size_t messages;
+            std::size_t delivered;
+            double duration;
+        };
+
+        /**
+         * @brief Open a capture file
+         * @param path
+         * @param transport Messages are injected into this transport
+         */
+        Replay(const std::string &path, LoopbackTransport &transport);
+
+        /**
+         * @brief Called for every start record, e.g. to prepare processing once the time source reflects the start
+         * @param on_start
+         */
+        void setStartCallback(std::function<void()> on_start);
+
+        /**
+         * @brief Get the Oxygen host time of the current record, to be used as time source of the service
+         * @return Timestamp
+         */
+        Timestamp now() const;
+
+        /**
+         * @brief Replay all remaining records, blocks until done
+         * @param speed
+         * @return Statistics
+         */
+        Statistics run(Speed speed);
+
+    private:
+        std::ifstream m_file;
+        LoopbackTransport &m_transport;
+        std::function<void()> m_on_start;
+
+        std::atomic<std::uint64_t> m_ticks;
+        std::atomic<double> m_frequency;
+    };
+}
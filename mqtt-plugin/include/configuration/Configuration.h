@@ -1,6 +1,7 @@
 #pragma once
 
 //
+#include <cstdint>
 #include <string>
 #include <list>
 
@@ -37,6 +38,26 @@ namespace plugin::mqtt::config
             }
         };
 
+        /**
+         * @brief Topics affected by reloading the configuration
+         */
+        struct Changes
+        {
+            // New topics and topics whose configuration changed, their channels must be created
+            Topics added;
+
+            // Topics removed from the configuration or replaced by a changed one, their channels must be removed
+            Topics removed;
+
+            // The server configuration changed, a new connection is required
+            bool servers_changed;
+
+            Changes()
+            {
+                servers_changed = false;
+            }
+        };
+
         Configuration() = default;
 
         /**
@@ -53,6 +74,37 @@ namespace plugin::mqtt::config
          */
         static void writeToFile(const std::string path, const json &document);
 
+        /**
+         * @brief Write content to a file, e.g. a document dumped once for several destinations
+         * @param path
+         * @param content
+         */
+        static void writeToFile(const std::string path, const std::string &content);
+
+        /**
+         * @brief Hash of a configuration (FNV-1a), identifies the content a binary cache has been created from
+         * @param content
+         * @return std::uint64_t
+         */
+        static std::uint64_t hash(const std::string &content);
+
+        /**
+         * @brief Write a validated and dereferenced document in binary form (CBOR)
+         * @param path
+         * @param document As returned by load, including all generated UUIDs
+         * @param content_hash Hash of the content the document is loaded from next time
+         */
+        static void writeBinaryCache(const std::string path, const json &document, std::uint64_t content_hash);
+
+        /**
+         * @brief Load a binary cache, fails if it has not been created from content of the given hash or by a plugin
+         * release with a different schema
+         * @param path
+         * @param content_hash
+         * @return ConfigResult The cached document
+         */
+        static ConfigResult loadBinaryCache(const std::string path, std::uint64_t content_hash);
+
         /**
          * @brief Load configuration from file
          * @param path
@@ -61,6 +113,24 @@ namespace plugin::mqtt::config
          */
         ConfigResult load(const std::string content);
 
+        /**
+         * @brief Load a document that has already been validated and dereferenced, e.g. from a binary cache
+         * Skips parsing and schema validation
+         * @param document
+         * @return ConfigResult
+         */
+        ConfigResult loadValidated(json document);
+
+        /**
+         * @brief Reload a changed configuration, only topics with a changed configuration are created again
+         * Topics whose configuration did not change keep their Topic objects - and so their subscriptions, publish
+         * handlers, stream state and channel UUIDs. If no configuration has been loaded yet, all topics are added.
+         * @param content
+         * @param changes Topics added and removed by the new configuration
+         * @return ConfigResult The new document, containing the UUIDs of kept and created topics
+         */
+        ConfigResult reload(const std::string content, Changes &changes);
+
         /**
          * @brief Get the Subscriptions
          * @return Topics
@@ -82,6 +152,18 @@ namespace plugin::mqtt::config
     private:
         Topics m_topics;
         Servers m_servers;
+        ClockDomains m_clock_domains;
+
+        // The current document including all generated UUIDs, reloads are compared against it
+        json m_document;
+
+        /**
+         * @brief Parse, dereference and validate a configuration
+         * @param content
+         * @param d The parsed document
+         * @return ConfigResult
+         */
+        ConfigResult parse(const std::string &content, json &d);
 
         /**
          * @brief Replace all $ref variables with their actual value
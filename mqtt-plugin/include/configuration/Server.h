@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <memory>
+#include <optional>
 #include <string>
 
 //
@@ -26,11 +27,53 @@ namespace plugin::mqtt::config
          */
         std::string getUrl() const;
 
+        /**
+         * @brief Get the maximum number of payloads in flight towards the broker, if configured
+         * @return std::optional<int>
+         */
+        std::optional<int> getMaxInflight() const;
+
+        /**
+         * @brief Get the path of the file arriving messages are captured to, if configured
+         * @return std::optional<std::string>
+         */
+        std::optional<std::string> getCaptureFile() const;
+
+        /**
+         * @brief Check whether diagnostic output channels should be created for subscribed topics
+         * @return bool
+         */
+        bool getDiagnostics() const;
+
+        /**
+         * @brief Get the path of the file latency traces are written to, if configured
+         * @return std::optional<std::string>
+         */
+        std::optional<std::string> getTraceFile() const;
+
+        /**
+         * @brief Get the user name to authenticate at the broker, if configured
+         * @return std::optional<std::string>
+         */
+        std::optional<std::string> getUsername() const;
+
+        /**
+         * @brief Get the password to authenticate at the broker, if configured
+         * @return std::optional<std::string>
+         */
+        std::optional<std::string> getPassword() const;
+
         // Friends
         friend void from_json(const json &d, Servers &t);
 
     private:
         std::string m_url;
+        std::optional<int> m_max_inflight;
+        std::optional<std::string> m_capture_file;
+        bool m_diagnostics = false;
+        std::optional<std::string> m_trace_file;
+        std::optional<std::string> m_username;
+        std::optional<std::string> m_password;
     };
 
     void from_json(const json &d, Servers &subscriptions);
@@ -0,0 +1,58 @@
+#pragma once
+
+//
+#include <map>
+#include <string>
+#include <vector>
+
+//
+#include "resampling/Stream.h"
+#include "subscription/Subscription.h"
+
+namespace plugin::mqtt::config
+{
+    /**
+     * @brief The state learned by the resampled streams of sync channels (e.g. the drift of a device), keyed by
+     * channel UUID and persisted next to the configuration cache. New streams are seeded from it, hence short
+     * measurements do not start from the nominal sample rate again.
+     */
+    class StreamStates
+    {
+    public:
+        using States = std::map<std::string, StreamBase::WarmStart>;
+
+        /**
+         * @brief Load the persisted states
+         * @param path
+         * @return StreamStates empty if the file does not exist or is damaged
+         */
+        static StreamStates load(const std::string &path);
+
+        /**
+         * @brief Persist the states (CBOR)
+         * @param path
+         */
+        void save(const std::string &path) const;
+
+        /**
+         * @brief Seed the decoders of all channels with a known state
+         * @param subscriptions
+         */
+        void seed(const std::vector<Subscription::Pointer> &subscriptions) const;
+
+        /**
+         * @brief Take over the states learned by the decoders, states of channels without new estimates are kept
+         * @param subscriptions
+         */
+        void update(const std::vector<Subscription::Pointer> &subscriptions);
+
+        /**
+         * @brief Get the states by channel UUID
+         * @return const States&
+         */
+        const States &getStates() const;
+
+    private:
+        States m_states;
+    };
+}
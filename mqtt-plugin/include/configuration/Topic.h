@@ -6,8 +6,10 @@
 #include "subscription/Subscription.h"
 #include "publish/Publish.h"
 #include "subscription/decoding/Decoder.h"
+#include "resampling/StreamClock.h"
 
 //
+#include <map>
 #include <string>
 #include <vector>
 
@@ -20,6 +22,9 @@ namespace plugin::mqtt::config
     using nlohmann::json;
     using Topics = std::vector<std::shared_ptr<Topic>>;
 
+    // Clock domains coordinating the streams of topics sharing a clock
+    using ClockDomains = std::map<std::string, ClockDomain::Pointer>;
+
     class Topic
     {
     public:
@@ -55,6 +60,12 @@ namespace plugin::mqtt::config
          */
         Publish::Pointer getPublisher();
 
+        /**
+         * @brief Get the MQTT topic path this configuration belongs to
+         * @return const std::string&
+         */
+        const std::string &getPath() const;
+
         /**
          * @brief Get the Operation (Publish or Subscribe)
          * @return Operation
@@ -66,13 +77,15 @@ namespace plugin::mqtt::config
          * This method inserts unique identifiers for each channel into the JSON object
          * @param d
          * @param t
+         * @param clock_domains Topics joining an existing clock domain share its start
          */
-        static void fromJson(json &d, Topics &t);
+        static void fromJson(json &d, Topics &t, ClockDomains &clock_domains);
 
     private:
         OxygenOutputChannelMap m_output_channel_map;
         Subscription::Pointer m_subscription;
         Publish::Pointer m_publish;
         Operation m_operation;
+        std::string m_path;
     };
 }
\ No newline at end of file
@@ -31,6 +31,31 @@ inline nlohmann::json configuration_file_schema = R"(
                     "url": {
                         "type": "string",
                         "description": "The Server-URL"
+                    },
+                    "max-inflight": {
+                        "type": "integer",
+                        "description": "Maximum number of published payloads awaiting an acknowledge by the broker",
+                        "minimum": 1
+                    },
+                    "capture": {
+                        "type": "string",
+                        "description": "Capture all messages arriving while processing to the given file, e.g. to replay them later"
+                    },
+                    "diagnostics": {
+                        "type": "boolean",
+                        "description": "Create output channels reporting the ingest health (message rate, decode failures, resampling state) of each subscribed topic"
+                    },
+                    "trace": {
+                        "type": "string",
+                        "description": "Trace the latency of messages and payloads while processing, written to the given file in the Chrome trace event format once processing stops"
+                    },
+                    "username": {
+                        "type": "string",
+                        "description": "User name to authenticate at the broker"
+                    },
+                    "password": {
+                        "type": "string",
+                        "description": "Password to authenticate at the broker"
                     }
                 },
                 "required": [
@@ -128,6 +153,46 @@ inline nlohmann::json configuration_file_schema = R"(
                 "samples-per-packet": {
                     "description": "The number of samples within every MQTT payload packet. Only used for sampling-mode sync.",
                     "type": "integer"
+                },
+                "channels": {
+                    "description": "Bundle several Oxygen-Channels sharing a common timebase within every payload. Each name becomes a selectable input channel. Only used for sampling-mode sync.",
+                    "type": "array",
+                    "minItems": 1,
+                    "uniqueItems": true,
+                    "items": {
+                        "type": "string"
+                    }
+                },
+                "layout": {
+                    "description": "How the samples of bundled channels are arranged: one array per channel (columnar) or sample by sample (interleaved).",
+                    "type": "string",
+                    "enum": [
+                        "columnar",
+                        "interleaved"
+                    ]
+                },
+                "format": {
+                    "description": "The encoding of the payload. cbor/json/sync adds the timestamp of the last sample and can be subscribed by the cbor/json/sync decoder.",
+                    "type": "string",
+                    "enum": [
+                        "text/json",
+                        "cbor/json/sync"
+                    ]
+                },
+                "max-latency": {
+                    "description": "Publish partial packets once the buffered samples span the given time in seconds. Only used for sampling-mode sync.",
+                    "type": "number",
+                    "minimum": 0,
+                    "exclusiveMinimum": true
+                },
+                "adaptive": {
+                    "description": "Size packets based on the acknowledge latency of the broker. samples-per-packet becomes the minimum packet size, max-latency (default: 1 second) limits the packet size. Only used for sampling-mode sync.",
+                    "type": "boolean"
+                },
+                "max-queued": {
+                    "description": "The number of payloads kept while the broker is unreachable or can not keep up (default: 10000). The oldest payloads are dropped beyond.",
+                    "type": "integer",
+                    "minimum": 1
                 }
             },
             "required": [
@@ -207,8 +272,38 @@ inline nlohmann::json configuration_file_schema = R"(
                                 "integer"
                             ]
                         },
+                        "sample-type": {
+                            "description": "Native type of the samples, used to store and resample the stream. Integer channels require int16 or int32 and keep raw ADC counts. Defaults to int32 for integer and float64 for number channels.",
+                            "type": "string",
+                            "enum": [
+                                "int16",
+                                "int32",
+                                "float32",
+                                "float64"
+                            ]
+                        },
                         "range": {
                             "$ref": "#/definitions/range"
+                        },
+                        "channels": {
+                            "description": "Channels of a frame sampled by a common clock, e.g. the channels of a single ADC. All channels share a single resampled stream.",
+                            "type": "array",
+                            "minItems": 1,
+                            "items": {
+                                "type": "object",
+                                "properties": {
+                                    "name": {
+                                        "description": "Name of the channel within the frame",
+                                        "type": "string"
+                                    },
+                                    "range": {
+                                        "$ref": "#/definitions/range"
+                                    }
+                                },
+                                "required": [
+                                    "name"
+                                ]
+                            }
                         }
                     }
                 }
@@ -241,13 +336,19 @@ inline nlohmann::json configuration_file_schema = R"(
             "properties": {
                 "type": {
                     "type": "string",
-                    "description": "If type is object, then JSON-Payload is nested, else this will become a channel in Oxygen.",
+                    "description": "If type is object, then JSON-Payload is nested, else this will become a channel in Oxygen. An array of numbers becomes a vector channel, one array per sample.",
                     "enum": [
                         "object",
                         "integer",
-                        "number"
+                        "number",
+                        "array"
                     ]
                 },
+                "dimension": {
+                    "type": "integer",
+                    "description": "Number of elements of an array (e.g. the bins of a spectrum), every payload must contain exactly this many numbers. Requires sampling mode async.",
+                    "minimum": 1
+                },
                 "range": {
                     "$ref": "#/definitions/range"
                 },
@@ -273,6 +374,19 @@ inline nlohmann::json configuration_file_schema = R"(
                         "properties"
                     ]
                 },
+                {
+                    "properties": {
+                        "type": {
+                            "enum": [
+                                "array"
+                            ]
+                        }
+                    },
+                    "required": [
+                        "type",
+                        "dimension"
+                    ]
+                },
                 {
                     "properties": {
                         "type": {
@@ -307,6 +421,32 @@ inline nlohmann::json configuration_file_schema = R"(
                 "clock": {
                     "description": "Synced channels can share a common clock domain (depending on the procol). This domains are identified by their clock name",
                     "type": "string"
+                },
+                "resync": {
+                    "description": "Re-anchor sync-channels on their clock after an outage instead of discarding all further packets, enabled if omitted",
+                    "type": "boolean"
+                },
+                "gap-fill": {
+                    "description": "How samples of lost packets are replaced in sync-channels: NaN, the last value or a linear bridge to the next value, nan if omitted",
+                    "type": "string",
+                    "enum": [
+                        "nan",
+                        "hold",
+                        "linear"
+                    ]
+                },
+                "reorder-depth": {
+                    "description": "Number of sync-packets held back to restore their order using the sequence number of the packets, 8 if omitted",
+                    "type": "integer",
+                    "minimum": 0
+                },
+                "preview": {
+                    "description": "Sample rates in Hz of decimated min, max and mean channels added for every sync-channel, e.g. [1000, 10]. The sample-rate must be a multiple of every rate.",
+                    "type": "array",
+                    "items": {
+                        "type": "integer",
+                        "minimum": 1
+                    }
                 }
             },
             "required": [
@@ -0,0 +1,90 @@
+#pragma once
+
+//
+#include "Types.h"
+#include "diagnostics/Metrics.h"
+#include "processing/SampleSink.h"
+#include "subscription/Subscription.h"
+
+//
+#include <optional>
+#include <vector>
+
+namespace plugin::mqtt::diagnostics
+{
+    /**
+     * @brief Writes the ingest metrics of subscriptions to async output channels in a fixed interval
+     * Rates and percentiles are computed over the interval, so a degrading stream shows up while processing
+     */
+    class DiagnosticChannels
+    {
+    public:
+        /**
+         * @brief The output channels of a single subscription, channels without a local id are skipped
+         */
+        struct Channels
+        {
+            LocalId messages_per_second;
+            LocalId bytes_per_second;
+            LocalId decode_failures_per_second;
+
+            // 99th percentile of the time spent decoding a payload in microseconds
+            LocalId decode_time;
+
+            // Resampled stream, sync subscriptions only
+            LocalId estimated_sample_rate;
+            LocalId nan_filled;
+            LocalId unrecoverable;
+            LocalId resyncs;
+        };
+
+        /**
+         * @brief Construct a new Diagnostic Channels object
+         * @param interval Interval between two samples in seconds
+         */
+        DiagnosticChannels(double interval = 1.0);
+
+        /**
+         * @brief Add a subscription to report
+         * @param subscription
+         * @param channels
+         */
+        void add(Subscription::Pointer subscription, Channels channels);
+
+        /**
+         * @brief Stop reporting a subscription
+         * @param subscription
+         */
+        void remove(const Subscription::Pointer &subscription);
+
+        /**
+         * @brief Check whether any subscription is reported
+         * @return true if at least one subscription has been added
+         */
+        bool empty() const;
+
+        /**
+         * @brief Restart measuring, the first interval begins with the next call to process
+         */
+        void reset();
+
+        /**
+         * @brief Write a sample to each output channel once the interval has elapsed
+         * @param sink
+         * @param now Current host time
+         */
+        void process(SampleSink &sink, const Timestamp &now);
+
+    private:
+        struct Entry
+        {
+            Subscription::Pointer subscription;
+            Channels channels;
+            TopicMetrics::Snapshot previous;
+        };
+
+        const double m_interval;
+        std::vector<Entry> m_entries;
+        std::optional<Timestamp> m_last;
+    };
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+//
+#include "resampling/Stream.h"
+
+//
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace plugin::mqtt::diagnostics
+{
+    /**
+     * @brief Lock-free histogram of durations using power-of-two buckets
+     * Bucket 0 counts durations below one microsecond, bucket n counts durations within [2^(n-1), 2^n) microseconds
+     */
+    class LatencyHistogram
+    {
+    public:
+        static constexpr std::size_t NUM_BUCKETS = 32;
+        using Buckets = std::array<std::uint64_t, NUM_BUCKETS>;
+
+        LatencyHistogram();
+
+        /**
+         * @brief Count a duration
+         * @param seconds
+         */
+        void record(double seconds);
+
+        /**
+         * @brief Get a copy of the current bucket counts
+         * @return Buckets
+         */
+        Buckets getBuckets() const;
+
+        /**
+         * @brief Estimate a percentile from bucket counts
+         * @param buckets
+         * @param p The percentile within [0, 1]
+         * @return double Upper bound of the bucket containing the percentile in seconds, 0 if no duration has been counted
+         */
+        static double percentile(const Buckets &buckets, double p);
+
+    private:
+        std::array<std::atomic<std::uint64_t>, NUM_BUCKETS> m_buckets;
+    };
+
+    /**
+     * @brief Ingest counters of a single subscribed topic
+     * Counters are updated by the MQTT-Thread and may be read from any thread without locking
+     */
+    class TopicMetrics
+    {
+    public:
+        struct Snapshot
+        {
+            std::uint64_t messages;
+            std::uint64_t bytes;
+            std::uint64_t decode_failures;
+            LatencyHistogram::Buckets decode_time;
+
+            // State of the resampled stream, sync subscriptions only
+            std::optional<Stream::Statistics> stream;
+        };
+
+        TopicMetrics();
+
+        /**
+         * @brief Count an arriving message
+         * @param bytes Size of the payload
+         */
+        void received(std::size_t bytes);
+
+        /**
+         * @brief Count a payload the decoders failed on
+         */
+        void decodeFailed();
+
+        /**
+         * @brief Record the time spent decoding a payload
+         * @param seconds
+         */
+        void decoded(double seconds);
+
+        /**
+         * @brief Update the state of the resampled stream
+         * @param statistics
+         */
+        void updateStream(const Stream::Statistics &statistics);
+
+        /**
+         * @brief Get a copy of all counters, counters updated meanwhile might be off by one message
+         * @return Snapshot
+         */
+        Snapshot getSnapshot() const;
+
+    private:
+        std::atomic<std::uint64_t> m_messages;
+        std::atomic<std::uint64_t> m_bytes;
+        std::atomic<std::uint64_t> m_decode_failures;
+        LatencyHistogram m_decode_time;
+
+        std::atomic<bool> m_has_stream;
+        std::atomic<int> m_stream_rate;
+        std::atomic<std::uint64_t> m_nan_filled;
+        std::atomic<bool> m_unrecoverable;
+        std::atomic<std::uint64_t> m_gap_filled;
+        std::atomic<std::uint64_t> m_resyncs;
+        std::atomic<std::uint64_t> m_reordered_packets;
+        std::atomic<std::uint64_t> m_dropped_packets;
+        std::atomic<std::uint64_t> m_lost_packets;
+        std::atomic<double> m_drift_ppm;
+    };
+
+    /**
+     * @brief Counters of a single publish handler
+     * Counters are updated by the processing and MQTT-Threads and may be read from any thread without locking
+     */
+    class PublishMetrics
+    {
+    public:
+        struct Snapshot
+        {
+            // Payloads waiting to be sent
+            std::uint64_t queued;
+
+            // Payloads dropped unsent as the queue exceeded its limit
+            std::uint64_t dropped;
+
+            // Payloads (and their bytes) handed to the transport
+            std::uint64_t payloads;
+            std::uint64_t bytes;
+
+            // Deliveries acknowledged by the broker or failed
+            std::uint64_t acknowledged;
+            std::uint64_t failed;
+            LatencyHistogram::Buckets ack_latency;
+        };
+
+        PublishMetrics();
+
+        /**
+         * @brief Update the number of payloads waiting to be sent
+         * @param queued
+         */
+        void setQueued(std::size_t queued);
+
+        /**
+         * @brief Count payloads dropped unsent as the queue exceeded its limit
+         * @param count
+         */
+        void dropped(std::size_t count);
+
+        /**
+         * @brief Count a payload handed to the transport
+         * @param bytes
+         */
+        void sent(std::size_t bytes);
+
+        /**
+         * @brief Count a payload acknowledged by the broker
+         * @param seconds Time between sending and acknowledge
+         */
+        void acknowledged(double seconds);
+
+        /**
+         * @brief Count a payload that could not be delivered
+         */
+        void failed();
+
+        /**
+         * @brief Get a copy of all counters
+         * @return Snapshot
+         */
+        Snapshot getSnapshot() const;
+
+    private:
+        std::atomic<std::uint64_t> m_queued;
+        std::atomic<std::uint64_t> m_dropped;
+        std::atomic<std::uint64_t> m_payloads;
+        std::atomic<std::uint64_t> m_bytes;
+        std::atomic<std::uint64_t> m_acknowledged;
+        std::atomic<std::uint64_t> m_failed;
+        LatencyHistogram m_ack_latency;
+    };
+}
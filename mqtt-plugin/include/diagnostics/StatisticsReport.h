@@ -0,0 +1,94 @@
+#pragma once
+
+//
+#include "Service.h"
+#include "diagnostics/Metrics.h"
+
+//
+#include "nlohmann/json.hpp"
+
+//
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace plugin::mqtt::diagnostics
+{
+    using nlohmann::json;
+
+    /**
+     * @brief JSON snapshot of the subscription and publish statistics of a Service
+     * The snapshot is built from lock-free counters and never blocks the MQTT or processing threads.
+     * Rates are computed over the time since the previous snapshot.
+     */
+    class StatisticsReport
+    {
+    public:
+        using Pointer = std::shared_ptr<StatisticsReport>;
+
+        /**
+         * @brief Construct a new Statistics Report object
+         * @param name Identifies the reported plugin instance
+         * @param service Must outlive the report
+         */
+        StatisticsReport(std::string name, Service &service);
+
+        /**
+         * @brief Get the name of the reported plugin instance
+         * @return const std::string&
+         */
+        const std::string &getName() const;
+
+        /**
+         * @brief Build a snapshot of all statistics
+         * @return json
+         */
+        json getSnapshot();
+
+        /**
+         * @brief Register a report to be included in getAllSnapshots, e.g. for each plugin instance
+         * @param report
+         */
+        static void add(Pointer report);
+
+        /**
+         * @brief Remove a registered report
+         * @param report
+         */
+        static void remove(const Pointer &report);
+
+        /**
+         * @brief Build snapshots of all registered reports
+         * @return json An array with one snapshot per report
+         */
+        static json getAllSnapshots();
+
+    private:
+        struct Counters
+        {
+            std::uint64_t messages;
+            std::uint64_t bytes;
+        };
+
+        /**
+         * @brief Compute message and byte rates of a topic since the previous snapshot and remember the counters
+         * @param previous
+         * @param topic
+         * @param current
+         * @param elapsed Seconds since the previous snapshot
+         * @return json
+         */
+        static json rates(std::map<std::string, Counters> &previous, const std::string &topic, Counters current, double elapsed);
+
+        const std::string m_name;
+        Service &m_service;
+
+        std::mutex m_mtx;
+        std::optional<std::chrono::steady_clock::time_point> m_last;
+        std::map<std::string, Counters> m_previous_subscriptions;
+        std::map<std::string, Counters> m_previous_publishers;
+    };
+}
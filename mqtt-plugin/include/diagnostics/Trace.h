@@ -0,0 +1,178 @@
+#pragma once
+
+//
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace plugin::mqtt::diagnostics
+{
+    /**
+     * @brief Low-overhead tracing of the path of messages and payloads through the plugin
+     * Tracepoints are written to a ring buffer owned by the calling thread, the oldest events are overwritten once
+     * a buffer is full. While tracing is disabled, a tracepoint costs a single atomic load.
+     * The collected events can be written to a file in the Chrome trace event format (chrome://tracing, Perfetto).
+     */
+    class Trace
+    {
+    public:
+        enum class Phase : char
+        {
+            // A span of time on the calling thread
+            Complete = 'X',
+
+            // A single point in time
+            Instant = 'i',
+
+            // Begin and end of an arrow linking events across threads, e.g. arrival and hand-off of a message
+            FlowBegin = 's',
+            FlowEnd = 'f'
+        };
+
+        struct Event
+        {
+            // Must point to a string literal, names are not copied
+            const char *name;
+            Phase phase;
+
+            // Steady clock in nanoseconds
+            std::uint64_t timestamp;
+            std::uint64_t duration;
+
+            // Correlates events of the same message or payload
+            std::uint64_t id;
+
+            // Event specific value, e.g. a sample time or number of samples
+            double value;
+
+            // Truncated label, e.g. the topic
+            char label[48];
+
+            // Index of the recording thread
+            std::uint32_t thread;
+        };
+
+        /**
+         * @brief Enable or disable all tracepoints
+         * @param enable
+         * @param capacity Number of events kept per thread, applies to threads tracing for the first time
+         */
+        static void enable(bool enable, std::size_t capacity = 65536);
+
+        /**
+         * @brief Start tracing on behalf of one of several users, e.g. plugin instances
+         * The first user clears the events of a previous trace and enables all tracepoints
+         * @param capacity Number of events kept per thread, applies to threads tracing for the first time
+         */
+        static void acquire(std::size_t capacity = 65536);
+
+        /**
+         * @brief Stop tracing on behalf of a user, tracepoints are disabled once the last user released them
+         * @return true if the last user released tracing, e.g. to write the trace
+         */
+        static bool release();
+
+        /**
+         * @brief Check whether tracepoints are recorded
+         * @return true if enabled
+         */
+        static bool isEnabled()
+        {
+            return s_enabled.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Get the current time of the trace clock
+         * @return std::uint64_t Nanoseconds
+         */
+        static std::uint64_t now();
+
+        /**
+         * @brief Get a unique id to correlate events
+         * @return std::uint64_t
+         */
+        static std::uint64_t nextId();
+
+        /**
+         * @brief Record a span of time, ignored if begin is zero (stamped while tracing was disabled)
+         * @param name
+         * @param begin As returned by now()
+         * @param end As returned by now()
+         * @param id
+         * @param label
+         * @param value
+         */
+        static void complete(const char *name, std::uint64_t begin, std::uint64_t end, std::uint64_t id = 0, const std::string &label = {}, double value = 0);
+
+        /**
+         * @brief Record a point in time
+         */
+        static void instant(const char *name, std::uint64_t timestamp, std::uint64_t id = 0, const std::string &label = {}, double value = 0);
+
+        /**
+         * @brief Record the begin or end of a flow, events of the same flow share name and id
+         */
+        static void flowBegin(const char *name, std::uint64_t timestamp, std::uint64_t id);
+        static void flowEnd(const char *name, std::uint64_t timestamp, std::uint64_t id);
+
+        /**
+         * @brief Get a copy of the events of all threads ordered by time
+         * The buffers of finished threads are released once their events have been collected
+         * @return std::vector<Event>
+         */
+        static std::vector<Event> collect();
+
+        /**
+         * @brief Discard the events of all threads, releasing the buffers of finished threads
+         */
+        static void clear();
+
+        /**
+         * @brief Write the events of all threads to a file in the Chrome trace event format
+         * @param path
+         */
+        static void writeChromeTrace(const std::string &path);
+
+    private:
+        class Buffer;
+        struct Registry;
+        static Registry &registry();
+        static void record(const char *name, Phase phase, std::uint64_t timestamp, std::uint64_t duration, std::uint64_t id, const std::string &label, double value);
+        static Buffer &threadBuffer();
+
+        static std::atomic<bool> s_enabled;
+    };
+
+    /**
+     * @brief Records a span of time from construction to destruction
+     */
+    class TraceScope
+    {
+    public:
+        TraceScope(const char *name, std::uint64_t id = 0, const std::string &label = {}, double value = 0)
+            : m_name(name), m_id(id), m_label(Trace::isEnabled() ? label : std::string()), m_value(value), m_begin(Trace::isEnabled() ? Trace::now() : 0)
+        {
+        }
+
+        ~TraceScope()
+        {
+            if (m_begin > 0 && Trace::isEnabled())
+            {
+                Trace::complete(m_name, m_begin, Trace::now(), m_id, m_label, m_value);
+            }
+        }
+
+        TraceScope(const TraceScope &) = delete;
+        TraceScope &operator=(const TraceScope &) = delete;
+
+    private:
+        const char *m_name;
+        std::uint64_t m_id;
+        std::string m_label;
+        double m_value;
+        std::uint64_t m_begin;
+    };
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+//
+#include "Service.h"
+#include "processing/SampleSink.h"
+#include "processing/SampleSource.h"
+
+//
+#include <cstdint>
+
+namespace plugin::mqtt
+{
+    /**
+     * @brief Moves samples between the Service and the host within a processing cycle
+     * Subscribed samples are written to a SampleSink, samples to publish are read from a SampleSource
+     */
+    class Processor
+    {
+    public:
+        Processor(Service &service);
+
+        /**
+         * @brief Process a single cycle, prevents the MQTT-Threads from manipulating any buffers meanwhile
+         * @param sink
+         * @param source
+         * @param master_ticks Current host time in ticks, used for async channels without new samples
+         */
+        void process(SampleSink &sink, SampleSource &source, std::uint64_t master_ticks);
+
+        /**
+         * @brief Write all samples received by the subscriptions to the sink
+         * @param sink
+         * @param master_ticks
+         */
+        void processSubscriptions(SampleSink &sink, std::uint64_t master_ticks);
+
+        /**
+         * @brief Read the input channels of all publish handlers and send out payloads
+         * @param source
+         */
+        void processPublishHandlers(SampleSource &source);
+
+    private:
+        Service &m_service;
+    };
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+//
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace plugin::mqtt
+{
+    /**
+     * @brief Receives the samples of subscribed topics, e.g. the Oxygen output channels
+     */
+    class SampleSink
+    {
+    public:
+        virtual ~SampleSink() = default;
+
+        /**
+         * @brief Add a single sample to an output channel
+         * @param local_channel_id
+         * @param ticks The timestamp in ticks of the output channel timebase
+         * @param value
+         */
+        virtual void addSample(std::uint32_t local_channel_id, std::uint64_t ticks, int value) = 0;
+        virtual void addSample(std::uint32_t local_channel_id, std::uint64_t ticks, double value) = 0;
+        virtual void addSample(std::uint32_t local_channel_id, std::uint64_t ticks, const std::string &value) = 0;
+
+        /**
+         * @brief Add a single sample to a vector output channel, the elements are written as one contiguous block
+         * @param local_channel_id
+         * @param ticks The timestamp in ticks of the output channel timebase
+         * @param value The elements of the sample, as many as the dimension of the channel
+         */
+        virtual void addSample(std::uint32_t local_channel_id, std::uint64_t ticks, const std::vector<double> &value) = 0;
+
+        /**
+         * @brief Add consecutive samples to a sync output channel
+         * @param local_channel_id
+         * @param ticks The timestamp of the first sample in ticks of the output channel timebase
+         * @param values
+         */
+        virtual void addSamples(std::uint32_t local_channel_id, std::uint64_t ticks, const std::vector<int> &values) = 0;
+        virtual void addSamples(std::uint32_t local_channel_id, std::uint64_t ticks, const std::vector<double> &values) = 0;
+    };
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+//
+#include "Types.h"
+
+//
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace plugin::mqtt
+{
+    /**
+     * @brief Provides the samples of the input channels selected for publishing within the current processing window
+     */
+    class SampleSource
+    {
+    public:
+        using AsyncCallback = std::function<void(double timestamp, const value_t &value)>;
+
+        virtual ~SampleSource() = default;
+
+        /**
+         * @brief Read all samples of a sync input channel within the current processing window
+         * @param channel_id
+         * @param values
+         * @param sample_rate
+         * @param timestamp Time of the first sample in seconds
+         * @return false if the channel is not available or not a sync channel
+         */
+        virtual bool readSync(std::uint64_t channel_id, std::vector<value_t> &values, double &sample_rate, double &timestamp) = 0;
+
+        /**
+         * @brief Read all samples of an async input channel within the current processing window
+         * @param channel_id
+         * @param callback Called for every sample with its time in seconds
+         * @return false if the channel is not available or not an async channel
+         */
+        virtual bool readAsync(std::uint64_t channel_id, const AsyncCallback &callback) = 0;
+    };
+}
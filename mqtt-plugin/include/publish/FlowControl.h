@@ -0,0 +1,111 @@
+#pragma once
+
+//
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace plugin::mqtt
+{
+    /**
+     * @brief Regulates how many payloads may be in flight towards the broker
+     * The congestion window grows additively for each delivery acknowledged in time and shrinks multiplicatively
+     * once deliveries fail or the acknowledge latency rises above the lowest latency seen (queueing at the broker or
+     * within the network). Deliveries are tracked per MQTT QoS level.
+     */
+    class FlowControl
+    {
+    public:
+        struct Statistics
+        {
+            // Smoothed acknowledge round-trip time in seconds, negative if unknown
+            double round_trip_time;
+
+            // Lowest acknowledge round-trip time in seconds since the connection has been established, negative if unknown
+            double min_round_trip_time;
+
+            // The current congestion window (number of payloads)
+            double window;
+
+            // Number of payloads awaiting an acknowledge, indexed by QoS level
+            std::array<std::size_t, 3> in_flight;
+
+            // Total number of acknowledged and failed deliveries
+            std::uint64_t acknowledged;
+            std::uint64_t failed;
+        };
+
+        /**
+         * @brief Construct a new Flow Control object
+         * @param max_window The maximum number of payloads in flight
+         * @param target_delay Tolerated queueing delay (acknowledge latency above the lowest latency seen) in seconds
+         */
+        FlowControl(std::size_t max_window = 65535, double target_delay = 0.1);
+
+        /**
+         * @brief Set the maximum number of payloads in flight, e.g. as configured for the MQTT client
+         * @param max_window
+         */
+        void setMaxWindow(std::size_t max_window);
+
+        /**
+         * @brief Check whether another payload may be sent
+         * @return true if the number of payloads in flight is below the congestion window
+         */
+        bool isOpen() const;
+
+        /**
+         * @brief Register a payload being sent
+         * @param qos
+         * @return std::uint64_t The generation to be passed on acknowledge or failure
+         */
+        std::uint64_t sent(int qos);
+
+        /**
+         * @brief Register a payload acknowledged by the broker
+         * @param generation As returned by sent
+         * @param qos
+         * @param round_trip_time Time between sending and acknowledge in seconds
+         */
+        void acknowledged(std::uint64_t generation, int qos, double round_trip_time);
+
+        /**
+         * @brief Register a failed delivery
+         * @param generation As returned by sent
+         * @param qos
+         */
+        void failed(std::uint64_t generation, int qos);
+
+        /**
+         * @brief Forget about all payloads in flight and restart with the initial window, e.g. if the connection has been lost
+         * Deliveries sent before the reset are not taken into account anymore
+         */
+        void reset();
+
+        /**
+         * @brief Get the current measurements
+         * @return Statistics
+         */
+        Statistics getStatistics() const;
+
+    private:
+        std::size_t inFlight() const;
+        void release(int qos);
+        void decrease();
+
+        mutable std::mutex m_mtx;
+        std::size_t m_max_window;
+        double m_target_delay;
+        double m_window;
+        double m_round_trip_time;
+        double m_min_round_trip_time;
+        std::array<std::size_t, 3> m_in_flight;
+        std::uint64_t m_acknowledged;
+        std::uint64_t m_failed;
+        std::uint64_t m_generation;
+
+        // Number of acknowledges to wait for after a decrease, the window is reduced at most once per window
+        std::size_t m_recovery;
+    };
+}
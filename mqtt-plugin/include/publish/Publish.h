@@ -2,6 +2,8 @@
 
 //
 #include "Types.h"
+#include "publish/encoding/Encoder.h"
+#include "diagnostics/Metrics.h"
 
 //
 #include "odkfw_properties.h"
@@ -11,8 +13,12 @@
 #include "nlohmann/json.hpp"
 
 //
+#include <atomic>
+#include <deque>
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 namespace plugin::mqtt
 {
@@ -21,12 +27,52 @@ namespace plugin::mqtt
     class Publish
     {
     public:
+        // Payloads kept by default, e.g. 100 seconds of packets published at 100 Hz
+        static constexpr std::size_t DEFAULT_MAX_QUEUED = 10000;
+
         struct Sampling
         {
             SamplingModes mode;
             int downsampling_factor;
         };
 
+        struct Payload
+        {
+            // The datatype of the published Oxygen channels
+            Datatype datatype;
+
+            // The packet size if publishing sync-channels
+            int packet_size;
+
+            // Names of bundled input channels, a single unnamed input channel if empty
+            std::vector<std::string> channels;
+
+            // How samples of bundled channels are arranged within a packet
+            ChannelLayout layout = ChannelLayout::Columnar;
+
+            // The encoding of published payloads
+            PayloadFormat format = PayloadFormat::TextJson;
+
+            // Partial packets are published once their samples span the given time in seconds
+            std::optional<double> max_latency;
+
+            // Size packets based on the broker acknowledge latency, packet_size becomes the minimum packet size
+            bool adaptive = false;
+
+            // Payloads kept while the broker can not keep up, the oldest ones are dropped beyond
+            std::size_t max_queued = DEFAULT_MAX_QUEUED;
+        };
+
+        /**
+         * An Oxygen input channel selected by the user, identified by its name within the payload
+         */
+        struct Input
+        {
+            std::string name;
+            std::shared_ptr<odk::framework::EditableChannelIDProperty> channel;
+        };
+        using Inputs = std::vector<Input>;
+
         using Pointer = std::shared_ptr<Publish>;
 
         /**
@@ -40,6 +86,16 @@ namespace plugin::mqtt
          */
         Publish(std::string topic, std::string uuid, Sampling sampling, Datatype datatype, int packet_size, int QoS);
 
+        /**
+         * @brief Construct a new Publish Handler bundling one or more Oxygen input channels
+         * @param topic
+         * @param uuid
+         * @param sampling
+         * @param payload
+         * @param QoS
+         */
+        Publish(std::string topic, std::string uuid, Sampling sampling, Payload payload, int QoS);
+
         /**
          * @brief Get the Uuid
          * @return std::string
@@ -59,17 +115,49 @@ namespace plugin::mqtt
         int getQoS() const;
 
         /**
-         * @brief Get the underlying Oxygen Input channel
+         * @brief Get the underlying Oxygen Input channel (the first one if several channels are bundled)
          * @return std::shared_ptr<odk::framework::EditableChannelIDProperty>
          */
         std::shared_ptr<odk::framework::EditableChannelIDProperty> getInputChannel() const;
 
+        /**
+         * @brief Get all Oxygen Input channels in payload order
+         * @return Inputs
+         */
+        const Inputs &getInputChannels() const;
+
         /**
          * @brief Get the Sampling Settings of this Publish Handler
          * @return Sampling
          */
         Sampling getSampling() const;
 
+        /**
+         * @brief Get the Payload Settings of this Publish Handler
+         * @return const Payload&
+         */
+        const Payload &getPayload() const;
+
+        /**
+         * @brief Report the time it took the broker to acknowledge a payload of this publish handler
+         * Used to size packets in adaptive mode, can be called from any thread
+         * @param seconds
+         */
+        void reportAckLatency(double seconds);
+
+        /**
+         * @brief Get the number of samples per packet currently used for sync-channels
+         * @param sample_rate sample rate of the published samples (respecting downsampling)
+         * @return std::size_t
+         */
+        std::size_t getPacketSize(double sample_rate) const;
+
+        /**
+         * @brief Get the counters of this publish handler, may be read from any thread
+         * @return diagnostics::PublishMetrics&
+         */
+        diagnostics::PublishMetrics &getMetrics();
+
         /**
          * @brief Discard all buffers and reset
          */
@@ -84,22 +172,25 @@ namespace plugin::mqtt
         template <typename T>
         void addAsyncSample(double timestamp, T value)
         {
-            json j;
-
-            j["sampling"] = "async";
-            j["timestamp"] = timestamp;
-            j["value"] = value;
-
-            auto str_rep = j.dump();
-            m_output_buffer.push_back(str_rep);
+            enqueue(m_encoder->encode(timestamp, value_t(value)));
         }
 
         /**
          * @brief Add Sync channels in order (as they are deliverd by Oxygen)
          * @param values
          * @param sample_rate
+         * @param timestamp Oxygen timestamp of the first sample in seconds
+         */
+        void addSyncSamples(std::vector<value_t> values, double sample_rate, double timestamp);
+
+        /**
+         * @brief Add Sync samples of all bundled channels (one vector per input channel, in payload order)
+         * All channels must share a common timebase, hence the same number of samples is expected for every channel
+         * @param channels
+         * @param sample_rate
+         * @param timestamp Oxygen timestamp of the first sample in seconds
          */
-        void addSyncSamples(std::vector<value_t> values, double sample_rate);
+        void addSyncChannels(std::vector<std::vector<value_t>> channels, double sample_rate, double timestamp);
 
         /**
          * @brief True if there is a payload to publish
@@ -115,19 +206,48 @@ namespace plugin::mqtt
         std::string pop();
 
     private:
+        /**
+         * @brief Add an encoded payload to the output buffer, dropping the oldest payloads beyond the limit
+         * @param payload
+         */
+        void enqueue(std::string payload);
+
+        /**
+         * @brief Encode a chunk of buffered samples, add it to the output buffer and remove it from the input buffers
+         * @param num_samples number of samples per channel
+         * @param sample_rate
+         */
+        void addSyncPacket(std::size_t num_samples, double sample_rate);
+
+        /**
+         * @brief Encode a chunk of buffered samples as a single sync payload
+         * @param num_samples number of samples per channel taken from the front of the input buffers
+         * @param sample_rate
+         * @return std::string
+         */
+        std::string encodeSyncPacket(std::size_t num_samples, double sample_rate);
+
         int m_qos;
         Datatype m_datatype;
         std::string m_topic;
         std::string m_uuid;
         Publish::Sampling m_sampling;
+        Publish::Payload m_payload;
+        std::shared_ptr<Encoder> m_encoder;
 
-        std::shared_ptr<odk::framework::EditableChannelIDProperty> m_input_channel;
-        std::vector<value_t> m_input_buffer;
-        std::vector<std::string> m_output_buffer;
+        Inputs m_inputs;
+        std::vector<std::vector<value_t>> m_input_buffers;
+        std::deque<std::string> m_output_buffer;
 
         // Helpers for sync-channels
         size_t m_next_idx;
         uint64_t m_packet_idx;
         int m_packet_size;
+        double m_last_timestamp;
+
+        // Smoothed acknowledge latency in seconds, negative until the first payload has been acknowledged
+        std::atomic<double> m_ack_latency;
+
+        diagnostics::PublishMetrics m_metrics;
     };
 }
@@ -0,0 +1,38 @@
+#pragma once
+#include "publish/encoding/Encoder.h"
+
+namespace plugin::mqtt
+{
+    class CborSyncEncoder : public Encoder
+    {
+    public:
+        CborSyncEncoder(Datatype d) : Encoder(d) {}
+
+        /**
+         * @brief Encode sync samples complying to the CBOR-Sync protocol. The timestamp of the last sample
+         * allows a subscriber (e.g. the cbor/json/sync decoder) to resample the stream
+         * @param packet
+         * @return std::string
+         */
+        std::string encode(const SyncPacket &packet) override
+        {
+            auto j = toJson(packet);
+            j["timestamp"] = packet.timestamp;
+
+            auto cbor = json::to_cbor(j);
+            return std::string(cbor.begin(), cbor.end());
+        }
+
+        /**
+         * @brief Encode an async sample as CBOR
+         * @param timestamp
+         * @param value
+         * @return std::string
+         */
+        std::string encode(double timestamp, const value_t &value) override
+        {
+            auto cbor = json::to_cbor(toJson(timestamp, value));
+            return std::string(cbor.begin(), cbor.end());
+        }
+    };
+}
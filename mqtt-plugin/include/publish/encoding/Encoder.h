@@ -0,0 +1,175 @@
+#pragma once
+
+#include "Types.h"
+
+//
+#include <string>
+#include <vector>
+#include <memory>
+
+//
+#include "nlohmann/json.hpp"
+
+namespace plugin::mqtt
+{
+    using nlohmann::json;
+
+    /**
+     * @brief Encode samples of one or more Oxygen channels as a payload
+     */
+    class Encoder
+    {
+    public:
+        /**
+         * A packet of sync samples shared by all bundled channels
+         */
+        struct SyncPacket
+        {
+            // Running index of the packet
+            std::uint64_t idx;
+
+            // Sample rate of the published samples (respecting downsampling)
+            double sample_rate;
+
+            // Oxygen timestamp of the last sample within the packet in seconds
+            double timestamp;
+
+            // Names of bundled channels, empty if a single channel is published
+            std::vector<std::string> channels;
+
+            // How samples of bundled channels are arranged
+            ChannelLayout layout;
+
+            // One vector of samples per channel
+            std::vector<std::vector<value_t>> data;
+        };
+
+        Encoder(Datatype d) : m_datatype(d) {}
+        virtual ~Encoder() = default;
+
+        /**
+         * @brief Encode a packet of sync samples
+         * @param packet
+         * @return std::string
+         */
+        virtual std::string encode(const SyncPacket &packet) = 0;
+
+        /**
+         * @brief Encode a single async sample
+         * @param timestamp Oxygen timestamp of the sample in seconds
+         * @param value
+         * @return std::string
+         */
+        virtual std::string encode(double timestamp, const value_t &value) = 0;
+
+        /**
+         * @brief Get the Datatype
+         * @return Datatype
+         */
+        Datatype getDatatype() { return m_datatype; }
+
+    protected:
+        /**
+         * @brief Get the JSON representation of a sync packet, shared by all encoders
+         * @param packet
+         * @return json
+         */
+        json toJson(const SyncPacket &packet)
+        {
+            json j;
+            j["sampling"] = "sync";
+            j["idx"] = packet.idx;
+            j["data"] = json::array();
+            j["sample-rate"] = packet.sample_rate;
+            auto &arr = j["data"];
+
+            if (packet.channels.empty())
+            {
+                // A single channel is published as a plain array of samples
+                for (const auto &sample : packet.data.front())
+                {
+                    append(arr, sample);
+                }
+            }
+            else
+            {
+                j["channels"] = packet.channels;
+
+                switch (packet.layout)
+                {
+                case ChannelLayout::Columnar:
+                {
+                    j["layout"] = "columnar";
+                    for (const auto &channel : packet.data)
+                    {
+                        auto column = json::array();
+                        for (const auto &sample : channel)
+                        {
+                            append(column, sample);
+                        }
+                        arr.push_back(std::move(column));
+                    }
+                }
+                break;
+                case ChannelLayout::Interleaved:
+                {
+                    j["layout"] = "interleaved";
+                    const auto num_samples = packet.data.front().size();
+                    for (std::size_t n = 0; n < num_samples; ++n)
+                    {
+                        for (const auto &channel : packet.data)
+                        {
+                            append(arr, channel[n]);
+                        }
+                    }
+                }
+                break;
+                }
+            }
+
+            return j;
+        }
+
+        /**
+         * @brief Get the JSON representation of an async sample, shared by all encoders
+         * @param timestamp
+         * @param value
+         * @return json
+         */
+        json toJson(double timestamp, const value_t &value)
+        {
+            json j;
+            j["sampling"] = "async";
+            j["timestamp"] = timestamp;
+            std::visit([&j](auto &&v)
+                       { j["value"] = v; },
+                       value);
+
+            return j;
+        }
+
+    private:
+        void append(json &arr, const value_t &sample)
+        {
+            switch (m_datatype)
+            {
+            case Datatype::Integer:
+            {
+                const auto out_value = std::get<int>(sample);
+                arr.insert(arr.end(), out_value);
+            }
+            break;
+            case Datatype::Number:
+            {
+                const auto out_value = std::get<double>(sample);
+                arr.insert(arr.end(), out_value);
+            }
+            break;
+            default:
+                throw std::invalid_argument("Datatype can not be published as sync samples.");
+            }
+        }
+
+        Datatype m_datatype;
+    };
+}
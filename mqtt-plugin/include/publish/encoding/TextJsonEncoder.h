@@ -0,0 +1,32 @@
+#pragma once
+#include "publish/encoding/Encoder.h"
+
+namespace plugin::mqtt
+{
+    class TextJsonEncoder : public Encoder
+    {
+    public:
+        TextJsonEncoder(Datatype d) : Encoder(d) {}
+
+        /**
+         * @brief Encode sync samples as an ASCII JSON document, e.g. {"sampling": "sync", "idx": 0, "sample-rate": 100.0, "data": [1, 2, 3]}
+         * @param packet
+         * @return std::string
+         */
+        std::string encode(const SyncPacket &packet) override
+        {
+            return toJson(packet).dump();
+        }
+
+        /**
+         * @brief Encode an async sample as an ASCII JSON document, e.g. {"sampling": "async", "timestamp": 0.25, "value": 1.25}
+         * @param timestamp
+         * @param value
+         * @return std::string
+         */
+        std::string encode(double timestamp, const value_t &value) override
+        {
+            return toJson(timestamp, value).dump();
+        }
+    };
+}
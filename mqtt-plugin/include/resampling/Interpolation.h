@@ -0,0 +1,145 @@
+#pragma once
+
+//
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace plugin::mqtt::interpolation
+{
+    /**
+     * @brief Implementation used to resample the streams
+     *
+     * The batched kernel computes the positions and interpolates in blocks, using AVX2 if the plugin has been built
+     * with MQTT_PLUGIN_AVX2. Both kernels produce bit-identical samples, the reference kernel is kept to verify this.
+     */
+    enum class Kernel
+    {
+        Reference,
+        Batched
+    };
+
+    /**
+     * @brief Properties of a sample type: the type interpolation is computed in and the value filling gaps
+     */
+    template <typename T>
+    struct SampleTraits
+    {
+        // float carries int16_t exactly, int32_t needs double
+        using Promoted = std::conditional_t<std::is_same_v<T, std::int16_t> || std::is_same_v<T, float>, float, double>;
+
+        static T invalid()
+        {
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                return std::numeric_limits<T>::quiet_NaN();
+            }
+            else
+            {
+                return 0;
+            }
+        }
+
+        static T narrow(Promoted value)
+        {
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                return static_cast<T>(value);
+            }
+            else
+            {
+                const auto rounded = std::round(value);
+                const auto clamped = std::clamp<Promoted>(rounded, std::numeric_limits<T>::lowest(), std::numeric_limits<T>::max());
+                return static_cast<T>(clamped);
+            }
+        }
+    };
+
+    /**
+     * @brief Linear Interpolation function, computed in the promoted type of the samples
+     */
+    template <typename T>
+    inline T lerp(T a, T b, typename SampleTraits<T>::Promoted t)
+    {
+        using Promoted = typename SampleTraits<T>::Promoted;
+        const auto pa = static_cast<Promoted>(a);
+        return SampleTraits<T>::narrow(pa + (static_cast<Promoted>(b) - pa) * t);
+    }
+
+    class InputVectorLabels
+    {
+    public:
+        InputVectorLabels(double start, double end, std::size_t size)
+            : m_start(start),
+              m_scale(static_cast<double>(size) / (end - start)) // precompute the index scaling
+        {
+        }
+
+        inline double indexOfTime(double time) const
+        {
+            return m_scale * (time - m_start);
+        }
+
+        double getStart() const
+        {
+            return m_start;
+        }
+
+        double getScale() const
+        {
+            return m_scale;
+        }
+
+    private:
+        double m_start;
+        double m_scale;
+    };
+
+    /**
+     * @brief Positions of output samples within the input samples, shared by all channels of a stream
+     * Stored as separate arrays to be loaded in blocks.
+     */
+    struct Positions
+    {
+        std::vector<std::int32_t> idx;
+        std::vector<double> t;
+
+        std::size_t size() const
+        {
+            return idx.size();
+        }
+    };
+
+    /**
+     * @brief Compute the positions of output samples within the input samples
+     * Stops at the first output sample not enclosed by two input samples.
+     * @param kernel
+     * @param output Positions, cleared before
+     * @param x_start Sample count of the first output sample
+     * @param x_samplerate Sample rate of the output samples
+     * @param num Maximum number of output samples
+     * @param fp_time Timestamps of the input samples
+     * @param fp_size Number of input samples
+     * @return std::size_t Number of positions computed
+     */
+    std::size_t positions(Kernel kernel, Positions &output, std::uint64_t x_start, double x_samplerate, std::size_t num, const InputVectorLabels &fp_time, std::size_t fp_size);
+
+    /**
+     * @brief Compute linearly interpolated output samples and append them to the vector
+     * @param kernel
+     * @param output
+     * @param positions Computed by positions()
+     * @param fp Input samples
+     */
+    template <typename T>
+    void interp(Kernel kernel, std::vector<T> &output, const Positions &positions, const std::vector<T> &fp);
+
+    // Interpolated in native type, see Interpolation.cpp
+    extern template void interp<std::int16_t>(Kernel, std::vector<std::int16_t> &, const Positions &, const std::vector<std::int16_t> &);
+    extern template void interp<std::int32_t>(Kernel, std::vector<std::int32_t> &, const Positions &, const std::vector<std::int32_t> &);
+    extern template void interp<float>(Kernel, std::vector<float> &, const Positions &, const std::vector<float> &);
+    extern template void interp<double>(Kernel, std::vector<double> &, const Positions &, const std::vector<double> &);
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "resampling/Stream.h"
+
+//
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace plugin::mqtt
+{
+    /**
+     * @brief Decimates a resampled stream to fixed lower rates, reporting the minimum, maximum and mean of every
+     * block of samples
+     *
+     * The previews are computed incrementally while the stream is decoded, a block might span several packets.
+     * NaN samples and the samples filled as invalid by the stream (e.g. aligning the start of a stream, 0 for integer
+     * samples) are ignored, a block without any valid sample is NaN.
+     * Displaying long time spans of a high-rate stream only reads the previews instead of the full-rate samples.
+     */
+    class Preview
+    {
+    public:
+        using Pointer = std::shared_ptr<Preview>;
+
+        enum class Statistic
+        {
+            Min,
+            Max,
+            Mean
+        };
+
+        static constexpr std::array<Statistic, 3> STATISTICS = {Statistic::Min, Statistic::Max, Statistic::Mean};
+
+        /**
+         * @brief Construct a new Preview object
+         * @param sample_rate Sample rate of the resampled stream
+         * @param rates Sample rates of the previews, the sample rate must be a multiple of each
+         */
+        Preview(int sample_rate, std::vector<int> rates);
+
+        /**
+         * @brief Drop all previews and the partial blocks
+         */
+        void reset();
+
+        /**
+         * @brief Add resampled samples of the stream
+         * @param samples
+         * @param gaps The samples filled as invalid by the stream, see BasicStream::getAndClearSamples
+         */
+        template <typename T>
+        void append(const std::vector<T> &samples, const StreamBase::Gaps &gaps = {});
+
+        /**
+         * @brief Skip samples not written by the stream (e.g. an outage), the samples are ignored like invalid samples
+         * Blocks entirely within the skipped samples are not completed, the following blocks continue at their position.
+         * @param num Number of samples
+         */
+        void skip(std::uint64_t num);
+
+        /**
+         * @brief Get the completed preview samples of a rate and clear them
+         * Preview samples separated by skipped blocks are taken one contiguous run at a time.
+         * @param level Index of the rate
+         * @param statistic
+         * @return std::vector<double>
+         */
+        std::vector<double> getAndClearSamples(std::size_t level, Statistic statistic);
+
+        /**
+         * @brief Get the position of the next preview sample taken, counted in preview samples of the rate
+         * @param level Index of the rate
+         * @param statistic
+         * @return std::uint64_t
+         */
+        std::uint64_t getPosition(std::size_t level, Statistic statistic) const;
+
+        /**
+         * @brief Get the sample rates of the previews
+         * @return const std::vector<int>&
+         */
+        const std::vector<int> &getRates() const;
+
+    private:
+        /**
+         * @brief Contiguous completed preview samples
+         */
+        struct Run
+        {
+            std::uint64_t position;
+            std::vector<double> samples;
+        };
+
+        /**
+         * @brief The preview of a single rate
+         */
+        struct Level
+        {
+            // Number of stream samples per preview sample
+            std::size_t factor;
+
+            // The block in progress and its position
+            std::uint64_t position;
+            std::size_t count;
+            std::size_t valid;
+            double min;
+            double max;
+            double sum;
+
+            // Completed preview samples per statistic
+            std::array<std::deque<Run>, 3> output;
+        };
+
+        /**
+         * @brief Complete the block in progress and start the next one
+         * @param level
+         */
+        static void complete(Level &level);
+
+        /**
+         * @brief Start an empty block
+         * @param level
+         */
+        static void begin(Level &level);
+
+        std::vector<int> m_rates;
+        std::vector<Level> m_levels;
+    };
+
+    // Previews of the sample types of resampled streams, see Preview.cpp
+    extern template void Preview::append<std::int16_t>(const std::vector<std::int16_t> &, const StreamBase::Gaps &);
+    extern template void Preview::append<std::int32_t>(const std::vector<std::int32_t> &, const StreamBase::Gaps &);
+    extern template void Preview::append<float>(const std::vector<float> &, const StreamBase::Gaps &);
+    extern template void Preview::append<double>(const std::vector<double> &, const StreamBase::Gaps &);
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+//
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace plugin::mqtt
+{
+    /**
+     * @brief Bounded buffer restoring the order of packets carrying a sequence number
+     *
+     * Packets arriving out of order are held back until the missing packets arrive. Once more than <depth>
+     * packets are waiting, the missing packets are considered lost. Packets arriving twice (e.g. MQTT QoS 1)
+     * or after their successors have been released are dropped. This allows streaming with QoS 0 or 1
+     * instead of requiring exactly-once, in-order delivery.
+     */
+    template <typename Packet>
+    class ReorderBuffer
+    {
+    public:
+        // Packets further behind are considered a restart of the sequence (e.g. the publisher restarted)
+        static constexpr std::uint64_t RESTART_WINDOW = 1024;
+
+        /**
+         * @brief A packet released in order
+         */
+        struct Released
+        {
+            // Number of packets lost right before this packet
+            std::uint64_t lost;
+
+            // The sequence restarted with this packet, e.g. after an outage of the publisher
+            bool restarted;
+            Packet packet;
+        };
+
+        struct Statistics
+        {
+            // Packets which arrived after one of their successors
+            std::uint64_t reordered;
+
+            // Packets dropped as they arrived twice or too late
+            std::uint64_t dropped;
+
+            // Packets considered lost
+            std::uint64_t lost;
+
+            // Number of times the sequence restarted
+            std::uint64_t restarts;
+        };
+
+        /**
+         * @brief Construct a new Reorder Buffer object
+         * @param depth Maximum number of packets held back waiting for a missing packet
+         */
+        explicit ReorderBuffer(std::size_t depth) : m_depth(depth),
+                                                    m_restarted(false),
+                                                    m_statistics{0, 0, 0, 0}
+        {
+        }
+
+        /**
+         * @brief Forget all waiting packets and the expected sequence number
+         */
+        void reset()
+        {
+            m_next.reset();
+            m_pending.clear();
+            m_restarted = false;
+            m_statistics = {0, 0, 0, 0};
+        }
+
+        /**
+         * @brief Add an arriving packet
+         * @param idx Sequence number of the packet
+         * @param packet
+         * @return std::vector<Released> Packets released in order, might be empty
+         */
+        std::vector<Released> push(std::uint64_t idx, Packet packet)
+        {
+            std::vector<Released> released;
+
+            if (m_next && idx < m_next.value())
+            {
+                const auto behind = m_next.value() - idx;
+                const bool restarted = behind > RESTART_WINDOW || (idx == 0 && behind > m_depth + 1);
+                if (!restarted)
+                {
+                    m_statistics.dropped++;
+                    return released;
+                }
+
+                // Release all waiting packets of the previous sequence
+                while (!m_pending.empty())
+                {
+                    releaseFront(released);
+                }
+                m_next.reset();
+                m_restarted = true;
+                m_statistics.restarts++;
+            }
+
+            if (!m_next)
+            {
+                m_next = idx;
+            }
+
+            if (!m_pending.emplace(idx, std::move(packet)).second)
+            {
+                m_statistics.dropped++;
+                return released;
+            }
+
+            if (idx == m_next.value() && m_pending.size() > 1)
+            {
+                m_statistics.reordered++;
+            }
+
+            releaseConsecutive(released);
+
+            // Too many packets waiting, the missing ones are lost
+            while (m_pending.size() > m_depth)
+            {
+                releaseFront(released);
+                releaseConsecutive(released);
+            }
+
+            return released;
+        }
+
+        /**
+         * @brief Get the number of packets held back
+         * @return std::size_t
+         */
+        std::size_t size() const
+        {
+            return m_pending.size();
+        }
+
+        /**
+         * @brief Get the counters of the buffer
+         * @return Statistics
+         */
+        Statistics getStatistics() const
+        {
+            return m_statistics;
+        }
+
+    private:
+        /**
+         * @brief Release the waiting packets following the last released one
+         */
+        void releaseConsecutive(std::vector<Released> &released)
+        {
+            while (!m_pending.empty() && m_pending.begin()->first == m_next.value())
+            {
+                releaseFront(released);
+            }
+        }
+
+        /**
+         * @brief Release the oldest waiting packet, all packets before it are lost
+         */
+        void releaseFront(std::vector<Released> &released)
+        {
+            auto it = m_pending.begin();
+            const auto lost = it->first - m_next.value();
+
+            m_statistics.lost += lost;
+            released.push_back({lost, m_restarted, std::move(it->second)});
+            m_restarted = false;
+
+            m_next = it->first + 1;
+            m_pending.erase(it);
+        }
+
+        const std::size_t m_depth;
+        std::optional<std::uint64_t> m_next;
+
+        // The next packet released is the first of a restarted sequence
+        bool m_restarted;
+        std::map<std::uint64_t, Packet> m_pending;
+        Statistics m_statistics;
+    };
+}
@@ -1,17 +1,122 @@
 #pragma once
 
+#include "resampling/Interpolation.h"
 #include "resampling/StreamClock.h"
+#include "Types.h"
 
 //
+#include <cstdint>
 #include <optional>
 #include <vector>
 
 namespace plugin::mqtt
 {
-    class Stream
+    /**
+     * @brief Types shared by the streams of all sample types
+     */
+    class StreamBase
     {
     public:
-        Stream(StreamClock::Pointer clock, int nominal_sampling_rate);
+        // An outage of this length or more re-anchors the stream or marks it unrecoverable (see Recovery)
+        static constexpr double MAX_OUTAGE_SECONDS = 20.0;
+
+        struct Statistics
+        {
+            // The estimated sampling rate of the incoming stream, once sufficient data has been received
+            std::optional<int> estimated_sampling_rate;
+
+            // Number of NaN samples inserted to align the stream or to replace lost packets
+            std::uint64_t nan_filled;
+
+            // Whether the stream lost its integrity and further packets are discarded
+            bool unrecoverable;
+
+            // Deviation of the estimated from the nominal sampling rate in parts per million
+            std::optional<double> drift_ppm;
+
+            // Number of samples inserted to replace lost packets, using the gap-fill policy
+            std::uint64_t gap_filled;
+
+            // Number of times the stream has been re-anchored on the stream clock
+            std::uint64_t resyncs;
+
+            // Packets reordered, dropped (duplicates or too late) and lost according to their sequence number
+            std::uint64_t reordered_packets;
+            std::uint64_t dropped_packets;
+            std::uint64_t lost_packets;
+        };
+
+        /**
+         * @brief How the stream handles lost packets and outages
+         */
+        struct Recovery
+        {
+            // Re-anchor the stream on the stream clock instead of marking it unrecoverable
+            bool resync;
+
+            // Samples inserted for packets lost within a running stream
+            GapFill gap_fill;
+        };
+
+        /**
+         * @brief State learned by a stream, used to seed the stream of the next acquisition
+         */
+        struct WarmStart
+        {
+            // The estimated interval between two samples of the source in seconds
+            double sampling_interval;
+
+            // The size of the packets of the source
+            std::size_t packet_size;
+        };
+
+        /**
+         * @brief A run of samples filled as invalid by the stream (NaN, or 0 for integer samples)
+         */
+        struct Gap
+        {
+            // Index of the first filled sample within the samples taken from the stream
+            std::size_t offset;
+
+            // Number of filled samples
+            std::size_t count;
+        };
+
+        using Gaps = std::vector<Gap>;
+    };
+
+    /**
+     * @brief A resampled stream of one or more channels sharing a common sample clock (e.g. of a single ADC)
+     * The sampling rate is estimated and the resampling positions are computed once for all channels.
+     *
+     * Samples are stored and resampled in their native type T (int16_t, int32_t, float or double), preserving raw
+     * ADC counts. Interpolation is computed in float for int16_t and float, in double for int32_t and double, and
+     * rounded back to integer samples. Integer samples can not represent NaN, gaps are filled with 0 instead.
+     */
+    template <typename T>
+    class BasicStream : public StreamBase
+    {
+    public:
+        using Sample = T;
+
+        // One vector of samples per channel
+        using Channels = std::vector<std::vector<T>>;
+
+        /**
+         * @brief Construct a new Stream object, the stream becomes unrecoverable once it lost its integrity
+         * @param clock
+         * @param nominal_sampling_rate
+         */
+        BasicStream(StreamClock::Pointer clock, int nominal_sampling_rate);
+
+        /**
+         * @brief Construct a new Stream object
+         * @param clock
+         * @param nominal_sampling_rate
+         * @param recovery
+         * @param num_channels Number of channels sharing the sample clock
+         */
+        BasicStream(StreamClock::Pointer clock, int nominal_sampling_rate, Recovery recovery, std::size_t num_channels = 1);
 
         /**
          * @brief Reset the stream handler and its resampler
@@ -28,7 +133,17 @@ namespace plugin::mqtt
          * the incoming timestamp with the stream clock (which can be global to sync multiple stream sources).
          *
          * If packets are lost (stream looses integrity), the handler will try to recover the stream
-         * by inserting the missing amount of samples as NaN
+         * by inserting the missing amount of samples according to the gap-fill policy (NaN by default).
+         *
+         * Packets might vary in size (e.g. partial packets published to bound the latency), the sampling rate
+         * is estimated per sample.
+         *
+         * A timestamp going backwards or an outage of 20 seconds or more either marks
+         * the stream unrecoverable or, if resync is enabled, re-anchors the stream on the stream clock:
+         * the outage is filled with NaN and the stream continues with the new packet. An outage longer than
+         * MAX_OUTAGE_SECONDS is not filled once all samples written before have been taken, the output continues
+         * at the current tick instead (see getPosition). A timestamp jumping backwards or ahead of the current
+         * Oxygen time is mapped onto the current Oxygen time instead.
          *
          * The underlying network protocol is responsible to ensure that packets are delivered exactly once
          * and that the packet transmission is kept in the correct order (e.g. MQTT QoS 2). The Resampler
@@ -37,8 +152,24 @@ namespace plugin::mqtt
          * @param samples
          * @param incoming_ts timestamp of the last sample in seconds (should be part of the protocol)
          * @param local_tick the current oxygen target tick (respecting the correct sampling rate!)
+         * @param lost_packets number of packets lost before this packet if known from a sequence number,
+         * otherwise lost packets are estimated based on the timestamps. Time missing beyond the lost packets
+         * (e.g. an outage) is filled with NaN instead of the gap-fill policy.
+         * @param restarted the sequence restarted with this packet (e.g. the publisher restarted), any time
+         * missing before it is filled with NaN
          */
-        void append(std::vector<double> samples, double incoming_ts_seconds, std::uint64_t base_ticks, double base_frequency);
+        void append(std::vector<T> samples, double incoming_ts_seconds, std::uint64_t base_ticks, double base_frequency, std::optional<std::uint64_t> lost_packets = std::nullopt, bool restarted = false);
+
+        /**
+         * @brief Append and resample a packet of all channels, see append
+         * @param channels The samples of every channel, all channels must contain the same number of samples
+         * @param incoming_ts_seconds timestamp of the last sample in seconds
+         * @param base_ticks
+         * @param base_frequency
+         * @param lost_packets
+         * @param restarted
+         */
+        void appendChannels(Channels channels, double incoming_ts_seconds, std::uint64_t base_ticks, double base_frequency, std::optional<std::uint64_t> lost_packets = std::nullopt, bool restarted = false);
 
         /**
          * @brief Get the estimated sampling rate once the stream has received sufficient data
@@ -48,9 +179,64 @@ namespace plugin::mqtt
 
         /**
          * @brief Get the And Clear buffered (resampled) samples aligned with Oxygen Stream
-         * @return std::vector<double>
+         * @return std::vector<T>
+         */
+        std::vector<T> getAndClearSamples();
+
+        /**
+         * @brief Get and clear the buffered (resampled) samples of a single channel
+         * @param channel
+         * @return std::vector<T>
          */
-        std::vector<double> getAndClearSamples();
+        std::vector<T> getAndClearSamples(std::size_t channel);
+
+        /**
+         * @brief Get and clear the buffered (resampled) samples of a single channel and the samples filled as invalid
+         * Integer samples can not be told apart from the 0 filling them, e.g. to ignore them in a preview.
+         * @param channel
+         * @param gaps Receives the runs of samples filled as invalid, in order
+         * @return std::vector<T>
+         */
+        std::vector<T> getAndClearSamples(std::size_t channel, Gaps &gaps);
+
+        /**
+         * @brief Get the number of channels
+         * @return std::size_t
+         */
+        std::size_t getNumChannels() const;
+
+        /**
+         * @brief Get the tick of the first buffered sample at the nominal sampling rate, counted from the start of
+         * the stream. The buffered samples are contiguous, skipping an outage moves the position ahead.
+         * @return std::uint64_t
+         */
+        std::uint64_t getPosition() const;
+
+        /**
+         * @brief Get the current state of the stream, e.g. for diagnostics
+         * @return Statistics
+         */
+        Statistics getStatistics() const;
+
+        /**
+         * @brief Seed the sampling rate estimate of the stream, kept when resetting the stream
+         * The seed is used instead of the nominal sampling rate if the first packet matches its packet size and its
+         * sampling interval is within the tolerated drift.
+         * @param warm_start
+         */
+        void setWarmStart(std::optional<WarmStart> warm_start);
+
+        /**
+         * @brief Get the sampling interval and packet size estimated from the received packets
+         * @return std::optional<WarmStart> empty until the sampling rate has been estimated
+         */
+        std::optional<WarmStart> getWarmStart() const;
+
+        /**
+         * @brief Select the implementation used to resample, e.g. the reference kernel to verify the batched one
+         * @param kernel
+         */
+        void setKernel(interpolation::Kernel kernel);
 
     private:
         /**
@@ -60,25 +246,79 @@ namespace plugin::mqtt
 
         /**
          * @brief Begin a stream (manage first packet)
-         * @param samples The samples of the packet
+         * @param channels The samples of the packet
+         * @param incoming_ts_seconds The timestamp of the last sample in the packet
+         */
+        void beginStream(const Channels &channels, double incoming_ts_seconds);
+
+        /**
+         * @brief Re-anchor the stream on the stream clock after it lost its integrity, or throw if not enabled
+         * @param reason The error thrown if the stream can not be resynchronised
+         * @param channels The samples of the packet
          * @param incoming_ts_seconds The timestamp of the last sample in the packet
+         * @param base_ticks The current Oxygen tick, used if the clock of the publisher has been reset
+         * @param base_frequency
          */
-        void beginStream(std::vector<double> &samples, double incoming_ts_seconds);
+        void resync(const char *reason, const Channels &channels, double incoming_ts_seconds, std::uint64_t base_ticks, double base_frequency);
+
+        /**
+         * @brief Write the samples of a packet aligned with the stream clock, the gap to the previous
+         * samples is filled with NaN (0 for integer samples) or skipped if longer than MAX_OUTAGE_SECONDS,
+         * samples overlapping the previous ones are dropped
+         * @param channels The samples of the packet
+         * @param incoming_ts_seconds The timestamp of the last sample in the packet
+         */
+        void anchor(const Channels &channels, double incoming_ts_seconds);
+
+        /**
+         * @brief Replace the samples of lost packets according to the gap-fill policy
+         * @param num Number of samples lost
+         * @param next The samples received after the gap
+         */
+        void fillGap(std::size_t num, const Channels &next);
+
+        /**
+         * @brief Fill the output buffer of a channel with invalid samples and record them as a gap
+         * @param channel
+         * @param num Number of samples
+         */
+        void fillInvalid(std::size_t channel, std::size_t num);
 
         StreamClock::Pointer m_clock;
 
         const int m_nominal_sampling_rate;
         const double m_nominal_sampling_interval;
+        const Recovery m_recovery;
         bool m_unrecoverable;
 
         std::optional<double> m_estimated_sampling_interval;
         std::optional<int> m_estimated_sampling_rate;
+        // The size of the packet the stream has been anchored with, packets might vary in size
         size_t m_nominal_packet_size;
         std::uint64_t m_actual_scnt;
         std::uint64_t m_packet_received_counter;
         double m_previous_aligned_ts_seconds;
+        std::uint64_t m_nan_filled;
+        std::uint64_t m_gap_filled;
+        std::uint64_t m_resyncs;
+        std::optional<WarmStart> m_warm_start;
+        interpolation::Kernel m_kernel;
 
-        std::vector<double> m_output_buffer;
-        std::vector<double> m_input_buffer;
+        // The last sample written per channel, used to fill gaps
+        std::vector<T> m_last_values;
+
+        Channels m_output_buffers;
+        Channels m_input_buffers;
+
+        // The samples filled as invalid per output buffer
+        std::vector<Gaps> m_output_gaps;
     };
+
+    // Resampled in native type, see Stream.cpp
+    extern template class BasicStream<std::int16_t>;
+    extern template class BasicStream<std::int32_t>;
+    extern template class BasicStream<float>;
+    extern template class BasicStream<double>;
+
+    using Stream = BasicStream<double>;
 }
\ No newline at end of file
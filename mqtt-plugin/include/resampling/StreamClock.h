@@ -2,18 +2,95 @@
 
 //
 #include <ctype.h>
+#include <cstdint>
 #include <memory>
+#include <mutex>
+#include <optional>
 
 namespace plugin::mqtt
 {
+    /**
+     * @brief Coordinates the sources of a clock domain, e.g. devices synchronised by PTP
+     * The first source starting a stream sets the common start of the domain: the source time mapped onto the
+     * current Oxygen time. All other sources map their timestamps using the same start, hence samples taken at the
+     * same time get the same sample index. The start is kept as long as any source is streaming.
+     */
+    class ClockDomain
+    {
+    public:
+        using Pointer = std::shared_ptr<ClockDomain>;
+
+        /**
+         * @brief The source time mapped onto the Oxygen time
+         */
+        struct Start
+        {
+            std::int64_t offset_ns;
+            std::uint64_t base_ticks;
+            std::uint64_t base_frequency;
+        };
+
+        /**
+         * @brief Join the domain, the proposed start becomes the common start if no source is streaming
+         * @param proposed
+         * @return Start The common start of the domain
+         */
+        Start join(const Start &proposed);
+
+        /**
+         * @brief Leave the domain, the common start is dropped once the last source left
+         */
+        void leave();
+
+        /**
+         * @brief Get the common start
+         * @return std::optional<Start> empty if no source is streaming
+         */
+        std::optional<Start> getStart() const;
+
+        /**
+         * @brief Get the number of sources streaming
+         * @return std::size_t
+         */
+        std::size_t getSourceCount() const;
+
+    private:
+        mutable std::mutex m_mtx;
+        std::optional<Start> m_start;
+        std::size_t m_sources = 0;
+    };
+
+    /**
+     * @brief Maps the timestamps of a stream onto the Oxygen time
+     * Timestamps are converted to integer nanoseconds once, all further clock math is done in integer arithmetic
+     * (using 128 bit intermediates), hence streams sharing a clock are aligned identically even after days.
+     *
+     * Every source (stream) of a clock domain uses its own StreamClock joining the domain. A source whose clock has
+     * been reset is re-anchored by an offset relative to the domain, without moving the other sources.
+     */
     class StreamClock
     {
     public:
         using Pointer = std::shared_ptr<StreamClock>;
+
+        /**
+         * @brief Construct a stream clock of a single source
+         */
         StreamClock();
 
         /**
-         * @brief Set the Start Of Stream
+         * @brief Construct a stream clock of a source within a clock domain
+         * @param domain
+         */
+        explicit StreamClock(ClockDomain::Pointer domain);
+
+        ~StreamClock();
+
+        StreamClock(const StreamClock &) = delete;
+        StreamClock &operator=(const StreamClock &) = delete;
+
+        /**
+         * @brief Set the Start Of Stream, joining the common start if another source of the domain is streaming
          * @param incoming_ts_seconds timestamp of last sample in seconds
          * @param base_ticks Oxygen base ticks when first packet of stream arrived
          * @param base_frequency Oxygen base frequency
@@ -21,7 +98,16 @@ namespace plugin::mqtt
         void setStartOfStream(double incoming_ts_seconds, std::uint64_t base_ticks, double base_frequency);
 
         /**
-         * @brief Reset start of stream
+         * @brief Map a timestamp onto the current Oxygen time, e.g. after the clock of the source has been reset
+         * Only the offset of this source relative to its domain changes, other sources are not affected
+         * @param incoming_ts_seconds timestamp of last sample in seconds
+         * @param base_ticks the current Oxygen base ticks
+         * @param base_frequency Oxygen base frequency
+         */
+        void reanchor(double incoming_ts_seconds, std::uint64_t base_ticks, double base_frequency);
+
+        /**
+         * @brief Reset start of stream, leaving the clock domain
          */
         void resetSartOfStream();
 
@@ -36,14 +122,13 @@ namespace plugin::mqtt
          * @brief Align the incoming timestamp in seconds with the Oxygen time in samples since acquistion start
          * @param incoming_ts_seconds timestamp of last sample in seconds
          * @param sample_rate sample rate of stream
-         * @return std::uint64_t samples since start of Oxygen time in given sample rate
+         * @return std::uint64_t samples since start of Oxygen time in given sample rate, rounded to the nearest sample
          */
         std::uint64_t alignSamples(double incoming_ts_seconds, int sample_rate);
 
         /**
          * @brief Align the incoming timestamp in seconds with the Oxygen time in seconds since acquisition start
          * @param incoming_ts_seconds
-         * @param sample_rate
          * @return double seconds since start of Oxygen time
          */
         double alignSeconds(double incoming_ts_seconds);
@@ -56,11 +141,37 @@ namespace plugin::mqtt
          */
         bool validTimestamp(double incoming_ts_seconds);
 
+        /**
+         * @brief Get the offset of this source relative to its clock domain
+         * @return std::int64_t nanoseconds added to the timestamps of this source, 0 unless re-anchored
+         */
+        std::int64_t getSourceOffsetNanoseconds() const;
+
+        /**
+         * @brief Convert a timestamp in seconds to integer nanoseconds
+         * @param seconds
+         * @return std::int64_t
+         */
+        static std::int64_t toNanoseconds(double seconds);
+
+        /**
+         * @brief Compute a * b / c rounded down, using a 128 bit intermediate
+         * @param a
+         * @param b
+         * @param c
+         * @return std::uint64_t
+         */
+        static std::uint64_t mulDiv(std::uint64_t a, std::uint64_t b, std::uint64_t c);
+
     private:
+        /**
+         * @brief Get the nanoseconds since the start of the domain, negative for timestamps before the start
+         */
+        std::int64_t domainNanoseconds(double incoming_ts_seconds) const;
+
+        ClockDomain::Pointer m_domain;
         bool m_set;
-        double m_stream_offset;
-        std::uint64_t m_base_ticks;
-        double m_base_frequency;
-        double m_base_seconds;
+        ClockDomain::Start m_start;
+        std::int64_t m_source_offset_ns;
     };
 }
@@ -6,6 +6,7 @@
 
 //
 #include <memory>
+#include <optional>
 #include <vector>
 
 //
@@ -36,6 +37,12 @@ namespace plugin::mqtt
 
             // Channel range
             Range range;
+
+            // Sync channels sampled at another rate than their subscription, e.g. previews
+            std::optional<double> sample_rate;
+
+            // Number of elements of a sample of a vector channel (e.g. the bins of a spectrum), empty for scalar channels
+            std::optional<std::size_t> dimension;
         };
 
         using Pointer = std::shared_ptr<Channel>;
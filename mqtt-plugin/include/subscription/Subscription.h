@@ -6,11 +6,13 @@
 #include <functional>
 #include <string>
 #include <optional>
+#include <atomic>
 
 //
 #include "Types.h"
 #include "subscription/Channel.h"
 #include "subscription/decoding/Decoder.h"
+#include "diagnostics/Metrics.h"
 
 //
 #include "mqtt/message.h"
@@ -86,10 +88,43 @@ namespace plugin::mqtt
          */
         int getQoS();
 
+        /**
+         * @brief Mark whether the channels of this subscription are in use, only active subscriptions receive payloads
+         * @param active
+         */
+        void setActive(bool active);
+
+        /**
+         * @brief Check whether the channels of this subscription are in use
+         * @return true if the topic should be subscribed while processing
+         */
+        bool isActive() const;
+
+        /**
+         * @brief Get the ingest counters of this subscription, may be read from any thread
+         * @return diagnostics::TopicMetrics&
+         */
+        diagnostics::TopicMetrics &getMetrics();
+
+        /**
+         * @brief Remember a traced message until its samples are handed to Oxygen
+         * @param id The trace id of the message
+         */
+        void addTraceId(std::uint64_t id);
+
+        /**
+         * @brief Get and clear the trace ids of all messages interpreted since the last call
+         * @return std::vector<std::uint64_t>
+         */
+        std::vector<std::uint64_t> takeTraceIds();
+
     private:
         Channels m_channels;
         Sampling m_sampling;
         std::string m_topic;
         int m_qos;
+        std::atomic<bool> m_active;
+        diagnostics::TopicMetrics m_metrics;
+        std::vector<std::uint64_t> m_trace_ids;
     };
 }
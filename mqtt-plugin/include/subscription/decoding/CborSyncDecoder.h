@@ -1,5 +1,6 @@
 #pragma once
 #include "subscription/decoding/Decoder.h"
+#include "resampling/ReorderBuffer.h"
 #include "resampling/Stream.h"
 #include "resampling/StreamClock.h"
 
@@ -7,14 +8,53 @@
 #include "nlohmann/json.hpp"
 
 //
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace plugin::mqtt
 {
-    class CborSyncDecoder : public Decoder
+    /**
+     * @brief Decoder of the cbor/json/sync protocol, samples are decoded and resampled in their native type T
+     * (int16_t, int32_t, float or double). Integer channels require an integer sample type.
+     */
+    template <typename T>
+    class BasicCborSyncDecoder : public Decoder
     {
     public:
-        CborSyncDecoder(Datatype d, int nominal_sample_rate, StreamClock::Pointer clock);
+        using Stream = BasicStream<T>;
+
+        // Packets held back to restore the order of packets carrying a sequence number ("idx")
+        static constexpr std::size_t DEFAULT_REORDER_DEPTH = 8;
+
+        BasicCborSyncDecoder(Datatype d, int nominal_sample_rate, StreamClock::Pointer clock);
+
+        /**
+         * @brief Construct a new Cbor Sync Decoder object
+         * @param d
+         * @param nominal_sample_rate
+         * @param clock
+         * @param recovery How the resampled stream handles lost packets and outages
+         * @param reorder_depth Maximum number of packets held back waiting for a missing packet
+         */
+        BasicCborSyncDecoder(Datatype d, int nominal_sample_rate, StreamClock::Pointer clock, StreamBase::Recovery recovery, std::size_t reorder_depth);
+
+        /**
+         * @brief Create the decoders of a frame carrying several channels sampled by a common clock (e.g. a single ADC)
+         * All channels share one resampled stream. The first decoder decodes and resamples all channels of a payload,
+         * the other decoders take their samples from it, hence all decoders must be called in order for every payload.
+         * @param d
+         * @param nominal_sample_rate
+         * @param clock
+         * @param recovery
+         * @param reorder_depth
+         * @param channels Names of the channels, located by the channel names of the frame or by their position
+         * @return std::vector<std::shared_ptr<BasicCborSyncDecoder>> One decoder per channel
+         */
+        static std::vector<std::shared_ptr<BasicCborSyncDecoder>> createFrameDecoders(Datatype d, int nominal_sample_rate, StreamClock::Pointer clock, StreamBase::Recovery recovery, std::size_t reorder_depth, std::vector<std::string> channels);
+
         void prepareProcessing() override;
 
         /**
@@ -26,9 +66,117 @@ namespace plugin::mqtt
          */
         Sample getValue(const Timestamp &start, const Timestamp &timestamp, const std::string &payload) override;
 
+        /**
+         * @brief Get the state of the resampled stream
+         * @return std::optional<StreamBase::Statistics>
+         */
+        std::optional<StreamBase::Statistics> getStreamStatistics() const override;
+
+        /**
+         * @brief Get the state learned by the stream shared by all channels of the frame
+         * @return std::optional<StreamBase::WarmStart>
+         */
+        std::optional<StreamBase::WarmStart> getWarmStart() const override;
+
+        /**
+         * @brief Seed the stream shared by all channels of the frame
+         * @param warm_start
+         */
+        void setWarmStart(const StreamBase::WarmStart &warm_start) override;
+
+        /**
+         * @brief Compute a preview of the resampled samples of this channel
+         * @param preview
+         */
+        void setPreview(Preview::Pointer preview) override;
+
     private:
+        /**
+         * @brief A packet waiting in the reorder buffer
+         */
+        struct Packet
+        {
+            typename Stream::Channels channels;
+            double timestamp;
+            std::uint64_t base_ticks;
+            double base_frequency;
+        };
+
+        /**
+         * @brief Resampled samples of a channel and the samples filled as invalid by the stream
+         */
+        struct Decoded
+        {
+            // Tick of the first sample, see BasicStream::getPosition
+            std::uint64_t position;
+            std::vector<T> samples;
+            StreamBase::Gaps gaps;
+        };
+
+        /**
+         * @brief The state shared by the decoders of all channels of a frame
+         */
+        struct Frame
+        {
+            Frame(int nominal_sample_rate, StreamClock::Pointer clock, StreamBase::Recovery recovery, std::size_t reorder_depth, std::vector<std::string> channels);
+
+            /**
+             * @brief Get the samples of all channels from a payload
+             * @param j
+             * @return Stream::Channels
+             */
+            typename Stream::Channels extract(const json &j) const;
+
+            /**
+             * @brief Take the samples resampled by the stream, samples following an outage skipped by the stream
+             * are queued separately
+             */
+            void take();
+
+            // Names of the channels, empty if the topic carries a single channel
+            std::vector<std::string> names;
+
+            Stream stream;
+            ReorderBuffer<Packet> reorder;
+
+            // Resampled samples per channel, waiting to be taken by the decoder of the channel.
+            // Usually a single entry, the samples following a skipped outage are taken with the next payload.
+            std::vector<std::deque<Decoded>> decoded;
+        };
+
+        BasicCborSyncDecoder(Datatype d, int nominal_sample_rate, std::shared_ptr<Frame> frame, std::size_t channel);
+
+        /**
+         * @brief Decode and resample all channels of a payload
+         * @param timestamp
+         * @param payload
+         */
+        void decodeFrame(const Timestamp &timestamp, const std::string &payload);
+
         int m_nominal_sample_rate;
         std::uint64_t m_timestamp;
-        std::shared_ptr<Stream> m_stream;
+        std::shared_ptr<Frame> m_frame;
+        std::size_t m_channel;
+        Preview::Pointer m_preview;
     };
-}
+
+    extern template class BasicCborSyncDecoder<std::int16_t>;
+    extern template class BasicCborSyncDecoder<std::int32_t>;
+    extern template class BasicCborSyncDecoder<float>;
+    extern template class BasicCborSyncDecoder<double>;
+
+    using CborSyncDecoder = BasicCborSyncDecoder<double>;
+
+    /**
+     * @brief Create the decoders of a sync topic for the configured sample type
+     * @param type Native type of the samples
+     * @param d
+     * @param nominal_sample_rate
+     * @param clock
+     * @param recovery
+     * @param reorder_depth
+     * @param channels Names of the channels of a frame, empty if the topic carries a single channel
+     * @return std::vector<std::shared_ptr<Decoder>> One decoder per channel
+     */
+    std::vector<std::shared_ptr<Decoder>> createCborSyncDecoders(SampleType type, Datatype d, int nominal_sample_rate, StreamClock::Pointer clock, StreamBase::Recovery recovery, std::size_t reorder_depth, std::vector<std::string> channels);
+}
\ No newline at end of file
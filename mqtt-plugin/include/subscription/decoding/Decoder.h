@@ -1,11 +1,14 @@
 #pragma once
 
 #include "Types.h"
+#include "resampling/Preview.h"
+#include "resampling/Stream.h"
 
 //
 #include <string>
 #include <variant>
 #include <memory>
+#include <optional>
 
 namespace plugin::mqtt
 {
@@ -40,6 +43,30 @@ namespace plugin::mqtt
          */
         virtual void stopProcessing(){};
 
+        /**
+         * @brief Get the state of the resampled stream, only available for sync decoders
+         * @return std::optional<Stream::Statistics>
+         */
+        virtual std::optional<Stream::Statistics> getStreamStatistics() const { return std::nullopt; }
+
+        /**
+         * @brief Get the state learned by the resampled stream, only available for sync decoders
+         * @return std::optional<StreamBase::WarmStart>
+         */
+        virtual std::optional<StreamBase::WarmStart> getWarmStart() const { return std::nullopt; }
+
+        /**
+         * @brief Seed the resampled stream with the state of a previous acquisition, ignored by async decoders
+         * @param warm_start
+         */
+        virtual void setWarmStart(const StreamBase::WarmStart &) {}
+
+        /**
+         * @brief Compute a preview of the decoded samples, ignored by async decoders
+         * @param preview
+         */
+        virtual void setPreview(Preview::Pointer) {}
+
     private:
         Datatype m_datatype;
     };
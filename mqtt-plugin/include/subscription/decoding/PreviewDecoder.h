@@ -0,0 +1,46 @@
+#pragma once
+#include "subscription/decoding/Decoder.h"
+#include "resampling/Preview.h"
+
+//
+#include <cstdint>
+
+namespace plugin::mqtt
+{
+    /**
+     * @brief Decodes a statistic of a preview of a resampled stream (e.g. the minimum at 10 Hz)
+     * The preview is computed by the decoder of the resampled stream, hence this decoder must be called after it.
+     */
+    class PreviewDecoder : public Decoder
+    {
+    public:
+        PreviewDecoder(Preview::Pointer preview, std::size_t level, Preview::Statistic statistic) : Decoder(Datatype::Number),
+                                                                                                     m_preview(std::move(preview)),
+                                                                                                     m_level(level),
+                                                                                                     m_statistic(statistic)
+        {
+        }
+
+        /**
+         * @brief Take the preview samples completed by the payload, the payload has been decoded by the stream
+         * @param start
+         * @param timestamp
+         * @param payload
+         * @return Sample
+         */
+        Sample getValue(const Timestamp &, const Timestamp &, const std::string &) override
+        {
+            // Positioned by the preview, outages skipped by the stream are not filled
+            const auto position = m_preview->getPosition(m_level, m_statistic);
+            auto preview = m_preview->getAndClearSamples(m_level, m_statistic);
+            std::vector<value_t> samples(preview.begin(), preview.end());
+
+            return Sample(std::move(samples), Timestamp(position, m_preview->getRates().at(m_level)));
+        }
+
+    private:
+        Preview::Pointer m_preview;
+        const std::size_t m_level;
+        const Preview::Statistic m_statistic;
+    };
+}
@@ -3,8 +3,14 @@
 #include "subscription/decoding/Decoder.h"
 
 //
+#include "fmt/core.h"
 #include "nlohmann/json.hpp"
 
+//
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
 namespace plugin::mqtt
 {
     using nlohmann::json;
@@ -14,6 +20,13 @@ namespace plugin::mqtt
     public:
         TextJsonDecoder(json::json_pointer schema, Datatype d) : Decoder(d), m_schema(schema) {}
 
+        /**
+         * @brief Construct a decoder of a vector channel, a sample is an array of numbers (e.g. the bins of a spectrum)
+         * @param schema
+         * @param dimension Number of elements of the array
+         */
+        TextJsonDecoder(json::json_pointer schema, std::size_t dimension) : Decoder(Datatype::Number), m_schema(schema), m_dimension(dimension) {}
+
         /**
          * @brief Interpret the given payload (e.g. topic: /my/channel/{payload} where payload is an ASCII decoded json-object, e.g. {"key": 1.25})
          * This implementation uses a JSON-Pointer which is derived from the given config-file (schema-parameter)
@@ -23,6 +36,11 @@ namespace plugin::mqtt
         Sample getValue(const Timestamp &start, const Timestamp &timestamp, const std::string &payload) override
         {
             auto j = json::parse(payload);
+            if (m_dimension)
+            {
+                return Sample(getArray(j), timestamp);
+            }
+
             switch (getDatatype())
             {
             case Datatype::Integer:
@@ -37,6 +55,29 @@ namespace plugin::mqtt
         }
 
     private:
+        /**
+         * @brief Copy an array of the payload into a single sample
+         * @param j
+         * @return std::vector<double>
+         */
+        std::vector<double> getArray(const json &j) const
+        {
+            const auto &array = j.at(m_schema);
+            if (!array.is_array() || array.size() != m_dimension.value())
+            {
+                throw std::invalid_argument(fmt::format("Expected an array of {} numbers.", m_dimension.value()));
+            }
+
+            std::vector<double> values;
+            values.reserve(array.size());
+            for (const auto &element : array)
+            {
+                values.push_back(element.get<double>());
+            }
+            return values;
+        }
+
         json::json_pointer m_schema;
+        std::optional<std::size_t> m_dimension;
     };
 }
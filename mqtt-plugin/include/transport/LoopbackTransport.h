@@ -0,0 +1,100 @@
+#pragma once
+
+//
+#include "transport/Transport.h"
+
+//
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace plugin::mqtt
+{
+    /**
+     * @brief In-process transport without a broker
+     * Published payloads are recorded and looped back to subscribed topics, messages can be injected at a controlled
+     * rate. Allows deterministic tests and benchmarks of the ingest and publish path.
+     */
+    class LoopbackTransport : public Transport
+    {
+    public:
+        using Generator = std::function<const_message_ptr(std::size_t index)>;
+
+        struct Injection
+        {
+            // Number of messages injected
+            std::size_t injected;
+
+            // Number of messages delivered to a subscribed topic
+            std::size_t delivered;
+
+            // Time spent injecting in seconds
+            double duration;
+        };
+
+        LoopbackTransport() = default;
+
+        void setCallbacks(Callbacks callbacks) override;
+        void connect() override;
+        void disconnect() override;
+        bool isConnected() const override;
+        void subscribe(const std::string &topic, int qos) override;
+        void unsubscribe(const std::string &topic) override;
+
+        /**
+         * @brief Record a payload, payloads of subscribed topics are delivered by deliverPending
+         * Deliveries are completed immediately
+         */
+        void publish(const std::string &topic, const std::string &payload, int qos, DeliveryCallback on_delivery) override;
+
+        /**
+         * @brief Deliver a message as if it has been received from a broker
+         * @param msg
+         * @return true if the topic is subscribed and the message has been delivered
+         */
+        bool inject(const_message_ptr msg);
+
+        /**
+         * @brief Inject generated messages at a given rate, blocks until all messages have been injected
+         * @param count Number of messages
+         * @param rate Messages per second, inject as fast as possible if not positive
+         * @param generator Creates the message with the given index
+         * @return Injection
+         */
+        Injection inject(std::size_t count, double rate, const Generator &generator);
+
+        /**
+         * @brief Deliver payloads published to subscribed topics
+         * Delivery is deferred as the publishing side usually holds locks required by the subscribing side
+         * @return std::size_t Number of delivered messages
+         */
+        std::size_t deliverPending();
+
+        /**
+         * @brief Simulate a lost connection, the connection_lost callback is called
+         * @param cause
+         */
+        void loseConnection(const std::string &cause);
+
+        /**
+         * @brief Get and clear all payloads published so far
+         * @return std::vector<const_message_ptr>
+         */
+        std::vector<const_message_ptr> takePublished();
+
+        /**
+         * @brief Get the QoS of all subscribed topics
+         * @return std::map<std::string, int>
+         */
+        std::map<std::string, int> getSubscriptions() const;
+
+    private:
+        mutable std::mutex m_mtx;
+        Callbacks m_callbacks;
+        bool m_connected = false;
+        std::map<std::string, int> m_subscriptions;
+        std::vector<const_message_ptr> m_published;
+        std::deque<const_message_ptr> m_pending;
+    };
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+//
+#include "transport/Transport.h"
+#include "configuration/Server.h"
+
+//
+#include "mqtt/async_client.h"
+
+namespace plugin::mqtt
+{
+    /**
+     * @brief Transport to a MQTT broker using the paho async client
+     */
+    class PahoTransport : public Transport, public virtual callback
+    {
+    public:
+        PahoTransport(config::Server::Pointer server);
+        ~PahoTransport();
+
+        void setCallbacks(Callbacks callbacks) override;
+        void connect() override;
+        void disconnect() override;
+        bool isConnected() const override;
+        void subscribe(const std::string &topic, int qos) override;
+        void unsubscribe(const std::string &topic) override;
+        void publish(const std::string &topic, const std::string &payload, int qos, DeliveryCallback on_delivery) override;
+
+    private:
+        void connected(const std::string &cause) override;
+        void connection_lost(const std::string &cause) override;
+        void message_arrived(const_message_ptr msg) override;
+
+        config::Server::Pointer m_server;
+        std::unique_ptr<async_client> m_client;
+        connect_options m_options;
+        Callbacks m_callbacks;
+    };
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+//
+#include "transport/Transport.h"
+#include "configuration/Server.h"
+#include "publish/FlowControl.h"
+
+//
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace plugin::mqtt
+{
+    class SharedTransport;
+
+    /**
+     * @brief A single broker connection shared by several transports, e.g. of several plugin instances
+     * Subscriptions are reference counted: a topic is subscribed at the broker once the first transport subscribes
+     * to it and unsubscribed once the last one unsubscribed. Arriving messages are dispatched to all transports
+     * subscribed to their topic. The connection is established once the first transport connects and closed once
+     * the last one disconnected. Payloads of all transports are regulated by a single flow control.
+     */
+    class SharedConnection
+    {
+    public:
+        using Pointer = std::shared_ptr<SharedConnection>;
+
+        /**
+         * @brief Construct a new Shared Connection object
+         * @param transport The connection to the broker, owned by the shared connection
+         * @param flow_control Regulates the payloads in flight of all transports, e.g. limited to the max-inflight of the client
+         */
+        SharedConnection(Transport::Pointer transport, std::shared_ptr<FlowControl> flow_control = std::make_shared<FlowControl>());
+        ~SharedConnection();
+
+        SharedConnection(const SharedConnection &) = delete;
+        SharedConnection &operator=(const SharedConnection &) = delete;
+
+        /**
+         * @brief Attach a transport and connect to the broker if not yet connected
+         * @param session
+         */
+        void attach(const std::shared_ptr<SharedTransport> &session);
+
+        /**
+         * @brief Detach a transport, its topics are unsubscribed unless subscribed by other transports
+         * The broker is asked after releasing the lock, messages are still dispatched to the other transports meanwhile.
+         * Throws if a topic could not be unsubscribed, the transport is detached nevertheless.
+         * @param session
+         */
+        void detach(const SharedTransport *session);
+
+        /**
+         * @brief Check whether a transport is attached and the broker is connected
+         * @param session
+         * @return true if connected
+         */
+        bool isConnected(const SharedTransport *session) const;
+
+        /**
+         * @brief Subscribe a transport to a topic, the broker is only asked if no other transport subscribed to it
+         * A higher QoS than requested before subscribes the topic again
+         * @param session
+         * @param topic
+         * @param qos
+         */
+        void subscribe(const SharedTransport *session, const std::string &topic, int qos);
+
+        /**
+         * @brief Unsubscribe a transport from a topic, the broker is only asked if it has been the last subscriber
+         * @param session
+         * @param topic
+         */
+        void unsubscribe(const SharedTransport *session, const std::string &topic);
+
+        /**
+         * @brief Publish a payload using the shared connection
+         */
+        void publish(const std::string &topic, const std::string &payload, int qos, Transport::DeliveryCallback on_delivery);
+
+        /**
+         * @brief Get the number of attached transports
+         * @return std::size_t
+         */
+        std::size_t getSessionCount() const;
+
+        /**
+         * @brief Get the flow control shared by all attached transports
+         * @return std::shared_ptr<FlowControl>
+         */
+        std::shared_ptr<FlowControl> getFlowControl() const;
+
+    private:
+        struct Session
+        {
+            std::weak_ptr<SharedTransport> transport;
+            std::set<std::string> topics;
+        };
+
+        struct Subscription
+        {
+            std::size_t count;
+            int qos;
+        };
+
+        void connected(const std::string &cause);
+        void connection_lost(const std::string &cause);
+        void message_arrived(const_message_ptr msg);
+
+        /**
+         * @brief Get the attached transports, optionally only those subscribed to a topic
+         * Callbacks are called without holding the lock, as they acquire the locks of their services.
+         * A transport returned might be detached meanwhile, its callbacks are only called through dispatch.
+         * @param topic
+         * @return std::vector<std::shared_ptr<SharedTransport>>
+         */
+        std::vector<std::shared_ptr<SharedTransport>> getSessions(const std::string *topic = nullptr) const;
+
+        /**
+         * @brief Drop a topic of a session, requires the lock to be held
+         * @param topic
+         * @return true if no other session is subscribed and the topic must be unsubscribed at the broker
+         */
+        bool release(const std::string &topic);
+
+        Transport::Pointer m_transport;
+        std::shared_ptr<FlowControl> m_flow_control;
+
+        // Serializes the requests to the broker, so a topic released by one transport is not unsubscribed after
+        // another transport subscribed to it again. Never held while dispatching.
+        std::mutex m_broker_mtx;
+        mutable std::mutex m_mtx;
+        std::map<const SharedTransport *, Session> m_sessions;
+        std::map<std::string, Subscription> m_subscriptions;
+    };
+
+    /**
+     * @brief Transport of a single Service using a shared connection
+     */
+    class SharedTransport : public Transport, public std::enable_shared_from_this<SharedTransport>
+    {
+    public:
+        SharedTransport(SharedConnection::Pointer connection);
+        ~SharedTransport();
+
+        void setCallbacks(Callbacks callbacks) override;
+        void connect() override;
+        void disconnect() override;
+        bool isConnected() const override;
+        void subscribe(const std::string &topic, int qos) override;
+        void unsubscribe(const std::string &topic) override;
+        void publish(const std::string &topic, const std::string &payload, int qos, DeliveryCallback on_delivery) override;
+        std::shared_ptr<FlowControl> getFlowControl() const override;
+
+        /**
+         * @brief Get the shared connection
+         * @return SharedConnection::Pointer
+         */
+        SharedConnection::Pointer getConnection() const;
+
+    private:
+        friend class SharedConnection;
+
+        /**
+         * @brief Call the callbacks of the transport unless it has been disconnected, called by the shared connection
+         * Disconnecting waits until all calls in flight returned, so the callbacks never outlive their service
+         * @param call
+         */
+        void dispatch(const std::function<void(const Callbacks &callbacks)> &call);
+
+        /**
+         * @brief Stop dispatching and wait until the callbacks in flight returned
+         * Callbacks disconnecting their own transport are not waited for
+         */
+        void stopDispatching();
+
+        SharedConnection::Pointer m_connection;
+        mutable std::mutex m_mtx;
+        std::condition_variable m_idle;
+        Callbacks m_callbacks;
+        bool m_attached = false;
+        std::size_t m_dispatching = 0;
+    };
+
+    /**
+     * @brief Process-wide registry of shared broker connections, keyed by server url, credentials and connection options
+     * Connections are closed once all transports using them have been released. Server configurations differing in
+     * their connection options (e.g. max-inflight) use separate connections, so the options of each are applied.
+     */
+    class ConnectionRegistry
+    {
+    public:
+        // Creates the connection to the broker, e.g. a PahoTransport
+        using Factory = std::function<Transport::Pointer(config::Server::Pointer server)>;
+
+        /**
+         * @brief Get a transport to the broker of a server configuration
+         * The connection is shared with all other transports to the same broker using the same credentials and options
+         * @param server
+         * @param factory Called if no connection to the broker exists yet
+         * @return Transport::Pointer
+         */
+        static Transport::Pointer acquire(config::Server::Pointer server, const Factory &factory);
+
+        /**
+         * @brief Get the number of open shared connections
+         * @return std::size_t
+         */
+        static std::size_t getConnectionCount();
+
+    private:
+        struct Registry;
+        static Registry &registry();
+        static std::string getKey(const config::Server &server);
+    };
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+//
+#include <functional>
+#include <memory>
+#include <string>
+
+//
+#include "mqtt/message.h"
+
+namespace plugin::mqtt
+{
+    using namespace ::mqtt;
+
+    class FlowControl;
+
+    /**
+     * @brief Connection to a broker used by the Service to subscribe and publish
+     * Implementations throw std::exception derived errors if a request could not be issued
+     */
+    class Transport
+    {
+    public:
+        using Pointer = std::shared_ptr<Transport>;
+
+        struct Callbacks
+        {
+            // The connection has been (re)established
+            std::function<void(const std::string &cause)> connected;
+
+            // The connection has been lost, implementations might reconnect automatically
+            std::function<void(const std::string &cause)> connection_lost;
+
+            // A message of a subscribed topic arrived
+            std::function<void(const_message_ptr msg)> message_arrived;
+        };
+
+        // Called once a published payload has been delivered (true) or failed to be delivered (false)
+        using DeliveryCallback = std::function<void(bool delivered)>;
+
+        virtual ~Transport() = default;
+
+        /**
+         * @brief Install the callbacks, must be called before connecting
+         * @param callbacks
+         */
+        virtual void setCallbacks(Callbacks callbacks) = 0;
+
+        /**
+         * @brief Establish a connection to the broker, the connected callback is called once established
+         */
+        virtual void connect() = 0;
+
+        /**
+         * @brief Close the connection, no callbacks are called afterwards
+         */
+        virtual void disconnect() = 0;
+
+        /**
+         * @brief Check whether the connection is established
+         * @return true if connected
+         */
+        virtual bool isConnected() const = 0;
+
+        /**
+         * @brief Subscribe to a topic
+         * @param topic
+         * @param qos
+         */
+        virtual void subscribe(const std::string &topic, int qos) = 0;
+
+        /**
+         * @brief Unsubscribe from a topic
+         * @param topic
+         */
+        virtual void unsubscribe(const std::string &topic) = 0;
+
+        /**
+         * @brief Publish a payload
+         * @param topic
+         * @param payload
+         * @param qos
+         * @param on_delivery Called once the delivery completed, might be called before returning
+         */
+        virtual void publish(const std::string &topic, const std::string &payload, int qos, DeliveryCallback on_delivery) = 0;
+
+        /**
+         * @brief Get the flow control of a connection shared by several services
+         * The payloads of all services count towards the same window, so they never exceed the limit of the client
+         * @return std::shared_ptr<FlowControl> null if each service regulates its own payloads
+         */
+        virtual std::shared_ptr<FlowControl> getFlowControl() const
+        {
+            return nullptr;
+        }
+    };
+}
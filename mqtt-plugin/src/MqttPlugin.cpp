@@ -1,5 +1,11 @@
 #include "configuration/Configuration.h"
+#include "configuration/StreamStates.h"
 #include "Service.h"
+#include "transport/PahoTransport.h"
+#include "transport/SharedTransport.h"
+#include "processing/Processor.h"
+#include "diagnostics/DiagnosticChannels.h"
+#include "diagnostics/StatisticsReport.h"
 #include "Utility.h"
 #include "Types.h"
 
@@ -14,6 +20,11 @@
 //
 #include "fmt/core.h"
 
+//
+#include <filesystem>
+#include <mutex>
+#include <set>
+
 using namespace odk::framework;
 
 // Manifest constains necessary metadata for oxygen plugins
@@ -53,12 +64,16 @@ static const char *TRANSLATION_EN =
 static const char *MQTT_CONFIG = "MQTT_PLUGIN/ConfigFile";
 static const char *MQTT_CONFIG_CACHE = "MQTT_PLUGIN/ConfigFileCache";
 
+// Custom requests handled by the plugin, e.g. to be polled by QML pages or external tools
+static const std::uint16_t REQUEST_GET_STATISTICS = 1;
+
 class MqttChannel : public SoftwareChannelInstance
 {
 public:
     MqttChannel()
         : m_config_file_path(new EditableStringProperty("Path to Config-File.")),
-          m_config_file_cache(new EditableStringProperty("Internal Config-File Cache"))
+          m_config_file_cache(new EditableStringProperty("Internal Config-File Cache")),
+          m_processor(m_service)
     {
         m_config_file_path->setVisiblity("HIDDEN");
         m_config_file_cache->setVisiblity("HIDDEN");
@@ -67,6 +82,10 @@ public:
 
     ~MqttChannel()
     {
+        if (m_statistics)
+        {
+            plugin::mqtt::diagnostics::StatisticsReport::remove(m_statistics);
+        }
         m_service.disconnect();
     }
 
@@ -121,16 +140,16 @@ public:
         {
             return InitResult(false);
         }
+        m_config_file_content = f.cache;
+        setAppliedConfigFile(config_file, true);
 
-        // Reflect changes made to JSON config document to a file (e.g. UUIDs)
+        // Reflect changes made to JSON config document to a file (e.g. UUIDs) and cache configuration for plugin-reload
         const auto cache_path = m_dll_path + "\\" + config_file.filename().u8string() + ".cache";
-        plugin::mqtt::config::Configuration::writeToFile(cache_path, c.document);
-
-        // Cache configuration for plugin-reload
+        m_config_file_cache->setValue(writeCache(cache_path, c.document));
         m_config_file_path->setValue(config_file.u8string());
-        m_config_file_cache->setValue(c.document.dump());
+        loadStreamStates(cache_path);
 
-        return InitResult(createChannelsAndConnect());
+        return InitResult(createChannelsAndConnect(config_file.u8string()));
     }
 
     /**
@@ -187,21 +206,29 @@ public:
             cache = f.cache;
         }
 
+        // Parsing and validation are skipped if the binary cache has been created from the same content
+        auto b = plugin::mqtt::config::Configuration::loadBinaryCache(cache_path + ".cbor", plugin::mqtt::config::Configuration::hash(cache));
+
         // Load configuration
-        auto c = m_configuration.load(cache);
+        auto c = b.error ? m_configuration.load(cache) : m_configuration.loadValidated(std::move(b.document));
         if (c.error)
         {
             return false;
         }
 
-        if (!f.error)
+        if (!f.error && b.error)
         {
             // Reflect any changes made during load of configuration to file (e.g. UUIDs)
-            plugin::mqtt::config::Configuration::writeToFile(cache_path, c.document);
+            cache = writeCache(cache_path, c.document);
         }
 
+        // Changes made to the config-file meanwhile are applied by the next reload
+        m_config_file_content = cache;
+        setAppliedConfigFile(config_file, false);
+        loadStreamStates(cache_path);
+
         // Create channels and connect
-        if (!createChannelsAndConnect())
+        if (!createChannelsAndConnect(config_file.u8string()))
         {
             return false;
         }
@@ -212,7 +239,7 @@ public:
         // Update cache
         if (!f.error)
         {
-            m_config_file_cache->setValue(c.document.dump());
+            m_config_file_cache->setValue(cache);
         }
 
         return true;
@@ -220,12 +247,10 @@ public:
 
     /**
      * @brief Create all publish configs and subscriptions handlers and connect to server
+     * @param name Identifies this instance within the statistics
      */
-    bool createChannelsAndConnect()
+    bool createChannelsAndConnect(const std::string &name)
     {
-        // Create Channels
-        createChannels();
-
         // TODO: If necessary, the plugin could handle more than one
         // Server connection (e.g. for redundancy?), currently, only use the first config
         auto server_configs = m_configuration.getServers();
@@ -236,60 +261,418 @@ public:
         }
         auto server_config = server_configs[0];
 
+        // Create Channels
+        auto topics = m_configuration.getSubscriptions();
+        auto publishers = m_configuration.getPublishers();
+        topics.insert(topics.end(), publishers.begin(), publishers.end());
+        createChannels(topics, server_config->getDiagnostics());
+
         // Establish the MQTT-Connection - we will simply ignore messages if we are not processing
+        connect(server_config);
+
+        // Allow querying the statistics of this instance through custom requests
+        m_statistics = std::make_shared<plugin::mqtt::diagnostics::StatisticsReport>(name, m_service);
+        plugin::mqtt::diagnostics::StatisticsReport::add(m_statistics);
+        return true;
+    }
+
+    /**
+     * @brief Connect to the server, subscriptions are restored once connected
+     * @param server_config
+     */
+    void connect(plugin::mqtt::config::Server::Pointer server_config)
+    {
         m_service.setServerConfiguration(server_config);
+
+        if (auto capture_file = server_config->getCaptureFile())
+        {
+            try
+            {
+                m_service.setCapture(std::make_shared<plugin::mqtt::capture::CaptureWriter>(capture_file.value()));
+            }
+            catch (const std::exception &)
+            {
+                // TODO: Show error message, continue without capture
+            }
+        }
+        else
+        {
+            m_service.setCapture(nullptr);
+        }
+
+        // Instances connecting to the same broker share a single connection
+        m_service.setTransport(plugin::mqtt::ConnectionRegistry::acquire(server_config, [](plugin::mqtt::config::Server::Pointer server)
+                                                                         { return std::make_shared<plugin::mqtt::PahoTransport>(server); }));
         m_service.connect();
-        return true;
     }
 
     /**
      * @brief Create channels (publish and subscribe) and register them in the MQTT-Service
+     * @param topics
+     * @param diagnostics Create diagnostic channels for the subscriptions
      * @return true
      * @return false
      */
-    bool createChannels()
+    bool createChannels(const plugin::mqtt::config::Topics &topics, bool diagnostics)
     {
         auto root_channel = getRootChannel();
 
-        // Create all Channels and Groups for the configured subscription
-        for (auto topic : m_configuration.getSubscriptions())
+        for (auto topic : topics)
         {
-            // walk/traverse the output channel map and create the corresponding oxygen output channels
-            traverse(topic->getSubscription(), root_channel, topic->getOxygenOutputChannelMap());
+            if (topic->getOperation() == plugin::mqtt::Operation::Subscribe)
+            {
+                auto subscription = topic->getSubscription();
 
-            // add the subscription to the MQTT-Service
-            m_service.addSubscription(topic->getSubscription());
-        }
+                // walk/traverse the output channel map and create the corresponding oxygen output channels
+                traverse(subscription, root_channel, topic->getOxygenOutputChannelMap());
 
-        // Create configuration for the configured publishers
-        auto publishers = m_configuration.getPublishers();
+                if (diagnostics)
+                {
+                    createDiagnosticChannels(subscription);
+                }
+
+                // Topics added while processing are only subscribed if their channels are in use
+                auto &output_channels = m_output_channels[subscription];
+                subscription->setActive(std::any_of(output_channels.begin(), output_channels.end(), isUsed));
 
-        if (!publishers.empty())
+                // add the subscription to the MQTT-Service
+                m_service.addSubscription(subscription);
+            }
+            else
+            {
+                // Create configuration for the configured publishers
+                if (!m_publish_group_channel)
+                {
+                    m_publish_group_channel = addGroupChannel("MQTT@Publish-Group", root_channel);
+                    m_publish_group_channel->setDefaultName("Publish-Channels");
+
+                    auto used = m_publish_group_channel->getProperty("Used");
+                    used->update(odk::Property("Used", false));
+                }
+
+                auto publish = topic->getPublisher();
+
+                // Every bundled channel is selected separately, a single unnamed channel is keyed by the topic
+                for (const auto &input : publish->getInputChannels())
+                {
+                    m_publish_group_channel->addProperty(getPublishKey(publish, input), input.channel);
+                }
+
+                m_service.addPublishHandler(publish);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Remove the channels of topics and unregister them from the MQTT-Service
+     * The topics of removed subscriptions are unsubscribed, all other topics stay subscribed
+     * @param topics
+     * @param kept Keys of Oxygen channels to be kept for the channels created next, e.g. of a changed topic
+     */
+    void removeChannels(const plugin::mqtt::config::Topics &topics, const std::set<std::string> &kept = {})
+    {
+        for (auto topic : topics)
         {
-            auto publish_group_channel = addGroupChannel("MQTT@Publish-Group", root_channel);
-            publish_group_channel->setDefaultName("Publish-Channels");
+            if (topic->getOperation() == plugin::mqtt::Operation::Subscribe)
+            {
+                auto subscription = topic->getSubscription();
+                m_service.removeSubscription(subscription->getTopic());
+                removeDiagnosticChannels(subscription);
+
+                // The output channels are keyed by the UUIDs of their channels
+                std::map<std::uint32_t, std::string> keys;
+                for (auto &channel : subscription->getChannels())
+                {
+                    if (auto id = channel->getLocalChannelId())
+                    {
+                        keys[id.value()] = channel->getConfiguration().uuid;
+                    }
+                }
 
-            auto used = publish_group_channel->getProperty("Used");
-            used->update(odk::Property("Used", false));
+                // Output channels are removed before their groups
+                for (auto &channel : m_output_channels[subscription])
+                {
+                    auto key = keys.find(channel->getLocalId());
+                    if (key != keys.end() && kept.count(key->second) > 0)
+                    {
+                        m_kept_channels[key->second] = channel;
+                        continue;
+                    }
+                    removeOutputChannel(channel);
+                }
+                for (auto &[key, channel] : m_group_channels[subscription])
+                {
+                    if (kept.count(key) > 0)
+                    {
+                        m_kept_channels[key] = channel;
+                        continue;
+                    }
+                    removeOutputChannel(channel);
+                }
 
-            for (auto topic : m_configuration.getPublishers())
+                m_output_channels.erase(subscription);
+                m_group_channels.erase(subscription);
+            }
+            else
             {
                 auto publish = topic->getPublisher();
-                publish_group_channel->addProperty(publish->getTopic(), publish->getInputChannel());
+                m_service.removePublishHandler(publish->getTopic());
 
-                m_service.addPublishHandler(publish);
+                for (const auto &input : publish->getInputChannels())
+                {
+                    m_publish_group_channel->removeProperty(getPublishKey(publish, input));
+                }
             }
         }
+    }
+
+    /**
+     * @brief Get the property key of an input channel of a publish handler
+     * @param publish
+     * @param input
+     * @return std::string
+     */
+    static std::string getPublishKey(const plugin::mqtt::Publish::Pointer &publish, const plugin::mqtt::Publish::Input &input)
+    {
+        return input.name.empty() ? publish->getTopic() : publish->getTopic() + "/" + input.name;
+    }
+
+    /**
+     * @brief Reload the config-file and apply the differences to this instance
+     * Only the channels of added, changed and removed topics are touched, all other subscriptions keep their
+     * streams, resampler state and channel ids and stay subscribed. The broker is only reconnected if the server
+     * configuration changed.
+     * @return true if the configuration is valid (or did not change)
+     */
+    bool reloadConfiguration()
+    {
+        std::filesystem::path config_file = m_config_file_path->getValue();
+        auto f = plugin::mqtt::config::Configuration::loadFileContent(config_file.u8string());
+        if (f.error)
+        {
+            // TODO: Show error Message?
+            return false;
+        }
+        setAppliedConfigFile(config_file, true);
+
+        if (f.cache == m_config_file_content)
+        {
+            return true;
+        }
+
+        plugin::mqtt::config::Configuration::Changes changes;
+        auto c = m_configuration.reload(f.cache, changes);
+        if (c.error)
+        {
+            // TODO: Show error Message, the current configuration stays in place
+            return false;
+        }
+        m_config_file_content = f.cache;
+
+        auto server_configs = m_configuration.getServers();
+        if (server_configs.empty())
+        {
+            return false;
+        }
+        auto server_config = server_configs[0];
+
+        // The output channels are not changed while processing
+        std::lock_guard<std::mutex> lock(m_channels_mtx);
+
+        // Changed topics are removed before they are added again, channels keeping their UUID keep their Oxygen channel
+        std::set<std::string> kept;
+        for (auto &topic : changes.added)
+        {
+            if (topic->getOperation() == plugin::mqtt::Operation::Subscribe)
+            {
+                getChannelKeys(topic->getOxygenOutputChannelMap(), "", kept);
+            }
+        }
+
+        // Diagnostic channels follow the server configuration, removed topics take their diagnostic channels along
+        const bool diagnostics = server_config->getDiagnostics();
+        const bool had_diagnostics = !m_diagnostics_channels.empty();
+        removeChannels(changes.removed, kept);
+
+        if (changes.servers_changed && diagnostics != had_diagnostics)
+        {
+            for (auto &subscription : m_service.getSubscriptions())
+            {
+                diagnostics ? createDiagnosticChannels(subscription) : removeDiagnosticChannels(subscription);
+            }
+        }
+
+        createChannels(changes.added, diagnostics);
+
+        // Channels kept but not taken by the created channels
+        for (auto &[key, channel] : m_kept_channels)
+        {
+            removeOutputChannel(channel);
+        }
+        m_kept_channels.clear();
+
+        if (changes.servers_changed)
+        {
+            m_service.disconnect();
+            connect(server_config);
+        }
+
+        // Reflect the UUIDs of kept and created topics to the cache
+        const auto cache_path = m_dll_path + "\\" + config_file.filename().u8string() + ".cache";
+        m_config_file_cache->setValue(writeCache(cache_path, c.document));
         return true;
     }
 
+    /**
+     * @brief Write a configuration document to the cache file and its validated binary form
+     * The document is dumped once, the binary form is keyed by the hash of the dumped content
+     * @param cache_path
+     * @param document
+     * @return std::string The dumped document, e.g. for the cache property
+     */
+    static std::string writeCache(const std::string &cache_path, const plugin::mqtt::config::json &document)
+    {
+        auto content = document.dump(4);
+        plugin::mqtt::config::Configuration::writeToFile(cache_path, content);
+        plugin::mqtt::config::Configuration::writeBinaryCache(cache_path + ".cbor", document, plugin::mqtt::config::Configuration::hash(content));
+        return content;
+    }
+
+    /**
+     * @brief Create a group of diagnostic output channels for a subscription reporting its ingest health
+     * @param subscription
+     */
+    void createDiagnosticChannels(const plugin::mqtt::Subscription::Pointer &subscription)
+    {
+        if (!m_diagnostics_group_channel)
+        {
+            m_diagnostics_group_channel = addGroupChannel("MQTT@Diagnostics", getRootChannel());
+            m_diagnostics_group_channel->setDefaultName("Diagnostics");
+        }
+
+        const auto key = "MQTT@Diagnostics" + subscription->getTopic();
+        auto topic_group_channel = addGroupChannel(key, m_diagnostics_group_channel);
+        topic_group_channel->setDefaultName(subscription->getTopic());
+
+        auto &diagnostic_channels = m_diagnostics_channels[subscription];
+        plugin::mqtt::diagnostics::DiagnosticChannels::Channels channels;
+        channels.messages_per_second = addDiagnosticChannel(key + "/messages", "Messages/s", topic_group_channel, diagnostic_channels);
+        channels.bytes_per_second = addDiagnosticChannel(key + "/bytes", "Bytes/s", topic_group_channel, diagnostic_channels);
+        channels.decode_failures_per_second = addDiagnosticChannel(key + "/decode-failures", "Decode failures/s", topic_group_channel, diagnostic_channels);
+        channels.decode_time = addDiagnosticChannel(key + "/decode-time", "Decode time p99 (us)", topic_group_channel, diagnostic_channels);
+
+        if (subscription->getSampling().mode == plugin::mqtt::SamplingModes::Sync)
+        {
+            channels.estimated_sample_rate = addDiagnosticChannel(key + "/sample-rate", "Estimated sample rate (Hz)", topic_group_channel, diagnostic_channels);
+            channels.nan_filled = addDiagnosticChannel(key + "/nan-filled", "NaN samples", topic_group_channel, diagnostic_channels);
+            channels.unrecoverable = addDiagnosticChannel(key + "/unrecoverable", "Unrecoverable", topic_group_channel, diagnostic_channels);
+            channels.resyncs = addDiagnosticChannel(key + "/resyncs", "Resyncs", topic_group_channel, diagnostic_channels);
+        }
+
+        // The group is removed after its channels
+        diagnostic_channels.push_back(topic_group_channel);
+        m_diagnostics.add(subscription, channels);
+    }
+
+    /**
+     * @brief Remove the diagnostic output channels of a subscription
+     * @param subscription
+     */
+    void removeDiagnosticChannels(const plugin::mqtt::Subscription::Pointer &subscription)
+    {
+        m_diagnostics.remove(subscription);
+
+        auto it = m_diagnostics_channels.find(subscription);
+        if (it == m_diagnostics_channels.end())
+            return;
+
+        for (auto &channel : it->second)
+        {
+            removeOutputChannel(channel);
+        }
+        m_diagnostics_channels.erase(it);
+    }
+
+    /**
+     * @brief Create a single async diagnostic output channel
+     * @param key
+     * @param name
+     * @param group_channel
+     * @param created Receives the created channel
+     * @return plugin::mqtt::LocalId
+     */
+    plugin::mqtt::LocalId addDiagnosticChannel(const std::string &key, const std::string &name, odk::framework::PluginChannelPtr &group_channel, std::vector<PluginChannelPtr> &created)
+    {
+        auto output_channel = addOutputChannel(key, group_channel);
+        output_channel->setDefaultName(name)
+            .setDeletable(false);
+        output_channel->setSampleFormat(asOdkFormat(plugin::mqtt::SamplingModes::Async), asOdkFormat(plugin::mqtt::Datatype::Number));
+
+        created.push_back(output_channel);
+        return output_channel->getLocalId();
+    }
+
+    /**
+     * @brief Get the key of a group channel, unique among all groups of the configuration
+     * @param parent Key of the parent group, empty for the root channel
+     * @param group_name
+     * @return std::string
+     */
+    static std::string getGroupKey(const std::string &parent, const std::string &group_name)
+    {
+        // Separated by a character that can not be part of a topic or a JSON key of the configuration
+        return parent + '\n' + group_name;
+    }
+
+    /**
+     * @brief Get the keys of all output and group channels of an Oxygen output channel map
+     * @param map
+     * @param parent Key of the group of the map
+     * @param keys Receives the keys
+     */
+    static void getChannelKeys(plugin::mqtt::config::Topic::OxygenOutputChannelMap &map, const std::string &parent, std::set<std::string> &keys)
+    {
+        for (auto &channel : map.channels)
+        {
+            keys.insert(channel->getConfiguration().uuid);
+        }
+
+        for (auto &[group_name, sub_map] : map.group_channels)
+        {
+            const auto key = getGroupKey(parent, group_name);
+            keys.insert(key);
+            getChannelKeys(sub_map, key, keys);
+        }
+    }
+
+    /**
+     * @brief Take an Oxygen channel kept while reloading the configuration
+     * @param key
+     * @return PluginChannelPtr null if no channel has been kept
+     */
+    PluginChannelPtr takeKeptChannel(const std::string &key)
+    {
+        auto it = m_kept_channels.find(key);
+        if (it == m_kept_channels.end())
+        {
+            return nullptr;
+        }
+
+        auto channel = it->second;
+        m_kept_channels.erase(it);
+        return channel;
+    }
+
     /**
      * @brief Traverse through all subscriptions to create the corresponding Oxygen Output channels
+     * Channels kept while reloading the configuration are used instead of creating them again
      * @param subscription
      * @param group_channel
      * @param map
+     * @param parent Key of the group channel
      */
-    void traverse(const plugin::mqtt::Subscription::Pointer subscription, odk::framework::PluginChannelPtr &group_channel, plugin::mqtt::config::Topic::OxygenOutputChannelMap &map)
+    void traverse(const plugin::mqtt::Subscription::Pointer subscription, odk::framework::PluginChannelPtr &group_channel, plugin::mqtt::config::Topic::OxygenOutputChannelMap &map, const std::string &parent = "")
     {
         // Iterate channels of the current level
         for (auto channel : map.channels)
@@ -298,7 +681,11 @@ public:
             auto &sampling_configuration = subscription->getSampling();
 
             // Create a new output channel - using its unique-id as the key
-            auto output_channel = addOutputChannel(channel_configuration.uuid, group_channel);
+            auto output_channel = takeKeptChannel(channel_configuration.uuid);
+            if (!output_channel)
+            {
+                output_channel = addOutputChannel(channel_configuration.uuid, group_channel);
+            }
             output_channel->setDefaultName(channel_configuration.name)
                 .setDeletable(false);
 
@@ -309,41 +696,105 @@ public:
             switch (sampling_configuration.mode)
             {
             case plugin::mqtt::SamplingModes::Async:
-                output_channel->setSampleFormat(asOdkFormat(sampling_configuration.mode), asOdkFormat(channel_configuration.datatype));
+                // Vector channels (e.g. spectra) carry an array of numbers per sample
+                output_channel->setSampleFormat(asOdkFormat(sampling_configuration.mode), asOdkFormat(channel_configuration.datatype),
+                                                static_cast<std::uint32_t>(channel_configuration.dimension.value_or(1)));
                 break;
             case plugin::mqtt::SamplingModes::Sync:
+            {
+                // Preview channels are sampled at a lower rate than their subscription
+                const auto sample_rate = channel_configuration.sample_rate.value_or(sampling_configuration.sample_rate.value());
                 output_channel->setSampleFormat(asOdkFormat(sampling_configuration.mode), asOdkFormat(channel_configuration.datatype))
-                    .setSimpleTimebase(sampling_configuration.sample_rate.value());
+                    .setSimpleTimebase(sample_rate);
 
-                output_channel->setSamplerate({sampling_configuration.sample_rate.value(), "Hz"});
-                break;
+                output_channel->setSamplerate({sample_rate, "Hz"});
+            }
+            break;
             }
 
             // Link the MQTT-Channel to the Oxygen output channel using its local id
             channel_configuration.local_channel_id = output_channel->getLocalId();
+
+            // Remember the output channels of a subscription to decide whether it is in use
+            m_output_channels[subscription].push_back(output_channel);
         }
 
         // Create group channels and recursive call traverse
         for (auto &[group_name, sub_map] : map.group_channels)
         {
-            auto sub_group_channel = addGroupChannel(group_name, group_channel);
+            const auto key = getGroupKey(parent, group_name);
+            auto sub_group_channel = takeKeptChannel(key);
+            if (!sub_group_channel)
+            {
+                sub_group_channel = addGroupChannel(group_name, group_channel);
+            }
             sub_group_channel->setDefaultName(group_name);
 
-            traverse(subscription, sub_group_channel, sub_map);
+            traverse(subscription, sub_group_channel, sub_map, key);
+
+            // Nested groups are removed before their parents
+            m_group_channels[subscription].emplace_back(key, sub_group_channel);
         }
     }
 
     /**
      * @brief Called whenever a property changes
-     * Currently, we do not expose any properties where an "on-change" is of interest
+     * Setting the config-file property to another file, or again once the file has been modified, reloads the
+     * configuration, only changed topics are updated
      * @return true
      * @return false
      */
     bool update() override
     {
+        // Not yet initialized, or another property changed
+        if (m_config_file_content.empty() || !isConfigFileChanged())
+        {
+            return true;
+        }
+
+        reloadConfiguration();
         return true;
     }
 
+    /**
+     * @brief Remember the config-file the configuration has been applied from
+     * @param config_file
+     * @param current The configuration reflects the current content of the file, else it is reloaded on the next update
+     */
+    void setAppliedConfigFile(const std::filesystem::path &config_file, bool current)
+    {
+        m_applied_config_file = config_file.u8string();
+        m_applied_config_time = {};
+
+        if (current)
+        {
+            std::error_code error;
+            const auto time = std::filesystem::last_write_time(config_file, error);
+            if (!error)
+            {
+                m_applied_config_time = time;
+            }
+        }
+    }
+
+    /**
+     * @brief Check whether the config-file property or the file it refers to changed since the configuration has been applied
+     * The file is not read, only its modification time is compared
+     * @return true if the configuration must be reloaded
+     */
+    bool isConfigFileChanged() const
+    {
+        const std::filesystem::path config_file = m_config_file_path->getValue();
+        if (config_file.u8string() != m_applied_config_file)
+        {
+            return true;
+        }
+
+        std::error_code error;
+        const auto time = std::filesystem::last_write_time(config_file, error);
+        return !error && time != m_applied_config_time;
+    }
+
     void updatePropertyTypes(const PluginChannelPtr &output_channel) override
     {
         ODK_UNUSED(output_channel);
@@ -370,7 +821,43 @@ public:
                                         t.m_ticks,
                                         t.m_frequency
                                     ); });
+
+        // Only subscribe to topics with at least one of their output channels in use
+        std::lock_guard<std::mutex> lock(m_channels_mtx);
+        for (auto &[subscription, output_channels] : m_output_channels)
+        {
+            subscription->setActive(std::any_of(output_channels.begin(), output_channels.end(), isUsed));
+        }
+
+        {
+            // Streams start from the sample rate learned by previous acquisitions
+            std::lock_guard<std::mutex> lock(m_service.getLock());
+            m_stream_states.seed(m_service.getSubscriptions());
+        }
+
         m_service.prepareProcessing();
+        m_diagnostics.reset();
+    }
+
+    /**
+     * @brief Load the states of the resampled streams persisted next to the configuration cache
+     * @param cache_path
+     */
+    void loadStreamStates(const std::string &cache_path)
+    {
+        m_stream_states_path = cache_path + ".streams";
+        m_stream_states = plugin::mqtt::config::StreamStates::load(m_stream_states_path);
+    }
+
+    /**
+     * @brief Check whether an output channel is used (e.g. displayed or recorded)
+     * @param output_channel
+     * @return true if used or if the host does not provide the information
+     */
+    static bool isUsed(const PluginChannelPtr &output_channel)
+    {
+        auto used = std::dynamic_pointer_cast<BooleanProperty>(output_channel->getProperty("Used"));
+        return !used || used->getValue();
     }
 
     /**
@@ -381,217 +868,220 @@ public:
     {
         ODK_UNUSED(host);
         m_service.stopProcessing();
+
+        // Persist the sample rates learned, e.g. the drift of the devices
+        if (!m_stream_states_path.empty())
+        {
+            std::lock_guard<std::mutex> lock(m_service.getLock());
+            m_stream_states.update(m_service.getSubscriptions());
+            m_stream_states.save(m_stream_states_path);
+        }
     }
 
     /**
-     * @brief Process Subscriptions and append Data to Oxygen Output channels
+     * @brief Called by the host to process input and output channels
      * @param context
      * @param host
      */
-    void processSubscriptions(ProcessingContext &context, odk::IfHost *host)
+    void process(ProcessingContext &context, odk::IfHost *host) override
     {
-        // The service handles multiple subscriptions
-        for (auto &subscription : m_service.getSubscriptions())
+        // The configuration might be reloaded by another thread meanwhile
+        std::lock_guard<std::mutex> lock(m_channels_mtx);
+
+        OdkSampleSink sink(host);
+        OdkSampleSource source(*this, context);
+        m_processor.process(sink, source, context.m_master_timestamp.m_ticks);
+
+        // Diagnostics are sampled from lock-free counters, the MQTT-Thread is not blocked meanwhile
+        m_diagnostics.process(sink, plugin::mqtt::Timestamp(context.m_master_timestamp.m_ticks, context.m_master_timestamp.m_frequency));
+    }
+
+private:
+    /**
+     * @brief Append samples of subscribed topics to the Oxygen output channels
+     */
+    class OdkSampleSink : public plugin::mqtt::SampleSink
+    {
+    public:
+        OdkSampleSink(odk::IfHost *host) : m_host(host) {}
+
+        void addSample(std::uint32_t local_channel_id, std::uint64_t ticks, int value) override
         {
-            auto sampling = subscription->getSampling();
+            odk::addSample(m_host, local_channel_id, ticks, value);
+        }
 
-            // A subscription can have multiple channels
-            for (auto channel : subscription->getChannels())
-            {
-                auto samples = channel->getAndClearSamples();
-                auto id = channel->getLocalChannelId();
-                if (id)
-                {
-                    if (samples.size() == 0) {
-                        if (sampling.mode == plugin::mqtt::SamplingModes::Async)
-                        {
-                            odk::addSample(host, id.value(), context.m_master_timestamp.m_ticks, 0.0);
-                        }
-                    }
-                    // Every channel buffers samples
-                    for (auto &sample : samples)
-                    {
-                        // Handle different datatypes per channel
-
-                        switch (channel->getDatatype())
-                        {
-                        case plugin::mqtt::Datatype::Integer:
-                        {
-                            switch (sampling.mode)
-                            {
-                            case plugin::mqtt::SamplingModes::Async:
-                            {
-                                int value = sample.pop_back<int>();
-                                odk::addSample(host, id.value(), sample.time.ticks, value);
-                            }
-                            break;
-                            case plugin::mqtt::SamplingModes::Sync:
-                            {
-                                auto values = sample.pop_values<int>();
-                                odk::addSamples(host, id.value(), sample.time.ticks, values.data(), sizeof(int) * values.size());
-                            }
-                            break;
-                            }
-                        }
-                        break;
-                        case plugin::mqtt::Datatype::Number:
-                        {
-                            switch (sampling.mode)
-                            {
-                            case plugin::mqtt::SamplingModes::Async:
-                            {
-                                double value = sample.pop_back<double>();
-                                odk::addSample(host, id.value(), sample.time.ticks, value);
-                            }
-                            break;
-                            case plugin::mqtt::SamplingModes::Sync:
-                            {
-                                auto values = sample.pop_values<double>();
-                                odk::addSamples(host, id.value(), sample.time.ticks, values.data(), sizeof(double) * values.size());
-                            }
-                            break;
-                            }
-                        }
-                        break;
-                        case plugin::mqtt::Datatype::String:
-                        {
-                            std::string value = sample.pop_back<std::string>();
-                            odk::addSample(host, id.value(), sample.time.ticks, value.c_str(), value.size());
-                        }
-                        break;
-                        }
-                    }
-                }
-            }
+        void addSample(std::uint32_t local_channel_id, std::uint64_t ticks, double value) override
+        {
+            odk::addSample(m_host, local_channel_id, ticks, value);
         }
-    }
+
+        void addSample(std::uint32_t local_channel_id, std::uint64_t ticks, const std::string &value) override
+        {
+            odk::addSample(m_host, local_channel_id, ticks, value.c_str(), value.size());
+        }
+
+        void addSample(std::uint32_t local_channel_id, std::uint64_t ticks, const std::vector<double> &value) override
+        {
+            odk::addSample(m_host, local_channel_id, ticks, value.data(), sizeof(double) * value.size());
+        }
+
+        void addSamples(std::uint32_t local_channel_id, std::uint64_t ticks, const std::vector<int> &values) override
+        {
+            odk::addSamples(m_host, local_channel_id, ticks, values.data(), sizeof(int) * values.size());
+        }
+
+        void addSamples(std::uint32_t local_channel_id, std::uint64_t ticks, const std::vector<double> &values) override
+        {
+            odk::addSamples(m_host, local_channel_id, ticks, values.data(), sizeof(double) * values.size());
+        }
+
+    private:
+        odk::IfHost *m_host;
+    };
 
     /**
-     * @brief Process all Publish-Handlers, get data from selected input channels and send to host
-     * @param context
-     * @param host
+     * @brief Read the Oxygen input channels selected for publishing within the current processing window
      */
-    void processPublishHandlers(ProcessingContext &context, odk::IfHost *host)
+    class OdkSampleSource : public plugin::mqtt::SampleSource
     {
-        for (auto &publish : m_service.getPublishHandlers())
+    public:
+        OdkSampleSource(MqttChannel &plugin, ProcessingContext &context) : m_plugin(plugin), m_context(context) {}
+
+        bool readSync(std::uint64_t input_channel_id, std::vector<plugin::mqtt::value_t> &values, double &sample_rate, double &timestamp) override
         {
-            // Get Oxygen input-channel for publish-handler
-            const auto input_channel_id = publish->getInputChannel()->getValue();
-            if (auto input_channel = getInputChannelProxy(input_channel_id))
+            auto input_channel = m_plugin.getInputChannelProxy(input_channel_id);
+            if (!input_channel)
             {
-                const auto timebase = input_channel->getTimeBase();
-                const std::uint64_t start_sample = odk::convertTimeToTickAtOrAfter(context.m_window.first, timebase.m_frequency);
-                const std::uint64_t end_sample = odk::convertTimeToTickAtOrAfter(context.m_window.second, timebase.m_frequency);
+                return false;
+            }
 
-                odk::framework::StreamIterator &iterator = context.m_channel_iterators[input_channel_id];
-                iterator.setSkipGaps(false);
+            const auto dataformat = input_channel->getDataFormat();
+            if (dataformat.m_sample_occurrence != odk::ChannelDataformat::SampleOccurrence::SYNC)
+            {
+                return false;
+            }
 
-                const auto dataformat = input_channel->getDataFormat();
-                if (dataformat.m_sample_occurrence == odk::ChannelDataformat::SampleOccurrence::SYNC)
-                {
-                    const std::size_t num_output_samples = end_sample - start_sample;
-                    const auto sample_rate = input_channel->getSampleRate();
+            const auto timebase = input_channel->getTimeBase();
+            const std::uint64_t start_sample = odk::convertTimeToTickAtOrAfter(m_context.m_window.first, timebase.m_frequency);
+            const std::uint64_t end_sample = odk::convertTimeToTickAtOrAfter(m_context.m_window.second, timebase.m_frequency);
 
-                    if (publish->getSampling().mode == plugin::mqtt::SamplingModes::Sync)
-                    {
-                        std::vector<plugin::mqtt::value_t> values;
-                        values.reserve(num_output_samples);
-
-                        for (auto sample_index = start_sample; sample_index < end_sample; ++sample_index)
-                        {
-                            switch (dataformat.m_sample_format)
-                            {
-                            case odk::ChannelDataformat::SampleFormat::DOUBLE:
-                            {
-                                const auto current_value = iterator.value<double>();
-                                values.push_back(current_value);
-                            }
-                            break;
-
-                            case odk::ChannelDataformat::SampleFormat::SINT32:
-                            {
-                                const auto current_value = iterator.value<int32_t>();
-                                values.push_back(current_value);
-                            }
-                            break;
-                            default:
-                                // TODO Implement further datatypes?
-                                break;
-                            }
-                            ++iterator;
-                        }
-
-                        publish->addSyncSamples(values, sample_rate.m_val);
-                    }
-                    else
-                    {
-                        // TODO: Indicate wrong config (sampling modes do not match)
-                    }
+            odk::framework::StreamIterator &iterator = m_context.m_channel_iterators[input_channel_id];
+            iterator.setSkipGaps(false);
+
+            const std::size_t num_output_samples = end_sample - start_sample;
+            sample_rate = input_channel->getSampleRate().m_val;
+            timestamp = start_sample / timebase.m_frequency;
+
+            values.reserve(num_output_samples);
+            for (auto sample_index = start_sample; sample_index < end_sample; ++sample_index)
+            {
+                switch (dataformat.m_sample_format)
+                {
+                case odk::ChannelDataformat::SampleFormat::DOUBLE:
+                {
+                    const auto current_value = iterator.value<double>();
+                    values.push_back(current_value);
                 }
-                else if (dataformat.m_sample_occurrence == odk::ChannelDataformat::SampleOccurrence::ASYNC)
+                break;
+
+                case odk::ChannelDataformat::SampleFormat::SINT32:
                 {
-                    if (publish->getSampling().mode == plugin::mqtt::SamplingModes::Async)
-                    {
-                        while (iterator.valid() && iterator.timestamp() < end_sample)
-                        {
-                            const uint64_t timestamp = iterator.timestamp();
-                            const double timestamp_seconds = timestamp / timebase.m_frequency;
-
-                            switch (dataformat.m_sample_format)
-                            {
-                            case odk::ChannelDataformat::SampleFormat::DOUBLE:
-                            {
-                                const auto current_value = iterator.value<double>();
-                                publish->addAsyncSample(timestamp_seconds, current_value);
-                            }
-                            break;
-
-                            case odk::ChannelDataformat::SampleFormat::SINT32:
-                            {
-                                const auto current_value = iterator.value<int32_t>();
-                                publish->addAsyncSample(timestamp, current_value);
-                            }
-                            break;
-
-                            default:
-                                // TODO Implement further datatypes?
-                                break;
-                            }
-                            ++iterator;
-                        }
-                    }
-                    else
-                    {
-                        // TODO: Indicate wrong config (sampling modes do not match)
-                    }
+                    const auto current_value = iterator.value<int32_t>();
+                    values.push_back(current_value);
+                }
+                break;
+                default:
+                    // TODO Implement further datatypes?
+                    break;
                 }
+                ++iterator;
             }
+
+            return true;
         }
 
-        // Publish data if any
-        m_service.publish();
-    }
+        bool readAsync(std::uint64_t input_channel_id, const AsyncCallback &callback) override
+        {
+            auto input_channel = m_plugin.getInputChannelProxy(input_channel_id);
+            if (!input_channel)
+            {
+                return false;
+            }
 
-    /**
-     * @brief Called by the host to process input and output channels
-     * @param context
-     * @param host
-     */
-    void process(ProcessingContext &context, odk::IfHost *host) override
-    {
-        // Prevent MQTT-Threads from manipulating any buffers while processing
-        std::lock_guard<std::mutex> lock(m_service.getLock());
-        processSubscriptions(context, host);
-        processPublishHandlers(context, host);
-    }
+            const auto dataformat = input_channel->getDataFormat();
+            if (dataformat.m_sample_occurrence != odk::ChannelDataformat::SampleOccurrence::ASYNC)
+            {
+                return false;
+            }
+
+            const auto timebase = input_channel->getTimeBase();
+            const std::uint64_t end_sample = odk::convertTimeToTickAtOrAfter(m_context.m_window.second, timebase.m_frequency);
+
+            odk::framework::StreamIterator &iterator = m_context.m_channel_iterators[input_channel_id];
+            iterator.setSkipGaps(false);
+
+            while (iterator.valid() && iterator.timestamp() < end_sample)
+            {
+                const double timestamp_seconds = iterator.timestamp() / timebase.m_frequency;
+
+                switch (dataformat.m_sample_format)
+                {
+                case odk::ChannelDataformat::SampleFormat::DOUBLE:
+                    callback(timestamp_seconds, iterator.value<double>());
+                    break;
+
+                case odk::ChannelDataformat::SampleFormat::SINT32:
+                    callback(timestamp_seconds, static_cast<int>(iterator.value<int32_t>()));
+                    break;
+
+                default:
+                    // TODO Implement further datatypes?
+                    break;
+                }
+                ++iterator;
+            }
+
+            return true;
+        }
+
+    private:
+        MqttChannel &m_plugin;
+        ProcessingContext &m_context;
+    };
 
-private:
     std::shared_ptr<EditableStringProperty> m_config_file_path;
     std::shared_ptr<EditableStringProperty> m_config_file_cache;
 
     plugin::mqtt::Service m_service;
+    plugin::mqtt::Processor m_processor;
+    plugin::mqtt::diagnostics::DiagnosticChannels m_diagnostics;
+    plugin::mqtt::diagnostics::StatisticsReport::Pointer m_statistics;
     plugin::mqtt::config::Configuration m_configuration;
     std::string m_dll_path;
+
+    // The config-file content the current configuration has been loaded or reloaded from
+    std::string m_config_file_content;
+
+    // The config-file the configuration has been applied from and its modification time at that moment
+    std::string m_applied_config_file;
+    std::filesystem::file_time_type m_applied_config_time;
+
+    // Guards the output channels and diagnostics while the configuration is reloaded during processing
+    std::mutex m_channels_mtx;
+
+    // States of the resampled streams, persisted next to the configuration cache
+    plugin::mqtt::config::StreamStates m_stream_states;
+    std::string m_stream_states_path;
+
+    // Oxygen output channels created for each subscription
+    std::map<plugin::mqtt::Subscription::Pointer, std::vector<PluginChannelPtr>> m_output_channels;
+    std::map<plugin::mqtt::Subscription::Pointer, std::vector<std::pair<std::string, PluginChannelPtr>>> m_group_channels;
+    std::map<plugin::mqtt::Subscription::Pointer, std::vector<PluginChannelPtr>> m_diagnostics_channels;
+    PluginChannelPtr m_publish_group_channel;
+    PluginChannelPtr m_diagnostics_group_channel;
+
+    // Oxygen channels of changed topics kept while reloading the configuration, by key
+    std::map<std::string, PluginChannelPtr> m_kept_channels;
 };
 
 class MqttChannelPlugin : public SoftwareChannelPlugin<MqttChannel>
@@ -601,6 +1091,8 @@ public:
         : m_custom_requests(std::make_shared<odk::framework::CustomRequestHandler>())
     {
         addMessageHandler(m_custom_requests);
+
+        m_custom_requests->registerFunction(REQUEST_GET_STATISTICS, "GetStatistics", getStatistics);
     }
 
     void registerResources() final
@@ -610,6 +1102,20 @@ public:
     }
 
 private:
+    /**
+     * @brief Return a JSON snapshot of the subscription and publish statistics of all plugin instances
+     * The snapshot is built from lock-free counters, polling does not interfere with processing
+     * @param params unused
+     * @param returns "Statistics": JSON array with one object per plugin instance
+     * @return std::uint64_t
+     */
+    static std::uint64_t getStatistics(const odk::PropertyList &params, odk::PropertyList &returns)
+    {
+        ODK_UNUSED(params);
+        returns.setString("Statistics", plugin::mqtt::diagnostics::StatisticsReport::getAllSnapshots().dump());
+        return odk::error_codes::OK;
+    }
+
     std::shared_ptr<odk::framework::CustomRequestHandler> m_custom_requests;
 };
 
@@ -1,71 +1,104 @@
 #include "Service.h"
-#include "uuid.h"
+#include "diagnostics/Trace.h"
+
+//
+#include <chrono>
 
 using namespace plugin::mqtt;
+using plugin::mqtt::diagnostics::Trace;
 
 Service::~Service()
 {
     disconnect();
+
+    // Do not keep tracing enabled for other instances if destroyed while processing
+    if (m_tracing)
+    {
+        Trace::release();
+    }
 }
 
-void Service::connect()
+void Service::setTransport(Transport::Pointer transport)
 {
-    if (m_client)
-        return;
+    m_transport = transport;
 
-    // Create a random uuid as the connection to the broker will be unique
-    auto uuid = uuids::uuid_system_generator{}();
-    m_client = std::make_unique<::mqtt::async_client>(m_server_configuration->getUrl(), uuids::to_string(uuid));
+    // Services sharing a connection share its window, otherwise their payloads in flight add up
+    auto flow_control = m_transport ? m_transport->getFlowControl() : nullptr;
+    m_flow_control = flow_control ? flow_control : std::make_shared<FlowControl>();
+}
 
-    // Let the underlying paho client handle reconnect attempts
-    // TODO Make these settings part of the config-file
-    m_options.set_automatic_reconnect(true);
-    m_options.set_automatic_reconnect(10, 60);
+void Service::setCapture(capture::CaptureWriter::Pointer capture)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_capture = capture;
+}
 
-    // The client will always resubscribe to topics of interest when the connection is etasblished
-    // Hence, create a clean session
-    m_options.set_clean_session(false);
+void Service::connect()
+{
+    if (!m_transport || m_transport->isConnected())
+        return;
 
-    // Let paho handle MQTT Version handling (including fallbacks)
-    m_options.set_mqtt_version(MQTTVERSION_DEFAULT);
+    // Limit the payloads in flight, the congestion window never exceeds the client limit
+    if (m_server_configuration)
+    {
+        if (auto max_inflight = m_server_configuration->getMaxInflight())
+        {
+            m_flow_control->setMaxWindow(static_cast<std::size_t>(*max_inflight));
+        }
+    }
 
-    // Install callback and execute connect
-    m_client->set_callback(*this);
-    m_client->connect(m_options);
+    // Install callbacks and execute connect
+    Transport::Callbacks callbacks;
+    callbacks.connected = [this](const std::string &cause)
+    { connected(cause); };
+    callbacks.connection_lost = [this](const std::string &cause)
+    { connection_lost(cause); };
+    callbacks.message_arrived = [this](const_message_ptr msg)
+    { message_arrived(msg); };
+
+    m_transport->setCallbacks(callbacks);
+    m_transport->connect();
 }
 
 void Service::disconnect()
 {
-    std::lock_guard<std::mutex> lock(m_mtx);
-    if (m_client)
+    // Not holding the lock, transports wait for callbacks in flight which acquire it
+    if (m_transport)
     {
-        if (m_client->is_connected())
+        try
+        {
+            m_transport->disconnect();
+        }
+        catch (const std::exception &)
         {
-            m_client->disconnect(100)->wait();
-            m_client->disable_callbacks();
-            m_client.reset();
+            // The transport is closed nevertheless, payloads of topics failing to unsubscribe are not dispatched
         }
+        m_transport->setCallbacks({});
     }
 }
 
 void Service::connected(const std::string &cause)
 {
     // TODO: Show Message on connect?
+    std::lock_guard<std::mutex> lock(m_mtx);
 
-    // Subscribe to all topics
-    for (const auto &[path, sub] : m_subscriptions)
-    {
-        m_client->subscribe(path, sub->getQoS());
-    }
+    // (Re)subscribe to all topics of interest
+    m_subscribed.clear();
+    updateSubscriptions();
 }
 
 void Service::connection_lost(const std::string &cause)
 {
     // TODO: Show Message when connection is lost
+
+    // Deliveries pending on the lost connection are resent by the client and no measure for the next connection
+    m_flow_control->reset();
 }
 
 void Service::message_arrived(::mqtt::const_message_ptr msg)
 {
+    // Stamp the arrival before waiting for the processing thread to release the lock
+    const auto arrived = Trace::isEnabled() ? Trace::now() : 0;
     std::lock_guard<std::mutex> lock(m_mtx);
 
     if (!m_timesource)
@@ -76,12 +109,33 @@ void Service::message_arrived(::mqtt::const_message_ptr msg)
     // Interpet incoming message
     auto timestamp = m_timesource();
 
+    if (m_capture)
+    {
+        m_capture->write(capture::RecordKind::Message, timestamp, msg->get_topic(), msg->get_payload_str());
+    }
+
     auto it = m_subscriptions.find(msg->get_topic());
     if (it == m_subscriptions.end())
         return;
 
+    // Payloads might still arrive shortly after unsubscribing
     auto subscription = it->second;
+    if (!subscription->isActive())
+        return;
+
+    const auto decoding = arrived ? Trace::now() : 0;
     subscription->interpretPayload(m_start, timestamp, msg);
+
+    if (arrived)
+    {
+        // The flow ends once the samples are handed to Oxygen
+        const auto id = Trace::nextId();
+        const auto decoded = Trace::now();
+        Trace::complete("message_arrived", arrived, decoded, id, msg->get_topic());
+        Trace::complete("decode", decoding, decoded, id, msg->get_topic());
+        Trace::flowBegin("message", arrived, id);
+        subscription->addTraceId(id);
+    }
 }
 
 void Service::setTimeSource(Timesource timesource)
@@ -97,6 +151,11 @@ void Service::enable()
     // Capture Start of Sampling (for sync-channels)
     m_start = m_timesource();
     m_enable = true;
+
+    if (m_capture)
+    {
+        m_capture->write(capture::RecordKind::Start, m_start, "", "");
+    }
 }
 
 void Service::disable()
@@ -128,7 +187,44 @@ Service::Subscriptions Service::getSubscriptions()
 
 void Service::addSubscription(Subscription::Pointer sub)
 {
+    std::lock_guard<std::mutex> lock(m_mtx);
     m_subscriptions.insert(std::pair<std::string, Subscription::Pointer>(sub->getTopic(), sub));
+
+    // Added while processing, e.g. by reloading the configuration
+    if (m_enable)
+    {
+        sub->prepareProcessing();
+        updateSubscriptions();
+    }
+}
+
+void Service::removeSubscription(const std::string &topic)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    auto it = m_subscriptions.find(topic);
+    if (it == m_subscriptions.end())
+        return;
+
+    if (m_subscribed.count(topic) > 0)
+    {
+        m_subscribed.erase(topic);
+
+        try
+        {
+            if (m_transport && m_transport->isConnected())
+            {
+                m_transport->unsubscribe(topic);
+            }
+        }
+        catch (const std::exception &)
+        {
+            // TODO: Show message, payloads of the topic are ignored
+        }
+    }
+
+    it->second->stopProcessing();
+    it->second->discardSamples();
+    m_subscriptions.erase(it);
 }
 
 std::mutex &Service::getLock()
@@ -146,6 +242,14 @@ void Service::prepareProcessing()
     }
 
     enable();
+    updateSubscriptions();
+
+    // Tracing is shared by all instances, the first one to start clears the previous trace
+    if (m_server_configuration && m_server_configuration->getTraceFile() && !m_tracing)
+    {
+        Trace::acquire();
+        m_tracing = true;
+    }
 }
 
 void Service::stopProcessing()
@@ -158,6 +262,54 @@ void Service::stopProcessing()
     }
 
     disable();
+    updateSubscriptions();
+
+    // The events of all instances are written by the last one to stop
+    if (m_tracing)
+    {
+        m_tracing = false;
+        if (!Trace::release())
+            return;
+
+        try
+        {
+            Trace::writeChromeTrace(m_server_configuration->getTraceFile().value());
+        }
+        catch (const std::exception &)
+        {
+            // TODO: Show message, the trace is lost
+        }
+    }
+}
+
+void Service::updateSubscriptions()
+{
+    if (!m_transport || !m_transport->isConnected())
+        return;
+
+    for (const auto &[topic, subscription] : m_subscriptions)
+    {
+        const bool wanted = m_enable && subscription->isActive();
+        const bool subscribed = m_subscribed.count(topic) > 0;
+
+        try
+        {
+            if (wanted && !subscribed)
+            {
+                m_transport->subscribe(topic, subscription->getQoS());
+                m_subscribed.insert(topic);
+            }
+            else if (!wanted && subscribed)
+            {
+                m_transport->unsubscribe(topic);
+                m_subscribed.erase(topic);
+            }
+        }
+        catch (const std::exception &)
+        {
+            // TODO: Show message, subscriptions are updated again on reconnect
+        }
+    }
 }
 
 void Service::setServerConfiguration(config::Server::Pointer config)
@@ -167,9 +319,21 @@ void Service::setServerConfiguration(config::Server::Pointer config)
 
 void Service::addPublishHandler(Publish::Pointer pub)
 {
+    std::lock_guard<std::mutex> lock(m_mtx);
     m_publish_handlers.insert(std::pair<std::string, Publish::Pointer>(pub->getTopic(), pub));
 }
 
+void Service::removePublishHandler(const std::string &topic)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    auto it = m_publish_handlers.find(topic);
+    if (it == m_publish_handlers.end())
+        return;
+
+    it->second->discardSamples();
+    m_publish_handlers.erase(it);
+}
+
 Service::Publishers Service::getPublishHandlers()
 {
     Publishers publishers;
@@ -182,16 +346,95 @@ Service::Publishers Service::getPublishHandlers()
     return publishers;
 }
 
+FlowControl::Statistics Service::getFlowStatistics() const
+{
+    return m_flow_control->getStatistics();
+}
+
+capture::CaptureWriter::Pointer Service::getCapture() const
+{
+    return m_capture;
+}
+
 void Service::publish()
 {
-    for (auto it : m_publish_handlers)
-    {
-        auto publisher = it.second;
+    // Keep payloads buffered within the publish handlers until the connection is (re)established
+    if (!m_transport || !m_transport->isConnected())
+        return;
 
-        while(publisher->hasPayload())
+    // Drain the publish handlers round-robin as long as the congestion window permits
+    bool pending = true;
+    while (pending && m_flow_control->isOpen())
+    {
+        pending = false;
+        for (auto &[topic, publisher] : m_publish_handlers)
         {
+            if (!publisher->hasPayload())
+                continue;
+
+            if (!m_flow_control->isOpen())
+                return;
+
             auto payload = publisher->pop();
-            m_client->publish(publisher->getTopic(), payload.data(), payload.size(), publisher->getQoS(), false);
+            const auto qos = publisher->getQoS();
+            const auto generation = m_flow_control->sent(qos);
+            const auto sent = std::chrono::steady_clock::now();
+
+            // The acknowledge is traced from the sending to the delivery callback
+            const auto trace_sent = Trace::isEnabled() ? Trace::now() : 0;
+            const auto trace_id = trace_sent ? Trace::nextId() : 0;
+
+            try
+            {
+                // The callback does not refer to the Service, the delivery might complete once the Service is destroyed
+                std::weak_ptr<FlowControl> flow = m_flow_control;
+                m_transport->publish(topic, payload, qos, [flow, publisher, qos, generation, sent, trace_sent, trace_id](bool delivered)
+                                     {
+                                        auto flow_control = flow.lock();
+                                        if (!delivered)
+                                        {
+                                            if (flow_control)
+                                            {
+                                                flow_control->failed(generation, qos);
+                                            }
+                                            publisher->getMetrics().failed();
+                                            return;
+                                        }
+
+                                        const std::chrono::duration<double> latency = std::chrono::steady_clock::now() - sent;
+                                        if (flow_control)
+                                        {
+                                            flow_control->acknowledged(generation, qos, latency.count());
+                                        }
+                                        publisher->getMetrics().acknowledged(latency.count());
+
+                                        if (trace_sent)
+                                        {
+                                            Trace::complete("ack", trace_sent, Trace::now(), trace_id, publisher->getTopic(), latency.count());
+                                        }
+
+                                        // Adaptive packet sizes depend on the acknowledge latency of the broker
+                                        if (publisher->getPayload().adaptive)
+                                        {
+                                            publisher->reportAckLatency(latency.count());
+                                        } });
+            }
+            catch (const std::exception &)
+            {
+                // TODO: The payload is lost, show message
+                m_flow_control->failed(generation, qos);
+                publisher->getMetrics().failed();
+                return;
+            }
+
+            publisher->getMetrics().sent(payload.size());
+
+            if (trace_sent)
+            {
+                Trace::complete("publish", trace_sent, Trace::now(), trace_id, topic, static_cast<double>(payload.size()));
+            }
+
+            pending = pending || publisher->hasPayload();
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,91 @@
+#include "capture/CaptureWriter.h"
+
+using namespace plugin::mqtt::capture;
+
+CaptureWriter::CaptureWriter(const std::string &path, std::size_t max_pending_bytes) : m_file(path, std::ios::binary | std::ios::trunc),
+                                                                                      m_max_pending_bytes(max_pending_bytes),
+                                                                                      m_start(std::chrono::steady_clock::now()),
+                                                                                      m_pending_bytes(0),
+                                                                                      m_queued(0),
+                                                                                      m_written(0),
+                                                                                      m_stop(false),
+                                                                                      m_dropped(0)
+{
+    if (!m_file)
+        throw std::runtime_error("Unable to create capture file " + path);
+
+    writeHeader(m_file);
+    m_thread = std::thread(&CaptureWriter::run, this);
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+void CaptureWriter::write(RecordKind kind, const Timestamp &timestamp, const std::string &topic, const std::string &payload)
+{
+    const auto arrival = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start);
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        if (m_pending_bytes > m_max_pending_bytes)
+        {
+            m_dropped++;
+            return;
+        }
+
+        m_pending.push_back({kind, static_cast<std::uint64_t>(arrival.count()), timestamp, topic, payload});
+        m_pending_bytes += topic.size() + payload.size();
+        m_queued++;
+    }
+    m_cv.notify_all();
+}
+
+void CaptureWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mtx);
+    const auto queued = m_queued;
+    m_cv.wait(lock, [this, queued]
+              { return m_written >= queued; });
+}
+
+std::uint64_t CaptureWriter::getDropped() const
+{
+    return m_dropped;
+}
+
+void CaptureWriter::run()
+{
+    std::vector<Record> records;
+    std::unique_lock<std::mutex> lock(m_mtx);
+
+    while (true)
+    {
+        m_cv.wait(lock, [this]
+                  { return m_stop || !m_pending.empty(); });
+
+        if (m_pending.empty() && m_stop)
+            break;
+
+        records.swap(m_pending);
+        m_pending_bytes = 0;
+
+        // Write without holding the lock, the MQTT threads keep on queuing meanwhile
+        lock.unlock();
+        for (const auto &record : records)
+        {
+            writeRecord(m_file, record);
+        }
+        m_file.flush();
+        lock.lock();
+
+        m_written += records.size();
+        records.clear();
+        m_cv.notify_all();
+    }
+}
@@ -0,0 +1,76 @@
+#include "capture/Replay.h"
+
+//
+#include <chrono>
+#include <optional>
+#include <thread>
+
+using namespace plugin::mqtt;
+using namespace plugin::mqtt::capture;
+
+Replay::Replay(const std::string &path, LoopbackTransport &transport) : m_file(path, std::ios::binary),
+                                                                        m_transport(transport),
+                                                                        m_ticks(0),
+                                                                        m_frequency(1.0)
+{
+    if (!m_file)
+        throw std::runtime_error("Unable to open capture file " + path);
+
+    readHeader(m_file);
+}
+
+void Replay::setStartCallback(std::function<void()> on_start)
+{
+    m_on_start = std::move(on_start);
+}
+
+Timestamp Replay::now() const
+{
+    return Timestamp(m_ticks, m_frequency);
+}
+
+Replay::Statistics Replay::run(Speed speed)
+{
+    Statistics statistics{0, 0, 0.0};
+
+    const auto start = std::chrono::steady_clock::now();
+    std::optional<std::uint64_t> first_arrival;
+
+    Record record;
+    while (readRecord(m_file, record))
+    {
+        if (speed == Speed::Realtime)
+        {
+            if (!first_arrival)
+            {
+                first_arrival = record.arrival;
+            }
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(record.arrival - first_arrival.value()));
+        }
+
+        m_frequency = record.timestamp.frequency;
+        m_ticks = record.timestamp.ticks;
+
+        switch (record.kind)
+        {
+        case RecordKind::Start:
+            if (m_on_start)
+            {
+                m_on_start();
+            }
+            break;
+        case RecordKind::Message:
+            statistics.messages++;
+            if (m_transport.inject(make_message(record.topic, record.payload)))
+            {
+                statistics.delivered++;
+            }
+            break;
+        }
+    }
+
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    statistics.duration = duration.count();
+
+    return statistics;
+}
@@ -7,10 +7,14 @@
 #include <fmt/core.h>
 
 //
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <map>
+#include <set>
 #include <sstream>
+#include <vector>
 
 using namespace plugin::mqtt::config;
 using nlohmann::json;
@@ -123,13 +127,73 @@ void Configuration::writeToFile(const std::string path, const json &document)
     ofs.close();
 }
 
-Configuration::ConfigResult Configuration::load(const std::string cache)
+void Configuration::writeToFile(const std::string path, const std::string &content)
+{
+    std::ofstream ofs(path, std::ofstream::trunc | std::ofstream::binary);
+    ofs << content;
+    ofs.close();
+}
+
+std::uint64_t Configuration::hash(const std::string &content)
+{
+    std::uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : content)
+    {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+void Configuration::writeBinaryCache(const std::string path, const json &document, std::uint64_t content_hash)
+{
+    // The document has been validated against the schema of this plugin release only
+    const auto schema_hash = hash(plugin::mqtt::config::details::configuration_file_schema.dump());
+    const auto cbor = json::to_cbor(json{{"hash", content_hash}, {"schema", schema_hash}, {"document", document}});
+
+    std::ofstream ofs(path, std::ofstream::trunc | std::ofstream::binary);
+    ofs.write(reinterpret_cast<const char *>(cbor.data()), cbor.size());
+    ofs.close();
+}
+
+Configuration::ConfigResult Configuration::loadBinaryCache(const std::string path, std::uint64_t content_hash)
+{
+    ConfigResult res;
+
+    std::ifstream t(path, std::ifstream::binary | std::ifstream::ate);
+    if (!t)
+    {
+        res.msg = "Binary cache does not exist.";
+        res.error = true;
+        return res;
+    }
+
+    std::vector<std::uint8_t> cbor(static_cast<std::size_t>(t.tellg()));
+    t.seekg(0);
+    t.read(reinterpret_cast<char *>(cbor.data()), cbor.size());
+
+    // A damaged or outdated cache is ignored, the configuration is loaded from its content instead
+    const auto schema_hash = hash(plugin::mqtt::config::details::configuration_file_schema.dump());
+    json cache = json::from_cbor(cbor, true, false);
+    if (cache.is_discarded() || !cache.is_object() || !cache.contains("document") ||
+        cache.value("hash", std::uint64_t(0)) != content_hash || cache.value("schema", std::uint64_t(0)) != schema_hash)
+    {
+        res.msg = "Binary cache is outdated.";
+        res.error = true;
+        return res;
+    }
+
+    res.document = std::move(cache["document"]);
+    res.error = false;
+    return res;
+}
+
+Configuration::ConfigResult Configuration::parse(const std::string &content, json &d)
 {
     ConfigResult res;
-    json d;
     try
     {
-        d = json::parse(cache);
+        d = json::parse(content);
     }
     catch (json::parse_error &ex)
     {
@@ -153,8 +217,11 @@ Configuration::ConfigResult Configuration::load(const std::string cache)
         return res;
     }
 
-    // Dereference JSON
-    dereference(d);
+    // Dereference JSON, documents without references are not traversed
+    if (content.find("\"$ref\"") != std::string::npos)
+    {
+        dereference(d);
+    }
 
     // Check Schema
     try
@@ -169,10 +236,30 @@ Configuration::ConfigResult Configuration::load(const std::string cache)
         return res;
     }
 
+    res.error = false;
+    return res;
+}
+
+Configuration::ConfigResult Configuration::load(const std::string cache)
+{
+    json d;
+    auto res = parse(cache, d);
+    if (res.error)
+    {
+        return res;
+    }
+
+    return loadValidated(std::move(d));
+}
+
+Configuration::ConfigResult Configuration::loadValidated(json d)
+{
+    ConfigResult res;
+
     // Load subscriptions from JSON
     try
     {
-        Topic::fromJson(d, m_topics);
+        Topic::fromJson(d, m_topics, m_clock_domains);
         m_servers = d.get<Servers>();
     }
     catch (const std::exception &e)
@@ -183,6 +270,185 @@ Configuration::ConfigResult Configuration::load(const std::string cache)
         return res;
     }
 
+    m_document = d;
+    res.document = std::move(d);
+    res.error = false;
+    return res;
+}
+
+namespace
+{
+    /**
+     * @brief Copy of a configuration without the identifiers generated by the plugin (e.g. "__uuid")
+     * A configuration file compares equal to the cached document it has been loaded to
+     */
+    json withoutGeneratedKeys(const json &j)
+    {
+        if (!j.is_object())
+        {
+            return j;
+        }
+
+        json stripped = json::object();
+        for (auto &[key, item] : j.items())
+        {
+            if (key.rfind("__", 0) != 0)
+            {
+                stripped[key] = withoutGeneratedKeys(item);
+            }
+        }
+        return stripped;
+    }
+
+    /**
+     * @brief Copy the identifiers generated by the plugin from the current configuration of a changed topic
+     * Objects are matched by key, array elements (e.g. the channels of a sync topic) by name or else by position.
+     * Channels keep their UUID unless they are removed or moved, hence their Oxygen channels are kept.
+     * @param previous The current configuration of the topic
+     * @param item The changed configuration of the topic
+     */
+    void carryGeneratedKeys(const json &previous, json &item)
+    {
+        if (previous.is_object() && item.is_object())
+        {
+            for (auto &[key, value] : previous.items())
+            {
+                if (key.rfind("__", 0) == 0)
+                {
+                    if (!item.contains(key))
+                    {
+                        item[key] = value;
+                    }
+                }
+                else if (item.contains(key))
+                {
+                    carryGeneratedKeys(value, item[key]);
+                }
+            }
+        }
+        else if (previous.is_array() && item.is_array())
+        {
+            for (std::size_t n = 0; n < item.size(); ++n)
+            {
+                auto &element = item[n];
+                if (element.is_object() && element.contains("name"))
+                {
+                    auto match = std::find_if(previous.begin(), previous.end(), [&element](const json &p)
+                                              { return p.is_object() && p.contains("name") && p["name"] == element["name"]; });
+                    if (match != previous.end())
+                    {
+                        carryGeneratedKeys(*match, element);
+                    }
+                }
+                else if (n < previous.size())
+                {
+                    carryGeneratedKeys(previous[n], element);
+                }
+            }
+        }
+    }
+}
+
+Configuration::ConfigResult Configuration::reload(const std::string content, Changes &changes)
+{
+    if (m_document.is_null())
+    {
+        auto res = load(content);
+        if (!res.error)
+        {
+            changes.added = m_topics;
+        }
+        return res;
+    }
+
+    json d;
+    auto res = parse(content, d);
+    if (res.error)
+    {
+        return res;
+    }
+
+    // Unchanged topics keep the identifiers of the current document, only the others are created
+    const auto previous = m_document.value("topics", json::object());
+    json created = {{"topics", json::object()}};
+    std::set<std::string> unchanged;
+
+    if (d.contains("topics"))
+    {
+        for (auto &[path, item] : d["topics"].items())
+        {
+            auto it = previous.find(path);
+            if (it != previous.end() && withoutGeneratedKeys(*it) == withoutGeneratedKeys(item))
+            {
+                item = *it;
+                unchanged.insert(path);
+            }
+            else
+            {
+                // Channels of a changed topic keep their identifiers
+                if (it != previous.end())
+                {
+                    carryGeneratedKeys(*it, item);
+                }
+                created["topics"][path] = item;
+            }
+        }
+    }
+
+    Topics added;
+    Servers servers;
+    try
+    {
+        Topic::fromJson(created, added, m_clock_domains);
+        servers = d.get<Servers>();
+    }
+    catch (const std::exception &e)
+    {
+        // The current configuration stays in place
+        res.msg = "An unknown error occured while parsing the configuration.";
+        res.error = true;
+        return res;
+    }
+
+    // Reflect the identifiers of created topics to the new document
+    for (auto &[path, item] : created["topics"].items())
+    {
+        d["topics"][path] = item;
+    }
+
+    // Keep the order of the document
+    std::map<std::string, Topic::Pointer> topics;
+    for (auto &topic : m_topics)
+    {
+        if (unchanged.count(topic->getPath()) > 0)
+        {
+            topics[topic->getPath()] = topic;
+        }
+        else
+        {
+            changes.removed.push_back(topic);
+        }
+    }
+
+    for (auto &topic : added)
+    {
+        topics[topic->getPath()] = topic;
+    }
+
+    m_topics.clear();
+    for (auto &[path, topic] : topics)
+    {
+        m_topics.push_back(topic);
+    }
+
+    changes.added = std::move(added);
+    changes.servers_changed = d.value("servers", json()) != m_document.value("servers", json());
+    if (changes.servers_changed)
+    {
+        m_servers = servers;
+    }
+
+    m_document = d;
     res.document = d;
     res.error = false;
     return res;
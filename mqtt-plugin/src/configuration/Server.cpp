@@ -7,6 +7,36 @@ std::string Server::getUrl() const
     return m_url;
 }
 
+std::optional<int> Server::getMaxInflight() const
+{
+    return m_max_inflight;
+}
+
+std::optional<std::string> Server::getCaptureFile() const
+{
+    return m_capture_file;
+}
+
+bool Server::getDiagnostics() const
+{
+    return m_diagnostics;
+}
+
+std::optional<std::string> Server::getTraceFile() const
+{
+    return m_trace_file;
+}
+
+std::optional<std::string> Server::getUsername() const
+{
+    return m_username;
+}
+
+std::optional<std::string> Server::getPassword() const
+{
+    return m_password;
+}
+
 void plugin::mqtt::config::from_json(const json &d, Servers &servers)
 {
     if (!d.contains("servers"))
@@ -19,6 +49,36 @@ void plugin::mqtt::config::from_json(const json &d, Servers &servers)
         auto config = std::make_shared<Server>();
         config->m_url = server["url"];
 
+        if (server.contains("max-inflight"))
+        {
+            config->m_max_inflight = server["max-inflight"].get<int>();
+        }
+
+        if (server.contains("capture"))
+        {
+            config->m_capture_file = server["capture"].get<std::string>();
+        }
+
+        if (server.contains("diagnostics"))
+        {
+            config->m_diagnostics = server["diagnostics"].get<bool>();
+        }
+
+        if (server.contains("trace"))
+        {
+            config->m_trace_file = server["trace"].get<std::string>();
+        }
+
+        if (server.contains("username"))
+        {
+            config->m_username = server["username"].get<std::string>();
+        }
+
+        if (server.contains("password"))
+        {
+            config->m_password = server["password"].get<std::string>();
+        }
+
         servers.push_back(config);
     }
 }
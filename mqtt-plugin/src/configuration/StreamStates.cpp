@@ -0,0 +1,93 @@
+#include "configuration/StreamStates.h"
+
+//
+#include <nlohmann/json.hpp>
+
+//
+#include <fstream>
+
+using namespace plugin::mqtt::config;
+using nlohmann::json;
+
+StreamStates StreamStates::load(const std::string &path)
+{
+    StreamStates states;
+
+    std::ifstream t(path, std::ifstream::binary | std::ifstream::ate);
+    if (!t)
+    {
+        return states;
+    }
+
+    std::vector<std::uint8_t> cbor(static_cast<std::size_t>(t.tellg()));
+    t.seekg(0);
+    t.read(reinterpret_cast<char *>(cbor.data()), cbor.size());
+
+    // A damaged file is ignored, streams start from their nominal sample rate
+    json j = json::from_cbor(cbor, true, false);
+    if (j.is_discarded() || !j.is_object() || !j.contains("streams") || !j["streams"].is_object())
+    {
+        return states;
+    }
+
+    for (const auto &[uuid, stream] : j["streams"].items())
+    {
+        // Damaged entries are skipped, the other streams still warm-start
+        if (stream.is_object() && stream.contains("sampling-interval") && stream["sampling-interval"].is_number() &&
+            stream.contains("packet-size") && stream["packet-size"].is_number_unsigned())
+        {
+            states.m_states[uuid] = {stream["sampling-interval"].get<double>(), stream["packet-size"].get<std::size_t>()};
+        }
+    }
+
+    return states;
+}
+
+void StreamStates::save(const std::string &path) const
+{
+    json streams = json::object();
+    for (const auto &[uuid, state] : m_states)
+    {
+        streams[uuid] = {{"sampling-interval", state.sampling_interval}, {"packet-size", state.packet_size}};
+    }
+
+    const auto cbor = json::to_cbor(json{{"streams", streams}});
+
+    std::ofstream ofs(path, std::ofstream::trunc | std::ofstream::binary);
+    ofs.write(reinterpret_cast<const char *>(cbor.data()), cbor.size());
+    ofs.close();
+}
+
+void StreamStates::seed(const std::vector<Subscription::Pointer> &subscriptions) const
+{
+    for (const auto &subscription : subscriptions)
+    {
+        for (auto &channel : subscription->getChannels())
+        {
+            auto it = m_states.find(channel->getConfiguration().uuid);
+            if (it != m_states.end())
+            {
+                channel->getDecoder()->setWarmStart(it->second);
+            }
+        }
+    }
+}
+
+void StreamStates::update(const std::vector<Subscription::Pointer> &subscriptions)
+{
+    for (const auto &subscription : subscriptions)
+    {
+        for (auto &channel : subscription->getChannels())
+        {
+            if (auto state = channel->getDecoder()->getWarmStart())
+            {
+                m_states[channel->getConfiguration().uuid] = state.value();
+            }
+        }
+    }
+}
+
+const StreamStates::States &StreamStates::getStates() const
+{
+    return m_states;
+}
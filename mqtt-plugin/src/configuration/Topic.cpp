@@ -2,12 +2,22 @@
 #include "subscription/decoding/TextJsonDecoder.h"
 #include "subscription/decoding/TextPlainDecoder.h"
 #include "subscription/decoding/CborSyncDecoder.h"
+#include "subscription/decoding/PreviewDecoder.h"
+#include "resampling/Preview.h"
 #include "resampling/StreamClock.h"
 
 //
 #include "fmt/core.h"
 #include "uuid.h"
 
+//
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <optional>
+#include <random>
+#include <stdexcept>
+
 using namespace plugin::mqtt;
 using namespace plugin::mqtt::config;
 
@@ -26,6 +36,11 @@ Publish::Pointer Topic::getPublisher()
     return m_publish;
 }
 
+const std::string &Topic::getPath() const
+{
+    return m_path;
+}
+
 Operation Topic::getOperation()
 {
     return m_operation;
@@ -33,14 +48,45 @@ Operation Topic::getOperation()
 
 namespace
 {
+    /**
+     * @brief Generate a random UUID
+     * Creating a system generator per UUID is expensive, a single seeded engine is reused for all channels instead
+     * @return std::string
+     */
+    std::string generateUuid()
+    {
+        thread_local std::mt19937 engine = []
+        {
+            std::random_device device;
+            std::array<std::mt19937::result_type, std::mt19937::state_size> seed;
+            std::generate(seed.begin(), seed.end(), std::ref(device));
+            std::seed_seq sequence(seed.begin(), seed.end());
+            return std::mt19937(sequence);
+        }();
+        thread_local uuids::uuid_random_generator generator(engine);
+
+        return uuids::to_string(generator());
+    }
+
     inline void traverseJsonSchemaChannels(json &j, Topic::OxygenOutputChannelMap &map, json::json_pointer &pointer, Subscription::Pointer subscription)
     {
         for (auto &[key, value] : j.items())
         {
             if (value["type"] != "object")
             {
-                // The datatype of this channel
-                auto datatype = value["type"].get<Datatype>();
+                // The datatype of this channel, an array of numbers is a single sample of a vector channel
+                const bool is_array = value["type"] == "array";
+                auto datatype = is_array ? Datatype::Number : value["type"].get<Datatype>();
+
+                std::optional<std::size_t> dimension;
+                if (is_array)
+                {
+                    if (subscription->getSampling().mode != SamplingModes::Async)
+                    {
+                        throw std::invalid_argument(fmt::format("Array channel '{}' requires the sampling mode async.", key));
+                    }
+                    dimension = value["dimension"].get<std::size_t>();
+                }
 
                 std::string uuid;
                 if (value.count("__uuid") > 0)
@@ -49,8 +95,7 @@ namespace
                 }
                 else
                 {
-                    auto generator = uuids::uuid_system_generator{}();
-                    uuid = uuids::to_string(generator);
+                    uuid = generateUuid();
                     value["__uuid"] = uuid;
                 }
 
@@ -73,13 +118,21 @@ namespace
                 configuration.uuid = uuid;
                 configuration.datatype = datatype;
                 configuration.range = range;
+                configuration.dimension = dimension;
                 configuration.local_channel_id = INVALID_LOCAL_ID;
 
                 // Append the key to the json-path
                 pointer.push_back(key);
 
                 // Create Decoder
-                configuration.decoder = std::make_shared<TextJsonDecoder>(pointer, datatype);
+                if (dimension)
+                {
+                    configuration.decoder = std::make_shared<TextJsonDecoder>(pointer, *dimension);
+                }
+                else
+                {
+                    configuration.decoder = std::make_shared<TextJsonDecoder>(pointer, datatype);
+                }
 
                 // Reset JSON-Pointer
                 pointer.pop_back();
@@ -117,6 +170,52 @@ namespace
         traverseJsonSchemaChannels(j, group, pointer, subscription);
     }
 
+    // Names of the preview statistics, in order of Preview::STATISTICS
+    constexpr std::array<const char *, 3> PREVIEW_STATISTIC_NAMES = {"min", "max", "mean"};
+
+    /**
+     * @brief Add the preview channels of a sync channel, computed by the decoder of the channel
+     * The preview channels are added after the channel, hence their decoders are called after the decoder of the channel.
+     * @param source The configuration of the sync channel
+     * @param sample_rate
+     * @param rates Sample rates of the previews
+     * @param channels The channels of the output group
+     * @param subscription
+     */
+    inline void addPreviewChannels(const Channel::Configuration &source, int sample_rate, const std::vector<int> &rates, Topic::Channels &channels, Subscription::Pointer subscription)
+    {
+        if (rates.empty())
+        {
+            return;
+        }
+
+        auto preview = std::make_shared<Preview>(sample_rate, rates);
+        source.decoder->setPreview(preview);
+
+        for (std::size_t level = 0; level < rates.size(); ++level)
+        {
+            for (std::size_t n = 0; n < Preview::STATISTICS.size(); ++n)
+            {
+                const auto statistic = Preview::STATISTICS[n];
+                const auto name = PREVIEW_STATISTIC_NAMES[n];
+
+                Channel::Configuration configuration;
+                configuration.name = fmt::format("{} {} ({} Hz)", source.name, name, rates[level]);
+                // Derived from the channel, previews keep their Oxygen channels as long as the channel does
+                configuration.uuid = fmt::format("{}@preview/{}/{}", source.uuid, rates[level], name);
+                configuration.datatype = Datatype::Number;
+                configuration.decoder = std::make_shared<PreviewDecoder>(preview, level, statistic);
+                configuration.range = source.range;
+                configuration.local_channel_id = INVALID_LOCAL_ID;
+                configuration.sample_rate = rates[level];
+
+                auto channel = std::make_shared<Channel>(std::move(configuration));
+                subscription->addChannel(channel);
+                channels.push_back(channel);
+            }
+        }
+    }
+
     inline std::string insertOrGetUuidFromSchema(json &schema)
     {
         std::string uuid;
@@ -126,8 +225,7 @@ namespace
         }
         else
         {
-            auto generator = uuids::uuid_system_generator{}();
-            uuid = uuids::to_string(generator);
+            uuid = generateUuid();
             schema["__uuid"] = uuid;
         }
 
@@ -135,15 +233,13 @@ namespace
     }
 }
 
-void Topic::fromJson(json &d, Topics &topics)
+void Topic::fromJson(json &d, Topics &topics, ClockDomains &clock_domains)
 {
     if (!d.contains("topics"))
     {
         return;
     }
 
-    std::map<std::string, StreamClock::Pointer> stream_clocks;
-
     // Load Topics, filter for subscriptions
     for (auto &[path, item] : d["topics"].items())
     {
@@ -158,6 +254,7 @@ void Topic::fromJson(json &d, Topics &topics)
         {
             auto topic = std::make_shared<Topic>();
             topic->m_operation = Operation::Subscribe;
+            topic->m_path = path;
 
             // Sampling
             Subscription::Sampling sampling;
@@ -174,6 +271,31 @@ void Topic::fromJson(json &d, Topics &topics)
                 sampling.sample_rate = item["/subscribe/sampling/sample-rate"_json_pointer].get<double>();
             }
 
+            // Decimated min/max/mean channels of sync channels
+            std::vector<int> preview_rates;
+            if (item["/subscribe/sampling"_json_pointer].contains("preview"))
+            {
+                preview_rates = item["/subscribe/sampling/preview"_json_pointer].get<std::vector<int>>();
+            }
+
+            // Configured streams resynchronise after outages unless disabled
+            Stream::Recovery recovery{true, GapFill::NaN};
+            if (item["/subscribe/sampling"_json_pointer].contains("resync"))
+            {
+                recovery.resync = item["/subscribe/sampling/resync"_json_pointer].get<bool>();
+            }
+
+            if (item["/subscribe/sampling"_json_pointer].contains("gap-fill"))
+            {
+                recovery.gap_fill = item["/subscribe/sampling/gap-fill"_json_pointer].get<GapFill>();
+            }
+
+            std::size_t reorder_depth = CborSyncDecoder::DEFAULT_REORDER_DEPTH;
+            if (item["/subscribe/sampling"_json_pointer].contains("reorder-depth"))
+            {
+                reorder_depth = item["/subscribe/sampling/reorder-depth"_json_pointer].get<std::size_t>();
+            }
+
             // The underlying Subscription object
             auto subscription = std::make_shared<Subscription>(std::move(sampling), path, QoS);
             topic->m_subscription = subscription;
@@ -225,12 +347,17 @@ void Topic::fromJson(json &d, Topics &topics)
             else if (payload.contains("cbor/json/sync"))
             {
                 auto &schema = payload["/cbor~1json~1sync/schema"_json_pointer];
-                // The Unique-Identifier of this channel (get or create)
-                auto uuid = insertOrGetUuidFromSchema(schema);
                 // The Datatype of this channel
                 auto datatype = schema["type"].get<Datatype>();
 
-                // Create or get the Stream-Clock for this subscription
+                // Samples are resampled in their native type, integer channels keep raw counts
+                auto sample_type = datatype == Datatype::Integer ? SampleType::Int32 : SampleType::Float64;
+                if (schema.contains("sample-type"))
+                {
+                    sample_type = schema["sample-type"].get<SampleType>();
+                }
+
+                // Create the Stream-Clock for this subscription
                 StreamClock::Pointer clock;
 
                 if (clock_domain.empty())
@@ -240,15 +367,13 @@ void Topic::fromJson(json &d, Topics &topics)
                 }
                 else
                 {
-                    if (stream_clocks.count(clock_domain))
-                    {
-                        clock = stream_clocks[clock_domain];
-                    }
-                    else
+                    // Every stream is a source of the domain, sharing its start
+                    auto &domain = clock_domains[clock_domain];
+                    if (!domain)
                     {
-                        clock = std::make_shared<StreamClock>();
-                        stream_clocks[clock_domain] = clock;
+                        domain = std::make_shared<ClockDomain>();
                     }
+                    clock = std::make_shared<StreamClock>(domain);
                 }
 
                 // Channel Range
@@ -264,26 +389,79 @@ void Topic::fromJson(json &d, Topics &topics)
                     }
                 }
 
-                Channel::Configuration configuration;
-                configuration.name = path;
-                configuration.uuid = uuid;
-                configuration.datatype = datatype;
-                configuration.decoder = std::make_shared<CborSyncDecoder>(datatype, sampling.sample_rate.value(), clock);
-                configuration.range = range;
-                configuration.local_channel_id = INVALID_LOCAL_ID;
-
-                // Create a channel and add it to the subscription
-                auto channel = std::make_shared<Channel>(std::move(configuration));
-                subscription->addChannel(channel);
-
                 // Cbor-Sync requires sampling to be of mode sync!
                 if (sampling.mode != SamplingModes::Sync)
                 {
                     throw std::invalid_argument(fmt::format("Sampling mode of {} must be of type sync when using cbor/json/sync payload decoder.", path));
                 }
 
-                // Append Channel to the Oxygen Output Channel Map as a Root-Level Channel
-                topic->m_output_channel_map.channels.push_back(channel);
+                if (schema.contains("channels"))
+                {
+                    // Several channels of a single frame share one resampled stream
+                    auto &channels = schema["channels"];
+                    std::vector<std::string> names;
+                    for (auto &c : channels)
+                    {
+                        names.push_back(c["name"].get<std::string>());
+                    }
+
+                    auto decoders = createCborSyncDecoders(sample_type, datatype, sampling.sample_rate.value(), clock, recovery, reorder_depth, names);
+
+                    // All channels are mapped to the path of this topic
+                    auto &group = topic->m_output_channel_map.group_channels[path];
+                    for (std::size_t n = 0; n < names.size(); ++n)
+                    {
+                        auto &channel_schema = channels[n];
+
+                        // Channels might override the range of the frame
+                        Range channel_range = range;
+                        if (channel_schema.contains("range"))
+                        {
+                            channel_range.min = channel_schema["range"]["min"].get<double>();
+                            channel_range.max = channel_schema["range"]["max"].get<double>();
+
+                            if (channel_schema["range"].contains("unit"))
+                            {
+                                channel_range.unit = channel_schema["range"]["unit"].get<std::string>();
+                            }
+                        }
+
+                        Channel::Configuration configuration;
+                        configuration.name = names[n];
+                        configuration.uuid = insertOrGetUuidFromSchema(channel_schema);
+                        configuration.datatype = datatype;
+                        configuration.decoder = decoders[n];
+                        configuration.range = channel_range;
+                        configuration.local_channel_id = INVALID_LOCAL_ID;
+
+                        // The decoders must be called in frame order, hence the channels are added in order
+                        auto channel = std::make_shared<Channel>(std::move(configuration));
+                        subscription->addChannel(channel);
+                        group.channels.push_back(channel);
+
+                        addPreviewChannels(channel->getConfiguration(), sampling.sample_rate.value(), preview_rates, group.channels, subscription);
+                    }
+                }
+                else
+                {
+                    Channel::Configuration configuration;
+                    configuration.name = path;
+                    // The Unique-Identifier of this channel (get or create)
+                    configuration.uuid = insertOrGetUuidFromSchema(schema);
+                    configuration.datatype = datatype;
+                    configuration.decoder = createCborSyncDecoders(sample_type, datatype, sampling.sample_rate.value(), clock, recovery, reorder_depth, {}).front();
+                    configuration.range = range;
+                    configuration.local_channel_id = INVALID_LOCAL_ID;
+
+                    // Create a channel and add it to the subscription
+                    auto channel = std::make_shared<Channel>(std::move(configuration));
+                    subscription->addChannel(channel);
+
+                    // Append Channel to the Oxygen Output Channel Map as a Root-Level Channel
+                    topic->m_output_channel_map.channels.push_back(channel);
+
+                    addPreviewChannels(channel->getConfiguration(), sampling.sample_rate.value(), preview_rates, topic->m_output_channel_map.channels, subscription);
+                }
             }
 
             // Finally append to topics
@@ -293,6 +471,7 @@ void Topic::fromJson(json &d, Topics &topics)
         {
             auto topic = std::make_shared<Topic>();
             topic->m_operation = Operation::Publish;
+            topic->m_path = path;
 
             // Sampling
             Publish::Sampling sampling;
@@ -306,12 +485,53 @@ void Topic::fromJson(json &d, Topics &topics)
             }
 
             auto &p = item["/publish/payload"_json_pointer];
-            auto datatype = p["type"].get<Datatype>();
-            int packet_size = 10;
+            Publish::Payload payload;
+            payload.datatype = p["type"].get<Datatype>();
+            payload.packet_size = 10;
+            payload.layout = ChannelLayout::Columnar;
+            payload.format = PayloadFormat::TextJson;
 
             if (p.contains("samples-per-packet"))
             {
-                packet_size = p["samples-per-packet"].get<int>();
+                payload.packet_size = p["samples-per-packet"].get<int>();
+            }
+
+            if (p.contains("format"))
+            {
+                payload.format = p["format"].get<PayloadFormat>();
+            }
+
+            // Trade bandwidth against latency
+            if (p.contains("max-latency"))
+            {
+                payload.max_latency = p["max-latency"].get<double>();
+            }
+
+            if (p.contains("adaptive"))
+            {
+                payload.adaptive = p["adaptive"].get<bool>();
+            }
+
+            if (p.contains("max-queued"))
+            {
+                payload.max_queued = p["max-queued"].get<std::size_t>();
+            }
+
+            // Several Oxygen channels can be bundled within a single payload
+            if (p.contains("channels"))
+            {
+                payload.channels = p["channels"].get<std::vector<std::string>>();
+
+                if (p.contains("layout"))
+                {
+                    payload.layout = p["layout"].get<ChannelLayout>();
+                }
+
+                // Bundled channels require a common timebase
+                if (sampling.mode != SamplingModes::Sync)
+                {
+                    throw std::invalid_argument(fmt::format("Sampling mode of {} must be of type sync when bundling several channels.", path));
+                }
             }
 
             // Oxygen Channel ID and UUID
@@ -328,21 +548,17 @@ void Topic::fromJson(json &d, Topics &topics)
                 }
                 else
                 {
-                    auto generator = uuids::uuid_system_generator{}();
-                    uuid = uuids::to_string(generator);
-
+                    uuid = generateUuid();
                     c["__uuid"] = uuid;
                 }
             }
             else
             {
-                auto generator = uuids::uuid_system_generator{}();
-                uuid = uuids::to_string(generator);
-
+                uuid = generateUuid();
                 item["__channel"]["__uuid"] = uuid;
             }
 
-            auto publish = std::make_shared<Publish>(path, uuid, sampling, datatype, packet_size, QoS);
+            auto publish = std::make_shared<Publish>(path, uuid, sampling, payload, QoS);
             topic->m_publish = publish;
 
             topics.push_back(std::move(topic));
@@ -0,0 +1,97 @@
+#include "diagnostics/DiagnosticChannels.h"
+
+//
+#include <algorithm>
+
+using namespace plugin::mqtt;
+using namespace plugin::mqtt::diagnostics;
+
+namespace
+{
+    void addSample(SampleSink &sink, const LocalId &id, std::uint64_t ticks, double value)
+    {
+        if (id)
+        {
+            sink.addSample(id.value(), ticks, value);
+        }
+    }
+}
+
+DiagnosticChannels::DiagnosticChannels(double interval) : m_interval(interval)
+{
+}
+
+void DiagnosticChannels::add(Subscription::Pointer subscription, Channels channels)
+{
+    m_entries.push_back({subscription, channels, subscription->getMetrics().getSnapshot()});
+}
+
+void DiagnosticChannels::remove(const Subscription::Pointer &subscription)
+{
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [&subscription](const Entry &entry)
+                                   { return entry.subscription == subscription; }),
+                    m_entries.end());
+}
+
+bool DiagnosticChannels::empty() const
+{
+    return m_entries.empty();
+}
+
+void DiagnosticChannels::reset()
+{
+    m_last = std::nullopt;
+}
+
+void DiagnosticChannels::process(SampleSink &sink, const Timestamp &now)
+{
+    if (m_entries.empty())
+        return;
+
+    if (!m_last)
+    {
+        // Begin the first interval
+        for (auto &entry : m_entries)
+        {
+            entry.previous = entry.subscription->getMetrics().getSnapshot();
+        }
+        m_last = now;
+        return;
+    }
+
+    const double elapsed = (now.ticks - m_last->ticks) / now.frequency;
+    if (elapsed < m_interval)
+        return;
+
+    for (auto &entry : m_entries)
+    {
+        const auto current = entry.subscription->getMetrics().getSnapshot();
+        const auto &previous = entry.previous;
+        const auto &channels = entry.channels;
+
+        addSample(sink, channels.messages_per_second, now.ticks, (current.messages - previous.messages) / elapsed);
+        addSample(sink, channels.bytes_per_second, now.ticks, (current.bytes - previous.bytes) / elapsed);
+        addSample(sink, channels.decode_failures_per_second, now.ticks, (current.decode_failures - previous.decode_failures) / elapsed);
+
+        // Percentile of payloads decoded within this interval only
+        LatencyHistogram::Buckets decode_time;
+        for (std::size_t n = 0; n < decode_time.size(); ++n)
+        {
+            decode_time[n] = current.decode_time[n] - previous.decode_time[n];
+        }
+        addSample(sink, channels.decode_time, now.ticks, LatencyHistogram::percentile(decode_time, 0.99) * 1e6);
+
+        if (current.stream)
+        {
+            const auto &stream = current.stream.value();
+            addSample(sink, channels.estimated_sample_rate, now.ticks, stream.estimated_sampling_rate.value_or(0));
+            addSample(sink, channels.nan_filled, now.ticks, static_cast<double>(stream.nan_filled));
+            addSample(sink, channels.unrecoverable, now.ticks, stream.unrecoverable ? 1.0 : 0.0);
+            addSample(sink, channels.resyncs, now.ticks, static_cast<double>(stream.resyncs));
+        }
+
+        entry.previous = current;
+    }
+
+    m_last = now;
+}
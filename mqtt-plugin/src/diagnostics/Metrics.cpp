@@ -0,0 +1,189 @@
+#include "diagnostics/Metrics.h"
+
+//
+#include <algorithm>
+#include <cmath>
+
+using namespace plugin::mqtt;
+using namespace plugin::mqtt::diagnostics;
+
+LatencyHistogram::LatencyHistogram()
+{
+    for (auto &bucket : m_buckets)
+    {
+        bucket = 0;
+    }
+}
+
+void LatencyHistogram::record(double seconds)
+{
+    // Bucket n holds durations below 2^n microseconds
+    std::size_t idx = 0;
+    auto micros = static_cast<std::uint64_t>(std::max(0.0, seconds * 1e6));
+    while (micros > 0 && idx < NUM_BUCKETS - 1)
+    {
+        micros >>= 1;
+        idx++;
+    }
+
+    m_buckets[idx].fetch_add(1, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Buckets LatencyHistogram::getBuckets() const
+{
+    Buckets buckets;
+    for (std::size_t n = 0; n < NUM_BUCKETS; ++n)
+    {
+        buckets[n] = m_buckets[n].load(std::memory_order_relaxed);
+    }
+    return buckets;
+}
+
+double LatencyHistogram::percentile(const Buckets &buckets, double p)
+{
+    std::uint64_t total = 0;
+    for (auto count : buckets)
+    {
+        total += count;
+    }
+
+    if (total == 0)
+    {
+        return 0.0;
+    }
+
+    const auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(p, 0.0, 1.0) * total));
+    std::uint64_t cumulative = 0;
+    for (std::size_t n = 0; n < NUM_BUCKETS; ++n)
+    {
+        cumulative += buckets[n];
+        if (cumulative >= rank && cumulative > 0)
+        {
+            return std::ldexp(1.0, static_cast<int>(n)) * 1e-6;
+        }
+    }
+
+    return std::ldexp(1.0, static_cast<int>(NUM_BUCKETS - 1)) * 1e-6;
+}
+
+TopicMetrics::TopicMetrics() : m_messages(0),
+                               m_bytes(0),
+                               m_decode_failures(0),
+                               m_has_stream(false),
+                               m_stream_rate(0),
+                               m_nan_filled(0),
+                               m_unrecoverable(false),
+                               m_gap_filled(0),
+                               m_resyncs(0),
+                               m_reordered_packets(0),
+                               m_dropped_packets(0),
+                               m_lost_packets(0),
+                               m_drift_ppm(0)
+{
+}
+
+void TopicMetrics::received(std::size_t bytes)
+{
+    m_messages.fetch_add(1, std::memory_order_relaxed);
+    m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void TopicMetrics::decodeFailed()
+{
+    m_decode_failures.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TopicMetrics::decoded(double seconds)
+{
+    m_decode_time.record(seconds);
+}
+
+void TopicMetrics::updateStream(const Stream::Statistics &statistics)
+{
+    m_stream_rate.store(statistics.estimated_sampling_rate.value_or(0), std::memory_order_relaxed);
+    m_nan_filled.store(statistics.nan_filled, std::memory_order_relaxed);
+    m_unrecoverable.store(statistics.unrecoverable, std::memory_order_relaxed);
+    m_gap_filled.store(statistics.gap_filled, std::memory_order_relaxed);
+    m_resyncs.store(statistics.resyncs, std::memory_order_relaxed);
+    m_reordered_packets.store(statistics.reordered_packets, std::memory_order_relaxed);
+    m_dropped_packets.store(statistics.dropped_packets, std::memory_order_relaxed);
+    m_lost_packets.store(statistics.lost_packets, std::memory_order_relaxed);
+    m_drift_ppm.store(statistics.drift_ppm.value_or(0), std::memory_order_relaxed);
+    m_has_stream.store(true, std::memory_order_release);
+}
+
+TopicMetrics::Snapshot TopicMetrics::getSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.messages = m_messages.load(std::memory_order_relaxed);
+    snapshot.bytes = m_bytes.load(std::memory_order_relaxed);
+    snapshot.decode_failures = m_decode_failures.load(std::memory_order_relaxed);
+    snapshot.decode_time = m_decode_time.getBuckets();
+
+    if (m_has_stream.load(std::memory_order_acquire))
+    {
+        Stream::Statistics stream;
+        const auto rate = m_stream_rate.load(std::memory_order_relaxed);
+        stream.estimated_sampling_rate = rate > 0 ? std::optional<int>(rate) : std::nullopt;
+        stream.nan_filled = m_nan_filled.load(std::memory_order_relaxed);
+        stream.unrecoverable = m_unrecoverable.load(std::memory_order_relaxed);
+        stream.gap_filled = m_gap_filled.load(std::memory_order_relaxed);
+        stream.resyncs = m_resyncs.load(std::memory_order_relaxed);
+        stream.reordered_packets = m_reordered_packets.load(std::memory_order_relaxed);
+        stream.dropped_packets = m_dropped_packets.load(std::memory_order_relaxed);
+        stream.lost_packets = m_lost_packets.load(std::memory_order_relaxed);
+        stream.drift_ppm = rate > 0 ? std::optional<double>(m_drift_ppm.load(std::memory_order_relaxed)) : std::nullopt;
+        snapshot.stream = stream;
+    }
+
+    return snapshot;
+}
+
+PublishMetrics::PublishMetrics() : m_queued(0),
+                                   m_dropped(0),
+                                   m_payloads(0),
+                                   m_bytes(0),
+                                   m_acknowledged(0),
+                                   m_failed(0)
+{
+}
+
+void PublishMetrics::setQueued(std::size_t queued)
+{
+    m_queued.store(queued, std::memory_order_relaxed);
+}
+
+void PublishMetrics::dropped(std::size_t count)
+{
+    m_dropped.fetch_add(count, std::memory_order_relaxed);
+}
+
+void PublishMetrics::sent(std::size_t bytes)
+{
+    m_payloads.fetch_add(1, std::memory_order_relaxed);
+    m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void PublishMetrics::acknowledged(double seconds)
+{
+    m_acknowledged.fetch_add(1, std::memory_order_relaxed);
+    m_ack_latency.record(seconds);
+}
+
+void PublishMetrics::failed()
+{
+    m_failed.fetch_add(1, std::memory_order_relaxed);
+}
+
+PublishMetrics::Snapshot PublishMetrics::getSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.queued = m_queued.load(std::memory_order_relaxed);
+    snapshot.dropped = m_dropped.load(std::memory_order_relaxed);
+    snapshot.payloads = m_payloads.load(std::memory_order_relaxed);
+    snapshot.bytes = m_bytes.load(std::memory_order_relaxed);
+    snapshot.acknowledged = m_acknowledged.load(std::memory_order_relaxed);
+    snapshot.failed = m_failed.load(std::memory_order_relaxed);
+    snapshot.ack_latency = m_ack_latency.getBuckets();
+    return snapshot;
+}
@@ -0,0 +1,178 @@
+#include "diagnostics/StatisticsReport.h"
+
+//
+#include <algorithm>
+#include <vector>
+
+using namespace plugin::mqtt;
+using namespace plugin::mqtt::diagnostics;
+
+namespace
+{
+    struct Registry
+    {
+        std::mutex mtx;
+        std::vector<StatisticsReport::Pointer> reports;
+    };
+
+    Registry &registry()
+    {
+        static Registry r;
+        return r;
+    }
+
+    /**
+     * @brief Percentiles of a latency histogram in milliseconds
+     */
+    json percentiles(const LatencyHistogram::Buckets &buckets)
+    {
+        return {
+            {"p50", LatencyHistogram::percentile(buckets, 0.5) * 1e3},
+            {"p90", LatencyHistogram::percentile(buckets, 0.9) * 1e3},
+            {"p99", LatencyHistogram::percentile(buckets, 0.99) * 1e3}};
+    }
+
+    json optionalValue(const std::optional<double> &value)
+    {
+        return value ? json(value.value()) : json(nullptr);
+    }
+}
+
+StatisticsReport::StatisticsReport(std::string name, Service &service) : m_name(std::move(name)),
+                                                                          m_service(service)
+{
+}
+
+const std::string &StatisticsReport::getName() const
+{
+    return m_name;
+}
+
+json StatisticsReport::rates(std::map<std::string, Counters> &previous, const std::string &topic, Counters current, double elapsed)
+{
+    auto it = previous.find(topic);
+    json rates = {{"messages_per_second", nullptr}, {"bytes_per_second", nullptr}};
+
+    // Rates are unknown until the second snapshot
+    if (it != previous.end() && elapsed > 0)
+    {
+        rates["messages_per_second"] = (current.messages - it->second.messages) / elapsed;
+        rates["bytes_per_second"] = (current.bytes - it->second.bytes) / elapsed;
+    }
+
+    previous[topic] = current;
+    return rates;
+}
+
+json StatisticsReport::getSnapshot()
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+
+    const auto now = std::chrono::steady_clock::now();
+    const std::chrono::duration<double> elapsed = m_last ? now - m_last.value() : std::chrono::duration<double>(0);
+    m_last = now;
+
+    json subscriptions = json::array();
+    for (auto &subscription : m_service.getSubscriptions())
+    {
+        const auto &topic = subscription->getTopic();
+        const auto metrics = subscription->getMetrics().getSnapshot();
+
+        json s = {
+            {"topic", topic},
+            {"active", subscription->isActive()},
+            {"messages", metrics.messages},
+            {"bytes", metrics.bytes},
+            {"decode_failures", metrics.decode_failures},
+            {"decode_time_ms", percentiles(metrics.decode_time)}};
+        s.update(rates(m_previous_subscriptions, topic, {metrics.messages, metrics.bytes}, elapsed.count()));
+
+        if (metrics.stream)
+        {
+            const auto &stream = metrics.stream.value();
+            s["stream"] = {
+                {"estimated_sample_rate", stream.estimated_sampling_rate ? json(stream.estimated_sampling_rate.value()) : json(nullptr)},
+                {"drift_ppm", optionalValue(stream.drift_ppm)},
+                {"nan_filled", stream.nan_filled},
+                {"gap_filled", stream.gap_filled},
+                {"resyncs", stream.resyncs},
+                {"reordered_packets", stream.reordered_packets},
+                {"dropped_packets", stream.dropped_packets},
+                {"lost_packets", stream.lost_packets},
+                {"unrecoverable", stream.unrecoverable}};
+        }
+
+        subscriptions.push_back(std::move(s));
+    }
+
+    json publishers = json::array();
+    for (auto &publisher : m_service.getPublishHandlers())
+    {
+        const auto topic = publisher->getTopic();
+        const auto metrics = publisher->getMetrics().getSnapshot();
+
+        json p = {
+            {"topic", topic},
+            {"queued", metrics.queued},
+            {"dropped", metrics.dropped},
+            {"payloads", metrics.payloads},
+            {"bytes", metrics.bytes},
+            {"acknowledged", metrics.acknowledged},
+            {"failed", metrics.failed},
+            {"ack_latency_ms", percentiles(metrics.ack_latency)}};
+        p.update(rates(m_previous_publishers, topic, {metrics.payloads, metrics.bytes}, elapsed.count()));
+
+        publishers.push_back(std::move(p));
+    }
+
+    const auto flow = m_service.getFlowStatistics();
+    json flow_control = {
+        {"window", flow.window},
+        {"in_flight", flow.in_flight},
+        {"acknowledged", flow.acknowledged},
+        {"failed", flow.failed},
+        {"round_trip_time_ms", flow.round_trip_time < 0 ? json(nullptr) : json(flow.round_trip_time * 1e3)},
+        {"min_round_trip_time_ms", flow.min_round_trip_time < 0 ? json(nullptr) : json(flow.min_round_trip_time * 1e3)}};
+
+    json snapshot = {
+        {"name", m_name},
+        {"subscriptions", subscriptions},
+        {"publish", publishers},
+        {"flow_control", flow_control}};
+
+    if (auto capture = m_service.getCapture())
+    {
+        snapshot["capture"] = {{"dropped", capture->getDropped()}};
+    }
+
+    return snapshot;
+}
+
+void StatisticsReport::add(Pointer report)
+{
+    std::lock_guard<std::mutex> lock(registry().mtx);
+    registry().reports.push_back(report);
+}
+
+void StatisticsReport::remove(const Pointer &report)
+{
+    std::lock_guard<std::mutex> lock(registry().mtx);
+    auto &reports = registry().reports;
+    reports.erase(std::remove(reports.begin(), reports.end(), report), reports.end());
+}
+
+json StatisticsReport::getAllSnapshots()
+{
+    std::vector<Pointer> reports;
+    {
+        std::lock_guard<std::mutex> lock(registry().mtx);
+        reports = registry().reports;
+    }
+
+    json snapshots = json::array();
+    for (auto &report : reports)
+    {
+        snapshots.push_back(report->getSnapshot());
+    }
+    return snapshots;
+}
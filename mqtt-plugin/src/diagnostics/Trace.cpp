@@ -0,0 +1,322 @@
+#include "diagnostics/Trace.h"
+
+//
+#include "nlohmann/json.hpp"
+
+//
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+using namespace plugin::mqtt::diagnostics;
+using nlohmann::json;
+
+/**
+ * @brief Fixed-size ring buffer of a single thread
+ * The owning thread is the only writer, the mutex is only contended while events are collected
+ */
+class Trace::Buffer
+{
+public:
+    Buffer(std::size_t capacity, std::uint32_t thread) : m_events(capacity), m_next(0), m_size(0), m_thread(thread), m_finished(false)
+    {
+    }
+
+    void push(const Event &event)
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_events[m_next] = event;
+        m_events[m_next].thread = m_thread;
+        m_next = (m_next + 1) % m_events.size();
+        m_size = std::min(m_size + 1, m_events.size());
+    }
+
+    void copyTo(std::vector<Event> &events)
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        const auto first = (m_next + m_events.size() - m_size) % m_events.size();
+        for (std::size_t n = 0; n < m_size; ++n)
+        {
+            events.push_back(m_events[(first + n) % m_events.size()]);
+        }
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_next = 0;
+        m_size = 0;
+    }
+
+    // The owning thread exited, no further events are recorded
+    void finish()
+    {
+        m_finished = true;
+    }
+
+    bool isFinished() const
+    {
+        return m_finished;
+    }
+
+private:
+    std::mutex m_mtx;
+    std::vector<Event> m_events;
+    std::size_t m_next;
+    std::size_t m_size;
+    const std::uint32_t m_thread;
+    std::atomic<bool> m_finished;
+};
+
+/**
+ * @brief All buffers in use, buffers outlive their threads until the events of finished threads have been collected
+ */
+struct Trace::Registry
+{
+    std::mutex mtx;
+    std::vector<std::shared_ptr<Buffer>> buffers;
+    std::size_t capacity = 65536;
+    std::size_t users = 0;
+    std::uint32_t next_thread = 0;
+    std::atomic<std::uint64_t> next_id{0};
+
+    // Requires the lock to be held
+    void clear()
+    {
+        buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [](const std::shared_ptr<Buffer> &buffer)
+                                     { return buffer->isFinished(); }),
+                      buffers.end());
+        for (auto &buffer : buffers)
+        {
+            buffer->clear();
+        }
+    }
+};
+
+namespace
+{
+    double toMicroseconds(std::uint64_t nanoseconds)
+    {
+        return nanoseconds / 1000.0;
+    }
+}
+
+Trace::Registry &Trace::registry()
+{
+    static Registry r;
+    return r;
+}
+
+std::atomic<bool> Trace::s_enabled{false};
+
+void Trace::enable(bool enable, std::size_t capacity)
+{
+    {
+        std::lock_guard<std::mutex> lock(registry().mtx);
+        registry().capacity = std::max<std::size_t>(1, capacity);
+    }
+    s_enabled.store(enable);
+}
+
+void Trace::acquire(std::size_t capacity)
+{
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    if (r.users++ == 0)
+    {
+        r.clear();
+        r.capacity = std::max<std::size_t>(1, capacity);
+        s_enabled.store(true);
+    }
+}
+
+bool Trace::release()
+{
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    if (r.users == 0 || --r.users > 0)
+        return false;
+
+    s_enabled.store(false);
+    return true;
+}
+
+std::uint64_t Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::uint64_t Trace::nextId()
+{
+    return ++registry().next_id;
+}
+
+Trace::Buffer &Trace::threadBuffer()
+{
+    // Marks the buffer as finished once the thread exits
+    struct Holder
+    {
+        std::shared_ptr<Buffer> buffer;
+
+        ~Holder()
+        {
+            if (buffer)
+            {
+                buffer->finish();
+            }
+        }
+    };
+
+    thread_local Holder holder;
+    if (!holder.buffer)
+    {
+        auto &r = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        holder.buffer = std::make_shared<Buffer>(r.capacity, ++r.next_thread);
+        r.buffers.push_back(holder.buffer);
+    }
+    return *holder.buffer;
+}
+
+void Trace::record(const char *name, Phase phase, std::uint64_t timestamp, std::uint64_t duration, std::uint64_t id, const std::string &label, double value)
+{
+    Event event;
+    event.name = name;
+    event.phase = phase;
+    event.timestamp = timestamp;
+    event.duration = duration;
+    event.id = id;
+    event.value = value;
+
+    const auto length = std::min(label.size(), sizeof(event.label) - 1);
+    std::memcpy(event.label, label.data(), length);
+    event.label[length] = '\0';
+
+    threadBuffer().push(event);
+}
+
+void Trace::complete(const char *name, std::uint64_t begin, std::uint64_t end, std::uint64_t id, const std::string &label, double value)
+{
+    // Spans begun while tracing was disabled are not stamped
+    if (!isEnabled() || begin == 0)
+        return;
+
+    record(name, Phase::Complete, begin, end > begin ? end - begin : 0, id, label, value);
+}
+
+void Trace::instant(const char *name, std::uint64_t timestamp, std::uint64_t id, const std::string &label, double value)
+{
+    if (!isEnabled())
+        return;
+
+    record(name, Phase::Instant, timestamp, 0, id, label, value);
+}
+
+void Trace::flowBegin(const char *name, std::uint64_t timestamp, std::uint64_t id)
+{
+    if (!isEnabled())
+        return;
+
+    record(name, Phase::FlowBegin, timestamp, 0, id, {}, 0);
+}
+
+void Trace::flowEnd(const char *name, std::uint64_t timestamp, std::uint64_t id)
+{
+    if (!isEnabled())
+        return;
+
+    record(name, Phase::FlowEnd, timestamp, 0, id, {}, 0);
+}
+
+std::vector<Trace::Event> Trace::collect()
+{
+    std::vector<std::shared_ptr<Buffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(registry().mtx);
+        buffers = registry().buffers;
+    }
+
+    std::vector<Event> events;
+    std::vector<std::shared_ptr<Buffer>> collected;
+    for (auto &buffer : buffers)
+    {
+        // A thread finished before copying does not record further events
+        const bool finished = buffer->isFinished();
+        buffer->copyTo(events);
+        if (finished)
+        {
+            collected.push_back(buffer);
+        }
+    }
+
+    if (!collected.empty())
+    {
+        std::lock_guard<std::mutex> lock(registry().mtx);
+        auto &all = registry().buffers;
+        for (auto &buffer : collected)
+        {
+            all.erase(std::remove(all.begin(), all.end(), buffer), all.end());
+        }
+    }
+
+    std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b)
+                     { return a.timestamp < b.timestamp; });
+    return events;
+}
+
+void Trace::clear()
+{
+    std::lock_guard<std::mutex> lock(registry().mtx);
+    registry().clear();
+}
+
+void Trace::writeChromeTrace(const std::string &path)
+{
+    const auto events = collect();
+    const auto origin = events.empty() ? 0 : events.front().timestamp;
+
+    json trace_events = json::array();
+    for (const auto &event : events)
+    {
+        json e = {
+            {"name", event.name},
+            {"cat", "mqtt"},
+            {"ph", std::string(1, static_cast<char>(event.phase))},
+            {"ts", toMicroseconds(event.timestamp - origin)},
+            {"pid", 1},
+            {"tid", event.thread}};
+
+        switch (event.phase)
+        {
+        case Phase::Complete:
+            e["dur"] = toMicroseconds(event.duration);
+            e["args"] = {{"id", event.id}, {"label", event.label}, {"value", event.value}};
+            break;
+        case Phase::Instant:
+            e["s"] = "t";
+            e["args"] = {{"id", event.id}, {"label", event.label}, {"value", event.value}};
+            break;
+        case Phase::FlowBegin:
+            e["id"] = event.id;
+            break;
+        case Phase::FlowEnd:
+            // Bind to the enclosing span, e.g. the hand-off to Oxygen
+            e["id"] = event.id;
+            e["bp"] = "e";
+            break;
+        }
+
+        trace_events.push_back(std::move(e));
+    }
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+    {
+        throw std::runtime_error("Unable to open trace file " + path);
+    }
+
+    file << json({{"traceEvents", trace_events}, {"displayTimeUnit", "ms"}}).dump();
+}
@@ -0,0 +1,186 @@
+#include "processing/Processor.h"
+#include "diagnostics/Trace.h"
+
+//
+#include <optional>
+
+using namespace plugin::mqtt;
+using plugin::mqtt::diagnostics::Trace;
+
+Processor::Processor(Service &service) : m_service(service)
+{
+}
+
+void Processor::process(SampleSink &sink, SampleSource &source, std::uint64_t master_ticks)
+{
+    std::lock_guard<std::mutex> lock(m_service.getLock());
+    processSubscriptions(sink, master_ticks);
+    processPublishHandlers(source);
+}
+
+void Processor::processSubscriptions(SampleSink &sink, std::uint64_t master_ticks)
+{
+    // The service handles multiple subscriptions
+    for (auto &subscription : m_service.getSubscriptions())
+    {
+        auto sampling = subscription->getSampling();
+        const auto handoff = Trace::isEnabled() ? Trace::now() : 0;
+        std::size_t num_samples = 0;
+
+        // A subscription can have multiple channels
+        for (auto channel : subscription->getChannels())
+        {
+            auto samples = channel->getAndClearSamples();
+            auto id = channel->getLocalChannelId();
+            num_samples += samples.size();
+            if (!id)
+            {
+                continue;
+            }
+
+            // Vector channels receive arrays of a fixed dimension
+            const auto dimension = channel->getConfiguration().dimension;
+
+            if (samples.size() == 0)
+            {
+                if (sampling.mode == SamplingModes::Async)
+                {
+                    if (dimension)
+                    {
+                        sink.addSample(id.value(), master_ticks, std::vector<double>(dimension.value(), 0.0));
+                    }
+                    else
+                    {
+                        sink.addSample(id.value(), master_ticks, 0.0);
+                    }
+                }
+            }
+
+            // Every channel buffers samples
+            for (auto &sample : samples)
+            {
+                // Handle different datatypes per channel
+                switch (channel->getDatatype())
+                {
+                case Datatype::Integer:
+                {
+                    switch (sampling.mode)
+                    {
+                    case SamplingModes::Async:
+                        sink.addSample(id.value(), sample.time.ticks, sample.pop_back<int>());
+                        break;
+                    case SamplingModes::Sync:
+                        sink.addSamples(id.value(), sample.time.ticks, sample.pop_values<int>());
+                        break;
+                    }
+                }
+                break;
+                case Datatype::Number:
+                {
+                    switch (sampling.mode)
+                    {
+                    case SamplingModes::Async:
+                        if (dimension)
+                        {
+                            sink.addSample(id.value(), sample.time.ticks, sample.pop_back<std::vector<double>>());
+                        }
+                        else
+                        {
+                            sink.addSample(id.value(), sample.time.ticks, sample.pop_back<double>());
+                        }
+                        break;
+                    case SamplingModes::Sync:
+                        sink.addSamples(id.value(), sample.time.ticks, sample.pop_values<double>());
+                        break;
+                    }
+                }
+                break;
+                case Datatype::String:
+                    sink.addSample(id.value(), sample.time.ticks, sample.pop_back<std::string>());
+                    break;
+                }
+            }
+        }
+
+        if (handoff)
+        {
+            // Link the hand-off to the arrival of all messages interpreted since the last cycle
+            for (auto trace_id : subscription->takeTraceIds())
+            {
+                Trace::flowEnd("message", handoff, trace_id);
+            }
+            Trace::complete("addSample", handoff, Trace::now(), 0, subscription->getTopic(), static_cast<double>(num_samples));
+        }
+    }
+}
+
+void Processor::processPublishHandlers(SampleSource &source)
+{
+    for (auto &publish : m_service.getPublishHandlers())
+    {
+        const auto read = Trace::isEnabled() ? Trace::now() : 0;
+
+        if (publish->getSampling().mode == SamplingModes::Sync)
+        {
+            // All bundled channels must be available and share a common timebase
+            std::vector<std::vector<value_t>> channels;
+            std::optional<double> common_sample_rate;
+            double timestamp = 0;
+            bool valid = true;
+
+            for (const auto &input : publish->getInputChannels())
+            {
+                std::vector<value_t> values;
+                double sample_rate = 0;
+
+                if (!source.readSync(input.channel->getValue(), values, sample_rate, timestamp))
+                {
+                    // TODO: Indicate wrong config (sampling modes do not match)
+                    valid = false;
+                    break;
+                }
+
+                if (common_sample_rate && common_sample_rate.value() != sample_rate)
+                {
+                    // TODO: Indicate wrong config (bundled channels do not share a timebase)
+                    valid = false;
+                    break;
+                }
+
+                if (!channels.empty() && channels.front().size() != values.size())
+                {
+                    // TODO: Indicate wrong config (bundled channels do not provide the same samples, e.g. a sample format not supported)
+                    valid = false;
+                    break;
+                }
+
+                common_sample_rate = sample_rate;
+                channels.push_back(std::move(values));
+            }
+
+            if (valid)
+            {
+                publish->addSyncChannels(std::move(channels), common_sample_rate.value(), timestamp);
+            }
+
+            // The value is the Oxygen time of the first sample read
+            Trace::complete("read", read, Trace::now(), 0, publish->getTopic(), timestamp);
+            continue;
+        }
+
+        // Async publish-handlers read the first input channel only
+        const auto input_channel_id = publish->getInputChannel()->getValue();
+        const bool valid = source.readAsync(input_channel_id, [&publish](double timestamp, const value_t &value)
+                                            { publish->addAsyncSample(timestamp, value); });
+        if (!valid)
+        {
+            // TODO: Indicate wrong config (sampling modes do not match)
+        }
+
+        // Async samples are encoded while reading
+        Trace::complete("read", read, Trace::now(), 0, publish->getTopic());
+    }
+
+    // Publish data if any
+    m_service.publish();
+}
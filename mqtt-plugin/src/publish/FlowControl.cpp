@@ -0,0 +1,150 @@
+#include "publish/FlowControl.h"
+
+//
+#include <algorithm>
+#include <cmath>
+
+using namespace plugin::mqtt;
+
+namespace
+{
+    // Initial congestion window
+    constexpr double INITIAL_WINDOW = 10.0;
+
+    // Smoothing factor of the acknowledge round-trip time
+    constexpr double RTT_WEIGHT = 1.0 / 8.0;
+
+    inline std::size_t qosIndex(int qos)
+    {
+        return static_cast<std::size_t>(std::clamp(qos, 0, 2));
+    }
+}
+
+FlowControl::FlowControl(std::size_t max_window, double target_delay) : m_max_window(std::max<std::size_t>(max_window, 1)),
+                                                                        m_target_delay(target_delay),
+                                                                        m_window(std::min(INITIAL_WINDOW, static_cast<double>(m_max_window))),
+                                                                        m_round_trip_time(-1.0),
+                                                                        m_min_round_trip_time(-1.0),
+                                                                        m_in_flight{0, 0, 0},
+                                                                        m_acknowledged(0),
+                                                                        m_failed(0),
+                                                                        m_generation(0),
+                                                                        m_recovery(0)
+{
+}
+
+void FlowControl::setMaxWindow(std::size_t max_window)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_max_window = std::max<std::size_t>(max_window, 1);
+    m_window = std::min(m_window, static_cast<double>(m_max_window));
+}
+
+bool FlowControl::isOpen() const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return static_cast<double>(inFlight()) < std::floor(m_window);
+}
+
+std::uint64_t FlowControl::sent(int qos)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_in_flight[qosIndex(qos)]++;
+    return m_generation;
+}
+
+void FlowControl::acknowledged(std::uint64_t generation, int qos, double round_trip_time)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_acknowledged++;
+
+    // Deliveries sent before a reset are neither in flight nor representative for the current connection
+    if (generation != m_generation)
+        return;
+
+    release(qos);
+
+    m_round_trip_time = m_round_trip_time < 0 ? round_trip_time : m_round_trip_time + RTT_WEIGHT * (round_trip_time - m_round_trip_time);
+    m_min_round_trip_time = m_min_round_trip_time < 0 ? round_trip_time : std::min(m_min_round_trip_time, round_trip_time);
+
+    if (m_recovery > 0)
+    {
+        m_recovery--;
+        return;
+    }
+
+    if (round_trip_time - m_min_round_trip_time > m_target_delay)
+    {
+        // Payloads queue up somewhere between here and the broker
+        decrease();
+    }
+    else
+    {
+        // Additive increase: about one payload per window acknowledged
+        m_window = std::min(m_window + 1.0 / m_window, static_cast<double>(m_max_window));
+    }
+}
+
+void FlowControl::failed(std::uint64_t generation, int qos)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_failed++;
+
+    if (generation != m_generation)
+        return;
+
+    release(qos);
+
+    if (m_recovery > 0)
+    {
+        m_recovery--;
+        return;
+    }
+
+    decrease();
+}
+
+void FlowControl::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_generation++;
+    m_in_flight = {0, 0, 0};
+    m_window = std::min(INITIAL_WINDOW, static_cast<double>(m_max_window));
+    m_round_trip_time = -1.0;
+    m_min_round_trip_time = -1.0;
+    m_recovery = 0;
+}
+
+FlowControl::Statistics FlowControl::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+
+    Statistics statistics;
+    statistics.round_trip_time = m_round_trip_time;
+    statistics.min_round_trip_time = m_min_round_trip_time;
+    statistics.window = m_window;
+    statistics.in_flight = m_in_flight;
+    statistics.acknowledged = m_acknowledged;
+    statistics.failed = m_failed;
+
+    return statistics;
+}
+
+std::size_t FlowControl::inFlight() const
+{
+    return m_in_flight[0] + m_in_flight[1] + m_in_flight[2];
+}
+
+void FlowControl::release(int qos)
+{
+    auto &count = m_in_flight[qosIndex(qos)];
+    if (count > 0)
+        count--;
+}
+
+void FlowControl::decrease()
+{
+    // Multiplicative decrease, then wait for the payloads already in flight before reacting again
+    m_window = std::max(m_window / 2.0, 1.0);
+    m_recovery = inFlight();
+}
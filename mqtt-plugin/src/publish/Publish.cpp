@@ -1,19 +1,71 @@
 #include "publish/Publish.h"
+#include "publish/encoding/TextJsonEncoder.h"
+#include "publish/encoding/CborSyncEncoder.h"
+#include "diagnostics/Trace.h"
+
+//
+#include <cmath>
 
 using namespace plugin::mqtt;
 
-Publish::Publish(std::string topic, std::string uuid, Publish::Sampling sampling, Datatype datatype, int packet_size, int QoS) : m_topic(topic),
-                                                                                                                                 m_uuid(uuid),
-                                                                                                                                 m_sampling(sampling),
-                                                                                                                                 m_input_channel(std::make_shared<odk::framework::EditableChannelIDProperty>()),
-                                                                                                                                 m_next_idx(0),
-                                                                                                                                 m_datatype(datatype),
-                                                                                                                                 m_packet_size(packet_size),
-                                                                                                                                 m_qos(QoS),
-                                                                                                                                 m_packet_idx(0)
+namespace
+{
+    inline Publish::Payload singleChannelPayload(Datatype datatype, int packet_size)
+    {
+        Publish::Payload payload;
+        payload.datatype = datatype;
+        payload.packet_size = packet_size;
+        payload.layout = ChannelLayout::Columnar;
+        payload.format = PayloadFormat::TextJson;
+
+        return payload;
+    }
+
+    inline std::shared_ptr<Encoder> createEncoder(PayloadFormat format, Datatype datatype)
+    {
+        switch (format)
+        {
+        case PayloadFormat::TextJson:
+            return std::make_shared<TextJsonEncoder>(datatype);
+        case PayloadFormat::CborSync:
+            return std::make_shared<CborSyncEncoder>(datatype);
+        }
+
+        throw std::invalid_argument("Payload format is unknown.");
+    }
+}
+
+Publish::Publish(std::string topic, std::string uuid, Publish::Sampling sampling, Datatype datatype, int packet_size, int QoS) : Publish(topic, uuid, sampling, singleChannelPayload(datatype, packet_size), QoS)
 {
 }
 
+Publish::Publish(std::string topic, std::string uuid, Publish::Sampling sampling, Publish::Payload payload, int QoS) : m_qos(QoS),
+                                                                                                                    m_datatype(payload.datatype),
+                                                                                                                    m_topic(topic),
+                                                                                                                    m_uuid(uuid),
+                                                                                                                    m_sampling(sampling),
+                                                                                                                    m_payload(payload),
+                                                                                                                    m_encoder(createEncoder(payload.format, payload.datatype)),
+                                                                                                                    m_next_idx(0),
+                                                                                                                    m_packet_idx(0),
+                                                                                                                    m_packet_size(payload.packet_size),
+                                                                                                                    m_last_timestamp(0),
+                                                                                                                    m_ack_latency(-1)
+{
+    // Every bundled channel is selected by the user as a separate Oxygen input channel
+    if (m_payload.channels.empty())
+    {
+        m_inputs.push_back({"", std::make_shared<odk::framework::EditableChannelIDProperty>()});
+    }
+
+    for (const auto &name : m_payload.channels)
+    {
+        m_inputs.push_back({name, std::make_shared<odk::framework::EditableChannelIDProperty>()});
+    }
+
+    m_input_buffers.resize(m_inputs.size());
+}
+
 std::string Publish::getUuid() const
 {
     return m_uuid;
@@ -26,7 +78,12 @@ std::string Publish::getTopic() const
 
 std::shared_ptr<odk::framework::EditableChannelIDProperty> Publish::getInputChannel() const
 {
-    return m_input_channel;
+    return m_inputs.front().channel;
+}
+
+const Publish::Inputs &Publish::getInputChannels() const
+{
+    return m_inputs;
 }
 
 Publish::Sampling Publish::getSampling() const
@@ -36,9 +93,13 @@ Publish::Sampling Publish::getSampling() const
 
 void Publish::discardSamples()
 {
-    m_input_buffer.clear();
+    for (auto &buffer : m_input_buffers)
+    {
+        buffer.clear();
+    }
     m_output_buffer.clear();
     m_packet_idx = 0;
+    m_metrics.setQueued(0);
 }
 
 int Publish::getQoS() const
@@ -46,68 +107,153 @@ int Publish::getQoS() const
     return m_qos;
 }
 
-void Publish::addSyncSamples(std::vector<value_t> values, double sample_rate)
+const Publish::Payload &Publish::getPayload() const
+{
+    return m_payload;
+}
+
+diagnostics::PublishMetrics &Publish::getMetrics()
+{
+    return m_metrics;
+}
+
+void Publish::reportAckLatency(double seconds)
+{
+    // Exponential smoothing as used for round trip time estimation in TCP
+    const auto previous = m_ack_latency.load();
+    const auto smoothed = previous < 0 ? seconds : previous + (seconds - previous) / 8.0;
+
+    m_ack_latency.store(smoothed);
+}
+
+std::size_t Publish::getPacketSize(double sample_rate) const
 {
-    std::vector<value_t> downsampled;
+    std::size_t packet_size = m_packet_size;
 
-    // Downsample
-    int idx;
-    for (idx = m_next_idx; idx < values.size(); idx += m_sampling.downsampling_factor)
+    if (m_payload.adaptive)
     {
-        downsampled.push_back(values[idx]);
+        // Leave time for a payload to be acknowledged before the next one is sent, but never exceed the maximum latency
+        const auto ack_latency = m_ack_latency.load();
+        const auto max_latency = m_payload.max_latency.value_or(1.0);
+
+        if (ack_latency > 0)
+        {
+            packet_size = std::max(packet_size, static_cast<std::size_t>(std::ceil(2 * ack_latency * sample_rate)));
+        }
+
+        packet_size = std::min(packet_size, std::max<std::size_t>(1, static_cast<std::size_t>(max_latency * sample_rate)));
     }
 
-    // Remember idx to align with next samples
-    m_next_idx = idx - values.size();
-    m_input_buffer.insert(m_input_buffer.end(), downsampled.begin(), downsampled.end());
+    return packet_size;
+}
 
-    // can we actually create payloads based on currently buffered samples?
-    while (m_input_buffer.size() >= m_packet_size)
-    {
-        // Extract chunck of buffer
-        std::vector<value_t> sub(m_input_buffer.begin(), m_input_buffer.begin() + m_packet_size);
-        m_input_buffer.erase(m_input_buffer.begin(), m_input_buffer.begin() + m_packet_size);
+void Publish::addSyncSamples(std::vector<value_t> values, double sample_rate, double timestamp)
+{
+    std::vector<std::vector<value_t>> channels;
+    channels.push_back(std::move(values));
 
-        // Prepare JSON-Data
-        json j;
-        j["sampling"] = "sync";
-        j["idx"] = m_packet_idx;
-        j["data"] = json::array();
-        j["sample-rate"] = sample_rate / static_cast<double>(m_sampling.downsampling_factor);
-        auto &arr = j["data"];
+    addSyncChannels(std::move(channels), sample_rate, timestamp);
+}
 
-        try
-        {
+void Publish::addSyncChannels(std::vector<std::vector<value_t>> channels, double sample_rate, double timestamp)
+{
+    if (channels.size() != m_input_buffers.size())
+    {
+        throw std::invalid_argument(fmt::format("Publishing {} expects {} channels, got {}.", m_topic, m_input_buffers.size(), channels.size()));
+    }
 
-            for (auto sample : sub)
-            {
-                switch (m_datatype)
-                {
-                case Datatype::Integer:
-                {
-                    const auto out_value = std::get<int>(sample);
-                    arr.insert(arr.end(), out_value);
-                }
-                break;
-                case Datatype::Number:
-                {
-                    const auto out_value = std::get<double>(sample);
-                    arr.insert(arr.end(), out_value);
-                }
-                break;
-                }
-            }
-
-            m_packet_idx++;
-
-            auto str_rep = j.dump();
-            m_output_buffer.push_back(str_rep);
+    const auto num_values = channels.front().size();
+    for (const auto &values : channels)
+    {
+        if (values.size() != num_values)
+        {
+            throw std::invalid_argument(fmt::format("Channels published on {} do not share a common timebase.", m_topic));
         }
-        catch (...)
+    }
+
+    // Downsample, all channels share the same sample positions
+    const auto step = static_cast<std::size_t>(m_sampling.downsampling_factor);
+    std::size_t idx = m_next_idx;
+    for (std::size_t channel = 0; channel < channels.size(); ++channel)
+    {
+        auto &values = channels[channel];
+        auto &buffer = m_input_buffers[channel];
+
+        for (idx = m_next_idx; idx < values.size(); idx += step)
         {
-            // TODO we can end here if we have an issue when extracting a value from std::variant, display error?
+            buffer.push_back(values[idx]);
         }
     }
+
+    // Remember the timestamp of the last buffered sample
+    if (idx > m_next_idx)
+    {
+        const auto last_idx = idx - step;
+        m_last_timestamp = timestamp + static_cast<double>(last_idx) / sample_rate;
+    }
+
+    // Remember idx to align with next samples
+    m_next_idx = idx - num_values;
+
+    const auto output_sample_rate = sample_rate / static_cast<double>(m_sampling.downsampling_factor);
+    const auto packet_size = getPacketSize(output_sample_rate);
+
+    // can we actually create payloads based on currently buffered samples?
+    while (m_input_buffers.front().size() >= packet_size)
+    {
+        addSyncPacket(packet_size, sample_rate);
+    }
+
+    // Do not hold back samples longer than allowed, publish a partial packet instead
+    const auto buffered = m_input_buffers.front().size();
+    if (m_payload.max_latency && buffered > 0 && (buffered / output_sample_rate) >= m_payload.max_latency.value())
+    {
+        addSyncPacket(buffered, sample_rate);
+    }
+}
+
+void Publish::addSyncPacket(std::size_t num_samples, double sample_rate)
+{
+    // The value is the Oxygen time of the last sample buffered
+    diagnostics::TraceScope trace("encode", m_packet_idx, m_topic, m_last_timestamp);
+
+    try
+    {
+        auto str_rep = encodeSyncPacket(num_samples, sample_rate);
+        m_packet_idx++;
+
+        enqueue(std::move(str_rep));
+    }
+    catch (...)
+    {
+        // TODO we can end here if we have an issue when extracting a value from std::variant, display error?
+    }
+
+    // Remove chunk from buffers
+    for (auto &buffer : m_input_buffers)
+    {
+        buffer.erase(buffer.begin(), buffer.begin() + num_samples);
+    }
+}
+
+std::string Publish::encodeSyncPacket(std::size_t num_samples, double sample_rate)
+{
+    Encoder::SyncPacket packet;
+    packet.idx = m_packet_idx;
+    packet.sample_rate = sample_rate / static_cast<double>(m_sampling.downsampling_factor);
+    packet.channels = m_payload.channels;
+    packet.layout = m_payload.layout;
+
+    // The last sample of this packet is followed by the remaining buffered samples
+    const auto remaining = m_input_buffers.front().size() - num_samples;
+    packet.timestamp = m_last_timestamp - remaining / packet.sample_rate;
+
+    for (const auto &buffer : m_input_buffers)
+    {
+        packet.data.emplace_back(buffer.begin(), buffer.begin() + num_samples);
+    }
+
+    return m_encoder->encode(packet);
 }
 
 bool Publish::hasPayload()
@@ -117,7 +263,23 @@ bool Publish::hasPayload()
 
 std::string Publish::pop()
 {
-    auto res = m_output_buffer.front();
-    m_output_buffer.erase(m_output_buffer.begin());
+    auto res = std::move(m_output_buffer.front());
+    m_output_buffer.pop_front();
+    m_metrics.setQueued(m_output_buffer.size());
     return res;
-}
\ No newline at end of file
+}
+
+void Publish::enqueue(std::string payload)
+{
+    m_output_buffer.push_back(std::move(payload));
+
+    // Publishing fell behind (e.g. the broker is unreachable), the most recent payloads are kept
+    const auto limit = std::max<std::size_t>(1, m_payload.max_queued);
+    if (m_output_buffer.size() > limit)
+    {
+        const auto excess = m_output_buffer.size() - limit;
+        m_output_buffer.erase(m_output_buffer.begin(), m_output_buffer.begin() + static_cast<std::ptrdiff_t>(excess));
+        m_metrics.dropped(excess);
+    }
+    m_metrics.setQueued(m_output_buffer.size());
+}
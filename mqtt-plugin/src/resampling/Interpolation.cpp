@@ -0,0 +1,214 @@
+#include "resampling/Interpolation.h"
+
+//
+#if defined(MQTT_PLUGIN_AVX2)
+#include <immintrin.h>
+#endif
+
+using namespace plugin::mqtt::interpolation;
+
+namespace
+{
+    // Number of output samples computed per block
+    constexpr std::size_t BLOCK = 4;
+
+    // Sample counts up to 2^53 are converted to double exactly
+    constexpr std::uint64_t EXACT_DOUBLE = std::uint64_t(1) << 53;
+
+    /**
+     * Position of a single output sample, returns false if the sample is not enclosed by two input samples
+     */
+    inline bool position(std::uint64_t x, double x_samplerate, const InputVectorLabels &fp_time, std::size_t fp_size, std::int32_t &idx, double &t)
+    {
+        const double val = x / x_samplerate;
+        const double pos = fp_time.indexOfTime(val);
+
+        idx = static_cast<std::int32_t>(std::floor(pos));
+        t = pos - static_cast<double>(idx);
+
+        // element fp[idx + 1] is inaccessible
+        return idx >= 0 && static_cast<std::size_t>(idx) + 1 < fp_size;
+    }
+
+    /**
+     * Positions of a block of output samples, returns false if any sample is not enclosed by two input samples
+     */
+    inline bool positionBlock(std::uint64_t x, double x_samplerate, const InputVectorLabels &fp_time, std::size_t fp_size, std::int32_t *idx, double *t)
+    {
+#if defined(MQTT_PLUGIN_AVX2)
+        // Same operations in the same order as position(), the sample counts are exact (see EXACT_DOUBLE)
+        const __m256d lanes = _mm256_set_pd(3, 2, 1, 0);
+        const __m256d val = _mm256_div_pd(_mm256_add_pd(_mm256_set1_pd(static_cast<double>(x)), lanes), _mm256_set1_pd(x_samplerate));
+        const __m256d pos = _mm256_mul_pd(_mm256_set1_pd(fp_time.getScale()), _mm256_sub_pd(val, _mm256_set1_pd(fp_time.getStart())));
+
+        // Positions out of range of int32 convert to INT32_MIN and fail the bounds check
+        const __m128i i = _mm256_cvttpd_epi32(_mm256_floor_pd(pos));
+        const __m128i upper = _mm_set1_epi32(static_cast<std::int32_t>(fp_size - 1));
+        const __m128i valid = _mm_and_si128(_mm_cmpgt_epi32(i, _mm_set1_epi32(-1)), _mm_cmpgt_epi32(upper, i));
+        if (_mm_movemask_ps(_mm_castsi128_ps(valid)) != 0xF)
+        {
+            return false;
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(idx), i);
+        _mm256_storeu_pd(t, _mm256_sub_pd(pos, _mm256_cvtepi32_pd(i)));
+        return true;
+#else
+        // Branch free to allow the compiler to vectorise, the sample counts are exact (see EXACT_DOUBLE)
+        double pos[BLOCK];
+        bool valid = true;
+        for (std::size_t lane = 0; lane < BLOCK; ++lane)
+        {
+            pos[lane] = fp_time.indexOfTime((static_cast<double>(x) + lane) / x_samplerate);
+
+            // Equivalent to the bounds check of position(), NaN fails both comparisons
+            valid &= (pos[lane] >= 0) & (pos[lane] < static_cast<double>(fp_size - 1));
+        }
+        if (!valid)
+        {
+            return false;
+        }
+
+        // Truncating non-negative positions equals floor, without calling it
+        for (std::size_t lane = 0; lane < BLOCK; ++lane)
+        {
+            idx[lane] = static_cast<std::int32_t>(pos[lane]);
+            t[lane] = pos[lane] - static_cast<double>(idx[lane]);
+        }
+        return true;
+#endif
+    }
+
+    /**
+     * Interpolates a block of output samples
+     */
+    template <typename T>
+    inline void interpBlock(T *out, const std::int32_t *idx, const double *t, const T *fp)
+    {
+        using Promoted = typename SampleTraits<T>::Promoted;
+#if defined(MQTT_PLUGIN_AVX2)
+        // Input and output rate are about the same, consecutive output samples mostly use consecutive input samples
+        const bool consecutive = idx[BLOCK - 1] - idx[0] == BLOCK - 1;
+        if constexpr (std::is_same_v<T, double>)
+        {
+            __m256d a, b;
+            if (consecutive)
+            {
+                a = _mm256_loadu_pd(fp + idx[0]);
+                b = _mm256_loadu_pd(fp + idx[0] + 1);
+            }
+            else
+            {
+                const __m128i i = _mm_loadu_si128(reinterpret_cast<const __m128i *>(idx));
+                a = _mm256_i32gather_pd(fp, i, sizeof(double));
+                b = _mm256_i32gather_pd(fp + 1, i, sizeof(double));
+            }
+            _mm256_storeu_pd(out, _mm256_add_pd(a, _mm256_mul_pd(_mm256_sub_pd(b, a), _mm256_loadu_pd(t))));
+            return;
+        }
+        else if constexpr (std::is_same_v<T, float>)
+        {
+            __m128 a, b;
+            if (consecutive)
+            {
+                a = _mm_loadu_ps(fp + idx[0]);
+                b = _mm_loadu_ps(fp + idx[0] + 1);
+            }
+            else
+            {
+                const __m128i i = _mm_loadu_si128(reinterpret_cast<const __m128i *>(idx));
+                a = _mm_i32gather_ps(fp, i, sizeof(float));
+                b = _mm_i32gather_ps(fp + 1, i, sizeof(float));
+            }
+            _mm_storeu_ps(out, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm256_cvtpd_ps(_mm256_loadu_pd(t)))));
+            return;
+        }
+#endif
+        // Integer samples are rounded and clamped, which has no SIMD equivalent
+        for (std::size_t lane = 0; lane < BLOCK; ++lane)
+        {
+            out[lane] = lerp(fp[idx[lane]], fp[idx[lane] + 1], static_cast<Promoted>(t[lane]));
+        }
+    }
+}
+
+std::size_t plugin::mqtt::interpolation::positions(Kernel kernel, Positions &output, std::uint64_t x_start, double x_samplerate, std::size_t num, const InputVectorLabels &fp_time, std::size_t fp_size)
+{
+    output.idx.clear();
+    output.t.clear();
+
+    std::size_t n = 0;
+    const bool batched = kernel == Kernel::Batched && x_start + num < EXACT_DOUBLE && fp_size <= static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max());
+    if (batched)
+    {
+        output.idx.reserve(num);
+        output.t.reserve(num);
+
+        std::int32_t idx[BLOCK];
+        double t[BLOCK];
+        for (; n + BLOCK <= num; n += BLOCK)
+        {
+            if (!positionBlock(x_start + n, x_samplerate, fp_time, fp_size, idx, t))
+            {
+                break;
+            }
+            output.idx.insert(output.idx.end(), idx, idx + BLOCK);
+            output.t.insert(output.t.end(), t, t + BLOCK);
+        }
+    }
+
+    // The remaining samples and the block containing the last position one by one
+    for (; n < num; ++n)
+    {
+        std::int32_t idx;
+        double t;
+        if (!position(x_start + n, x_samplerate, fp_time, fp_size, idx, t))
+        {
+            return n;
+        }
+
+        output.idx.push_back(idx);
+        output.t.push_back(t);
+    }
+    return num;
+}
+
+template <typename T>
+void plugin::mqtt::interpolation::interp(Kernel kernel, std::vector<T> &output, const Positions &positions, const std::vector<T> &fp)
+{
+    using Promoted = typename SampleTraits<T>::Promoted;
+
+    const auto num = positions.size();
+    if (kernel == Kernel::Reference)
+    {
+        for (std::size_t n = 0; n < num; ++n)
+        {
+            const auto idx = positions.idx[n];
+            output.push_back(lerp(fp[idx], fp[idx + 1], static_cast<Promoted>(positions.t[n])));
+        }
+        return;
+    }
+
+    const auto offset = output.size();
+    output.resize(offset + num);
+
+    auto *out = output.data() + offset;
+    std::size_t n = 0;
+    for (; n + BLOCK <= num; n += BLOCK)
+    {
+        interpBlock(out + n, positions.idx.data() + n, positions.t.data() + n, fp.data());
+    }
+    for (; n < num; ++n)
+    {
+        const auto idx = positions.idx[n];
+        out[n] = lerp(fp[idx], fp[idx + 1], static_cast<Promoted>(positions.t[n]));
+    }
+}
+
+namespace plugin::mqtt::interpolation
+{
+    template void interp<std::int16_t>(Kernel, std::vector<std::int16_t> &, const Positions &, const std::vector<std::int16_t> &);
+    template void interp<std::int32_t>(Kernel, std::vector<std::int32_t> &, const Positions &, const std::vector<std::int32_t> &);
+    template void interp<float>(Kernel, std::vector<float> &, const Positions &, const std::vector<float> &);
+    template void interp<double>(Kernel, std::vector<double> &, const Positions &, const std::vector<double> &);
+}
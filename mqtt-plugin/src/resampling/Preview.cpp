@@ -0,0 +1,175 @@
+#include "resampling/Preview.h"
+
+//
+#include "fmt/core.h"
+
+//
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+using namespace plugin::mqtt;
+
+namespace
+{
+    constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+    constexpr double INF = std::numeric_limits<double>::infinity();
+}
+
+Preview::Preview(int sample_rate, std::vector<int> rates) : m_rates(std::move(rates))
+{
+    for (const auto rate : m_rates)
+    {
+        if (rate <= 0 || rate >= sample_rate || sample_rate % rate != 0)
+        {
+            throw std::invalid_argument(fmt::format("Preview rate {} Hz must divide the sample rate of {} Hz.", rate, sample_rate));
+        }
+
+        Level level{};
+        level.factor = static_cast<std::size_t>(sample_rate / rate);
+        m_levels.push_back(std::move(level));
+    }
+    reset();
+}
+
+void Preview::reset()
+{
+    for (auto &level : m_levels)
+    {
+        begin(level);
+        level.position = 0;
+        for (auto &output : level.output)
+        {
+            output.clear();
+        }
+    }
+}
+
+void Preview::skip(std::uint64_t num)
+{
+    for (auto &level : m_levels)
+    {
+        const auto total = level.count + num;
+        const auto blocks = total / level.factor;
+        if (blocks == 0)
+        {
+            level.count = static_cast<std::size_t>(total);
+            continue;
+        }
+
+        // The block in progress is completed with the samples received before, the skipped blocks are left out
+        if (level.count > 0)
+        {
+            complete(level);
+            level.position += blocks - 1;
+        }
+        else
+        {
+            level.position += blocks;
+        }
+
+        begin(level);
+        level.count = static_cast<std::size_t>(total % level.factor);
+    }
+}
+
+template <typename T>
+void Preview::append(const std::vector<T> &samples, const StreamBase::Gaps &gaps)
+{
+    for (auto &level : m_levels)
+    {
+        auto gap = gaps.begin();
+        std::size_t n = 0;
+        while (n < samples.size())
+        {
+            // Samples up to the end of the current block, checking for its end once per block
+            const auto end = std::min(samples.size(), n + level.factor - level.count);
+            for (; n < end; ++n)
+            {
+                while (gap != gaps.end() && n >= gap->offset + gap->count)
+                {
+                    ++gap;
+                }
+                const bool filled = gap != gaps.end() && n >= gap->offset;
+
+                const auto value = static_cast<double>(samples[n]);
+                if (!filled && !std::isnan(value))
+                {
+                    level.min = std::min(level.min, value);
+                    level.max = std::max(level.max, value);
+                    level.sum += value;
+                    level.valid++;
+                }
+                level.count++;
+            }
+
+            if (level.count == level.factor)
+            {
+                complete(level);
+            }
+        }
+    }
+}
+
+std::vector<double> Preview::getAndClearSamples(std::size_t level, Statistic statistic)
+{
+    auto &output = m_levels.at(level).output[static_cast<std::size_t>(statistic)];
+    if (output.empty())
+    {
+        return {};
+    }
+
+    auto samples = std::move(output.front().samples);
+    output.pop_front();
+    return samples;
+}
+
+std::uint64_t Preview::getPosition(std::size_t level, Statistic statistic) const
+{
+    const auto &l = m_levels.at(level);
+    const auto &output = l.output[static_cast<std::size_t>(statistic)];
+    return output.empty() ? l.position : output.front().position;
+}
+
+const std::vector<int> &Preview::getRates() const
+{
+    return m_rates;
+}
+
+void Preview::complete(Level &level)
+{
+    const bool valid = level.valid > 0;
+    const std::array<double, 3> values = {valid ? level.min : NaN, valid ? level.max : NaN, valid ? level.sum / static_cast<double>(level.valid) : NaN};
+
+    for (const auto statistic : STATISTICS)
+    {
+        // Begin a new run after skipped blocks
+        auto &output = level.output[static_cast<std::size_t>(statistic)];
+        if (output.empty() || output.back().position + output.back().samples.size() != level.position)
+        {
+            output.push_back({level.position, {}});
+        }
+        output.back().samples.push_back(values[static_cast<std::size_t>(statistic)]);
+    }
+
+    level.position++;
+    begin(level);
+}
+
+void Preview::begin(Level &level)
+{
+    level.count = 0;
+    level.valid = 0;
+    level.min = INF;
+    level.max = -INF;
+    level.sum = 0;
+}
+
+namespace plugin::mqtt
+{
+    template void Preview::append<std::int16_t>(const std::vector<std::int16_t> &, const StreamBase::Gaps &);
+    template void Preview::append<std::int32_t>(const std::vector<std::int32_t> &, const StreamBase::Gaps &);
+    template void Preview::append<float>(const std::vector<float> &, const StreamBase::Gaps &);
+    template void Preview::append<double>(const std::vector<double> &, const StreamBase::Gaps &);
+}
@@ -1,98 +1,75 @@
 #include "resampling/Stream.h"
 
 //
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <limits>
 #include <stdexcept>
+#include <type_traits>
 
 using namespace plugin::mqtt;
+using namespace plugin::mqtt::interpolation;
 
-namespace
+template <typename T>
+BasicStream<T>::BasicStream(StreamClock::Pointer clock, int nominal_sampling_rate) : BasicStream(clock, nominal_sampling_rate, Recovery{false, GapFill::NaN})
 {
-    /**
-     * Linear Interpolation function
-     */
-    inline double lerp(double a, double b, double t)
-    {
-        return a + (b - a) * t;
-    }
-
-    class InputVectorLabels
-    {
-    public:
-        InputVectorLabels(double start, double end, std::size_t size)
-            : m_start(start)
-              //, m_end(end)
-              //, m_size(static_cast<double>(size))
-              ,
-              m_scale(static_cast<double>(size) / (end - start)) // precompute the index scaling
-        {
-        }
-
-        inline double indexOfTime(double time) const
-        {
-            // return m_size * (time - m_start) / (m_end - m_start);
-            return m_scale * (time - m_start);
-        }
-
-    private:
-        double m_start;
-        // double m_end;
-        // double m_size;
-        double m_scale;
-    };
-
-    /**
-     * computes linearly interpolated output samples and pushes them to the vector
-     */
-    std::size_t interp(std::vector<double> &output, std::uint64_t x_start, double x_samplerate, std::size_t num, const InputVectorLabels &fp_time, const std::vector<double> &fp)
-    {
-        for (std::size_t n = 0; n < num; ++n)
-        {
-            double val = (x_start + n) / x_samplerate;
-            double pos = fp_time.indexOfTime(val);
-
-            const int idx = static_cast<int>(std::floor(pos));
-            const double t = pos - static_cast<double>(idx);
-
-            // Why do we need to check for negative idx?
-            if (idx + 1 >= fp.size() || idx < 0)
-            {
-                // element fp[idx + 1] is inaccessible, early return
-                return n;
-            }
-
-            double val_interp = lerp(fp[idx], fp[idx + 1], t);
-            output.push_back(val_interp);
-        }
-        return num;
-    }
-
 }
 
-Stream::Stream(StreamClock::Pointer clock, int nominal_sampling_rate) : m_clock(clock),
-                                                                        m_unrecoverable(false),
-                                                                        m_estimated_sampling_rate(std::nullopt),
-                                                                        m_nominal_sampling_interval(1 / static_cast<double>(nominal_sampling_rate)),
-                                                                        m_nominal_sampling_rate(nominal_sampling_rate),
-                                                                        m_actual_scnt(0),
-                                                                        m_packet_received_counter(0)
+template <typename T>
+BasicStream<T>::BasicStream(StreamClock::Pointer clock, int nominal_sampling_rate, Recovery recovery, std::size_t num_channels) : m_clock(clock),
+                                                                                                                     m_recovery(recovery),
+                                                                                                                     m_unrecoverable(false),
+                                                                                                                     m_estimated_sampling_rate(std::nullopt),
+                                                                                                                     m_nominal_sampling_interval(1 / static_cast<double>(nominal_sampling_rate)),
+                                                                                                                     m_nominal_sampling_rate(nominal_sampling_rate),
+                                                                                                                     m_actual_scnt(0),
+                                                                                                                     m_packet_received_counter(0),
+                                                                                                                     m_nan_filled(0),
+                                                                                                                     m_gap_filled(0),
+                                                                                                                     m_resyncs(0),
+                                                                                                                     m_kernel(Kernel::Batched),
+                                                                                                                     m_last_values(num_channels, SampleTraits<T>::invalid()),
+                                                                                                                     m_output_buffers(num_channels),
+                                                                                                                     m_input_buffers(num_channels),
+                                                                                                                     m_output_gaps(num_channels)
 {
+    if (num_channels == 0)
+    {
+        throw std::invalid_argument("A stream requires at least one channel.");
+    }
 }
 
-void Stream::reset()
+template <typename T>
+void BasicStream<T>::reset()
 {
     m_unrecoverable = false;
     m_estimated_sampling_rate = std::nullopt;
     m_estimated_sampling_interval = std::nullopt;
-    m_output_buffer.clear();
-    m_input_buffer.clear();
+    for (auto &buffer : m_output_buffers)
+    {
+        buffer.clear();
+    }
+    for (auto &buffer : m_input_buffers)
+    {
+        buffer.clear();
+    }
+    for (auto &gaps : m_output_gaps)
+    {
+        gaps.clear();
+    }
     m_actual_scnt = 0;
     m_packet_received_counter = 0;
+    m_nan_filled = 0;
+    m_gap_filled = 0;
+    m_resyncs = 0;
+    std::fill(m_last_values.begin(), m_last_values.end(), SampleTraits<T>::invalid());
 
     m_clock->resetSartOfStream();
 }
 
-void Stream::ensureValidStreamClock(double incoming_ts_seconds, std::uint64_t base_ticks, double base_frequency)
+template <typename T>
+void BasicStream<T>::ensureValidStreamClock(double incoming_ts_seconds, std::uint64_t base_ticks, double base_frequency)
 {
     if (!m_clock->startOfStreamSet())
     {
@@ -102,45 +79,167 @@ void Stream::ensureValidStreamClock(double incoming_ts_seconds, std::uint64_t ba
 
     if (!m_clock->validTimestamp(incoming_ts_seconds))
     {
-        throw std::runtime_error("Start of stream (timestamp) not valid, discard packet.");
+        if (!m_recovery.resync || m_packet_received_counter == 0)
+        {
+            throw std::runtime_error("Start of stream (timestamp) not valid, discard packet.");
+        }
+
+        // The clock of the publisher has been reset, re-anchor on the current Oxygen time
+        m_clock->reanchor(incoming_ts_seconds, base_ticks, base_frequency);
+        m_previous_aligned_ts_seconds = -std::numeric_limits<double>::infinity();
     }
 }
 
-void Stream::beginStream(std::vector<double> &samples, double incoming_ts_seconds)
+template <typename T>
+void BasicStream<T>::beginStream(const Channels &channels, double incoming_ts_seconds)
+{
+    // Align start of stream with oxygen time
+    anchor(channels, incoming_ts_seconds);
+}
+
+template <typename T>
+void BasicStream<T>::anchor(const Channels &channels, double incoming_ts_seconds)
 {
     // Remember nominal packet size
-    m_nominal_packet_size = samples.size();
+    const auto packet_size = channels.front().size();
+    m_nominal_packet_size = packet_size;
 
-    // Align start of stream with oxygen time
-    const auto num_samples = m_clock->alignSamples(incoming_ts_seconds, m_nominal_sampling_rate);
-    const int diff = num_samples - samples.size();
+    // Samples between the samples written so far and the first sample of the packet
+    const auto num_samples = static_cast<std::int64_t>(m_clock->alignSamples(incoming_ts_seconds, m_nominal_sampling_rate));
+    const auto diff = num_samples - static_cast<std::int64_t>(m_actual_scnt + packet_size);
+
+    // Remove samples at the front which have already been written
+    const auto skip = diff < 0 ? std::min(static_cast<std::size_t>(-diff), packet_size) : 0;
+
+    // A long outage (e.g. hours at a high rate) is not filled, the output continues at the current tick.
+    // The ticks of the buffered samples must stay contiguous, hence only once they have been taken
+    const bool outage_skipped = diff > static_cast<std::int64_t>(MAX_OUTAGE_SECONDS * m_nominal_sampling_rate) &&
+                                std::all_of(m_output_buffers.begin(), m_output_buffers.end(), [](const std::vector<T> &output)
+                                            { return output.empty(); });
+
+    for (std::size_t c = 0; c < channels.size(); ++c)
+    {
+        auto &output = m_output_buffers[c];
+
+        // Reuse as much of the received samples as possible, append NaN at front
+        if (diff > 0 && !outage_skipped)
+        {
+            fillInvalid(c, static_cast<std::size_t>(diff));
+        }
+
+        // Append to output buffer
+        output.insert(output.end(), channels[c].begin() + skip, channels[c].end());
+    }
 
-    // Reuse as much of the received samples as possible
     if (diff > 0)
     {
-        // Append NaN at front
-        std::vector<double> NaN;
-        NaN.resize(diff);
-        std::fill(NaN.begin(), NaN.end(), std::nan(""));
+        if (!outage_skipped)
+        {
+            m_nan_filled += diff;
+        }
+        m_actual_scnt += diff;
+    }
+    m_actual_scnt += packet_size - skip;
+
+    // Begin sample rate estimation with the rate learned by a previous acquisition, if it is plausible
+    const bool seeded = m_warm_start && m_warm_start->packet_size == packet_size &&
+                        std::abs(m_warm_start->sampling_interval / m_nominal_sampling_interval - 1.0) < 0.1;
+    if (seeded)
+    {
+        m_estimated_sampling_interval = m_warm_start->sampling_interval;
+        m_estimated_sampling_rate = static_cast<int>(std::lround(1 / m_estimated_sampling_interval.value()));
+    }
+    else
+    {
+        // Begin sample rate estimation with nominal sample rate
+        m_estimated_sampling_rate = m_nominal_sampling_rate;
+        m_estimated_sampling_interval = 1 / static_cast<double>(m_estimated_sampling_rate.value());
+    }
+}
+
+template <typename T>
+void BasicStream<T>::resync(const char *reason, const Channels &channels, double incoming_ts_seconds, std::uint64_t base_ticks, double base_frequency)
+{
+    if (!m_recovery.resync)
+    {
+        m_unrecoverable = true;
+        throw std::runtime_error(reason);
+    }
 
-        samples.insert(samples.begin(), NaN.begin(), NaN.end());
+    // The clock of the publisher jumped backwards or ahead of the Oxygen time (e.g. an NTP step or a reboot changing
+    // its epoch), map the packet to the current Oxygen time instead of filling the jump
+    const auto aligned_ts_seconds = m_clock->alignSeconds(incoming_ts_seconds);
+    if (aligned_ts_seconds < m_previous_aligned_ts_seconds || aligned_ts_seconds > base_ticks / base_frequency)
+    {
+        m_clock->reanchor(incoming_ts_seconds, base_ticks, base_frequency);
     }
-    if (diff < 0)
+
+    m_resyncs++;
+    anchor(channels, incoming_ts_seconds);
+}
+
+template <typename T>
+void BasicStream<T>::fillInvalid(std::size_t channel, std::size_t num)
+{
+    auto &output = m_output_buffers[channel];
+    auto &gaps = m_output_gaps[channel];
+
+    // Extend the previous gap if it ends at the last sample
+    if (!gaps.empty() && gaps.back().offset + gaps.back().count == output.size())
     {
-        // Remove some samples at the front
-        samples.erase(samples.begin(), samples.begin() + (-1) * diff);
+        gaps.back().count += num;
+    }
+    else
+    {
+        gaps.push_back({output.size(), num});
+    }
+    output.insert(output.end(), num, SampleTraits<T>::invalid());
+}
+
+template <typename T>
+void BasicStream<T>::fillGap(std::size_t num, const Channels &next)
+{
+    for (std::size_t c = 0; c < next.size(); ++c)
+    {
+        auto &output = m_output_buffers[c];
+        const auto last_value = m_last_values[c];
+
+        switch (m_recovery.gap_fill)
+        {
+        case GapFill::NaN:
+            fillInvalid(c, num);
+            break;
+        case GapFill::Hold:
+            output.insert(output.end(), num, last_value);
+            break;
+        case GapFill::Linear:
+            // Bridge from the last sample written to the first sample received
+            for (std::size_t n = 1; n <= num; ++n)
+            {
+                output.push_back(lerp<T>(last_value, next[c].front(), n / static_cast<typename SampleTraits<T>::Promoted>(num + 1)));
+            }
+            break;
+        }
     }
 
-    // Begin sample rate estimation with nominal sample rate
-    m_estimated_sampling_rate = m_nominal_sampling_rate;
-    m_estimated_sampling_interval = 1 / static_cast<double>(m_estimated_sampling_rate.value());
+    if (m_recovery.gap_fill == GapFill::NaN)
+    {
+        m_nan_filled += num;
+    }
+    m_gap_filled += num;
+    m_actual_scnt += num;
+}
 
-    // Append to output buffer
-    m_output_buffer.insert(m_output_buffer.end(), samples.begin(), samples.end());
-    m_actual_scnt += samples.size();
+template <typename T>
+void BasicStream<T>::append(std::vector<T> samples, double incoming_ts_seconds, std::uint64_t base_ticks, double base_frequency, std::optional<std::uint64_t> lost_packets, bool restarted)
+{
+    Channels channels(1);
+    channels.front() = std::move(samples);
+    appendChannels(std::move(channels), incoming_ts_seconds, base_ticks, base_frequency, lost_packets, restarted);
 }
 
-void Stream::append(std::vector<double> samples, double incoming_ts_seconds, std::uint64_t base_ticks, double base_frequency)
+template <typename T>
+void BasicStream<T>::appendChannels(Channels channels, double incoming_ts_seconds, std::uint64_t base_ticks, double base_frequency, std::optional<std::uint64_t> lost_packets, bool restarted)
 {
     // Stream still active?
     if (m_unrecoverable)
@@ -148,81 +247,110 @@ void Stream::append(std::vector<double> samples, double incoming_ts_seconds, std
         throw std::runtime_error("The stream is unrecoverable (too many packets lost?)");
     }
 
+    if (channels.size() != m_output_buffers.size())
+    {
+        throw std::invalid_argument("Number of channels does not match the stream.");
+    }
+
+    const auto packet_size = channels.front().size();
+    for (const auto &channel : channels)
+    {
+        if (channel.size() != packet_size)
+        {
+            throw std::invalid_argument("All channels of a packet must contain the same number of samples.");
+        }
+    }
+
     ensureValidStreamClock(incoming_ts_seconds, base_ticks, base_frequency);
-    const auto aligned_ts_seconds = m_clock->alignSeconds(incoming_ts_seconds);
     m_packet_received_counter++;
 
     if (m_packet_received_counter == 1)
     {
         // Handle start of stream
-        beginStream(samples, incoming_ts_seconds);
+        beginStream(channels, incoming_ts_seconds);
+    }
+    else if (m_clock->alignSeconds(incoming_ts_seconds) < m_previous_aligned_ts_seconds)
+    {
+        resync("Steady clock expected, unrecoverable.", channels, incoming_ts_seconds, base_ticks, base_frequency);
+    }
+    else if ((m_clock->alignSeconds(incoming_ts_seconds) - m_previous_aligned_ts_seconds) >= MAX_OUTAGE_SECONDS)
+    {
+        resync("Stream lost its integrity for 20 seconds, mark as unrecoverable.", channels, incoming_ts_seconds, base_ticks, base_frequency);
     }
     else
     {
         // A normal stream packet
-        if (samples.size() != m_nominal_packet_size)
-        {
-            m_unrecoverable = true;
-            throw std::runtime_error("Streams are not allowed to change their packet size, unrecoverable.");
-        }
+        const auto aligned_ts_seconds = m_clock->alignSeconds(incoming_ts_seconds);
 
-        if (aligned_ts_seconds < m_previous_aligned_ts_seconds)
-        {
-            m_unrecoverable = true;
-            throw std::runtime_error("Steady clock expected, unrecoverable.");
-        }
-
-        // TODO Find a way to make sure streams are always recoverable (e.g. insert NaN on a regular basis/timeouts?)
-        if ((aligned_ts_seconds - m_previous_aligned_ts_seconds) >= 20.0)
-        {
-            m_unrecoverable = true;
-            throw std::runtime_error("Stream lost its integrity for 20 seconds, mark as unrecoverable.");
-        }
+        // Estimate packet properties, packets might vary in size (e.g. partial or adaptive packets)
+        const auto packet_interval = packet_size * m_estimated_sampling_interval.value();
+        const auto expected_packet_timestamp = m_previous_aligned_ts_seconds + packet_interval;
 
-        // Estimate packet properties
-        const auto nominal_packet_interval = m_nominal_packet_size * m_estimated_sampling_interval.value();
-        const auto expected_packet_timestamp = m_previous_aligned_ts_seconds + nominal_packet_interval;
+        // Tolerated deviation of the timestamp, not tighter for small packets
+        const auto tolerance = std::max(packet_size, m_nominal_packet_size) * m_estimated_sampling_interval.value() * 0.25;
 
         // Map Incoming timestamp to nominal sample rate aligned with Oxygen time
         const auto last_sample_aligned_tick = m_clock->alignSamples(incoming_ts_seconds, m_nominal_sampling_rate);
-        const std::size_t num = last_sample_aligned_tick - m_actual_scnt;
+        const auto num = static_cast<std::int64_t>(last_sample_aligned_tick) - static_cast<std::int64_t>(m_actual_scnt);
 
-        // Based on timestamps, estimate if packets have been lost, if so insert NaN
-        if (aligned_ts_seconds > (expected_packet_timestamp + (nominal_packet_interval * 0.25)))
+        // The sequence number only accounts for lost packets, the timestamps reveal time missing beyond them
+        // (e.g. an outage before the publisher restarted), which is never bridged by the gap-fill policy
+        const bool timestamp_gap = aligned_ts_seconds > (expected_packet_timestamp + tolerance);
+        bool outage = false;
+        if (lost_packets && timestamp_gap)
         {
-            // Packet lost based on timetamp estimation, align with stream
-            const auto diff = num - samples.size();
+            const auto lost_interval = (lost_packets.value() + 1) * std::max(packet_size, m_nominal_packet_size) * m_estimated_sampling_interval.value();
+            outage = restarted || (aligned_ts_seconds - m_previous_aligned_ts_seconds) > (lost_interval + tolerance);
+        }
 
+        // Based on sequence numbers or timestamps, estimate if packets have been lost, if so fill the gap
+        const bool packets_lost = lost_packets ? (lost_packets.value() > 0 || outage) : timestamp_gap;
+        if (packets_lost)
+        {
+            // Packet lost, align with stream according to the timestamp
+            const auto diff = num - static_cast<std::int64_t>(packet_size);
             if (diff < 0)
             {
-                m_unrecoverable = true;
-                throw std::runtime_error("Error while recovering stream.");
+                resync("Error while recovering stream.", channels, incoming_ts_seconds, base_ticks, base_frequency);
+            }
+            else
+            {
+                // Fill at front to align stream
+                if (outage)
+                {
+                    for (std::size_t c = 0; c < channels.size(); ++c)
+                    {
+                        fillInvalid(c, static_cast<std::size_t>(diff));
+                    }
+                    m_nan_filled += diff;
+                    m_actual_scnt += diff;
+                }
+                else
+                {
+                    fillGap(static_cast<std::size_t>(diff), channels);
+                }
+
+                // Buffer samples + resampling result
+                for (std::size_t c = 0; c < channels.size(); ++c)
+                {
+                    m_output_buffers[c].insert(m_output_buffers[c].end(), channels[c].begin(), channels[c].end());
+                }
+
+                // Update sample count
+                m_actual_scnt += packet_size;
             }
-
-            std::vector<double> NaN;
-            NaN.resize(static_cast<size_t>(diff));
-            std::fill(NaN.begin(), NaN.end(), std::nan(""));
-
-            // Add NaN at front to align stream
-            samples.insert(samples.begin(), NaN.begin(), NaN.end());
-
-            // Buffer samples + resampling result
-            m_output_buffer.insert(m_output_buffer.end(), samples.begin(), samples.end());
-
-            // Update sample count
-            m_actual_scnt += samples.size();
         }
         else
         {
             // Valid packet, resample
-            // Re-Estimtae Sampling Rate (only if no packet has been lost)
-            m_estimated_sampling_interval = (aligned_ts_seconds - m_previous_aligned_ts_seconds) / m_nominal_packet_size;
-            m_estimated_sampling_rate = std::floor(1 / m_estimated_sampling_interval.value());
+            // Re-Estimtae Sampling Rate (only if no packet has been lost), per sample of this packet
+            m_estimated_sampling_interval = (aligned_ts_seconds - m_previous_aligned_ts_seconds) / packet_size;
+            m_estimated_sampling_rate = static_cast<int>(std::lround(1 / m_estimated_sampling_interval.value()));
 
             // Use previous and current packet to interpolate
-            m_input_buffer.insert(m_input_buffer.end(), samples.begin(), samples.end());
+            const auto input_size = m_input_buffers.front().size() + packet_size;
 
-            auto estimated_first_sample_timestamp = aligned_ts_seconds - m_input_buffer.size() * m_estimated_sampling_interval.value();
+            auto estimated_first_sample_timestamp = aligned_ts_seconds - input_size * m_estimated_sampling_interval.value();
             if (estimated_first_sample_timestamp < 0)
             {
                 // TODO is there any better way to overcome/handle this? Estimates before time zero only can occure at start of stream
@@ -230,34 +358,124 @@ void Stream::append(std::vector<double> samples, double incoming_ts_seconds, std
             }
 
             // Prepare Labels for resampling
-            InputVectorLabels input_desc(estimated_first_sample_timestamp, aligned_ts_seconds, m_input_buffer.size());
-
-            // write up to <num> interpolated samples to m_output_buffer
-            std::vector<double> resampled;
-            std::size_t num_written = interp(resampled,
-                                             m_actual_scnt, m_nominal_sampling_rate, num, // this iterates over real output timestamps in ticks
-                                             input_desc,                                  // Timestamps of input samples
-                                             m_input_buffer                               // actual input samples
+            InputVectorLabels input_desc(estimated_first_sample_timestamp, aligned_ts_seconds, input_size);
+
+            // Compute up to <num> output positions once for all channels
+            Positions output_positions;
+            std::size_t num_written = positions(m_kernel, output_positions,
+                                                m_actual_scnt, m_nominal_sampling_rate, static_cast<std::size_t>(std::max<std::int64_t>(num, 0)), // this iterates over real output timestamps in ticks
+                                                input_desc,                                                                                      // Timestamps of input samples
+                                                input_size                                                                                       // number of input samples
             );
 
-            m_output_buffer.insert(m_output_buffer.end(), resampled.begin(), resampled.end());
+            // write the interpolated samples of every channel to its output buffer
+            for (std::size_t c = 0; c < channels.size(); ++c)
+            {
+                auto &input = m_input_buffers[c];
+                input.insert(input.end(), channels[c].begin(), channels[c].end());
+                interp(m_kernel, m_output_buffers[c], output_positions, input);
+            }
+
             m_actual_scnt += num_written;
         }
     }
 
-    m_previous_aligned_ts_seconds = aligned_ts_seconds;
-    m_input_buffer = samples;
+    for (std::size_t c = 0; c < channels.size(); ++c)
+    {
+        if (!m_output_buffers[c].empty())
+        {
+            // The last sample written, used to fill gaps
+            m_last_values[c] = m_output_buffers[c].back();
+        }
+    }
+
+    m_previous_aligned_ts_seconds = m_clock->alignSeconds(incoming_ts_seconds);
+    m_input_buffers = std::move(channels);
 }
 
-std::optional<int> Stream::estimatedSamplingRate()
+template <typename T>
+std::optional<int> BasicStream<T>::estimatedSamplingRate()
 {
     return m_estimated_sampling_rate;
 }
 
-std::vector<double> Stream::getAndClearSamples()
+template <typename T>
+StreamBase::Statistics BasicStream<T>::getStatistics() const
+{
+    std::optional<double> drift_ppm;
+    if (m_estimated_sampling_interval)
+    {
+        drift_ppm = (m_nominal_sampling_interval / m_estimated_sampling_interval.value() - 1.0) * 1e6;
+    }
+
+    return {m_estimated_sampling_rate, m_nan_filled, m_unrecoverable, drift_ppm, m_gap_filled, m_resyncs, 0, 0, 0};
+}
+
+template <typename T>
+void BasicStream<T>::setWarmStart(std::optional<WarmStart> warm_start)
+{
+    m_warm_start = warm_start;
+}
+
+template <typename T>
+std::optional<StreamBase::WarmStart> BasicStream<T>::getWarmStart() const
+{
+    // The estimate is only meaningful once it has been computed from the timestamps of two packets
+    if (m_packet_received_counter < 2 || !m_estimated_sampling_interval)
+    {
+        return std::nullopt;
+    }
+
+    return WarmStart{m_estimated_sampling_interval.value(), m_nominal_packet_size};
+}
+
+template <typename T>
+void BasicStream<T>::setKernel(Kernel kernel)
+{
+    m_kernel = kernel;
+}
+
+template <typename T>
+std::vector<T> BasicStream<T>::getAndClearSamples()
+{
+    return getAndClearSamples(0);
+}
+
+template <typename T>
+std::vector<T> BasicStream<T>::getAndClearSamples(std::size_t channel)
 {
-    std::vector<double> temp;
-    m_output_buffer.swap(temp);
+    Gaps gaps;
+    return getAndClearSamples(channel, gaps);
+}
+
+template <typename T>
+std::vector<T> BasicStream<T>::getAndClearSamples(std::size_t channel, Gaps &gaps)
+{
+    std::vector<T> temp;
+    m_output_buffers.at(channel).swap(temp);
+
+    gaps.clear();
+    m_output_gaps[channel].swap(gaps);
 
     return temp;
-}
\ No newline at end of file
+}
+
+template <typename T>
+std::size_t BasicStream<T>::getNumChannels() const
+{
+    return m_output_buffers.size();
+}
+
+template <typename T>
+std::uint64_t BasicStream<T>::getPosition() const
+{
+    return m_actual_scnt - m_output_buffers.front().size();
+}
+
+namespace plugin::mqtt
+{
+    template class BasicStream<std::int16_t>;
+    template class BasicStream<std::int32_t>;
+    template class BasicStream<float>;
+    template class BasicStream<double>;
+}
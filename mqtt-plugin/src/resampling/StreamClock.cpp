@@ -3,31 +3,121 @@
 //
 #include <cmath>
 
+#if defined(_MSC_VER) && !defined(__SIZEOF_INT128__)
+#include <intrin.h>
+#endif
+
 using namespace plugin::mqtt;
 
-StreamClock::StreamClock() : m_set(false),
-                             m_stream_offset(0),
-                             m_base_ticks(0),
-                             m_base_frequency(0),
-                             m_base_seconds(0)
+namespace
+{
+    constexpr std::uint64_t NANOSECONDS_PER_SECOND = 1000000000;
+}
+
+ClockDomain::Start ClockDomain::join(const Start &proposed)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (!m_start)
+    {
+        m_start = proposed;
+    }
+    m_sources++;
+
+    return m_start.value();
+}
+
+void ClockDomain::leave()
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (m_sources > 0 && --m_sources == 0)
+    {
+        m_start.reset();
+    }
+}
+
+std::optional<ClockDomain::Start> ClockDomain::getStart() const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_start;
+}
+
+std::size_t ClockDomain::getSourceCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_sources;
+}
+
+StreamClock::StreamClock() : StreamClock(std::make_shared<ClockDomain>())
+{
+}
+
+StreamClock::StreamClock(ClockDomain::Pointer domain) : m_domain(std::move(domain)),
+                                                        m_set(false),
+                                                        m_start{0, 0, 0},
+                                                        m_source_offset_ns(0)
+{
+}
+
+StreamClock::~StreamClock()
+{
+    resetSartOfStream();
+}
+
+std::int64_t StreamClock::toNanoseconds(double seconds)
+{
+    return std::llround(seconds * static_cast<double>(NANOSECONDS_PER_SECOND));
+}
+
+std::uint64_t StreamClock::mulDiv(std::uint64_t a, std::uint64_t b, std::uint64_t c)
 {
+#if defined(__SIZEOF_INT128__)
+    // A GCC/Clang extension, marked as such to keep pedantic builds quiet
+    __extension__ typedef unsigned __int128 uint128_t;
+    return static_cast<std::uint64_t>(static_cast<uint128_t>(a) * b / c);
+#else
+    std::uint64_t high;
+    const std::uint64_t low = _umul128(a, b, &high);
+    std::uint64_t remainder;
+    return _udiv128(high, low, c, &remainder);
+#endif
 }
+
 void StreamClock::setStartOfStream(double incoming_ts_seconds, std::uint64_t base_ticks, double base_frequency)
 {
+    resetSartOfStream();
+
+    // The Oxygen base frequency is an integer number of ticks per second
+    const ClockDomain::Start proposed{toNanoseconds(incoming_ts_seconds), base_ticks, static_cast<std::uint64_t>(std::llround(base_frequency))};
+    m_start = m_domain->join(proposed);
     m_set = true;
-    m_stream_offset = incoming_ts_seconds;
-    m_base_ticks = base_ticks;
-    m_base_frequency = base_frequency;
-    m_base_seconds = base_ticks / base_frequency;
+}
+
+void StreamClock::reanchor(double incoming_ts_seconds, std::uint64_t base_ticks, double base_frequency)
+{
+    if (!m_set)
+    {
+        setStartOfStream(incoming_ts_seconds, base_ticks, base_frequency);
+        return;
+    }
+
+    // The current Oxygen time relative to the start of the domain
+    const auto elapsed_ns = base_ticks >= m_start.base_ticks
+                                ? static_cast<std::int64_t>(mulDiv(base_ticks - m_start.base_ticks, NANOSECONDS_PER_SECOND, m_start.base_frequency))
+                                : -static_cast<std::int64_t>(mulDiv(m_start.base_ticks - base_ticks, NANOSECONDS_PER_SECOND, m_start.base_frequency));
+
+    m_source_offset_ns = m_start.offset_ns + elapsed_ns - toNanoseconds(incoming_ts_seconds);
 }
 
 void StreamClock::resetSartOfStream()
 {
+    if (m_set)
+    {
+        m_domain->leave();
+    }
+
     m_set = false;
-    m_stream_offset = 0;
-    m_base_ticks = 0;
-    m_base_frequency = 0;
-    m_base_seconds = 0;
+    m_start = {0, 0, 0};
+    m_source_offset_ns = 0;
 }
 
 bool StreamClock::startOfStreamSet() const
@@ -35,24 +125,30 @@ bool StreamClock::startOfStreamSet() const
     return m_set;
 }
 
+std::int64_t StreamClock::domainNanoseconds(double incoming_ts_seconds) const
+{
+    return toNanoseconds(incoming_ts_seconds) + m_source_offset_ns - m_start.offset_ns;
+}
+
 std::uint64_t StreamClock::alignSamples(double incoming_ts_seconds, int sample_rate)
 {
-    const auto sample_interval = 1 / static_cast<double>(sample_rate);
-    const auto referenced_stream = incoming_ts_seconds - m_stream_offset;
-    const auto stream_ticks = static_cast<std::uint64_t>(referenced_stream / sample_interval);
+    const auto rate = static_cast<std::uint64_t>(sample_rate);
+    const auto referenced_stream = domainNanoseconds(incoming_ts_seconds);
 
-    const auto rate_factor = sample_rate / static_cast<double>(m_base_frequency);
-    std::uint64_t reference_ticks = static_cast<std::uint64_t>(m_base_ticks * rate_factor);
+    // Rounded to the nearest sample, timestamps on the sample grid are never truncated to the previous sample
+    const auto half_sample_ns = NANOSECONDS_PER_SECOND / (2 * rate);
+    const auto stream_ticks = referenced_stream > 0 ? mulDiv(static_cast<std::uint64_t>(referenced_stream) + half_sample_ns, rate, NANOSECONDS_PER_SECOND) : 0;
+    const auto reference_ticks = m_start.base_frequency > 0 ? mulDiv(m_start.base_ticks, rate, m_start.base_frequency) : 0;
 
     return stream_ticks + reference_ticks;
 }
 
 double StreamClock::alignSeconds(double incoming_ts_seconds)
 {
-    const auto referenced_stream = incoming_ts_seconds - m_stream_offset;
-    const auto aligned_stream = referenced_stream + m_base_seconds;
+    const auto referenced_stream = domainNanoseconds(incoming_ts_seconds) / static_cast<double>(NANOSECONDS_PER_SECOND);
+    const auto base_seconds = m_start.base_frequency > 0 ? m_start.base_ticks / static_cast<double>(m_start.base_frequency) : 0;
 
-    return aligned_stream;
+    return referenced_stream + base_seconds;
 }
 
 bool StreamClock::validTimestamp(double incoming_ts_seconds)
@@ -62,10 +158,15 @@ bool StreamClock::validTimestamp(double incoming_ts_seconds)
         return false;
     }
 
-    if (incoming_ts_seconds < m_stream_offset)
+    if (domainNanoseconds(incoming_ts_seconds) < 0)
     {
         return false;
     }
 
     return true;
 }
+
+std::int64_t StreamClock::getSourceOffsetNanoseconds() const
+{
+    return m_source_offset_ns;
+}
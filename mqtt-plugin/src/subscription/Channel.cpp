@@ -25,7 +25,8 @@ LocalId Channel::getLocalChannelId()
 
 void Channel::interpretPayload(Timestamp start, Timestamp timestamp, const_message_ptr msg)
 {
-    auto sample = m_configuration.decoder->getValue(start, timestamp, msg->to_string());
+    // Not copied, every channel of a frame is handed the same payload
+    auto sample = m_configuration.decoder->getValue(start, timestamp, msg->get_payload_str());
     m_samples.push_back(sample);
 }
 
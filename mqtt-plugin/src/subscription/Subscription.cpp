@@ -4,14 +4,21 @@ using namespace plugin::mqtt;
 // Load a test interpreter
 #include "subscription/decoding/TextPlainDecoder.h"
 
+//
+#include <chrono>
+
 Subscription::Subscription(Subscription::Sampling sampling, std::string topic, int QoS) : m_sampling(sampling),
                                                                                           m_topic(topic),
-                                                                                          m_qos(QoS)
+                                                                                          m_qos(QoS),
+                                                                                          m_active(true)
 {
 }
 
 void Subscription::interpretPayload(Timestamp start, Timestamp timestamp, const_message_ptr msg)
 {
+    const auto begin = std::chrono::steady_clock::now();
+    m_metrics.received(msg->get_payload().size());
+
     try
     {
         for (auto &channel : m_channels)
@@ -22,11 +29,26 @@ void Subscription::interpretPayload(Timestamp start, Timestamp timestamp, const_
     catch (const std::exception &e)
     {
         // TODO: Invalid Payload received, show error message?
+        m_metrics.decodeFailed();
+    }
+
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - begin;
+    m_metrics.decoded(duration.count());
+
+    // Sync subscriptions consist of a single resampled stream
+    for (auto &channel : m_channels)
+    {
+        if (auto stream = channel->getDecoder()->getStreamStatistics())
+        {
+            m_metrics.updateStream(stream.value());
+        }
     }
 }
 
 void Subscription::discardSamples()
 {
+    m_trace_ids.clear();
+
     for (auto &channel : m_channels)
     {
         channel->discardSamples();
@@ -72,4 +94,31 @@ void Subscription::stopProcessing()
 int Subscription::getQoS()
 {
     return m_qos;
-}
\ No newline at end of file
+}
+
+void Subscription::setActive(bool active)
+{
+    m_active = active;
+}
+
+bool Subscription::isActive() const
+{
+    return m_active;
+}
+
+diagnostics::TopicMetrics &Subscription::getMetrics()
+{
+    return m_metrics;
+}
+
+void Subscription::addTraceId(std::uint64_t id)
+{
+    m_trace_ids.push_back(id);
+}
+
+std::vector<std::uint64_t> Subscription::takeTraceIds()
+{
+    std::vector<std::uint64_t> ids;
+    m_trace_ids.swap(ids);
+    return ids;
+}
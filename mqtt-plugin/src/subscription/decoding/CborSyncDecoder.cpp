@@ -1,47 +1,354 @@
 #include "subscription/decoding/CborSyncDecoder.h"
+
+//
+#include "fmt/core.h"
+
+//
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+
 using namespace plugin::mqtt;
 
-CborSyncDecoder::CborSyncDecoder(Datatype d, int nominal_sample_rate, StreamClock::Pointer clock) : Decoder(d),
-                                                                                                    m_nominal_sample_rate(nominal_sample_rate)
+template <typename T>
+BasicCborSyncDecoder<T>::Frame::Frame(int nominal_sample_rate, StreamClock::Pointer clock, StreamBase::Recovery recovery, std::size_t reorder_depth, std::vector<std::string> channels) : names(std::move(channels)),
+                                                                                                                                                                                       stream(clock, nominal_sample_rate, recovery, std::max<std::size_t>(names.size(), 1)),
+                                                                                                                                                                                       reorder(reorder_depth),
+                                                                                                                                                                                       decoded(stream.getNumChannels())
+{
+}
+
+template <typename T>
+typename BasicStream<T>::Channels BasicCborSyncDecoder<T>::Frame::extract(const json &j) const
+{
+    const auto &data = j.at("data");
+
+    if (names.empty())
+    {
+        // A single channel is carried as a plain array of samples
+        return {data.get<std::vector<T>>()};
+    }
+
+    // Locate the channels by name if the frame names its channels, otherwise by position
+    const auto frame_names = j.contains("channels") ? j["channels"].get<std::vector<std::string>>() : names;
+    std::vector<std::size_t> index;
+    for (const auto &name : names)
+    {
+        auto it = std::find(frame_names.begin(), frame_names.end(), name);
+        if (it == frame_names.end())
+        {
+            throw std::invalid_argument(fmt::format("Channel {} is not part of the frame.", name));
+        }
+        index.push_back(static_cast<std::size_t>(it - frame_names.begin()));
+    }
+
+    typename Stream::Channels channels(names.size());
+    if (j.value("layout", "columnar") == "interleaved")
+    {
+        // Samples of all channels, sample by sample
+        const auto stride = frame_names.size();
+        if (data.size() % stride != 0)
+        {
+            throw std::invalid_argument("Interleaved frame contains an incomplete sample.");
+        }
+
+        const auto num_samples = data.size() / stride;
+        for (auto &channel : channels)
+        {
+            channel.reserve(num_samples);
+        }
+
+        for (std::size_t n = 0; n < num_samples; ++n)
+        {
+            for (std::size_t c = 0; c < channels.size(); ++c)
+            {
+                channels[c].push_back(data[n * stride + index[c]].get<T>());
+            }
+        }
+    }
+    else
+    {
+        // One array of samples per channel
+        if (data.size() != frame_names.size())
+        {
+            throw std::invalid_argument("Columnar frame does not match its channels.");
+        }
+
+        for (std::size_t c = 0; c < channels.size(); ++c)
+        {
+            channels[c] = data[index[c]].get<std::vector<T>>();
+        }
+    }
+
+    return channels;
+}
+
+template <typename T>
+void BasicCborSyncDecoder<T>::Frame::take()
+{
+    // Taken after every packet, the stream only skips an outage once its samples have been taken
+    const auto position = stream.getPosition();
+    for (std::size_t c = 0; c < stream.getNumChannels(); ++c)
+    {
+        Decoded next;
+        next.position = position;
+        next.samples = stream.getAndClearSamples(c, next.gaps);
+
+        auto &queue = decoded[c];
+        if (queue.empty())
+        {
+            queue.push_back(std::move(next));
+        }
+        else if (queue.back().samples.empty())
+        {
+            queue.back() = std::move(next);
+        }
+        else if (next.samples.empty())
+        {
+            continue;
+        }
+        else if (queue.back().position + queue.back().samples.size() == next.position)
+        {
+            // Contiguous with the samples waiting
+            auto &back = queue.back();
+            for (auto gap : next.gaps)
+            {
+                gap.offset += back.samples.size();
+                back.gaps.push_back(gap);
+            }
+            back.samples.insert(back.samples.end(), next.samples.begin(), next.samples.end());
+        }
+        else
+        {
+            queue.push_back(std::move(next));
+        }
+    }
+}
+
+template <typename T>
+BasicCborSyncDecoder<T>::BasicCborSyncDecoder(Datatype d, int nominal_sample_rate, StreamClock::Pointer clock) : BasicCborSyncDecoder(d, nominal_sample_rate, clock, StreamBase::Recovery{false, GapFill::NaN}, DEFAULT_REORDER_DEPTH)
 {
     // TODO Make using the global clock for this protocol a config-parameter?
-    m_stream = std::shared_ptr<Stream>(new Stream(clock, nominal_sample_rate));
 }
 
-void CborSyncDecoder::prepareProcessing()
+template <typename T>
+BasicCborSyncDecoder<T>::BasicCborSyncDecoder(Datatype d, int nominal_sample_rate, StreamClock::Pointer clock, StreamBase::Recovery recovery, std::size_t reorder_depth) : BasicCborSyncDecoder(d, nominal_sample_rate, std::make_shared<Frame>(nominal_sample_rate, clock, recovery, reorder_depth, std::vector<std::string>{}), 0)
 {
-    m_stream->reset();
+}
+
+template <typename T>
+BasicCborSyncDecoder<T>::BasicCborSyncDecoder(Datatype d, int nominal_sample_rate, std::shared_ptr<Frame> frame, std::size_t channel) : Decoder(d),
+                                                                                                                                        m_nominal_sample_rate(nominal_sample_rate),
+                                                                                                                                        m_timestamp(0),
+                                                                                                                                        m_frame(std::move(frame)),
+                                                                                                                                        m_channel(channel)
+{
+    if (d == Datatype::String || (d == Datatype::Integer && std::is_floating_point_v<T>))
+    {
+        throw std::invalid_argument("Sync streams require number channels or integer channels of integer samples.");
+    }
+}
+
+template <typename T>
+std::vector<std::shared_ptr<BasicCborSyncDecoder<T>>> BasicCborSyncDecoder<T>::createFrameDecoders(Datatype d, int nominal_sample_rate, StreamClock::Pointer clock, StreamBase::Recovery recovery, std::size_t reorder_depth, std::vector<std::string> channels)
+{
+    auto frame = std::make_shared<Frame>(nominal_sample_rate, clock, recovery, reorder_depth, std::move(channels));
+
+    std::vector<std::shared_ptr<BasicCborSyncDecoder>> decoders;
+    for (std::size_t c = 0; c < frame->stream.getNumChannels(); ++c)
+    {
+        decoders.push_back(std::shared_ptr<BasicCborSyncDecoder>(new BasicCborSyncDecoder(d, nominal_sample_rate, frame, c)));
+    }
+    return decoders;
+}
+
+template <typename T>
+void BasicCborSyncDecoder<T>::prepareProcessing()
+{
+    // The frame is reset by the decoder of the first channel
+    if (m_preview)
+    {
+        m_preview->reset();
+    }
+
+    if (m_channel == 0)
+    {
+        m_frame->stream.reset();
+        m_frame->reorder.reset();
+        for (auto &decoded : m_frame->decoded)
+        {
+            decoded.clear();
+        }
+    }
     m_timestamp = 0;
 }
 
-Sample CborSyncDecoder::getValue(const Timestamp &start, const Timestamp &timestamp, const std::string &payload)
+template <typename T>
+void BasicCborSyncDecoder<T>::decodeFrame(const Timestamp &timestamp, const std::string &payload)
 {
     auto j = json::from_cbor(payload);
     auto incoming_packet_timestamp = j["timestamp"].get<double>();
+    auto channels = m_frame->extract(j);
+
+    auto &stream = m_frame->stream;
+    if (j.contains("idx"))
+    {
+        // Restore the order of the packets, lost packets are known from the sequence number
+        auto released = m_frame->reorder.push(j["idx"].get<std::uint64_t>(), {std::move(channels), incoming_packet_timestamp, timestamp.ticks, timestamp.frequency});
 
-    const auto rate_factor = m_nominal_sample_rate / static_cast<double>(timestamp.frequency);
-    std::uint64_t target_tick = static_cast<std::uint64_t>(timestamp.ticks * rate_factor);
+        // A packet failing does not drop the packets released after it, the first error is reported afterwards
+        std::exception_ptr error;
+        for (auto &r : released)
+        {
+            try
+            {
+                stream.appendChannels(std::move(r.packet.channels), r.packet.timestamp, r.packet.base_ticks, r.packet.base_frequency, r.lost, r.restarted);
+                m_frame->take();
+            }
+            catch (const std::exception &)
+            {
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
 
-    std::vector<value_t> samples;
-    switch (getDatatype())
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    else
     {
-    case Datatype::Number:
+        stream.appendChannels(std::move(channels), incoming_packet_timestamp, timestamp.ticks, timestamp.frequency);
+    }
+
+    // Every payload provides samples to the decoders of the channels, even if none have been written
+    m_frame->take();
+}
+
+template <typename T>
+Sample BasicCborSyncDecoder<T>::getValue(const Timestamp &, const Timestamp &timestamp, const std::string &payload)
+{
+    if (m_channel == 0)
     {
-        auto data = j["data"].get<std::vector<double>>();
-        m_stream->append(data, incoming_packet_timestamp, timestamp.ticks, timestamp.frequency);
+        decodeFrame(timestamp, payload);
+    }
 
-        data = m_stream->getAndClearSamples();
+    Decoded decoded;
+    decoded.position = m_timestamp;
+    auto &queue = m_frame->decoded[m_channel];
+    if (!queue.empty())
+    {
+        decoded = std::move(queue.front());
+        queue.pop_front();
+    }
+    const auto &data = decoded.samples;
 
-        std::transform(data.begin(), data.end(), std::back_inserter(samples), [](double v) -> value_t
-                       { return v; });
+    if (m_preview)
+    {
+        // Decimated incrementally, the preview decoders take the completed blocks
+        if (decoded.position > m_timestamp)
+        {
+            m_preview->skip(decoded.position - m_timestamp);
+        }
+        m_preview->append(data, decoded.gaps);
     }
-    break;
+
+    std::vector<value_t> samples;
+    samples.reserve(data.size());
+    switch (getDatatype())
+    {
+    case Datatype::Number:
+        std::transform(data.begin(), data.end(), std::back_inserter(samples), [](T v) -> value_t
+                       { return static_cast<double>(v); });
+        break;
+    case Datatype::Integer:
+        // Raw counts, integer channels require integer samples (see constructor)
+        std::transform(data.begin(), data.end(), std::back_inserter(samples), [](T v) -> value_t
+                       { return static_cast<int>(v); });
+        break;
     default:
         throw std::runtime_error("We should never get here.");
     }
 
-    auto ret = Sample(std::move(samples), Timestamp(m_timestamp, m_nominal_sample_rate));
+    // An outage skipped by the stream moves the samples ahead
+    auto ret = Sample(std::move(samples), Timestamp(decoded.position, m_nominal_sample_rate));
 
-    m_timestamp += ret.values.size();
+    m_timestamp = decoded.position + ret.values.size();
     return ret;
 }
+
+template <typename T>
+std::optional<StreamBase::Statistics> BasicCborSyncDecoder<T>::getStreamStatistics() const
+{
+    auto statistics = m_frame->stream.getStatistics();
+
+    const auto reorder = m_frame->reorder.getStatistics();
+    statistics.reordered_packets = reorder.reordered;
+    statistics.dropped_packets = reorder.dropped;
+    statistics.lost_packets = reorder.lost;
+
+    return statistics;
+}
+
+template <typename T>
+std::optional<StreamBase::WarmStart> BasicCborSyncDecoder<T>::getWarmStart() const
+{
+    return m_frame->stream.getWarmStart();
+}
+
+template <typename T>
+void BasicCborSyncDecoder<T>::setWarmStart(const StreamBase::WarmStart &warm_start)
+{
+    m_frame->stream.setWarmStart(warm_start);
+}
+
+template <typename T>
+void BasicCborSyncDecoder<T>::setPreview(Preview::Pointer preview)
+{
+    m_preview = std::move(preview);
+}
+
+namespace plugin::mqtt
+{
+    template class BasicCborSyncDecoder<std::int16_t>;
+    template class BasicCborSyncDecoder<std::int32_t>;
+    template class BasicCborSyncDecoder<float>;
+    template class BasicCborSyncDecoder<double>;
+
+    namespace
+    {
+        template <typename T>
+        std::vector<std::shared_ptr<Decoder>> createDecoders(Datatype d, int nominal_sample_rate, StreamClock::Pointer clock, StreamBase::Recovery recovery, std::size_t reorder_depth, std::vector<std::string> channels)
+        {
+            if (channels.empty())
+            {
+                return {std::make_shared<BasicCborSyncDecoder<T>>(d, nominal_sample_rate, clock, recovery, reorder_depth)};
+            }
+
+            auto decoders = BasicCborSyncDecoder<T>::createFrameDecoders(d, nominal_sample_rate, clock, recovery, reorder_depth, std::move(channels));
+            return {decoders.begin(), decoders.end()};
+        }
+    }
+
+    std::vector<std::shared_ptr<Decoder>> createCborSyncDecoders(SampleType type, Datatype d, int nominal_sample_rate, StreamClock::Pointer clock, StreamBase::Recovery recovery, std::size_t reorder_depth, std::vector<std::string> channels)
+    {
+        switch (type)
+        {
+        case SampleType::Int16:
+            return createDecoders<std::int16_t>(d, nominal_sample_rate, clock, recovery, reorder_depth, std::move(channels));
+        case SampleType::Int32:
+            return createDecoders<std::int32_t>(d, nominal_sample_rate, clock, recovery, reorder_depth, std::move(channels));
+        case SampleType::Float32:
+            return createDecoders<float>(d, nominal_sample_rate, clock, recovery, reorder_depth, std::move(channels));
+        case SampleType::Float64:
+            return createDecoders<double>(d, nominal_sample_rate, clock, recovery, reorder_depth, std::move(channels));
+        }
+
+        throw std::invalid_argument("Unknown sample-type.");
+    }
+}
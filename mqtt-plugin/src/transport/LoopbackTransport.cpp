@@ -0,0 +1,173 @@
+#include "transport/LoopbackTransport.h"
+
+//
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace plugin::mqtt;
+
+void LoopbackTransport::setCallbacks(Callbacks callbacks)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_callbacks = std::move(callbacks);
+}
+
+void LoopbackTransport::connect()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        if (m_connected)
+            return;
+
+        m_connected = true;
+    }
+
+    if (m_callbacks.connected)
+    {
+        m_callbacks.connected("loopback");
+    }
+}
+
+void LoopbackTransport::disconnect()
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_connected = false;
+    m_subscriptions.clear();
+    m_pending.clear();
+}
+
+bool LoopbackTransport::isConnected() const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_connected;
+}
+
+void LoopbackTransport::subscribe(const std::string &topic, int qos)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (!m_connected)
+        throw std::runtime_error("Loopback transport is not connected.");
+
+    m_subscriptions[topic] = qos;
+}
+
+void LoopbackTransport::unsubscribe(const std::string &topic)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (!m_connected)
+        throw std::runtime_error("Loopback transport is not connected.");
+
+    m_subscriptions.erase(topic);
+}
+
+void LoopbackTransport::publish(const std::string &topic, const std::string &payload, int qos, DeliveryCallback on_delivery)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        if (!m_connected)
+            throw std::runtime_error("Loopback transport is not connected.");
+
+        auto msg = make_message(topic, payload, qos, false);
+        m_published.push_back(msg);
+
+        if (m_subscriptions.count(topic) > 0)
+        {
+            m_pending.push_back(msg);
+        }
+    }
+
+    if (on_delivery)
+    {
+        on_delivery(true);
+    }
+}
+
+bool LoopbackTransport::inject(const_message_ptr msg)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        if (!m_connected || m_subscriptions.count(msg->get_topic()) == 0)
+            return false;
+    }
+
+    if (m_callbacks.message_arrived)
+    {
+        m_callbacks.message_arrived(msg);
+    }
+    return true;
+}
+
+LoopbackTransport::Injection LoopbackTransport::inject(std::size_t count, double rate, const Generator &generator)
+{
+    Injection injection{0, 0, 0.0};
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t n = 0; n < count; ++n)
+    {
+        // Pace by the absolute schedule, so a late message does not delay all following messages
+        if (rate > 0)
+        {
+            const std::chrono::duration<double> offset(n / rate);
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset));
+        }
+
+        injection.injected++;
+        if (inject(generator(n)))
+        {
+            injection.delivered++;
+        }
+    }
+
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    injection.duration = duration.count();
+
+    return injection;
+}
+
+std::size_t LoopbackTransport::deliverPending()
+{
+    std::deque<const_message_ptr> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        pending.swap(m_pending);
+    }
+
+    std::size_t delivered = 0;
+    for (auto &msg : pending)
+    {
+        if (inject(msg))
+        {
+            delivered++;
+        }
+    }
+    return delivered;
+}
+
+void LoopbackTransport::loseConnection(const std::string &cause)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_connected = false;
+        m_pending.clear();
+    }
+
+    if (m_callbacks.connection_lost)
+    {
+        m_callbacks.connection_lost(cause);
+    }
+}
+
+std::vector<const_message_ptr> LoopbackTransport::takePublished()
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    std::vector<const_message_ptr> published;
+    published.swap(m_published);
+    return published;
+}
+
+std::map<std::string, int> LoopbackTransport::getSubscriptions() const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_subscriptions;
+}
@@ -0,0 +1,165 @@
+#include "transport/PahoTransport.h"
+#include "uuid.h"
+
+using namespace plugin::mqtt;
+
+namespace
+{
+    /**
+     * @brief Forward the completion of a delivery
+     * The listener is owned by the pending delivery and deletes itself once the delivery completed
+     */
+    class DeliveryListener : public virtual ::mqtt::iaction_listener
+    {
+    public:
+        DeliveryListener(Transport::DeliveryCallback callback) : m_callback(std::move(callback))
+        {
+        }
+
+        void on_success(const ::mqtt::token &) override
+        {
+            complete(true);
+        }
+
+        void on_failure(const ::mqtt::token &) override
+        {
+            complete(false);
+        }
+
+        void complete(bool delivered)
+        {
+            if (m_callback)
+            {
+                m_callback(delivered);
+            }
+            delete this;
+        }
+
+    private:
+        Transport::DeliveryCallback m_callback;
+    };
+}
+
+PahoTransport::PahoTransport(config::Server::Pointer server) : m_server(server)
+{
+}
+
+PahoTransport::~PahoTransport()
+{
+    disconnect();
+}
+
+void PahoTransport::setCallbacks(Callbacks callbacks)
+{
+    m_callbacks = std::move(callbacks);
+}
+
+void PahoTransport::connect()
+{
+    if (m_client)
+        return;
+
+    // Create a random uuid as the connection to the broker will be unique
+    auto uuid = uuids::uuid_system_generator{}();
+    m_client = std::make_unique<::mqtt::async_client>(m_server->getUrl(), uuids::to_string(uuid));
+
+    // Let the underlying paho client handle reconnect attempts
+    // TODO Make these settings part of the config-file
+    m_options.set_automatic_reconnect(true);
+    m_options.set_automatic_reconnect(10, 60);
+
+    // The client will always resubscribe to topics of interest when the connection is etasblished
+    // Hence, create a clean session
+    m_options.set_clean_session(false);
+
+    // Let paho handle MQTT Version handling (including fallbacks)
+    m_options.set_mqtt_version(MQTTVERSION_DEFAULT);
+
+    // Authenticate at the broker
+    if (auto username = m_server->getUsername())
+    {
+        m_options.set_user_name(*username);
+    }
+
+    if (auto password = m_server->getPassword())
+    {
+        m_options.set_password(*password);
+    }
+
+    // Limit the payloads in flight
+    if (auto max_inflight = m_server->getMaxInflight())
+    {
+        m_options.set_max_inflight(*max_inflight);
+    }
+
+    // Install callback and execute connect
+    m_client->set_callback(*this);
+    m_client->connect(m_options);
+}
+
+void PahoTransport::disconnect()
+{
+    if (m_client)
+    {
+        if (m_client->is_connected())
+        {
+            m_client->disconnect(100)->wait();
+            m_client->disable_callbacks();
+            m_client.reset();
+        }
+    }
+}
+
+bool PahoTransport::isConnected() const
+{
+    return m_client && m_client->is_connected();
+}
+
+void PahoTransport::subscribe(const std::string &topic, int qos)
+{
+    m_client->subscribe(topic, qos);
+}
+
+void PahoTransport::unsubscribe(const std::string &topic)
+{
+    m_client->unsubscribe(topic);
+}
+
+void PahoTransport::publish(const std::string &topic, const std::string &payload, int qos, DeliveryCallback on_delivery)
+{
+    auto listener = new DeliveryListener(std::move(on_delivery));
+    try
+    {
+        m_client->publish(topic, payload.data(), payload.size(), qos, false, nullptr, *listener);
+    }
+    catch (...)
+    {
+        // The delivery has not been started, hence the listener is not owned by the client
+        delete listener;
+        throw;
+    }
+}
+
+void PahoTransport::connected(const std::string &cause)
+{
+    if (m_callbacks.connected)
+    {
+        m_callbacks.connected(cause);
+    }
+}
+
+void PahoTransport::connection_lost(const std::string &cause)
+{
+    if (m_callbacks.connection_lost)
+    {
+        m_callbacks.connection_lost(cause);
+    }
+}
+
+void PahoTransport::message_arrived(::mqtt::const_message_ptr msg)
+{
+    if (m_callbacks.message_arrived)
+    {
+        m_callbacks.message_arrived(msg);
+    }
+}
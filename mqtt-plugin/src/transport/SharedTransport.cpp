@@ -0,0 +1,437 @@
+#include "transport/SharedTransport.h"
+
+//
+#include <exception>
+#include <stdexcept>
+
+using namespace plugin::mqtt;
+
+namespace
+{
+    // The transport whose callbacks are called by this thread, if any
+    thread_local const SharedTransport *t_dispatching = nullptr;
+}
+
+SharedConnection::SharedConnection(Transport::Pointer transport, std::shared_ptr<FlowControl> flow_control)
+    : m_transport(std::move(transport)), m_flow_control(std::move(flow_control))
+{
+    Transport::Callbacks callbacks;
+    callbacks.connected = [this](const std::string &cause)
+    { connected(cause); };
+    callbacks.connection_lost = [this](const std::string &cause)
+    { connection_lost(cause); };
+    callbacks.message_arrived = [this](const_message_ptr msg)
+    { message_arrived(msg); };
+
+    m_transport->setCallbacks(callbacks);
+}
+
+SharedConnection::~SharedConnection()
+{
+    m_transport->disconnect();
+    m_transport->setCallbacks({});
+}
+
+void SharedConnection::attach(const std::shared_ptr<SharedTransport> &session)
+{
+    bool attached = false;
+    bool connected = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        attached = m_sessions.emplace(session.get(), Session{session, {}}).second;
+        connected = m_transport->isConnected();
+    }
+
+    if (!connected)
+    {
+        // The connected callback is called for all attached transports
+        m_transport->connect();
+    }
+    else if (attached)
+    {
+        // Joining an established connection
+        session->dispatch([](const Transport::Callbacks &callbacks)
+                          {
+                              if (callbacks.connected)
+                              {
+                                  callbacks.connected("shared");
+                              } });
+    }
+}
+
+void SharedConnection::detach(const SharedTransport *session)
+{
+    std::unique_lock<std::mutex> broker(m_broker_mtx);
+
+    std::vector<std::string> released;
+    bool last = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        auto it = m_sessions.find(session);
+        if (it == m_sessions.end())
+            return;
+
+        const bool connected = m_transport->isConnected();
+        for (const auto &topic : it->second.topics)
+        {
+            if (release(topic) && connected)
+            {
+                released.push_back(topic);
+            }
+        }
+
+        m_sessions.erase(it);
+        last = m_sessions.empty();
+    }
+
+    // Ask the broker without holding the lock, the other transports keep receiving meanwhile
+    std::exception_ptr error;
+    for (const auto &topic : released)
+    {
+        try
+        {
+            m_transport->unsubscribe(topic);
+        }
+        catch (const std::exception &)
+        {
+            // The first failure is reported once all topics have been asked
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    broker.unlock();
+
+    // Close the connection without holding the lock, callbacks might be pending
+    if (last)
+    {
+        m_transport->disconnect();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+bool SharedConnection::isConnected(const SharedTransport *session) const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_sessions.count(session) > 0 && m_transport->isConnected();
+}
+
+void SharedConnection::subscribe(const SharedTransport *session, const std::string &topic, int qos)
+{
+    std::lock_guard<std::mutex> broker(m_broker_mtx);
+    std::lock_guard<std::mutex> lock(m_mtx);
+    auto it = m_sessions.find(session);
+    if (it == m_sessions.end())
+        throw std::runtime_error("Transport is not connected.");
+
+    if (it->second.topics.count(topic) > 0)
+        return;
+
+    // Subscribe at the broker before counting, a failed subscription is retried by the service
+    auto subscription = m_subscriptions.find(topic);
+    if (subscription == m_subscriptions.end())
+    {
+        m_transport->subscribe(topic, qos);
+        m_subscriptions[topic] = {1, qos};
+    }
+    else
+    {
+        if (qos > subscription->second.qos)
+        {
+            m_transport->subscribe(topic, qos);
+            subscription->second.qos = qos;
+        }
+        subscription->second.count++;
+    }
+
+    it->second.topics.insert(topic);
+}
+
+void SharedConnection::unsubscribe(const SharedTransport *session, const std::string &topic)
+{
+    std::lock_guard<std::mutex> broker(m_broker_mtx);
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        auto it = m_sessions.find(session);
+        if (it == m_sessions.end())
+            throw std::runtime_error("Transport is not connected.");
+
+        if (it->second.topics.erase(topic) == 0 || !release(topic))
+            return;
+    }
+
+    // Ask the broker without holding the lock, the other transports keep receiving meanwhile
+    m_transport->unsubscribe(topic);
+}
+
+bool SharedConnection::release(const std::string &topic)
+{
+    auto it = m_subscriptions.find(topic);
+    if (it == m_subscriptions.end())
+        return false;
+
+    if (--it->second.count > 0)
+        return false;
+
+    m_subscriptions.erase(it);
+    return true;
+}
+
+void SharedConnection::publish(const std::string &topic, const std::string &payload, int qos, Transport::DeliveryCallback on_delivery)
+{
+    m_transport->publish(topic, payload, qos, std::move(on_delivery));
+}
+
+std::size_t SharedConnection::getSessionCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_sessions.size();
+}
+
+std::shared_ptr<FlowControl> SharedConnection::getFlowControl() const
+{
+    return m_flow_control;
+}
+
+std::vector<std::shared_ptr<SharedTransport>> SharedConnection::getSessions(const std::string *topic) const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    std::vector<std::shared_ptr<SharedTransport>> sessions;
+    for (const auto &[key, session] : m_sessions)
+    {
+        if (topic && session.topics.count(*topic) == 0)
+            continue;
+
+        if (auto transport = session.transport.lock())
+        {
+            sessions.push_back(transport);
+        }
+    }
+    return sessions;
+}
+
+void SharedConnection::connected(const std::string &cause)
+{
+    {
+        // Every service subscribes to its topics again once connected
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_subscriptions.clear();
+        for (auto &[key, session] : m_sessions)
+        {
+            session.topics.clear();
+        }
+    }
+
+    for (auto &session : getSessions())
+    {
+        session->dispatch([&](const Transport::Callbacks &callbacks)
+                          {
+                              if (callbacks.connected)
+                              {
+                                  callbacks.connected(cause);
+                              } });
+    }
+}
+
+void SharedConnection::connection_lost(const std::string &cause)
+{
+    for (auto &session : getSessions())
+    {
+        session->dispatch([&](const Transport::Callbacks &callbacks)
+                          {
+                              if (callbacks.connection_lost)
+                              {
+                                  callbacks.connection_lost(cause);
+                              } });
+    }
+}
+
+void SharedConnection::message_arrived(const_message_ptr msg)
+{
+    const auto &topic = msg->get_topic();
+    for (auto &session : getSessions(&topic))
+    {
+        session->dispatch([&](const Transport::Callbacks &callbacks)
+                          {
+                              if (callbacks.message_arrived)
+                              {
+                                  callbacks.message_arrived(msg);
+                              } });
+    }
+}
+
+SharedTransport::SharedTransport(SharedConnection::Pointer connection) : m_connection(std::move(connection))
+{
+}
+
+SharedTransport::~SharedTransport()
+{
+    // No callback is in flight, the shared connection holds the transport while dispatching
+    try
+    {
+        m_connection->detach(this);
+    }
+    catch (const std::exception &)
+    {
+        // Payloads of topics failing to unsubscribe are not dispatched to any transport
+    }
+}
+
+void SharedTransport::setCallbacks(Callbacks callbacks)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_callbacks = std::move(callbacks);
+}
+
+void SharedTransport::dispatch(const std::function<void(const Callbacks &callbacks)> &call)
+{
+    Callbacks callbacks;
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        if (!m_attached)
+            return;
+
+        callbacks = m_callbacks;
+        m_dispatching++;
+    }
+
+    // Leaves the dispatch even if the callback throws
+    struct Leave
+    {
+        SharedTransport &transport;
+        const SharedTransport *previous;
+
+        ~Leave()
+        {
+            t_dispatching = previous;
+
+            std::lock_guard<std::mutex> lock(transport.m_mtx);
+            if (--transport.m_dispatching == 0)
+            {
+                transport.m_idle.notify_all();
+            }
+        }
+    } leave{*this, t_dispatching};
+
+    t_dispatching = this;
+    call(callbacks);
+}
+
+void SharedTransport::stopDispatching()
+{
+    std::unique_lock<std::mutex> lock(m_mtx);
+    m_attached = false;
+
+    // A callback disconnecting its own transport would wait for itself
+    const std::size_t own = t_dispatching == this ? 1 : 0;
+    m_idle.wait(lock, [this, own]
+                { return m_dispatching <= own; });
+}
+
+void SharedTransport::connect()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_attached = true;
+    }
+    m_connection->attach(shared_from_this());
+}
+
+void SharedTransport::disconnect()
+{
+    // No callback reaches the service once disconnected
+    stopDispatching();
+    m_connection->detach(this);
+}
+
+bool SharedTransport::isConnected() const
+{
+    return m_connection->isConnected(this);
+}
+
+void SharedTransport::subscribe(const std::string &topic, int qos)
+{
+    m_connection->subscribe(this, topic, qos);
+}
+
+void SharedTransport::unsubscribe(const std::string &topic)
+{
+    m_connection->unsubscribe(this, topic);
+}
+
+void SharedTransport::publish(const std::string &topic, const std::string &payload, int qos, DeliveryCallback on_delivery)
+{
+    m_connection->publish(topic, payload, qos, std::move(on_delivery));
+}
+
+std::shared_ptr<FlowControl> SharedTransport::getFlowControl() const
+{
+    return m_connection->getFlowControl();
+}
+
+SharedConnection::Pointer SharedTransport::getConnection() const
+{
+    return m_connection;
+}
+
+struct ConnectionRegistry::Registry
+{
+    std::mutex mtx;
+    std::map<std::string, std::weak_ptr<SharedConnection>> connections;
+};
+
+ConnectionRegistry::Registry &ConnectionRegistry::registry()
+{
+    static Registry r;
+    return r;
+}
+
+std::string ConnectionRegistry::getKey(const config::Server &server)
+{
+    // Separated by characters that can not be part of an url
+    const auto max_inflight = server.getMaxInflight();
+    return server.getUrl() + '\n' + server.getUsername().value_or("") + '\n' + server.getPassword().value_or("") + '\n' +
+           (max_inflight ? std::to_string(*max_inflight) : std::string());
+}
+
+Transport::Pointer ConnectionRegistry::acquire(config::Server::Pointer server, const Factory &factory)
+{
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+
+    auto &entry = r.connections[getKey(*server)];
+    auto connection = entry.lock();
+    if (!connection)
+    {
+        // The payloads of all services never exceed the limit of the client
+        auto flow_control = std::make_shared<FlowControl>();
+        if (auto max_inflight = server->getMaxInflight())
+        {
+            flow_control->setMaxWindow(static_cast<std::size_t>(*max_inflight));
+        }
+
+        connection = std::make_shared<SharedConnection>(factory(server), flow_control);
+        entry = connection;
+    }
+
+    return std::make_shared<SharedTransport>(connection);
+}
+
+std::size_t ConnectionRegistry::getConnectionCount()
+{
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+
+    // Drop connections released meanwhile
+    for (auto it = r.connections.begin(); it != r.connections.end();)
+    {
+        it = it->second.expired() ? r.connections.erase(it) : std::next(it);
+    }
+    return r.connections.size();
+}
@@ -0,0 +1,376 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+//
+#include "Service.h"
+#include "processing/Processor.h"
+#include "subscription/decoding/TextPlainDecoder.h"
+#include "transport/LoopbackTransport.h"
+
+namespace plugin::mqtt::test
+{
+    /**
+     * @brief Create an async subscription of a single text/plain channel, named by its topic
+     * @param topic
+     * @param datatype
+     * @param local_channel_id
+     * @return Subscription::Pointer
+     */
+    inline Subscription::Pointer createSubscription(const std::string &topic, Datatype datatype = Datatype::Integer, std::uint32_t local_channel_id = 1)
+    {
+        Subscription::Sampling sampling;
+        sampling.mode = SamplingModes::Async;
+        sampling.timeout = 0;
+
+        Channel::Configuration config;
+        config.name = topic;
+        config.uuid = topic;
+        config.datatype = datatype;
+        config.decoder = std::make_shared<TextPlainDecoder>(datatype);
+        config.local_channel_id = local_channel_id;
+
+        auto subscription = std::make_shared<Subscription>(sampling, topic, 0);
+        subscription->addChannel(std::make_shared<Channel>(config));
+        return subscription;
+    }
+
+    /**
+     * @brief Create a publish handler of a single Oxygen input channel
+     * @param topic
+     * @param input_channel_id
+     * @param mode
+     * @param datatype
+     * @param packet_size Samples per payload, sync publish handlers only
+     * @return Publish::Pointer
+     */
+    inline Publish::Pointer createPublisher(const std::string &topic, std::uint64_t input_channel_id, SamplingModes mode = SamplingModes::Async, Datatype datatype = Datatype::Integer, int packet_size = 1)
+    {
+        Publish::Sampling sampling;
+        sampling.mode = mode;
+        sampling.downsampling_factor = 1;
+
+        auto publish = std::make_shared<Publish>(topic, "uuid", sampling, datatype, packet_size, 0);
+        publish->getInputChannel()->setValue(input_channel_id);
+        return publish;
+    }
+
+    /**
+     * @brief Records all samples written to the Oxygen output channels
+     */
+    class RecordingSink : public SampleSink
+    {
+    public:
+        struct Channel
+        {
+            std::size_t calls = 0;
+            std::vector<std::uint64_t> ticks;
+            std::vector<double> values;
+            std::vector<std::string> strings;
+        };
+
+        void addSample(std::uint32_t local_channel_id, std::uint64_t ticks, int value) override
+        {
+            record(local_channel_id, ticks, value);
+        }
+
+        void addSample(std::uint32_t local_channel_id, std::uint64_t ticks, double value) override
+        {
+            record(local_channel_id, ticks, value);
+        }
+
+        void addSample(std::uint32_t local_channel_id, std::uint64_t ticks, const std::string &value) override
+        {
+            auto &channel = m_channels[local_channel_id];
+            channel.calls++;
+            channel.ticks.push_back(ticks);
+            channel.strings.push_back(value);
+            m_samples++;
+        }
+
+        void addSample(std::uint32_t local_channel_id, std::uint64_t ticks, const std::vector<double> &value) override
+        {
+            // A single sample, all of its elements are recorded
+            auto &channel = m_channels[local_channel_id];
+            channel.calls++;
+            channel.ticks.push_back(ticks);
+            channel.values.insert(channel.values.end(), value.begin(), value.end());
+            m_samples++;
+        }
+
+        void addSamples(std::uint32_t local_channel_id, std::uint64_t ticks, const std::vector<int> &values) override
+        {
+            record(local_channel_id, ticks, values);
+        }
+
+        void addSamples(std::uint32_t local_channel_id, std::uint64_t ticks, const std::vector<double> &values) override
+        {
+            record(local_channel_id, ticks, values);
+        }
+
+        Channel &channel(std::uint32_t local_channel_id)
+        {
+            return m_channels[local_channel_id];
+        }
+
+        std::size_t samples() const
+        {
+            return m_samples;
+        }
+
+        void clear()
+        {
+            m_channels.clear();
+        }
+
+    private:
+        template <typename T>
+        void record(std::uint32_t local_channel_id, std::uint64_t ticks, T value)
+        {
+            auto &channel = m_channels[local_channel_id];
+            channel.calls++;
+            channel.ticks.push_back(ticks);
+            channel.values.push_back(static_cast<double>(value));
+            m_samples++;
+        }
+
+        template <typename T>
+        void record(std::uint32_t local_channel_id, std::uint64_t ticks, const std::vector<T> &values)
+        {
+            auto &channel = m_channels[local_channel_id];
+            channel.calls++;
+            channel.ticks.push_back(ticks);
+            channel.values.insert(channel.values.end(), values.begin(), values.end());
+            m_samples += values.size();
+        }
+
+        std::map<std::uint32_t, Channel> m_channels;
+        std::size_t m_samples = 0;
+    };
+
+    /**
+     * @brief Synthetic Oxygen input channels, samples are generated for the current processing window
+     */
+    class SyntheticSource : public SampleSource
+    {
+    public:
+        using Generator = std::function<value_t(std::uint64_t index)>;
+
+        void addSyncChannel(std::uint64_t channel_id, double sample_rate, Generator generator)
+        {
+            m_channels[channel_id] = {SamplingModes::Sync, sample_rate, std::move(generator)};
+        }
+
+        void addAsyncChannel(std::uint64_t channel_id, double sample_rate, Generator generator)
+        {
+            m_channels[channel_id] = {SamplingModes::Async, sample_rate, std::move(generator)};
+        }
+
+        /**
+         * @brief Add a sync channel of a sample format the plugin does not read, it is read without samples
+         */
+        void addUnsupportedSyncChannel(std::uint64_t channel_id, double sample_rate)
+        {
+            m_channels[channel_id] = {SamplingModes::Sync, sample_rate, nullptr};
+        }
+
+        void setWindow(double start, double end)
+        {
+            m_window_start = start;
+            m_window_end = end;
+        }
+
+        bool readSync(std::uint64_t channel_id, std::vector<value_t> &values, double &sample_rate, double &timestamp) override
+        {
+            auto it = m_channels.find(channel_id);
+            if (it == m_channels.end() || it->second.mode != SamplingModes::Sync)
+                return false;
+
+            const auto &channel = it->second;
+            const auto first = static_cast<std::uint64_t>(std::ceil(m_window_start * channel.sample_rate));
+            const auto last = static_cast<std::uint64_t>(std::ceil(m_window_end * channel.sample_rate));
+
+            sample_rate = channel.sample_rate;
+            timestamp = first / channel.sample_rate;
+
+            if (!channel.generator)
+                return true;
+
+            values.reserve(last - first);
+            for (auto idx = first; idx < last; ++idx)
+            {
+                values.push_back(channel.generator(idx));
+            }
+
+            m_samples += last - first;
+            return true;
+        }
+
+        bool readAsync(std::uint64_t channel_id, const AsyncCallback &callback) override
+        {
+            auto it = m_channels.find(channel_id);
+            if (it == m_channels.end() || it->second.mode != SamplingModes::Async)
+                return false;
+
+            const auto &channel = it->second;
+            const auto first = static_cast<std::uint64_t>(std::ceil(m_window_start * channel.sample_rate));
+            const auto last = static_cast<std::uint64_t>(std::ceil(m_window_end * channel.sample_rate));
+
+            for (auto idx = first; idx < last; ++idx)
+            {
+                callback(idx / channel.sample_rate, channel.generator(idx));
+            }
+
+            m_samples += last - first;
+            return true;
+        }
+
+        std::size_t samples() const
+        {
+            return m_samples;
+        }
+
+    private:
+        struct Channel
+        {
+            SamplingModes mode;
+            double sample_rate;
+            Generator generator;
+        };
+
+        std::map<std::uint64_t, Channel> m_channels;
+        double m_window_start = 0;
+        double m_window_end = 0;
+        std::size_t m_samples = 0;
+    };
+
+    /**
+     * @brief Stand-in for the Oxygen host: drives the Processor cycle by cycle, connected to a loopback transport
+     * Reports the number of processed samples per second and the latency of a processing cycle
+     */
+    class HeadlessHost
+    {
+    public:
+        struct Report
+        {
+            std::size_t cycles;
+
+            // Samples written to output channels and read from input channels per second of wall time
+            double samples_per_second;
+
+            // Wall time spent within a processing cycle in seconds
+            double mean_cycle_latency;
+            double max_cycle_latency;
+        };
+
+        HeadlessHost(double master_frequency = 1e6) : m_master_frequency(master_frequency),
+                                                      m_transport(std::make_shared<LoopbackTransport>()),
+                                                      m_processor(m_service)
+        {
+            m_service.setTimeSource([this]
+                                    { return Timestamp(m_now, m_master_frequency); });
+            m_service.setTransport(m_transport);
+        }
+
+        ~HeadlessHost()
+        {
+            m_service.disconnect();
+        }
+
+        Service &service()
+        {
+            return m_service;
+        }
+
+        LoopbackTransport &transport()
+        {
+            return *m_transport;
+        }
+
+        RecordingSink &sink()
+        {
+            return m_sink;
+        }
+
+        SyntheticSource &source()
+        {
+            return m_source;
+        }
+
+        /**
+         * @brief Connect and prepare processing, all configured subscriptions and publish handlers must be added before
+         */
+        void start()
+        {
+            m_service.connect();
+            m_service.prepareProcessing();
+        }
+
+        void stop()
+        {
+            m_service.stopProcessing();
+        }
+
+        /**
+         * @brief Get the current host time
+         * @return Timestamp
+         */
+        Timestamp now() const
+        {
+            return Timestamp(m_now, m_master_frequency);
+        }
+
+        /**
+         * @brief Advance the host time and process the resulting window
+         * @param duration Length of the processing window in seconds
+         */
+        void cycle(double duration)
+        {
+            const double start = m_time;
+            m_time += duration;
+            m_now = static_cast<std::uint64_t>(std::llround(m_time * m_master_frequency));
+            m_source.setWindow(start, m_time);
+
+            const auto begin = std::chrono::steady_clock::now();
+            m_processor.process(m_sink, m_source, m_now);
+            const std::chrono::duration<double> latency = std::chrono::steady_clock::now() - begin;
+
+            m_cycles++;
+            m_total_latency += latency.count();
+            m_max_latency = std::max(m_max_latency, latency.count());
+        }
+
+        Report report() const
+        {
+            Report report;
+            report.cycles = m_cycles;
+            report.samples_per_second = m_total_latency > 0 ? (m_sink.samples() + m_source.samples()) / m_total_latency : 0.0;
+            report.mean_cycle_latency = m_cycles > 0 ? m_total_latency / m_cycles : 0.0;
+            report.max_cycle_latency = m_max_latency;
+            return report;
+        }
+
+    private:
+        const double m_master_frequency;
+        std::atomic<std::uint64_t> m_now{0};
+        double m_time = 0;
+
+        Service m_service;
+        std::shared_ptr<LoopbackTransport> m_transport;
+        Processor m_processor;
+        RecordingSink m_sink;
+        SyntheticSource m_source;
+
+        std::size_t m_cycles = 0;
+        double m_total_latency = 0;
+        double m_max_latency = 0;
+    };
+}
@@ -0,0 +1,136 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+//
+#include <catch2/catch_test_macros.hpp>
+
+//
+#include "HeadlessHost.h"
+#include "capture/CaptureWriter.h"
+#include "capture/Replay.h"
+
+using namespace plugin::mqtt;
+using namespace plugin::mqtt::capture;
+using namespace plugin::mqtt::test;
+
+namespace
+{
+    std::string capturePath(const std::string &name)
+    {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+}
+
+TEST_CASE("Capture file round trip")
+{
+    const auto path = capturePath("mqtt_capture_roundtrip.mqttcap");
+    const std::string binary("\0\x01\xff payload", 11);
+    {
+        CaptureWriter writer(path);
+        writer.write(RecordKind::Start, Timestamp(10, 1000.0), "", "");
+        for (int n = 0; n < 100; ++n)
+        {
+            writer.write(RecordKind::Message, Timestamp(100 + n, 1000.0), "/capture/" + std::to_string(n % 3), binary + std::to_string(n));
+        }
+        REQUIRE(writer.getDropped() == 0);
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    readHeader(file);
+
+    Record record;
+    REQUIRE(readRecord(file, record));
+    REQUIRE(record.kind == RecordKind::Start);
+    REQUIRE(record.timestamp.ticks == 10);
+
+    std::uint64_t arrival = 0;
+    for (int n = 0; n < 100; ++n)
+    {
+        REQUIRE(readRecord(file, record));
+        REQUIRE(record.kind == RecordKind::Message);
+        REQUIRE(record.timestamp.ticks == static_cast<std::uint64_t>(100 + n));
+        REQUIRE(record.timestamp.frequency == 1000.0);
+        REQUIRE(record.topic == "/capture/" + std::to_string(n % 3));
+        REQUIRE(record.payload == binary + std::to_string(n));
+        REQUIRE(record.arrival >= arrival);
+        arrival = record.arrival;
+    }
+    REQUIRE(readRecord(file, record) == false);
+
+    file.close();
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Replay captured traffic through the decode path")
+{
+    const auto path = capturePath("mqtt_capture_replay.mqttcap");
+    std::uint64_t now = 0;
+
+    // Capture messages arriving at the service
+    Samples captured;
+    {
+        auto transport = std::make_shared<LoopbackTransport>();
+        auto subscription = createSubscription("/capture/in");
+
+        Service service;
+        service.setTimeSource([&now]
+                              { return Timestamp(now, 1000000); });
+        service.setCapture(std::make_shared<CaptureWriter>(path));
+        service.addSubscription(subscription);
+        service.setTransport(transport);
+        service.connect();
+        service.prepareProcessing();
+
+        for (int n = 0; n < 50; ++n)
+        {
+            now += 1000 + 37 * n;
+            transport->inject(make_message("/capture/in", std::to_string(n)));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        captured = subscription->getChannels().front()->getAndClearSamples();
+        service.stopProcessing();
+        service.disconnect();
+    }
+
+    for (auto speed : {Replay::Speed::Unlimited, Replay::Speed::Realtime})
+    {
+        auto transport = std::make_shared<LoopbackTransport>();
+        auto subscription = createSubscription("/capture/in");
+        Replay replay(path, *transport);
+
+        Service service;
+        service.setTimeSource([&replay]
+                              { return replay.now(); });
+        service.addSubscription(subscription);
+        service.setTransport(transport);
+        service.connect();
+        replay.setStartCallback([&service]
+                                { service.prepareProcessing(); });
+
+        auto statistics = replay.run(speed);
+        REQUIRE(statistics.messages == 50);
+        REQUIRE(statistics.delivered == 50);
+
+        // Captured messages arrived at least 1 ms apart
+        if (speed == Replay::Speed::Realtime)
+        {
+            REQUIRE(statistics.duration >= 0.049);
+        }
+
+        auto replayed = subscription->getChannels().front()->getAndClearSamples();
+        REQUIRE(replayed.size() == captured.size());
+        for (std::size_t n = 0; n < replayed.size(); ++n)
+        {
+            REQUIRE(replayed[n].time.ticks == captured[n].time.ticks);
+            REQUIRE(replayed[n].values == captured[n].values);
+        }
+
+        service.disconnect();
+    }
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,650 @@
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+//
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+//
+#include "HeadlessHost.h"
+#include "configuration/Configuration.h"
+#include "configuration/StreamStates.h"
+#include "diagnostics/DiagnosticChannels.h"
+
+//
+#include "nlohmann/json.hpp"
+
+using namespace plugin::mqtt;
+using namespace plugin::mqtt::config;
+using namespace plugin::mqtt::diagnostics;
+using namespace plugin::mqtt::test;
+using nlohmann::json;
+
+namespace
+{
+    json subscribeTopic(const std::string &type)
+    {
+        return {
+            {"subscribe",
+             {{"sampling", {{"type", "async"}}},
+              {"payload", {{"text/plain", {{"schema", {{"type", type}}}}}}}}}};
+    }
+
+    json publishTopic()
+    {
+        return {
+            {"publish",
+             {{"sampling", {{"type", "async"}}},
+              {"payload", {{"type", "number"}}}}}};
+    }
+
+    json configuration(const json &topics, bool diagnostics = false)
+    {
+        return {
+            {"version", "0.1"},
+            {"servers", {{{"url", "loopback"}, {"diagnostics", diagnostics}}}},
+            {"topics", topics}};
+    }
+
+    /**
+     * @brief A configuration of JSON topics with ten channels each
+     */
+    json largeConfiguration(std::size_t num_channels)
+    {
+        json schema = json::object();
+        for (int n = 0; n < 10; ++n)
+        {
+            schema["channel" + std::to_string(n)] = {{"type", "number"}};
+        }
+
+        json topics = json::object();
+        for (std::size_t n = 0; n < num_channels / 10; ++n)
+        {
+            topics["/large/" + std::to_string(n)] = {
+                {"subscribe",
+                 {{"sampling", {{"type", "async"}}},
+                  {"payload", {{"text/json", {{"schema", schema}}}}}}}};
+        }
+        return configuration(topics);
+    }
+
+    std::vector<std::string> paths(const Topics &topics)
+    {
+        std::vector<std::string> p;
+        for (auto &topic : topics)
+        {
+            p.push_back(topic->getPath());
+        }
+        std::sort(p.begin(), p.end());
+        return p;
+    }
+
+    Topic::Pointer find(const Topics &topics, const std::string &path)
+    {
+        for (auto &topic : topics)
+        {
+            if (topic->getPath() == path)
+                return topic;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Apply reloaded changes to a service the way the plugin does
+     */
+    void apply(Service &service, const Configuration::Changes &changes, LocalId::value_type &next_id)
+    {
+        for (auto &topic : changes.removed)
+        {
+            if (topic->getOperation() == Operation::Subscribe)
+                service.removeSubscription(topic->getPath());
+            else
+                service.removePublishHandler(topic->getPath());
+        }
+
+        for (auto &topic : changes.added)
+        {
+            if (topic->getOperation() == Operation::Subscribe)
+            {
+                for (auto &channel : topic->getSubscription()->getChannels())
+                {
+                    channel->getConfiguration().local_channel_id = next_id++;
+                }
+                service.addSubscription(topic->getSubscription());
+            }
+            else
+            {
+                service.addPublishHandler(topic->getPublisher());
+            }
+        }
+    }
+
+    /**
+     * @brief Keeps the diagnostic channels of subscriptions the way the plugin does
+     * Group channels are keyed by their topic, Oxygen does not accept a key twice
+     */
+    struct DiagnosticOutputs
+    {
+        DiagnosticChannels diagnostics{1.0};
+        std::map<std::string, Subscription::Pointer> groups;
+        std::map<Subscription::Pointer, std::pair<std::string, LocalId::value_type>> channels;
+        LocalId::value_type next_id = 1000;
+
+        void create(const Subscription::Pointer &subscription)
+        {
+            const auto key = "MQTT@Diagnostics" + subscription->getTopic();
+            REQUIRE(groups.emplace(key, subscription).second);
+
+            DiagnosticChannels::Channels c;
+            c.messages_per_second = next_id;
+            channels[subscription] = {key, next_id++};
+            diagnostics.add(subscription, c);
+        }
+
+        void remove(const Subscription::Pointer &subscription)
+        {
+            diagnostics.remove(subscription);
+
+            auto it = channels.find(subscription);
+            if (it == channels.end())
+                return;
+
+            groups.erase(it->second.first);
+            channels.erase(it);
+        }
+
+        void apply(const Configuration::Changes &changes)
+        {
+            // Removed topics take their diagnostic channels along, changed topics create them again
+            for (auto &topic : changes.removed)
+            {
+                if (topic->getOperation() == Operation::Subscribe)
+                    remove(topic->getSubscription());
+            }
+            for (auto &topic : changes.added)
+            {
+                if (topic->getOperation() == Operation::Subscribe)
+                    create(topic->getSubscription());
+            }
+        }
+    };
+}
+
+TEST_CASE("Reloading a configuration keeps unchanged topics")
+{
+    Configuration c;
+    Configuration::Changes changes;
+
+    auto loaded = c.reload(configuration({{"/a", subscribeTopic("integer")}, {"/b", subscribeTopic("integer")}, {"/c", publishTopic()}}).dump(), changes);
+    REQUIRE(loaded.error == false);
+
+    // The first reload loads all topics
+    REQUIRE(paths(changes.added) == std::vector<std::string>{"/a", "/b", "/c"});
+    REQUIRE(changes.removed.empty());
+
+    const auto a = find(c.getSubscriptions(), "/a");
+    const auto uuid = loaded.document["/topics/~1a/subscribe/payload/text~1plain/schema/__uuid"_json_pointer];
+
+    // The configuration file does not contain the generated UUIDs: /b changes, /c is removed and /d is added
+    changes = {};
+    auto reloaded = c.reload(configuration({{"/a", subscribeTopic("integer")}, {"/b", subscribeTopic("number")}, {"/d", subscribeTopic("string")}}).dump(), changes);
+    REQUIRE(reloaded.error == false);
+
+    REQUIRE(paths(changes.added) == std::vector<std::string>{"/b", "/d"});
+    REQUIRE(paths(changes.removed) == std::vector<std::string>{"/b", "/c"});
+    REQUIRE(changes.servers_changed == false);
+
+    // Unchanged topics keep their objects and identifiers
+    REQUIRE(find(c.getSubscriptions(), "/a") == a);
+    REQUIRE(reloaded.document["/topics/~1a/subscribe/payload/text~1plain/schema/__uuid"_json_pointer] == uuid);
+    REQUIRE(reloaded.document["/topics/~1d/subscribe/payload/text~1plain/schema"_json_pointer].contains("__uuid"));
+    REQUIRE(paths(c.getSubscriptions()) == std::vector<std::string>{"/a", "/b", "/d"});
+    REQUIRE(c.getPublishers().empty());
+
+    // Reloading the cached document does not change anything
+    changes = {};
+    REQUIRE(c.reload(reloaded.document.dump(), changes).error == false);
+    REQUIRE(changes.added.empty());
+    REQUIRE(changes.removed.empty());
+
+    // Server changes require a new connection
+    changes = {};
+    auto servers = reloaded.document;
+    servers["servers"][0]["url"] = "127.0.0.1:1883";
+    REQUIRE(c.reload(servers.dump(), changes).error == false);
+    REQUIRE(changes.servers_changed);
+    REQUIRE(changes.added.empty());
+    REQUIRE(c.getServers().front()->getUrl() == "127.0.0.1:1883");
+
+    // An invalid configuration leaves the current one in place
+    changes = {};
+    REQUIRE(c.reload("{", changes).error);
+    REQUIRE(paths(c.getSubscriptions()) == std::vector<std::string>{"/a", "/b", "/d"});
+}
+
+TEST_CASE("Reloading a changed topic keeps the identifiers of its channels")
+{
+    json schema = {{"type", "number"}};
+    schema["channels"] = json::array({{{"name", "voltage"}}, {{"name", "current"}}});
+
+    json topic;
+    topic["subscribe"]["sampling"] = {{"type", "sync"}, {"sample-rate", 1000}};
+    topic["subscribe"]["payload"]["cbor/json/sync"]["schema"] = schema;
+
+    Configuration c;
+    Configuration::Changes changes;
+    auto loaded = c.reload(configuration({{"/adc", topic}}).dump(), changes);
+    REQUIRE(loaded.error == false);
+
+    auto uuid = [](const json &document, const std::string &name)
+    {
+        for (auto &channel : document["/topics/~1adc/subscribe/payload/cbor~1json~1sync/schema/channels"_json_pointer])
+        {
+            if (channel["name"] == name)
+                return channel["__uuid"].get<std::string>();
+        }
+        return std::string();
+    };
+    const auto voltage = uuid(loaded.document, "voltage");
+    REQUIRE(voltage.empty() == false);
+
+    // Another QoS, a channel is inserted before the remaining one and another one is removed
+    topic["QoS"] = 1;
+    topic["subscribe"]["payload"]["cbor/json/sync"]["schema"]["channels"] = json::array({{{"name", "power"}}, {{"name", "voltage"}, {"range", {{"min", -1}, {"max", 1}}}}});
+
+    changes = {};
+    auto reloaded = c.reload(configuration({{"/adc", topic}}).dump(), changes);
+    REQUIRE(reloaded.error == false);
+    REQUIRE(paths(changes.added) == std::vector<std::string>{"/adc"});
+    REQUIRE(paths(changes.removed) == std::vector<std::string>{"/adc"});
+
+    REQUIRE(uuid(reloaded.document, "voltage") == voltage);
+    REQUIRE(uuid(reloaded.document, "power").empty() == false);
+    REQUIRE(uuid(reloaded.document, "power") != uuid(loaded.document, "current"));
+
+    const auto &channels = find(c.getSubscriptions(), "/adc")->getOxygenOutputChannelMap().group_channels.at("/adc").channels;
+    REQUIRE(channels[1]->getConfiguration().uuid == voltage);
+}
+
+TEST_CASE("Reloading resubscribes changed topics only")
+{
+    Configuration c;
+    Configuration::Changes changes;
+    REQUIRE(c.reload(configuration({{"/keep", subscribeTopic("integer")}, {"/drop", subscribeTopic("integer")}}).dump(), changes).error == false);
+
+    HeadlessHost host;
+    LocalId::value_type next_id = 1;
+    apply(host.service(), changes, next_id);
+    host.start();
+
+    const auto keep = find(c.getSubscriptions(), "/keep")->getSubscription();
+    const auto keep_id = keep->getChannels().front()->getLocalChannelId().value();
+    REQUIRE(host.transport().getSubscriptions().size() == 2);
+
+    host.transport().inject(10, 0, [](std::size_t n)
+                            { return make_message("/keep", std::to_string(n)); });
+
+    // Reload while processing, samples of untouched topics are not lost
+    changes = {};
+    REQUIRE(c.reload(configuration({{"/keep", subscribeTopic("integer")}, {"/add", subscribeTopic("integer")}}).dump(), changes).error == false);
+    apply(host.service(), changes, next_id);
+
+    const auto subscribed = host.transport().getSubscriptions();
+    REQUIRE(subscribed.size() == 2);
+    REQUIRE(subscribed.count("/keep") == 1);
+    REQUIRE(subscribed.count("/add") == 1);
+    REQUIRE(host.service().getSubscriptions().size() == 2);
+
+    host.transport().inject(10, 0, [](std::size_t n)
+                            { return make_message(n % 2 ? "/keep" : "/add", std::to_string(n)); });
+    REQUIRE(host.transport().inject(make_message("/drop", "1")) == false);
+    host.cycle(0.1);
+
+    REQUIRE(host.sink().channel(keep_id).values.size() == 15);
+    REQUIRE(host.sink().channel(next_id - 1).values.size() == 5);
+
+    host.stop();
+}
+
+TEST_CASE("Reloading a changed topic replaces its diagnostic channels")
+{
+    Configuration c;
+    Configuration::Changes changes;
+    REQUIRE(c.reload(configuration({{"/keep", subscribeTopic("integer")}, {"/change", subscribeTopic("integer")}}, true).dump(), changes).error == false);
+    REQUIRE(c.getServers().front()->getDiagnostics());
+
+    HeadlessHost host;
+    LocalId::value_type next_id = 1;
+    apply(host.service(), changes, next_id);
+
+    DiagnosticOutputs outputs;
+    outputs.apply(changes);
+    REQUIRE(outputs.groups.size() == 2);
+    const auto changed_id = outputs.channels.at(find(c.getSubscriptions(), "/change")->getSubscription()).second;
+
+    // The changed topic is removed and added again with a new subscription
+    changes = {};
+    REQUIRE(c.reload(configuration({{"/keep", subscribeTopic("integer")}, {"/change", subscribeTopic("number")}}, true).dump(), changes).error == false);
+    REQUIRE(paths(changes.removed) == std::vector<std::string>{"/change"});
+    apply(host.service(), changes, next_id);
+    outputs.apply(changes);
+
+    // A single group per topic, none left behind for the replaced subscription
+    REQUIRE(outputs.groups.size() == 2);
+    REQUIRE(outputs.channels.size() == 2);
+    for (auto &[subscription, channel] : outputs.channels)
+    {
+        REQUIRE(find(c.getSubscriptions(), subscription->getTopic())->getSubscription() == subscription);
+    }
+
+    // Only the diagnostic channels of the current subscriptions are written
+    host.start();
+    outputs.diagnostics.process(host.sink(), host.now());
+    for (int cycle = 0; cycle < 10; ++cycle)
+    {
+        host.transport().inject(10, 0, [](std::size_t n)
+                                { return make_message(n % 2 ? "/keep" : "/change", std::to_string(n)); });
+        host.cycle(0.1);
+        outputs.diagnostics.process(host.sink(), host.now());
+    }
+
+    for (auto &[subscription, channel] : outputs.channels)
+    {
+        REQUIRE(host.sink().channel(channel.second).values.size() == 1);
+    }
+    REQUIRE(host.sink().channel(changed_id).values.empty());
+
+    host.stop();
+}
+
+TEST_CASE("Sync topic carrying several channels")
+{
+    json schema = {{"type", "number"}};
+    schema["channels"] = json::array({{{"name", "voltage"}}, {{"name", "current"}, {"range", {{"min", -1}, {"max", 1}}}}});
+
+    json topic;
+    topic["subscribe"]["sampling"] = {{"type", "sync"}, {"sample-rate", 1000}};
+    topic["subscribe"]["payload"]["cbor/json/sync"]["schema"] = schema;
+
+    Configuration c;
+    auto loaded = c.load(configuration({{"/adc", topic}}).dump());
+    REQUIRE(loaded.error == false);
+
+    // The channels are grouped by the topic, every channel gets its own identifier
+    auto adc = find(c.getSubscriptions(), "/adc");
+    const auto &group = adc->getOxygenOutputChannelMap().group_channels.at("/adc");
+    REQUIRE(group.channels.size() == 2);
+    REQUIRE(group.channels[0]->getConfiguration().name == "voltage");
+    REQUIRE(group.channels[1]->getConfiguration().range.max == 1);
+    REQUIRE(loaded.document["/topics/~1adc/subscribe/payload/cbor~1json~1sync/schema/channels/0"_json_pointer].contains("__uuid"));
+    REQUIRE(loaded.document["/topics/~1adc/subscribe/payload/cbor~1json~1sync/schema"_json_pointer].contains("__uuid") == false);
+}
+
+TEST_CASE("Sync topic using a native sample type")
+{
+    json topic;
+    topic["subscribe"]["sampling"] = {{"type", "sync"}, {"sample-rate", 1000}};
+    topic["subscribe"]["payload"]["cbor/json/sync"]["schema"] = {{"type", "integer"}, {"sample-type", "int16"}};
+
+    Configuration c;
+    auto loaded = c.load(configuration({{"/adc", topic}}).dump());
+    REQUIRE(loaded.error == false);
+
+    auto adc = find(c.getSubscriptions(), "/adc");
+    REQUIRE(adc->getOxygenOutputChannelMap().channels.front()->getConfiguration().datatype == Datatype::Integer);
+
+    // Integer channels can not carry floating point samples
+    topic["subscribe"]["payload"]["cbor/json/sync"]["schema"]["sample-type"] = "float32";
+    Configuration invalid;
+    REQUIRE(invalid.load(configuration({{"/adc", topic}}).dump()).error);
+}
+
+TEST_CASE("Preview channels of a sync topic")
+{
+    json topic;
+    topic["subscribe"]["sampling"] = {{"type", "sync"}, {"sample-rate", 1000}, {"preview", {100, 10}}};
+    topic["subscribe"]["payload"]["cbor/json/sync"]["schema"] = {{"type", "integer"}, {"channels", {{{"name", "a"}}, {{"name", "b"}}}}};
+
+    Configuration c;
+    auto loaded = c.load(configuration({{"/adc", topic}}).dump());
+    REQUIRE(loaded.error == false);
+
+    // Every channel is followed by its previews: min, max and mean per rate
+    auto adc = find(c.getSubscriptions(), "/adc");
+    auto subscription = adc->getSubscription();
+    auto &channels = subscription->getChannels();
+    REQUIRE(channels.size() == 14);
+    REQUIRE(adc->getOxygenOutputChannelMap().group_channels["/adc"].channels.size() == 14);
+
+    const auto &a = channels[0]->getConfiguration();
+    const auto &preview = channels[6]->getConfiguration();
+    REQUIRE(preview.name == "a mean (10 Hz)");
+    REQUIRE(preview.uuid == a.uuid + "@preview/10/mean");
+    REQUIRE(preview.datatype == Datatype::Number);
+    REQUIRE(preview.sample_rate == 10);
+    REQUIRE(a.sample_rate == std::nullopt);
+    REQUIRE(channels[7]->getConfiguration().name == "b");
+
+    // The previews are computed while decoding the frames
+    subscription->prepareProcessing();
+    for (int p = 1; p <= 20; ++p)
+    {
+        json j;
+        j["timestamp"] = p * 100 / 1000.0;
+        j["data"] = {std::vector<int>(100, p), std::vector<int>(100, -p)};
+
+        const auto cbor = json::to_cbor(j);
+        subscription->interpretPayload(Timestamp(0, 1000000), Timestamp(p * 100000, 1000000), make_message("/adc", std::string(cbor.begin(), cbor.end())));
+    }
+
+    auto values = [&channels](std::size_t n)
+    {
+        std::vector<double> values;
+        for (auto &sample : channels[n]->getAndClearSamples())
+        {
+            auto v = sample.pop_values<double>();
+            values.insert(values.end(), v.begin(), v.end());
+        }
+        return values;
+    };
+
+    const auto max_a = values(2);
+    const auto min_b = values(8);
+    REQUIRE(max_a.size() == min_b.size());
+    REQUIRE(max_a.size() >= 18);
+    REQUIRE(max_a.back() == 20);
+    REQUIRE(min_b.back() == -20);
+
+    // Rates not dividing the sample rate are rejected
+    topic["subscribe"]["sampling"]["preview"] = {300};
+    Configuration invalid;
+    REQUIRE(invalid.load(configuration({{"/adc", topic}}).dump()).error);
+}
+
+TEST_CASE("Array channels of a JSON topic")
+{
+    json topic;
+    topic["subscribe"]["sampling"] = {{"type", "async"}};
+    topic["subscribe"]["payload"]["text/json"]["schema"] = {{"spectrum", {{"type", "array"}, {"dimension", 4}}}, {"peak", {{"type", "number"}}}};
+
+    Configuration c;
+    auto loaded = c.load(configuration({{"/fft", topic}}).dump());
+    REQUIRE(loaded.error == false);
+
+    auto fft = find(c.getSubscriptions(), "/fft");
+    auto subscription = fft->getSubscription();
+    const auto &group = fft->getOxygenOutputChannelMap().group_channels.at("/fft");
+    REQUIRE(group.channels.size() == 2);
+
+    auto spectrum = std::find_if(group.channels.begin(), group.channels.end(), [](auto &channel)
+                                 { return channel->getConfiguration().name == "spectrum"; });
+    REQUIRE(spectrum != group.channels.end());
+    REQUIRE((*spectrum)->getConfiguration().dimension == 4);
+    REQUIRE((*spectrum)->getConfiguration().datatype == Datatype::Number);
+
+    // A whole array is a single sample, payloads of a different dimension are dropped
+    subscription->prepareProcessing();
+    subscription->interpretPayload(Timestamp(0, 1000), Timestamp(10, 1000), make_message("/fft", R"({"spectrum": [1, 2.5, 3, 4], "peak": 4})"));
+    subscription->interpretPayload(Timestamp(0, 1000), Timestamp(20, 1000), make_message("/fft", R"({"spectrum": [1, 2], "peak": 2})"));
+
+    auto samples = (*spectrum)->getAndClearSamples();
+    REQUIRE(samples.size() == 1);
+    REQUIRE(samples.front().pop_back<std::vector<double>>() == std::vector<double>{1, 2.5, 3, 4});
+
+    // A dimension is required, vector channels can not be sampled synchronously
+    topic["subscribe"]["payload"]["text/json"]["schema"]["spectrum"].erase("dimension");
+    Configuration missing;
+    REQUIRE(missing.load(configuration({{"/fft", topic}}).dump()).error);
+
+    topic["subscribe"]["payload"]["text/json"]["schema"]["spectrum"]["dimension"] = 4;
+    topic["subscribe"]["sampling"] = {{"type", "sync"}, {"sample-rate", 10}};
+    Configuration sync;
+    REQUIRE(sync.load(configuration({{"/fft", topic}}).dump()).error);
+}
+
+TEST_CASE("Binary configuration cache")
+{
+    const auto path = (std::filesystem::temp_directory_path() / "mqtt_config.cache.cbor").string();
+
+    Configuration c;
+    auto loaded = c.load(largeConfiguration(100).dump());
+    REQUIRE(loaded.error == false);
+
+    const auto content = loaded.document.dump(4);
+    Configuration::writeBinaryCache(path, loaded.document, Configuration::hash(content));
+
+    // The cache is only valid for the content it has been created from
+    REQUIRE(Configuration::loadBinaryCache(path, Configuration::hash(content + " ")).error);
+    REQUIRE(Configuration::loadBinaryCache(path + ".missing", Configuration::hash(content)).error);
+
+    auto cached = Configuration::loadBinaryCache(path, Configuration::hash(content));
+    REQUIRE(cached.error == false);
+    REQUIRE(cached.document == loaded.document);
+
+    // Restoring from the cache keeps all UUIDs
+    Configuration restored;
+    auto r = restored.loadValidated(std::move(cached.document));
+    REQUIRE(r.error == false);
+    REQUIRE(r.document == loaded.document);
+    REQUIRE(restored.getSubscriptions().size() == 10);
+    REQUIRE(restored.getSubscriptions().front()->getSubscription()->getChannels().size() == 10);
+
+    // A damaged cache is ignored
+    Configuration::writeToFile(path, std::string("damaged"));
+    REQUIRE(Configuration::loadBinaryCache(path, Configuration::hash(content)).error);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Stream states persisted across acquisitions")
+{
+    const auto path = (std::filesystem::temp_directory_path() / "mqtt_config.cache.streams").string();
+
+    json topic;
+    topic["subscribe"]["sampling"] = {{"type", "sync"}, {"sample-rate", 1000}};
+    topic["subscribe"]["payload"]["cbor/json/sync"]["schema"] = {{"type", "number"}};
+
+    // Packets of a device sampling at 990 Hz instead of 1000 Hz
+    auto feed = [](Decoder &decoder, int num_packets)
+    {
+        for (int p = 1; p <= num_packets; ++p)
+        {
+            json j;
+            j["timestamp"] = p * 100 / 990.0;
+            j["data"] = std::vector<double>(100, 1.0);
+
+            const auto cbor = json::to_cbor(j);
+            decoder.getValue(Timestamp(0, 1000000), Timestamp(p * 100000, 1000000), std::string(cbor.begin(), cbor.end()));
+        }
+    };
+
+    Configuration c;
+    auto loaded = c.load(configuration({{"/adc", topic}}).dump());
+    REQUIRE(loaded.error == false);
+
+    auto subscription = find(c.getSubscriptions(), "/adc")->getSubscription();
+    auto channel = subscription->getChannels().front();
+    channel->getDecoder()->prepareProcessing();
+    feed(*channel->getDecoder(), 3);
+
+    StreamStates states;
+    states.update({subscription});
+    const auto &learned = states.getStates().at(channel->getConfiguration().uuid);
+    REQUIRE(1 / learned.sampling_interval == Catch::Approx(990).margin(1));
+    REQUIRE(learned.packet_size == 100);
+    states.save(path);
+
+    // The next acquisition of the same channel starts from the learned sample rate
+    Configuration restored;
+    REQUIRE(restored.loadValidated(loaded.document).error == false);
+    auto restored_subscription = find(restored.getSubscriptions(), "/adc")->getSubscription();
+    auto decoder = restored_subscription->getChannels().front()->getDecoder();
+
+    StreamStates::load(path).seed({restored_subscription});
+    decoder->prepareProcessing();
+    feed(*decoder, 1);
+    REQUIRE(decoder->getStreamStatistics()->estimated_sampling_rate == 990);
+
+    // Channels without new estimates keep their state
+    decoder->prepareProcessing();
+    StreamStates kept = StreamStates::load(path);
+    kept.update({restored_subscription});
+    REQUIRE(kept.getStates().size() == 1);
+
+    // A damaged file is ignored
+    Configuration::writeToFile(path, std::string("damaged"));
+    REQUIRE(StreamStates::load(path).getStates().empty());
+
+    // Entries of the wrong type are skipped
+    json streams = {{"wrong", {{"sampling-interval", "fast"}, {"packet-size", 100}}},
+                    {"negative", {{"sampling-interval", 0.001}, {"packet-size", -1}}},
+                    {"scalar", 1},
+                    {"valid", {{"sampling-interval", 0.001}, {"packet-size", 100}}}};
+    const auto cbor = json::to_cbor(json{{"streams", streams}});
+    Configuration::writeToFile(path, std::string(cbor.begin(), cbor.end()));
+    const auto partial = StreamStates::load(path).getStates();
+    REQUIRE(partial.size() == 1);
+    REQUIRE(partial.count("valid") == 1);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Configuration load at 10k and 50k channels", "[.][benchmark]")
+{
+    const auto path = (std::filesystem::temp_directory_path() / "mqtt_benchmark.cache.cbor").string();
+
+    for (std::size_t num_channels : {10000, 50000})
+    {
+        const auto content = largeConfiguration(num_channels).dump();
+
+        // The cache as written after the first load, including the generated UUIDs
+        Configuration first;
+        const auto cache = first.load(content).document.dump(4);
+        Configuration::writeBinaryCache(path, json::parse(cache), Configuration::hash(cache));
+
+        BENCHMARK("Load " + std::to_string(num_channels) + " channels")
+        {
+            Configuration c;
+            return c.load(content).error;
+        };
+
+        BENCHMARK("Restore " + std::to_string(num_channels) + " channels from the cache")
+        {
+            Configuration c;
+            return c.load(cache).error;
+        };
+
+        BENCHMARK("Restore " + std::to_string(num_channels) + " channels from the binary cache")
+        {
+            Configuration c;
+            auto cached = Configuration::loadBinaryCache(path, Configuration::hash(cache));
+            return c.loadValidated(std::move(cached.document)).error;
+        };
+    }
+
+    std::filesystem::remove(path);
+}
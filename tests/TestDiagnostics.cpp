@@ -0,0 +1,282 @@
+#include <filesystem>
+#include <map>
+#include <set>
+#include <fstream>
+#include <string>
+#include <thread>
+
+//
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+//
+#include "HeadlessHost.h"
+#include "diagnostics/DiagnosticChannels.h"
+#include "diagnostics/Trace.h"
+#include "diagnostics/StatisticsReport.h"
+
+//
+#include "nlohmann/json.hpp"
+
+using namespace plugin::mqtt;
+using namespace plugin::mqtt::diagnostics;
+using namespace plugin::mqtt::test;
+using nlohmann::json;
+
+TEST_CASE("Latency histogram")
+{
+    LatencyHistogram histogram;
+    REQUIRE(LatencyHistogram::percentile(histogram.getBuckets(), 0.5) == 0.0);
+
+    // 90 durations of 3 us and 10 durations of 1 ms
+    for (int n = 0; n < 90; ++n)
+    {
+        histogram.record(3e-6);
+    }
+    for (int n = 0; n < 10; ++n)
+    {
+        histogram.record(1e-3);
+    }
+
+    const auto buckets = histogram.getBuckets();
+    REQUIRE(buckets[2] == 90);
+    REQUIRE(buckets[10] == 10);
+
+    // Percentiles are reported as the upper bound of their bucket
+    REQUIRE(LatencyHistogram::percentile(buckets, 0.5) == Catch::Approx(4e-6));
+    REQUIRE(LatencyHistogram::percentile(buckets, 0.9) == Catch::Approx(4e-6));
+    REQUIRE(LatencyHistogram::percentile(buckets, 0.99) == Catch::Approx(1024e-6));
+
+    // Durations beyond the last bucket are clamped
+    histogram.record(1e6);
+    REQUIRE(histogram.getBuckets()[LatencyHistogram::NUM_BUCKETS - 1] == 1);
+}
+
+TEST_CASE("Diagnostic channels report the ingest metrics of a subscription")
+{
+    HeadlessHost host;
+    auto subscription = createSubscription("/diagnostics/in");
+    host.service().addSubscription(subscription);
+    host.start();
+
+    DiagnosticChannels::Channels channels;
+    channels.messages_per_second = 10;
+    channels.bytes_per_second = 11;
+    channels.decode_failures_per_second = 12;
+    channels.decode_time = 13;
+    channels.nan_filled = 14;
+
+    DiagnosticChannels diagnostics(1.0);
+    diagnostics.add(subscription, channels);
+
+    // The first call begins the interval
+    diagnostics.process(host.sink(), host.now());
+    REQUIRE(host.sink().channel(10).values.empty());
+
+    for (int cycle = 0; cycle < 10; ++cycle)
+    {
+        // 20 valid and 5 invalid payloads per cycle
+        host.transport().inject(25, 0, [](std::size_t n)
+                                { return make_message("/diagnostics/in", n < 20 ? "42" : "invalid"); });
+        host.cycle(0.1);
+        diagnostics.process(host.sink(), host.now());
+    }
+
+    auto &messages = host.sink().channel(10);
+    REQUIRE(messages.values.size() == 1);
+    REQUIRE(messages.values.front() == Catch::Approx(250.0));
+    REQUIRE(messages.ticks.front() == host.now().ticks);
+
+    REQUIRE(host.sink().channel(11).values.front() == Catch::Approx(750.0));
+    REQUIRE(host.sink().channel(12).values.front() == Catch::Approx(50.0));
+    REQUIRE(host.sink().channel(13).values.front() > 0.0);
+
+    // Async subscriptions do not resample a stream
+    REQUIRE(host.sink().channel(14).values.empty());
+
+    // Only valid payloads are written to the output channel
+    REQUIRE(host.sink().channel(1).values.size() == 200);
+
+    auto snapshot = subscription->getMetrics().getSnapshot();
+    REQUIRE(snapshot.messages == 250);
+    REQUIRE(snapshot.decode_failures == 50);
+    REQUIRE(snapshot.stream.has_value() == false);
+
+    host.stop();
+}
+
+TEST_CASE("Trace events are kept in per-thread ring buffers")
+{
+    Trace::enable(true, 16);
+    Trace::clear();
+
+    // Threads tracing for the first time get a buffer of the configured capacity, older events are overwritten
+    std::thread worker([]
+                       {
+                           for (int n = 0; n < 100; ++n)
+                           {
+                               Trace::instant("worker", Trace::now(), n);
+                           } });
+    worker.join();
+
+    Trace::enable(false);
+    Trace::instant("disabled", Trace::now());
+
+    auto events = Trace::collect();
+    REQUIRE(events.size() == 16);
+    REQUIRE(events.front().id == 84);
+    REQUIRE(events.back().id == 99);
+
+    // The buffer of a finished thread is released once its events have been collected
+    REQUIRE(Trace::collect().empty());
+
+    Trace::clear();
+    REQUIRE(Trace::collect().empty());
+}
+
+TEST_CASE("Tracing is shared by all instances")
+{
+    const auto path = (std::filesystem::temp_directory_path() / "mqtt_trace_shared.json").string();
+    std::filesystem::remove(path);
+
+    config::Servers servers;
+    config::from_json(json{{"servers", {{{"url", "loopback"}, {"trace", path}}}}}, servers);
+
+    HeadlessHost first;
+    first.service().setServerConfiguration(servers.front());
+    first.service().addSubscription(createSubscription("/trace/first"));
+    first.start();
+
+    HeadlessHost second;
+    second.service().setServerConfiguration(servers.front());
+    second.service().addSubscription(createSubscription("/trace/second"));
+    second.start();
+
+    // Stopping one instance neither disables tracing for the other nor writes the trace
+    first.stop();
+    REQUIRE(Trace::isEnabled());
+    REQUIRE(std::filesystem::exists(path) == false);
+
+    second.transport().inject(3, 0, [](std::size_t n)
+                              { return make_message("/trace/second", std::to_string(n)); });
+    second.cycle(0.1);
+
+    // A repeated stop does not release the reference of another instance
+    first.stop();
+    REQUIRE(Trace::isEnabled());
+
+    second.stop();
+    REQUIRE(Trace::isEnabled() == false);
+
+    std::ifstream file(path);
+    auto trace = json::parse(file);
+    file.close();
+
+    std::size_t arrived = 0;
+    for (const auto &event : trace["traceEvents"])
+    {
+        if (event["name"] == "message_arrived")
+            arrived++;
+    }
+    REQUIRE(arrived == 3);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Messages are traced from arrival to the hand-off to Oxygen")
+{
+    const auto path = (std::filesystem::temp_directory_path() / "mqtt_trace.json").string();
+    config::Servers servers;
+    config::from_json(json{{"servers", {{{"url", "loopback"}, {"trace", path}}}}}, servers);
+
+    HeadlessHost host;
+    host.service().setServerConfiguration(servers.front());
+    host.service().addSubscription(createSubscription("/trace/in"));
+    host.start();
+    REQUIRE(Trace::isEnabled());
+
+    host.transport().inject(5, 0, [](std::size_t n)
+                            { return make_message("/trace/in", std::to_string(n)); });
+    host.cycle(0.1);
+
+    // The trace is written once processing stops
+    host.stop();
+    REQUIRE(Trace::isEnabled() == false);
+
+    std::ifstream file(path);
+    auto trace = json::parse(file);
+    file.close();
+
+    std::map<std::string, std::size_t> count;
+    std::set<std::uint64_t> flows_begun;
+    std::set<std::uint64_t> flows_ended;
+    for (const auto &event : trace["traceEvents"])
+    {
+        const auto name = event["name"].get<std::string>();
+        count[name]++;
+
+        if (name == "message" && event["ph"] == "s")
+            flows_begun.insert(event["id"].get<std::uint64_t>());
+        if (name == "message" && event["ph"] == "f")
+            flows_ended.insert(event["id"].get<std::uint64_t>());
+    }
+
+    REQUIRE(count["message_arrived"] == 5);
+    REQUIRE(count["decode"] == 5);
+    REQUIRE(count["addSample"] == 1);
+    REQUIRE(flows_begun.size() == 5);
+    REQUIRE(flows_begun == flows_ended);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Statistics report")
+{
+    HeadlessHost host;
+    host.service().addSubscription(createSubscription("/statistics/in"));
+    host.service().addPublishHandler(createPublisher("/statistics/out", 42));
+    host.source().addAsyncChannel(42, 100, [](std::uint64_t idx) -> value_t
+                                  { return static_cast<int>(idx); });
+    host.start();
+
+    auto report = std::make_shared<StatisticsReport>("instance", host.service());
+    StatisticsReport::add(report);
+
+    auto snapshot = report->getSnapshot();
+    REQUIRE(snapshot["name"] == "instance");
+    REQUIRE(snapshot["subscriptions"].size() == 1);
+    REQUIRE(snapshot["subscriptions"][0]["messages"] == 0);
+
+    // Rates are unknown until the second snapshot
+    REQUIRE(snapshot["subscriptions"][0]["messages_per_second"].is_null());
+
+    host.transport().inject(20, 0, [](std::size_t n)
+                            { return make_message("/statistics/in", n < 18 ? "1" : "invalid"); });
+    host.cycle(1.0);
+
+    auto all = StatisticsReport::getAllSnapshots();
+    REQUIRE(all.size() == 1);
+
+    const auto &subscription = all[0]["subscriptions"][0];
+    REQUIRE(subscription["topic"] == "/statistics/in");
+    REQUIRE(subscription["active"] == true);
+    REQUIRE(subscription["messages"] == 20);
+    REQUIRE(subscription["decode_failures"] == 2);
+    REQUIRE(subscription["messages_per_second"].get<double>() > 0.0);
+    REQUIRE(subscription["decode_time_ms"]["p99"].get<double>() > 0.0);
+    REQUIRE(subscription.contains("stream") == false);
+
+    const auto &publisher = all[0]["publish"][0];
+    REQUIRE(publisher["topic"] == "/statistics/out");
+    REQUIRE(publisher["payloads"] == 100);
+    REQUIRE(publisher["acknowledged"] == 100);
+    REQUIRE(publisher["queued"] == 0);
+    REQUIRE(publisher["failed"] == 0);
+
+    REQUIRE(all[0]["flow_control"]["acknowledged"] == 100);
+
+    StatisticsReport::remove(report);
+    REQUIRE(StatisticsReport::getAllSnapshots().empty());
+
+    host.stop();
+}
@@ -0,0 +1,113 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+//
+#include "publish/FlowControl.h"
+
+using namespace plugin::mqtt;
+
+namespace
+{
+    /**
+     * @brief Send payloads until the congestion window is exhausted
+     * @return The number of payloads sent
+     */
+    std::size_t fill(FlowControl &flow_control, int qos, std::uint64_t &generation)
+    {
+        std::size_t sent = 0;
+        while (flow_control.isOpen())
+        {
+            generation = flow_control.sent(qos);
+            sent++;
+        }
+        return sent;
+    }
+}
+
+TEST_CASE("Flow control limits the payloads in flight")
+{
+    FlowControl flow_control(100, 0.1);
+    std::uint64_t generation = 0;
+
+    SECTION("Initial window")
+    {
+        REQUIRE(fill(flow_control, 2, generation) == 10);
+        REQUIRE(flow_control.getStatistics().in_flight[2] == 10);
+        REQUIRE(flow_control.getStatistics().round_trip_time < 0);
+    }
+    SECTION("Additive increase while acknowledged in time")
+    {
+        for (int round = 0; round < 20; ++round)
+        {
+            auto sent = fill(flow_control, 1, generation);
+            for (std::size_t n = 0; n < sent; ++n)
+            {
+                flow_control.acknowledged(generation, 1, 0.01);
+            }
+        }
+
+        auto statistics = flow_control.getStatistics();
+        REQUIRE(statistics.window == Catch::Approx(30.0).margin(1.0));
+        REQUIRE(statistics.round_trip_time == Catch::Approx(0.01));
+        REQUIRE(statistics.in_flight[1] == 0);
+    }
+    SECTION("Window never exceeds its maximum")
+    {
+        flow_control.setMaxWindow(4);
+        REQUIRE(fill(flow_control, 0, generation) == 4);
+
+        for (int n = 0; n < 100; ++n)
+        {
+            flow_control.acknowledged(generation, 0, 0.01);
+            flow_control.sent(0);
+        }
+        REQUIRE(flow_control.getStatistics().window == Catch::Approx(4.0));
+    }
+    SECTION("Multiplicative decrease once per window on rising latency")
+    {
+        fill(flow_control, 2, generation);
+        flow_control.acknowledged(generation, 2, 0.01);
+        flow_control.acknowledged(generation, 2, 0.5);
+        REQUIRE(flow_control.getStatistics().window == Catch::Approx(5.05).margin(0.01));
+
+        // Payloads already in flight do not reduce the window again
+        for (int n = 0; n < 8; ++n)
+        {
+            flow_control.acknowledged(generation, 2, 0.5);
+        }
+        REQUIRE(flow_control.getStatistics().window == Catch::Approx(5.05).margin(0.01));
+        REQUIRE(flow_control.getStatistics().in_flight[2] == 0);
+
+        flow_control.sent(2);
+        flow_control.acknowledged(generation, 2, 0.5);
+        REQUIRE(flow_control.getStatistics().window == Catch::Approx(2.525).margin(0.01));
+    }
+    SECTION("Failed deliveries reduce the window")
+    {
+        fill(flow_control, 1, generation);
+        flow_control.failed(generation, 1);
+
+        auto statistics = flow_control.getStatistics();
+        REQUIRE(statistics.window == Catch::Approx(5.0));
+        REQUIRE(statistics.failed == 1);
+        REQUIRE(statistics.in_flight[1] == 9);
+        REQUIRE(flow_control.isOpen() == false);
+    }
+    SECTION("Deliveries sent before a reset are ignored")
+    {
+        fill(flow_control, 2, generation);
+        auto previous = generation;
+        flow_control.reset();
+
+        REQUIRE(fill(flow_control, 2, generation) == 10);
+        for (int n = 0; n < 10; ++n)
+        {
+            flow_control.failed(previous, 2);
+        }
+
+        auto statistics = flow_control.getStatistics();
+        REQUIRE(statistics.in_flight[2] == 10);
+        REQUIRE(statistics.window == Catch::Approx(10.0));
+        REQUIRE(statistics.failed == 10);
+    }
+}
@@ -0,0 +1,200 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+//
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+//
+#include "HeadlessHost.h"
+#include "subscription/decoding/TextJsonDecoder.h"
+
+//
+#include "fmt/core.h"
+#include "nlohmann/json.hpp"
+
+using namespace plugin::mqtt;
+using namespace plugin::mqtt::test;
+using nlohmann::json;
+
+namespace
+{
+    Subscription::Pointer createVectorSubscription(const std::string &topic, std::uint32_t local_channel_id, std::size_t dimension)
+    {
+        Subscription::Sampling sampling;
+        sampling.mode = SamplingModes::Async;
+        sampling.timeout = 0;
+
+        Channel::Configuration config;
+        config.name = topic;
+        config.uuid = topic;
+        config.datatype = Datatype::Number;
+        config.dimension = dimension;
+        config.decoder = std::make_shared<TextJsonDecoder>(json::json_pointer("/spectrum"), dimension);
+        config.local_channel_id = local_channel_id;
+
+        auto subscription = std::make_shared<Subscription>(sampling, topic, 0);
+        subscription->addChannel(std::make_shared<Channel>(config));
+        return subscription;
+    }
+
+    value_t ramp(std::uint64_t idx)
+    {
+        return static_cast<double>(idx);
+    }
+}
+
+TEST_CASE("Headless host drives the processing pipeline")
+{
+    HeadlessHost host;
+
+    SECTION("Subscribed samples are written to the output channels")
+    {
+        host.service().addSubscription(createSubscription("/headless/in", Datatype::Number, 7));
+        host.start();
+
+        host.transport().inject(10, 0, [](std::size_t n)
+                                { return make_message("/headless/in", std::to_string(n)); });
+        host.cycle(0.1);
+
+        auto &channel = host.sink().channel(7);
+        REQUIRE(channel.values.size() == 10);
+        REQUIRE(channel.values.back() == Catch::Approx(9.0));
+
+        // Samples are stamped with the host time of their arrival
+        REQUIRE(channel.ticks.back() == 0);
+
+        // Async channels without new samples are kept alive
+        host.cycle(0.1);
+        REQUIRE(channel.values.size() == 11);
+        REQUIRE(channel.ticks.back() == 200000);
+    }
+    SECTION("Arrays are written to vector channels as single samples")
+    {
+        host.service().addSubscription(createVectorSubscription("/headless/spectrum", 8, 4));
+        host.start();
+
+        host.transport().inject(3, 0, [](std::size_t n)
+                                { return make_message("/headless/spectrum", fmt::format(R"({{"spectrum": [{}, 1, 2, 3]}})", n)); });
+        host.cycle(0.1);
+
+        // One call per array, carrying all of its elements
+        auto &channel = host.sink().channel(8);
+        REQUIRE(channel.calls == 3);
+        REQUIRE(channel.values.size() == 12);
+        REQUIRE(channel.values[8] == Catch::Approx(2.0));
+        REQUIRE(host.sink().samples() == 3);
+
+        // Kept alive with an array of the dimension of the channel
+        host.cycle(0.1);
+        REQUIRE(channel.calls == 4);
+        REQUIRE(channel.values.size() == 16);
+    }
+    SECTION("Input channels are published in packets")
+    {
+        host.source().addSyncChannel(42, 1000, ramp);
+        host.service().addPublishHandler(createPublisher("/headless/out", 42, SamplingModes::Sync, Datatype::Number, 100));
+        host.start();
+
+        for (int n = 0; n < 10; ++n)
+        {
+            host.cycle(0.1);
+        }
+
+        auto published = host.transport().takePublished();
+        REQUIRE(published.size() == 10);
+
+        auto j = json::parse(published.back()->get_payload_str());
+        REQUIRE(j["idx"] == 9);
+        REQUIRE(j["data"].size() == 100);
+        REQUIRE(j["data"][0].get<double>() == Catch::Approx(900.0));
+    }
+    SECTION("Async input channels are published sample by sample")
+    {
+        host.source().addAsyncChannel(42, 10, [](std::uint64_t idx) -> value_t
+                                      { return static_cast<int>(idx); });
+        host.service().addPublishHandler(createPublisher("/headless/async", 42));
+        host.start();
+
+        host.cycle(1.0);
+
+        auto published = host.transport().takePublished();
+        REQUIRE(published.size() == 10);
+
+        auto j = json::parse(published.back()->get_payload_str());
+        REQUIRE(j["value"] == 9);
+        REQUIRE(j["timestamp"].get<double>() == Catch::Approx(0.9));
+    }
+
+    host.stop();
+}
+
+TEST_CASE("Bundled channels not providing the same samples are not published")
+{
+    HeadlessHost host;
+    host.source().addSyncChannel(1, 1000, ramp);
+    host.source().addUnsupportedSyncChannel(2, 1000);
+
+    Publish::Sampling sampling;
+    sampling.mode = SamplingModes::Sync;
+    sampling.downsampling_factor = 1;
+
+    Publish::Payload payload;
+    payload.datatype = Datatype::Number;
+    payload.packet_size = 10;
+    payload.channels = {"a", "b"};
+
+    auto publish = std::make_shared<Publish>("/headless/bundle", "uuid", sampling, payload, 0);
+    publish->getInputChannels()[0].channel->setValue(1);
+    publish->getInputChannels()[1].channel->setValue(2);
+    host.service().addPublishHandler(publish);
+    host.start();
+
+    // The processing continues, the bundle is skipped
+    REQUIRE_NOTHROW(host.cycle(0.1));
+    REQUIRE(publish->hasPayload() == false);
+    REQUIRE(host.transport().takePublished().empty());
+
+    host.stop();
+}
+
+TEST_CASE("Headless host at production rates", "[.][benchmark]")
+{
+    constexpr int NUM_PUBLISH = 20;
+    constexpr int NUM_SUBSCRIBE = 50;
+    constexpr double SAMPLE_RATE = 20000;
+    constexpr double WINDOW = 0.01;
+
+    HeadlessHost host;
+
+    for (int n = 0; n < NUM_PUBLISH; ++n)
+    {
+        host.source().addSyncChannel(1000 + n, SAMPLE_RATE, ramp);
+        host.service().addPublishHandler(createPublisher(fmt::format("/headless/out/{}", n), 1000 + n, SamplingModes::Sync, Datatype::Number, 1000));
+    }
+
+    for (int n = 0; n < NUM_SUBSCRIBE; ++n)
+    {
+        host.service().addSubscription(createSubscription(fmt::format("/headless/in/{}", n), Datatype::Number, n));
+    }
+    host.start();
+
+    for (int cycle = 0; cycle < 1000; ++cycle)
+    {
+        // 10 messages per topic and cycle, i.e. 1 kHz per subscribed topic
+        host.transport().inject(NUM_SUBSCRIBE * 10, 0, [](std::size_t n)
+                                { return make_message(fmt::format("/headless/in/{}", n % NUM_SUBSCRIBE), "1.25"); });
+        host.cycle(WINDOW);
+        host.transport().takePublished();
+    }
+
+    host.stop();
+
+    const auto report = host.report();
+    std::cout << fmt::format("Processed {} cycles: {:.0f} samples/s, cycle latency {:.1f} us (mean), {:.1f} us (max)\n",
+                             report.cycles, report.samples_per_second, report.mean_cycle_latency * 1e6, report.max_cycle_latency * 1e6);
+
+    REQUIRE(report.cycles == 1000);
+    REQUIRE(report.mean_cycle_latency < WINDOW);
+}
@@ -0,0 +1,178 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+//
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+//
+#include "resampling/Interpolation.h"
+#include "resampling/Stream.h"
+
+using namespace plugin::mqtt;
+using namespace plugin::mqtt::interpolation;
+
+namespace
+{
+    template <typename T>
+    bool identical(const std::vector<T> &a, const std::vector<T> &b)
+    {
+        // Compares the bits, NaN samples are equal if both kernels produce them
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+    }
+
+    template <typename T>
+    std::vector<T> randomSamples(std::mt19937 &rng, std::size_t size)
+    {
+        std::uniform_real_distribution<double> value(-30000, 30000);
+        std::vector<T> samples;
+        for (std::size_t n = 0; n < size; ++n)
+        {
+            samples.push_back(static_cast<T>(value(rng)));
+        }
+        return samples;
+    }
+
+    template <typename T>
+    void requireIdenticalInterpolation(std::mt19937 &rng, const Positions &positions, std::size_t size)
+    {
+        const auto input = randomSamples<T>(rng, size);
+
+        // The batched kernel appends to the samples already written
+        std::vector<T> reference(3, 1);
+        std::vector<T> batched(3, 1);
+        interp(Kernel::Reference, reference, positions, input);
+        interp(Kernel::Batched, batched, positions, input);
+
+        REQUIRE(reference.size() == positions.size() + 3);
+        REQUIRE(identical(reference, batched));
+    }
+}
+
+TEST_CASE("Batched interpolation is bit-identical to the reference kernel")
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> drift(0.95, 1.05);
+    std::uniform_real_distribution<double> offset(-2, 2);
+
+    for (const int sample_rate : {1000, 20000, 100000})
+    {
+        for (const std::uint64_t x_start : {std::uint64_t(0), std::uint64_t(123457), std::uint64_t(60480000001)})
+        {
+            for (int round = 0; round < 50; ++round)
+            {
+                // Two packets of input samples around the output samples, drifting and offset by a few samples
+                const std::size_t input_size = 2 * (1 + rng() % 1000);
+                const double interval = drift(rng) / sample_rate;
+                const double start = (x_start + offset(rng)) / sample_rate;
+                const InputVectorLabels fp_time(start, start + input_size * interval, input_size);
+                const std::size_t num = input_size + rng() % 8;
+
+                Positions reference;
+                Positions batched;
+                const auto num_reference = positions(Kernel::Reference, reference, x_start, sample_rate, num, fp_time, input_size);
+                const auto num_batched = positions(Kernel::Batched, batched, x_start, sample_rate, num, fp_time, input_size);
+
+                REQUIRE(num_reference == num_batched);
+                REQUIRE(reference.size() == num_reference);
+                REQUIRE(identical(reference.idx, batched.idx));
+                REQUIRE(identical(reference.t, batched.t));
+
+                requireIdenticalInterpolation<std::int16_t>(rng, reference, input_size);
+                requireIdenticalInterpolation<std::int32_t>(rng, reference, input_size);
+                requireIdenticalInterpolation<float>(rng, reference, input_size);
+                requireIdenticalInterpolation<double>(rng, reference, input_size);
+            }
+        }
+    }
+}
+
+TEST_CASE("Streams resampled by both kernels are bit-identical")
+{
+    const int nominal_sample_rate = 20000;
+    const std::size_t packet_size = 1000;
+
+    Stream reference(std::make_shared<StreamClock>(), nominal_sample_rate, {true, GapFill::Linear}, 2);
+    Stream batched(std::make_shared<StreamClock>(), nominal_sample_rate, {true, GapFill::Linear}, 2);
+    reference.setKernel(Kernel::Reference);
+    batched.setKernel(Kernel::Batched);
+
+    // A publisher sampling slightly too fast, with jittering timestamps and a lost packet
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> jitter(-2e-6, 2e-6);
+    const double interval = 1 / (nominal_sample_rate * 1.003);
+    for (std::uint64_t p = 1; p <= 200; ++p)
+    {
+        Stream::Channels channels(2);
+        for (std::size_t n = 0; n < packet_size; ++n)
+        {
+            const double t = ((p - 1) * packet_size + n) * interval;
+            channels[0].push_back(std::sin(2 * 3.141592653589793 * 50 * t));
+            channels[1].push_back(t);
+        }
+
+        if (p == 120)
+        {
+            continue;
+        }
+
+        const double timestamp = 1.5 + (p * packet_size - 1) * interval + jitter(rng);
+        const auto ticks = static_cast<std::uint64_t>(timestamp * 1000);
+        reference.appendChannels(channels, timestamp, ticks, 1000);
+        batched.appendChannels(channels, timestamp, ticks, 1000);
+    }
+
+    for (std::size_t c = 0; c < 2; ++c)
+    {
+        const auto expected = reference.getAndClearSamples(c);
+        REQUIRE(expected.size() > 190 * packet_size);
+        REQUIRE(identical(expected, batched.getAndClearSamples(c)));
+    }
+}
+
+TEST_CASE("Resampling kernel throughput", "[.][benchmark]")
+{
+    // Two packets of 10000 samples at 100 kHz, resampled once per packet
+    const std::size_t input_size = 20000;
+    const int sample_rate = 100000;
+    const std::uint64_t x_start = 8640000000;
+    const double start = (x_start - 0.3) / sample_rate;
+    const InputVectorLabels fp_time(start, start + input_size * 1.0001 / sample_rate, input_size);
+
+    std::mt19937 rng(1);
+    const auto doubles = randomSamples<double>(rng, input_size);
+    const auto floats = randomSamples<float>(rng, input_size);
+
+    for (const auto kernel : {Kernel::Reference, Kernel::Batched})
+    {
+        const auto name = kernel == Kernel::Reference ? std::string("reference") : std::string("batched");
+        Positions p;
+        std::vector<double> output_doubles;
+        std::vector<float> output_floats;
+        output_doubles.reserve(input_size);
+        output_floats.reserve(input_size);
+
+        BENCHMARK("positions, " + name)
+        {
+            return positions(kernel, p, x_start, sample_rate, input_size, fp_time, input_size);
+        };
+
+        positions(kernel, p, x_start, sample_rate, input_size, fp_time, input_size);
+        BENCHMARK("interpolate double, " + name)
+        {
+            output_doubles.clear();
+            interp(kernel, output_doubles, p, doubles);
+            return output_doubles.size();
+        };
+        BENCHMARK("interpolate float, " + name)
+        {
+            output_floats.clear();
+            interp(kernel, output_floats, p, floats);
+            return output_floats.size();
+        };
+    }
+}
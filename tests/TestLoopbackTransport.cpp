@@ -0,0 +1,189 @@
+#include <memory>
+#include <string>
+
+//
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+//
+#include "Service.h"
+#include "transport/LoopbackTransport.h"
+#include "subscription/decoding/TextPlainDecoder.h"
+
+using namespace plugin::mqtt;
+
+namespace
+{
+    Subscription::Pointer createSubscription(const std::string &topic, Datatype datatype)
+    {
+        Subscription::Sampling sampling;
+        sampling.mode = SamplingModes::Async;
+        sampling.timeout = 0;
+
+        Channel::Configuration config;
+        config.name = topic;
+        config.uuid = topic;
+        config.datatype = datatype;
+        config.decoder = std::make_shared<TextPlainDecoder>(datatype);
+
+        auto subscription = std::make_shared<Subscription>(sampling, topic, 0);
+        subscription->addChannel(std::make_shared<Channel>(config));
+        return subscription;
+    }
+
+    Publish::Pointer createPublisher(const std::string &topic)
+    {
+        Publish::Sampling sampling;
+        sampling.mode = SamplingModes::Async;
+        sampling.downsampling_factor = 1;
+
+        return std::make_shared<Publish>(topic, "uuid", sampling, Datatype::Number, 1, 1);
+    }
+
+    std::size_t countSamples(Subscription::Pointer subscription)
+    {
+        return subscription->getChannels().front()->getAndClearSamples().size();
+    }
+}
+
+TEST_CASE("Service using the loopback transport")
+{
+    auto transport = std::make_shared<LoopbackTransport>();
+    auto subscription = createSubscription("/loopback/in", Datatype::Integer);
+
+    Service service;
+    service.setTimeSource([]
+                          { return Timestamp(0, 1000000); });
+    service.addSubscription(subscription);
+    service.setTransport(transport);
+    service.connect();
+    REQUIRE(transport->isConnected());
+
+    SECTION("Topics are subscribed while processing only")
+    {
+        REQUIRE(transport->getSubscriptions().empty());
+
+        service.prepareProcessing();
+        REQUIRE(transport->getSubscriptions().count("/loopback/in") == 1);
+
+        service.stopProcessing();
+        REQUIRE(transport->getSubscriptions().empty());
+    }
+    SECTION("Injected messages are decoded")
+    {
+        service.prepareProcessing();
+
+        auto injection = transport->inject(1000, 0, [](std::size_t n)
+                                           { return make_message("/loopback/in", std::to_string(n)); });
+        REQUIRE(injection.injected == 1000);
+        REQUIRE(injection.delivered == 1000);
+        REQUIRE(countSamples(subscription) == 1000);
+
+        // Unknown topics are not delivered
+        REQUIRE(transport->inject(make_message("/loopback/unknown", "1")) == false);
+    }
+    SECTION("Messages are injected at a given rate")
+    {
+        service.prepareProcessing();
+
+        auto injection = transport->inject(100, 2000, [](std::size_t n)
+                                           { return make_message("/loopback/in", std::to_string(n)); });
+        REQUIRE(injection.delivered == 100);
+        REQUIRE(injection.duration >= 99 / 2000.0);
+        REQUIRE(countSamples(subscription) == 100);
+    }
+    SECTION("Published payloads are looped back to subscribed topics")
+    {
+        auto echo = createSubscription("/loopback/out", Datatype::String);
+        auto publisher = createPublisher("/loopback/out");
+        service.addSubscription(echo);
+        service.addPublishHandler(publisher);
+        service.prepareProcessing();
+
+        publisher->addAsyncSample(1.0, 1.5);
+        publisher->addAsyncSample(2.0, 2.5);
+        service.publish();
+
+        auto published = transport->takePublished();
+        REQUIRE(published.size() == 2);
+        REQUIRE(published.front()->get_topic() == "/loopback/out");
+
+        REQUIRE(transport->deliverPending() == 2);
+        REQUIRE(countSamples(echo) == 2);
+        REQUIRE(service.getFlowStatistics().acknowledged == 2);
+    }
+    SECTION("Payloads stay buffered while the connection is lost")
+    {
+        auto publisher = createPublisher("/loopback/out");
+        service.addPublishHandler(publisher);
+        service.prepareProcessing();
+
+        transport->loseConnection("test");
+        publisher->addAsyncSample(1.0, 1.5);
+        service.publish();
+        REQUIRE(publisher->hasPayload());
+
+        // Topics are subscribed again once reconnected
+        service.connect();
+        REQUIRE(transport->getSubscriptions().count("/loopback/in") == 1);
+
+        service.publish();
+        REQUIRE(publisher->hasPayload() == false);
+        REQUIRE(transport->takePublished().size() == 1);
+    }
+    SECTION("The oldest payloads are dropped while the connection is lost")
+    {
+        Publish::Sampling sampling{SamplingModes::Async, 1};
+        Publish::Payload payload;
+        payload.datatype = Datatype::Number;
+        payload.packet_size = 1;
+        payload.max_queued = 3;
+        auto publisher = std::make_shared<Publish>("/loopback/out", "uuid", sampling, payload, 1);
+        service.addPublishHandler(publisher);
+        service.prepareProcessing();
+
+        transport->loseConnection("test");
+        for (int n = 0; n < 5; ++n)
+        {
+            publisher->addAsyncSample(n, n + 0.5);
+        }
+        service.publish();
+
+        auto metrics = publisher->getMetrics().getSnapshot();
+        REQUIRE(metrics.queued == 3);
+        REQUIRE(metrics.dropped == 2);
+
+        // The most recent payloads are published once reconnected
+        service.connect();
+        service.publish();
+        auto published = transport->takePublished();
+        REQUIRE(published.size() == 3);
+        REQUIRE(published.front()->get_payload_str().find("2.5") != std::string::npos);
+    }
+
+    service.disconnect();
+}
+
+TEST_CASE("Ingest throughput using the loopback transport", "[.][benchmark]")
+{
+    auto transport = std::make_shared<LoopbackTransport>();
+    auto subscription = createSubscription("/loopback/in", Datatype::Number);
+
+    Service service;
+    service.setTimeSource([]
+                          { return Timestamp(0, 1000000); });
+    service.addSubscription(subscription);
+    service.setTransport(transport);
+    service.connect();
+    service.prepareProcessing();
+
+    BENCHMARK("Inject and decode 10000 plain-text messages")
+    {
+        auto injection = transport->inject(10000, 0, [](std::size_t n)
+                                           { return make_message("/loopback/in", "1.25"); });
+        return countSamples(subscription) + injection.delivered;
+    };
+
+    service.disconnect();
+}
@@ -18,8 +18,8 @@ TEST_CASE("Publish an Oxygen sync-channel with downsampling enabled")
         sampling.mode = SamplingModes::Sync;
 
         Publish publish("A Topic", "uuid", sampling, Datatype::Integer, 5, 0);
-        publish.addSyncSamples({0, 1, 2, 3, 4, 5, 6}, 100);
-        publish.addSyncSamples({7, 8, 9, 10}, 100);
+        publish.addSyncSamples({0, 1, 2, 3, 4, 5, 6}, 100, 0.0);
+        publish.addSyncSamples({7, 8, 9, 10}, 100, 0.07);
         REQUIRE(publish.hasPayload());
 
         auto payload = publish.pop();
@@ -34,8 +34,8 @@ TEST_CASE("Publish an Oxygen sync-channel with downsampling enabled")
         sampling.mode = SamplingModes::Sync;
 
         Publish publish("A Topic", "uuid", sampling, Datatype::Integer, 2, 0);
-        publish.addSyncSamples({0, 1, 2, 3, 4, 5, 6, 7, 8}, 100);
-        publish.addSyncSamples({9, 10, 11, 12, 13, 14, 15, 16, 17}, 100);
+        publish.addSyncSamples({0, 1, 2, 3, 4, 5, 6, 7, 8}, 100, 0.0);
+        publish.addSyncSamples({9, 10, 11, 12, 13, 14, 15, 16, 17}, 100, 0.09);
         REQUIRE(publish.hasPayload());
         payload = publish.pop();
         REQUIRE(payload == "{\"data\":[0,5],\"idx\":0,\"sample-rate\":20.0,\"sampling\":\"sync\"}");
@@ -46,3 +46,108 @@ TEST_CASE("Publish an Oxygen sync-channel with downsampling enabled")
         REQUIRE(payload == "{\"data\":[10,15],\"idx\":1,\"sample-rate\":20.0,\"sampling\":\"sync\"}");
     }
 }
+
+TEST_CASE("Publish several Oxygen sync-channels within a single payload")
+{
+    Publish::Sampling sampling;
+    sampling.downsampling_factor = 2;
+    sampling.mode = SamplingModes::Sync;
+
+    Publish::Payload payload;
+    payload.datatype = Datatype::Integer;
+    payload.packet_size = 3;
+    payload.channels = {"a", "b"};
+
+    SECTION("Columnar layout")
+    {
+        payload.layout = ChannelLayout::Columnar;
+
+        Publish publish("A Topic", "uuid", sampling, payload, 0);
+        REQUIRE(publish.getInputChannels().size() == 2);
+
+        publish.addSyncChannels({{0, 1, 2, 3}, {10, 11, 12, 13}}, 100, 0.0);
+        REQUIRE(publish.hasPayload() == false);
+
+        publish.addSyncChannels({{4, 5, 6}, {14, 15, 16}}, 100, 0.04);
+        REQUIRE(publish.hasPayload());
+
+        auto j = json::parse(publish.pop());
+        REQUIRE(publish.hasPayload() == false);
+        REQUIRE(j["channels"] == json({"a", "b"}));
+        REQUIRE(j["layout"] == "columnar");
+        REQUIRE(j["sample-rate"] == 50.0);
+        REQUIRE(j["data"] == json({{0, 2, 4}, {10, 12, 14}}));
+    }
+    SECTION("Interleaved layout")
+    {
+        payload.layout = ChannelLayout::Interleaved;
+
+        Publish publish("A Topic", "uuid", sampling, payload, 0);
+        publish.addSyncChannels({{0, 1, 2, 3, 4, 5, 6}, {10, 11, 12, 13, 14, 15, 16}}, 100, 0.0);
+        REQUIRE(publish.hasPayload());
+
+        auto j = json::parse(publish.pop());
+        REQUIRE(j["layout"] == "interleaved");
+        REQUIRE(j["data"] == json({0, 10, 2, 12, 4, 14}));
+    }
+    SECTION("Channels must share a common timebase")
+    {
+        Publish publish("A Topic", "uuid", sampling, payload, 0);
+        REQUIRE_THROWS(publish.addSyncChannels({{0, 1, 2}, {10, 11}}, 100, 0.0));
+        REQUIRE_THROWS(publish.addSyncSamples({0, 1, 2}, 100, 0.0));
+    }
+}
+
+TEST_CASE("Publish partial packets of a sync-channel")
+{
+    Publish::Sampling sampling;
+    sampling.downsampling_factor = 1;
+    sampling.mode = SamplingModes::Sync;
+
+    Publish::Payload payload;
+    payload.datatype = Datatype::Integer;
+    payload.packet_size = 10;
+
+    SECTION("Flush partial packets once they reach the maximum latency")
+    {
+        payload.max_latency = 0.05;
+        Publish publish("A Topic", "uuid", sampling, payload, 0);
+
+        // 4 Samples at 100 Hz span 40 ms
+        publish.addSyncSamples({0, 1, 2, 3}, 100, 0.0);
+        REQUIRE(publish.hasPayload() == false);
+
+        // 6 Samples span 60 ms
+        publish.addSyncSamples({4, 5}, 100, 0.04);
+        REQUIRE(publish.hasPayload());
+
+        auto j = json::parse(publish.pop());
+        REQUIRE(j["data"] == json({0, 1, 2, 3, 4, 5}));
+        REQUIRE(j["idx"] == 0);
+
+        // Full packets are still published as usual
+        publish.addSyncSamples({6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16}, 100, 0.06);
+        REQUIRE(publish.hasPayload());
+
+        j = json::parse(publish.pop());
+        REQUIRE(j["data"] == json({6, 7, 8, 9, 10, 11, 12, 13, 14, 15}));
+        REQUIRE(publish.hasPayload() == false);
+    }
+    SECTION("Adaptive packet size follows the acknowledge latency")
+    {
+        payload.adaptive = true;
+        payload.max_latency = 0.5;
+        Publish publish("A Topic", "uuid", sampling, payload, 0);
+
+        // Without any acknowledged payload, the minimum packet size is used
+        REQUIRE(publish.getPacketSize(1000) == 10);
+
+        // Packets cover twice the acknowledge latency
+        publish.reportAckLatency(0.1);
+        REQUIRE(publish.getPacketSize(1000) == 200);
+
+        // But never exceed the maximum latency
+        publish.reportAckLatency(2.0);
+        REQUIRE(publish.getPacketSize(1000) == 500);
+    }
+}
@@ -1,6 +1,8 @@
 #define M_PI 3.141592653589793238463
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <vector>
 #include <memory>
 
@@ -9,6 +11,8 @@
 #include <catch2/catch_approx.hpp>
 
 //
+#include "resampling/Preview.h"
+#include "resampling/ReorderBuffer.h"
 #include "resampling/Stream.h"
 
 using namespace plugin::mqtt;
@@ -173,6 +177,7 @@ TEST_CASE("Estimating Sampling-Rate.")
         handler.append(packet_1.samples, packet_1.timestamp, 0, BASE_FREQUENCY);
         handler.append(packet_2.samples, packet_2.timestamp, 100, BASE_FREQUENCY);
         REQUIRE(handler.estimatedSamplingRate().value() == 989);
+        REQUIRE(handler.getStatistics().drift_ppm.value() == Catch::Approx(-11000).margin(1000));
     }
     SECTION("Stream sampling rate higher than nominal sampling rate")
     {
@@ -232,6 +237,106 @@ TEST_CASE("Resampling Stream")
     }
 }
 
+TEST_CASE("Resample samples in their native type")
+{
+    const auto nominal_sampling_rate = 1000;
+    const double scale = 10000;
+
+    auto stream = TestStream(990, 0, 10);
+    const auto packet_size = stream.availableSamples() / 10;
+
+    auto reference = Stream(std::make_shared<StreamClock>(), nominal_sampling_rate);
+    auto counts = BasicStream<std::int16_t>(std::make_shared<StreamClock>(), nominal_sampling_rate);
+    auto singles = BasicStream<float>(std::make_shared<StreamClock>(), nominal_sampling_rate);
+
+    int idx = 1;
+    while (stream.availableSamples())
+    {
+        auto packet = stream.pop(packet_size);
+
+        // Raw ADC counts of the same signal
+        std::vector<double> scaled;
+        std::vector<std::int16_t> raw;
+        std::vector<float> single;
+        for (auto v : packet.samples)
+        {
+            scaled.push_back(std::round(v * scale));
+            raw.push_back(static_cast<std::int16_t>(std::round(v * scale)));
+            single.push_back(static_cast<float>(std::round(v * scale)));
+        }
+
+        reference.append(scaled, packet.timestamp, 1000 * idx, BASE_FREQUENCY);
+        counts.append(raw, packet.timestamp, 1000 * idx, BASE_FREQUENCY);
+        singles.append(single, packet.timestamp, 1000 * idx, BASE_FREQUENCY);
+        idx++;
+    }
+
+    const auto expected = reference.getAndClearSamples();
+    const auto resampled_counts = counts.getAndClearSamples();
+    const auto resampled_singles = singles.getAndClearSamples();
+
+    REQUIRE(counts.estimatedSamplingRate() == 990);
+    REQUIRE(resampled_counts.size() == expected.size());
+    REQUIRE(resampled_singles.size() == expected.size());
+
+    for (std::size_t n = 0; n < expected.size(); ++n)
+    {
+        if (std::isnan(expected[n]))
+        {
+            // Samples aligning the start of stream
+            REQUIRE(resampled_counts[n] == 0);
+            REQUIRE(std::isnan(resampled_singles[n]));
+            continue;
+        }
+
+        // Interpolated counts are rounded to the nearest count
+        REQUIRE(resampled_counts[n] == Catch::Approx(expected[n]).margin(0.51));
+        REQUIRE(resampled_singles[n] == Catch::Approx(expected[n]).margin(0.01));
+    }
+
+    SECTION("Gaps of integer samples are filled with 0")
+    {
+        auto handler = BasicStream<std::int32_t>(std::make_shared<StreamClock>(), nominal_sampling_rate, {true, GapFill::NaN});
+        const std::vector<std::int32_t> packet(100, 42);
+
+        handler.append(packet, 0.099, 100, BASE_FREQUENCY);
+        handler.append(packet, 0.199, 200, BASE_FREQUENCY);
+        handler.getAndClearSamples();
+
+        // Two packets lost
+        handler.append(packet, 0.499, 500, BASE_FREQUENCY);
+        const auto samples = handler.getAndClearSamples();
+        const auto filled = handler.getStatistics().nan_filled;
+        REQUIRE(samples.size() == Catch::Approx(300).margin(2));
+        REQUIRE(filled == Catch::Approx(200).margin(2));
+        REQUIRE(static_cast<std::uint64_t>(std::count(samples.begin(), samples.end(), 0)) == filled);
+        REQUIRE(samples.back() == 42);
+    }
+    SECTION("Samples filled as invalid are reported as gaps")
+    {
+        auto handler = BasicStream<std::int32_t>(std::make_shared<StreamClock>(), nominal_sampling_rate, {true, GapFill::NaN});
+        const std::vector<std::int32_t> packet(100, 0);
+
+        handler.append(packet, 0.099, 100, BASE_FREQUENCY);
+        handler.append(packet, 0.199, 200, BASE_FREQUENCY);
+        StreamBase::Gaps gaps;
+        handler.getAndClearSamples(0, gaps);
+
+        // Two packets lost, the received samples are 0 as well
+        handler.append(packet, 0.499, 500, BASE_FREQUENCY);
+        const auto samples = handler.getAndClearSamples(0, gaps);
+        const auto filled = handler.getStatistics().nan_filled;
+        REQUIRE(gaps.size() == 1);
+        REQUIRE(gaps.front().offset == 0);
+        REQUIRE(gaps.front().count == filled);
+        REQUIRE(samples.size() == filled + packet.size());
+
+        // Taking the samples clears the gaps
+        handler.getAndClearSamples(0, gaps);
+        REQUIRE(gaps.empty());
+    }
+}
+
 TEST_CASE("Recover from a broken stream")
 {
     const auto nominal_sampling_rate = 1000;
@@ -293,6 +398,10 @@ TEST_CASE("Recover from a broken stream")
 
         // TODO Reduce margin?
         REQUIRE(samples.size() == Catch::Approx(1000 * 20).margin(5));
+
+        // The lost packets have been replaced by NaN
+        REQUIRE(handler.getStatistics().nan_filled == Catch::Approx(600).margin(5));
+        REQUIRE(handler.getStatistics().unrecoverable == false);
     }
     SECTION("Stream is unrecoverable")
     {
@@ -316,6 +425,410 @@ TEST_CASE("Recover from a broken stream")
             REQUIRE_THROWS(handler.append(packet.samples, packet.timestamp, packet_size * idx, BASE_FREQUENCY));
             idx++;
         }
+        REQUIRE(handler.getStatistics().unrecoverable);
+    }
+}
+
+TEST_CASE("Resynchronise a broken stream")
+{
+    const auto nominal_sampling_rate = 1000;
+    const int packet_size = 100;
+    auto clock = std::make_shared<StreamClock>();
+
+    auto feed = [packet_size](Stream &handler, TestStream &stream, int &idx)
+    {
+        while (stream.availableSamples())
+        {
+            auto packet = stream.pop(packet_size);
+            handler.append(packet.samples, packet.timestamp, packet_size * idx, BASE_FREQUENCY);
+            idx++;
+        }
+    };
+
+    SECTION("Stream re-anchors after an outage of 30 seconds")
+    {
+        auto handler = Stream(clock, nominal_sampling_rate, {true, GapFill::NaN});
+        int idx = 1;
+
+        auto stream_part_1 = TestStream(1000, 0, 10);
+        auto stream_part_2 = TestStream(1000, 40, 50);
+
+        // The Oxygen time passes during the outage
+        feed(handler, stream_part_1, idx);
+        idx += 30000 / packet_size;
+        REQUIRE_NOTHROW(feed(handler, stream_part_2, idx));
+
+        // The outage is filled with NaN, the stream stays aligned with the stream clock
+        auto samples = handler.getAndClearSamples();
+        REQUIRE(samples.size() == Catch::Approx(1000 * 50).margin(5));
+        REQUIRE(std::isnan(samples[20000]));
+        REQUIRE(std::isnan(samples.back()) == false);
+
+        const auto statistics = handler.getStatistics();
+        REQUIRE(statistics.resyncs == 1);
+        REQUIRE(statistics.unrecoverable == false);
+        REQUIRE(statistics.nan_filled == Catch::Approx(30000).margin(5));
+    }
+    SECTION("Stream skips an outage of hours once its samples have been taken")
+    {
+        auto handler = Stream(clock, nominal_sampling_rate, {true, GapFill::NaN});
+        int idx = 1;
+
+        auto stream_part_1 = TestStream(1000, 0, 10);
+        auto stream_part_2 = TestStream(1000, 10810, 10820);
+
+        feed(handler, stream_part_1, idx);
+        const auto written = handler.getAndClearSamples().size();
+        REQUIRE(handler.getPosition() == written);
+
+        // Three hours pass, filling them would write 10.8 million samples
+        idx += 10800000 / packet_size;
+        REQUIRE_NOTHROW(feed(handler, stream_part_2, idx));
+
+        // The samples continue at the current tick
+        REQUIRE(handler.getPosition() == Catch::Approx(10810000).margin(5));
+        auto samples = handler.getAndClearSamples();
+        REQUIRE(samples.size() == Catch::Approx(1000 * 10).margin(5));
+        REQUIRE(handler.getPosition() == Catch::Approx(10820000).margin(5));
+
+        const auto statistics = handler.getStatistics();
+        REQUIRE(statistics.resyncs == 1);
+        REQUIRE(statistics.nan_filled < 5);
+    }
+    SECTION("Stream follows packets changing their size")
+    {
+        auto handler = Stream(clock, nominal_sampling_rate, {true, GapFill::NaN});
+        int idx = 1;
+
+        auto stream = TestStream(1000, 0, 10);
+        for (int n = 0; n < 50; ++n)
+        {
+            auto packet = stream.pop(packet_size);
+            handler.append(packet.samples, packet.timestamp, packet_size * idx, BASE_FREQUENCY);
+            idx++;
+        }
+
+        while (stream.availableSamples())
+        {
+            auto packet = stream.pop(50);
+            handler.append(packet.samples, packet.timestamp, packet_size * idx, BASE_FREQUENCY);
+            idx++;
+        }
+
+        // Samples are written continuously, the sampling rate is estimated per sample
+        auto samples = handler.getAndClearSamples();
+        REQUIRE(samples.size() == Catch::Approx(1000 * 10).margin(5));
+        REQUIRE(std::none_of(samples.begin() + 200, samples.end(), [](double s)
+                             { return std::isnan(s); }));
+
+        const auto statistics = handler.getStatistics();
+        REQUIRE(statistics.resyncs == 0);
+        REQUIRE(statistics.estimated_sampling_rate == nominal_sampling_rate);
+    }
+    SECTION("Stream re-anchors after the clock of the publisher has been reset")
+    {
+        auto handler = Stream(clock, nominal_sampling_rate, {true, GapFill::NaN});
+        int idx = 1;
+
+        auto stream_part_1 = TestStream(1000, 100, 110);
+        auto stream_part_2 = TestStream(1000, 0, 10);
+
+        feed(handler, stream_part_1, idx);
+        const auto written = handler.getAndClearSamples().size();
+        REQUIRE_NOTHROW(feed(handler, stream_part_2, idx));
+
+        // Samples continue at the current Oxygen time
+        auto samples = handler.getAndClearSamples();
+        REQUIRE(written + samples.size() == Catch::Approx(1000 * 20).margin(5));
+        REQUIRE(handler.getStatistics().resyncs == 1);
+    }
+    SECTION("Stream re-anchors after the clock of the publisher jumped ahead")
+    {
+        auto handler = Stream(clock, nominal_sampling_rate, {true, GapFill::NaN});
+        int idx = 1;
+
+        // A day ahead, e.g. a device rebooted using another epoch, while the Oxygen time continues
+        auto stream_part_1 = TestStream(1000, 0, 10);
+        auto stream_part_2 = TestStream(1000, 86400, 86410);
+
+        feed(handler, stream_part_1, idx);
+        const auto written = handler.getAndClearSamples().size();
+        REQUIRE_NOTHROW(feed(handler, stream_part_2, idx));
+
+        // The jump is not filled, samples continue at the current Oxygen time
+        auto samples = handler.getAndClearSamples();
+        REQUIRE(written + samples.size() == Catch::Approx(1000 * 20).margin(5));
+
+        const auto statistics = handler.getStatistics();
+        REQUIRE(statistics.resyncs == 1);
+        REQUIRE(statistics.unrecoverable == false);
+        REQUIRE(statistics.nan_filled < 5);
+    }
+    SECTION("Lost packets are replaced by the last value")
+    {
+        auto handler = Stream(clock, nominal_sampling_rate, {true, GapFill::Hold});
+        int idx = 1;
+
+        auto stream_part_1 = TestStream(1000, 0, 10);
+        auto stream_part_2 = TestStream(1000, 10.6, 20);
+
+        feed(handler, stream_part_1, idx);
+        const auto written = handler.getAndClearSamples();
+        feed(handler, stream_part_2, idx);
+
+        auto samples = handler.getAndClearSamples();
+        REQUIRE(written.size() + samples.size() == Catch::Approx(1000 * 20).margin(5));
+        REQUIRE(samples.front() == written.back());
+        REQUIRE(samples[500] == written.back());
+
+        const auto statistics = handler.getStatistics();
+        REQUIRE(statistics.gap_filled == Catch::Approx(600).margin(5));
+        REQUIRE(statistics.resyncs == 0);
+    }
+    SECTION("Lost packets are bridged linearly")
+    {
+        auto handler = Stream(clock, nominal_sampling_rate, {true, GapFill::Linear});
+        int idx = 1;
+
+        auto stream_part_1 = TestStream(1000, 0, 10);
+        auto stream_part_2 = TestStream(1000, 10.6, 20);
+        const auto first = stream_part_2.pop(packet_size);
+
+        feed(handler, stream_part_1, idx);
+        const auto written = handler.getAndClearSamples();
+        handler.append(first.samples, first.timestamp, packet_size * idx, BASE_FREQUENCY);
+
+        // The gap is followed by the received packet
+        auto samples = handler.getAndClearSamples();
+        const auto gap = samples.size() - packet_size;
+        REQUIRE(gap == handler.getStatistics().gap_filled);
+        REQUIRE(gap == Catch::Approx(600).margin(5));
+
+        const auto step = (first.samples.front() - written.back()) / (gap + 1);
+        for (std::size_t n = 0; n < gap; ++n)
+        {
+            REQUIRE(samples[n] == Catch::Approx(written.back() + step * (n + 1)));
+        }
+        REQUIRE(samples[gap] == first.samples.front());
+    }
+    SECTION("Time missing beyond the lost packets is filled up to the timestamp")
+    {
+        auto handler = Stream(clock, nominal_sampling_rate, {true, GapFill::Linear});
+
+        auto stream_part_1 = TestStream(1000, 0, 10);
+        auto stream_part_2 = TestStream(1000, 10.6, 20);
+
+        int idx = 1;
+        while (stream_part_1.availableSamples())
+        {
+            auto packet = stream_part_1.pop(packet_size);
+            handler.append(packet.samples, packet.timestamp, packet_size * idx++, BASE_FREQUENCY, 0);
+        }
+        const auto written = handler.getAndClearSamples().size();
+
+        // The sequence number accounts for a single packet, the timestamps for six
+        std::uint64_t lost = 1;
+        while (stream_part_2.availableSamples())
+        {
+            auto packet = stream_part_2.pop(packet_size);
+            handler.append(packet.samples, packet.timestamp, packet_size * idx++, BASE_FREQUENCY, lost);
+            lost = 0;
+        }
+
+        // The gap is filled with NaN instead of being bridged, the following packets are written
+        auto samples = handler.getAndClearSamples();
+        REQUIRE(written + samples.size() == Catch::Approx(1000 * 20).margin(5));
+        REQUIRE(std::isnan(samples[300]));
+        REQUIRE(std::none_of(samples.begin() + 700, samples.end(), [](double s)
+                             { return std::isnan(s); }));
+
+        const auto statistics = handler.getStatistics();
+        REQUIRE(statistics.nan_filled == Catch::Approx(600).margin(5));
+        REQUIRE(statistics.gap_filled == 0);
+        REQUIRE(statistics.resyncs == 0);
+    }
+}
+
+TEST_CASE("Reorder packets by their sequence number")
+{
+    ReorderBuffer<int> buffer(2);
+
+    auto indices = [](const std::vector<ReorderBuffer<int>::Released> &released)
+    {
+        std::vector<int> p;
+        for (const auto &r : released)
+        {
+            p.push_back(r.packet);
+        }
+        return p;
+    };
+
+    REQUIRE(indices(buffer.push(10, 10)) == std::vector<int>{10});
+
+    // Late packets are released once the missing packet arrived
+    REQUIRE(buffer.push(12, 12).empty());
+    REQUIRE(indices(buffer.push(11, 11)) == std::vector<int>{11, 12});
+
+    // Duplicates are dropped
+    REQUIRE(buffer.push(12, 12).empty());
+    REQUIRE(buffer.push(11, 11).empty());
+
+    // A missing packet is lost once the buffer is full
+    REQUIRE(buffer.push(14, 14).empty());
+    REQUIRE(buffer.push(15, 15).empty());
+    auto released = buffer.push(16, 16);
+    REQUIRE(indices(released) == std::vector<int>{14, 15, 16});
+    REQUIRE(released.front().lost == 1);
+    REQUIRE(released.back().lost == 0);
+
+    // The packet arrived too late
+    REQUIRE(buffer.push(13, 13).empty());
+
+    // The publisher restarted
+    released = buffer.push(0, 0);
+    REQUIRE(indices(released) == std::vector<int>{0});
+    REQUIRE(released.front().restarted);
+    released = buffer.push(1, 1);
+    REQUIRE(indices(released) == std::vector<int>{1});
+    REQUIRE(released.front().restarted == false);
+
+    const auto statistics = buffer.getStatistics();
+    REQUIRE(statistics.reordered == 1);
+    REQUIRE(statistics.dropped == 3);
+    REQUIRE(statistics.lost == 1);
+    REQUIRE(statistics.restarts == 1);
+}
+
+TEST_CASE("Warm start from a previous acquisition")
+{
+    const auto nominal_sampling_rate = 1000;
+    auto clock = std::make_shared<StreamClock>();
+    auto handler = Stream(clock, nominal_sampling_rate);
+
+    auto stream = TestStream(990, 0, 10);
+    const auto packet_1 = stream.pop(100);
+    const auto packet_2 = stream.pop(100);
+
+    SECTION("The stream starts from the seeded sample rate")
+    {
+        handler.setWarmStart(StreamBase::WarmStart{1 / 990.0, 100});
+        handler.append(packet_1.samples, packet_1.timestamp, 0, BASE_FREQUENCY);
+        REQUIRE(handler.estimatedSamplingRate() == 990);
+        REQUIRE(handler.getStatistics().drift_ppm.value() == Catch::Approx(-10000).margin(100));
+
+        // The seed is not an estimate of this stream
+        REQUIRE(handler.getWarmStart() == std::nullopt);
+
+        handler.append(packet_2.samples, packet_2.timestamp, 100, BASE_FREQUENCY);
+        REQUIRE(handler.getWarmStart()->packet_size == 100);
+        REQUIRE(1 / handler.getWarmStart()->sampling_interval == Catch::Approx(990).margin(1));
+
+        // The seed survives a reset
+        handler.reset();
+        handler.append(packet_1.samples, packet_1.timestamp, 0, BASE_FREQUENCY);
+        REQUIRE(handler.estimatedSamplingRate() == 990);
+    }
+    SECTION("A seed of another packet size is ignored")
+    {
+        handler.setWarmStart(StreamBase::WarmStart{1 / 990.0, 50});
+        handler.append(packet_1.samples, packet_1.timestamp, 0, BASE_FREQUENCY);
+        REQUIRE(handler.estimatedSamplingRate() == nominal_sampling_rate);
+    }
+    SECTION("A seed beyond the tolerated drift is ignored")
+    {
+        handler.setWarmStart(StreamBase::WarmStart{1 / 500.0, 100});
+        handler.append(packet_1.samples, packet_1.timestamp, 0, BASE_FREQUENCY);
+        REQUIRE(handler.estimatedSamplingRate() == nominal_sampling_rate);
+    }
+}
+
+TEST_CASE("Preview of a resampled stream")
+{
+    Preview preview(1000, {10, 1});
+
+    // A ramp in packets not aligned to the blocks of the previews, starting with NaN samples
+    std::vector<double> ramp(1000);
+    for (std::size_t n = 0; n < ramp.size(); ++n)
+    {
+        ramp[n] = n < 15 ? std::nan("") : static_cast<double>(n);
+    }
+    for (std::size_t n = 0; n < ramp.size(); n += 37)
+    {
+        preview.append(std::vector<double>(ramp.begin() + n, ramp.begin() + std::min(n + 37, ramp.size())));
+    }
+
+    const auto min = preview.getAndClearSamples(0, Preview::Statistic::Min);
+    const auto max = preview.getAndClearSamples(0, Preview::Statistic::Max);
+    const auto mean = preview.getAndClearSamples(0, Preview::Statistic::Mean);
+    REQUIRE(min.size() == 10);
+    REQUIRE(mean.size() == 10);
+
+    // NaN samples are ignored
+    REQUIRE(min[0] == 15);
+    REQUIRE(max[0] == 99);
+    REQUIRE(mean[0] == Catch::Approx(57));
+    for (std::size_t k = 1; k < min.size(); ++k)
+    {
+        REQUIRE(min[k] == k * 100);
+        REQUIRE(max[k] == k * 100 + 99);
+        REQUIRE(mean[k] == Catch::Approx(k * 100 + 49.5));
+    }
+    REQUIRE(preview.getAndClearSamples(0, Preview::Statistic::Min).empty());
+
+    // A single block of the lower rate
+    REQUIRE(preview.getAndClearSamples(1, Preview::Statistic::Max) == std::vector<double>{999});
+
+    SECTION("Blocks without valid samples are NaN")
+    {
+        preview.append(std::vector<double>(150, std::nan("")));
+        const auto nan = preview.getAndClearSamples(0, Preview::Statistic::Mean);
+        REQUIRE(nan.size() == 1);
+        REQUIRE(std::isnan(nan.front()));
+    }
+    SECTION("Integer samples")
+    {
+        preview.reset();
+        preview.append(std::vector<std::int16_t>(100, -7));
+        REQUIRE(preview.getAndClearSamples(0, Preview::Statistic::Mean) == std::vector<double>{-7});
+    }
+    SECTION("Integer samples filled as invalid by the stream are ignored")
+    {
+        preview.reset();
+
+        // 0 fills the first 30 samples and a gap of 40 samples
+        std::vector<std::int16_t> samples(100, -7);
+        std::fill(samples.begin(), samples.begin() + 30, 0);
+        std::fill(samples.begin() + 60, samples.end(), 0);
+        preview.append(samples, {{0, 30}, {60, 40}});
+
+        const auto min = preview.getAndClearSamples(0, Preview::Statistic::Min);
+        const auto max = preview.getAndClearSamples(0, Preview::Statistic::Max);
+        REQUIRE(min == std::vector<double>{-7});
+        REQUIRE(max == std::vector<double>{-7});
+        REQUIRE(preview.getAndClearSamples(0, Preview::Statistic::Mean) == std::vector<double>{-7});
+    }
+    SECTION("Skipped samples are left out")
+    {
+        preview.reset();
+
+        // The block in progress is completed, the blocks within the skipped samples are left out
+        preview.append(std::vector<double>(150, 1));
+        preview.skip(1000);
+        preview.append(std::vector<double>(50, 2));
+
+        REQUIRE(preview.getPosition(0, Preview::Statistic::Mean) == 0);
+        REQUIRE(preview.getAndClearSamples(0, Preview::Statistic::Mean) == std::vector<double>{1, 1});
+        REQUIRE(preview.getPosition(0, Preview::Statistic::Mean) == 11);
+        REQUIRE(preview.getAndClearSamples(0, Preview::Statistic::Mean) == std::vector<double>{2});
+        REQUIRE(preview.getPosition(0, Preview::Statistic::Mean) == 12);
+
+        // The skipped samples are ignored by the blocks they end in
+        REQUIRE(preview.getAndClearSamples(1, Preview::Statistic::Mean) == std::vector<double>{1});
+    }
+    SECTION("Rates must divide the sample rate")
+    {
+        REQUIRE_THROWS_AS(Preview(1000, {300}), std::invalid_argument);
+        REQUIRE_THROWS_AS(Preview(1000, {1000}), std::invalid_argument);
     }
 }
 
@@ -0,0 +1,414 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+//
+#include <catch2/catch_test_macros.hpp>
+
+//
+#include "Service.h"
+#include "transport/LoopbackTransport.h"
+#include "transport/SharedTransport.h"
+#include "subscription/decoding/TextPlainDecoder.h"
+
+//
+#include "nlohmann/json.hpp"
+
+using namespace plugin::mqtt;
+using nlohmann::json;
+
+namespace
+{
+    Subscription::Pointer createSubscription(const std::string &topic, int qos = 0)
+    {
+        Subscription::Sampling sampling;
+        sampling.mode = SamplingModes::Async;
+        sampling.timeout = 0;
+
+        Channel::Configuration config;
+        config.name = topic;
+        config.uuid = topic;
+        config.datatype = Datatype::Integer;
+        config.decoder = std::make_shared<TextPlainDecoder>(Datatype::Integer);
+        config.local_channel_id = 1;
+
+        auto subscription = std::make_shared<Subscription>(sampling, topic, qos);
+        subscription->addChannel(std::make_shared<Channel>(config));
+        return subscription;
+    }
+
+    config::Server::Pointer createServer(const json &server)
+    {
+        config::Servers servers;
+        config::from_json(json{{"servers", {server}}}, servers);
+        return servers.front();
+    }
+
+    std::size_t countSamples(const Subscription::Pointer &subscription)
+    {
+        std::size_t count = 0;
+        for (auto &channel : subscription->getChannels())
+        {
+            count += channel->getAndClearSamples().size();
+        }
+        return count;
+    }
+
+    /**
+     * @brief Loopback connection completing deliveries on request, like a broker acknowledging QoS 1 payloads later
+     */
+    class DeferredDeliveryTransport : public LoopbackTransport
+    {
+    public:
+        void publish(const std::string &topic, const std::string &payload, int qos, DeliveryCallback on_delivery) override
+        {
+            LoopbackTransport::publish(topic, payload, qos, nullptr);
+            m_deliveries.push_back(std::move(on_delivery));
+        }
+
+        std::size_t completeDeliveries(bool delivered)
+        {
+            const auto count = m_deliveries.size();
+            for (auto &on_delivery : m_deliveries)
+            {
+                on_delivery(delivered);
+            }
+            m_deliveries.clear();
+            return count;
+        }
+
+    private:
+        std::vector<DeliveryCallback> m_deliveries;
+    };
+
+    /**
+     * @brief Loopback connection refusing to unsubscribe
+     */
+    class FailingUnsubscribeTransport : public LoopbackTransport
+    {
+    public:
+        void unsubscribe(const std::string &) override
+        {
+            throw std::runtime_error("Unsubscribe failed.");
+        }
+    };
+
+    /**
+     * @brief Creates loopback connections and remembers the last one
+     */
+    struct LoopbackFactory
+    {
+        std::shared_ptr<LoopbackTransport> last;
+        std::size_t created = 0;
+
+        ConnectionRegistry::Factory get()
+        {
+            return [this](config::Server::Pointer)
+            {
+                created++;
+                last = std::make_shared<LoopbackTransport>();
+                return last;
+            };
+        }
+    };
+}
+
+TEST_CASE("Services connecting to the same broker share a connection")
+{
+    LoopbackFactory factory;
+    auto server = createServer({{"url", "loopback-shared"}, {"username", "user"}, {"password", "secret"}});
+
+    auto shared_a = createSubscription("/shared", 0);
+    auto shared_b = createSubscription("/shared", 1);
+    auto only_a = createSubscription("/only/a");
+
+    {
+        Service a;
+        a.setTimeSource([]
+                        { return Timestamp(0, 1000000); });
+        a.setTransport(ConnectionRegistry::acquire(server, factory.get()));
+        a.addSubscription(shared_a);
+        a.addSubscription(only_a);
+
+        Service b;
+        b.setTimeSource([]
+                        { return Timestamp(0, 1000000); });
+        b.setTransport(ConnectionRegistry::acquire(server, factory.get()));
+        b.addSubscription(shared_b);
+
+        REQUIRE(factory.created == 1);
+        REQUIRE(ConnectionRegistry::getConnectionCount() == 1);
+        auto &broker = *factory.last;
+
+        a.connect();
+        b.connect();
+        a.prepareProcessing();
+        b.prepareProcessing();
+
+        // Topics are subscribed once, using the highest QoS requested
+        auto subscribed = broker.getSubscriptions();
+        REQUIRE(subscribed.size() == 2);
+        REQUIRE(subscribed["/shared"] == 1);
+        REQUIRE(subscribed.count("/only/a") == 1);
+
+        // Messages are dispatched to the services subscribed to their topic
+        REQUIRE(broker.inject(make_message("/shared", "1")));
+        REQUIRE(broker.inject(make_message("/only/a", "2")));
+        REQUIRE(countSamples(shared_a) == 1);
+        REQUIRE(countSamples(shared_b) == 1);
+        REQUIRE(countSamples(only_a) == 1);
+
+        // A topic stays subscribed as long as any service needs it
+        a.stopProcessing();
+        subscribed = broker.getSubscriptions();
+        REQUIRE(subscribed.size() == 1);
+        REQUIRE(subscribed.count("/shared") == 1);
+
+        REQUIRE(broker.inject(make_message("/shared", "3")));
+        REQUIRE(countSamples(shared_a) == 0);
+        REQUIRE(countSamples(shared_b) == 1);
+
+        // Reconnecting restores the subscriptions of all services
+        a.prepareProcessing();
+        broker.loseConnection("test");
+        a.connect();
+        REQUIRE(broker.getSubscriptions().size() == 2);
+        REQUIRE(broker.inject(make_message("/shared", "4")));
+        REQUIRE(countSamples(shared_a) == 1);
+        REQUIRE(countSamples(shared_b) == 1);
+
+        // Other credentials require another connection
+        auto other = ConnectionRegistry::acquire(createServer({{"url", "loopback-shared"}, {"username", "other"}}), factory.get());
+        REQUIRE(factory.created == 2);
+        REQUIRE(ConnectionRegistry::getConnectionCount() == 2);
+        other.reset();
+        REQUIRE(ConnectionRegistry::getConnectionCount() == 1);
+
+        // Disconnecting a service keeps the connection of the others
+        a.disconnect();
+        REQUIRE(broker.isConnected());
+        REQUIRE(broker.getSubscriptions().size() == 1);
+
+        b.disconnect();
+        REQUIRE(broker.isConnected() == false);
+    }
+
+    // The connection is released with the last service
+    REQUIRE(ConnectionRegistry::getConnectionCount() == 0);
+}
+
+TEST_CASE("Deliveries completing after a service sharing the connection has been destroyed")
+{
+    auto broker = std::make_shared<DeferredDeliveryTransport>();
+    auto server = createServer({{"url", "loopback-deferred"}});
+    auto factory = [&broker](config::Server::Pointer)
+    { return broker; };
+
+    Publish::Sampling sampling{SamplingModes::Async, 1};
+    auto publisher = std::make_shared<Publish>("/deferred", "uuid", sampling, Datatype::Number, 1, 1);
+
+    Service remaining;
+    remaining.setTransport(ConnectionRegistry::acquire(server, factory));
+    remaining.connect();
+
+    {
+        Service removed;
+        removed.setTransport(ConnectionRegistry::acquire(server, factory));
+        removed.connect();
+        removed.addPublishHandler(publisher);
+
+        publisher->addAsyncSample(1.0, 1.5);
+        publisher->addAsyncSample(2.0, 2.5);
+        removed.publish();
+        REQUIRE(removed.getFlowStatistics().in_flight[1] == 2);
+    }
+
+    // The connection stays open for the remaining service, the payloads still count towards the shared window
+    REQUIRE(broker->isConnected());
+    REQUIRE(remaining.getFlowStatistics().in_flight[1] == 2);
+
+    // The acknowledges still arrive and release the window
+    REQUIRE(broker->completeDeliveries(true) == 2);
+    REQUIRE(publisher->getMetrics().getSnapshot().acknowledged == 2);
+    REQUIRE(remaining.getFlowStatistics().acknowledged == 2);
+    REQUIRE(remaining.getFlowStatistics().in_flight[1] == 0);
+
+    remaining.disconnect();
+}
+
+TEST_CASE("Detaching a transport waits for its callbacks in flight")
+{
+    auto broker = std::make_shared<LoopbackTransport>();
+    auto connection = std::make_shared<SharedConnection>(broker);
+    auto a = std::make_shared<SharedTransport>(connection);
+    auto b = std::make_shared<SharedTransport>(connection);
+
+    // The callback of a blocks until released, like a service waiting for its processing thread
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool entered = false;
+    bool released = false;
+    std::atomic<int> calls_a{0};
+    std::atomic<bool> returned_a{false};
+
+    Transport::Callbacks callbacks_a;
+    callbacks_a.message_arrived = [&](const_message_ptr)
+    {
+        calls_a++;
+        std::unique_lock<std::mutex> lock(mtx);
+        entered = true;
+        cv.notify_all();
+        cv.wait(lock, [&]
+                { return released; });
+        returned_a = true;
+    };
+    a->setCallbacks(callbacks_a);
+
+    std::atomic<int> calls_b{0};
+    Transport::Callbacks callbacks_b;
+    callbacks_b.message_arrived = [&](const_message_ptr)
+    { calls_b++; };
+    b->setCallbacks(callbacks_b);
+
+    a->connect();
+    b->connect();
+    a->subscribe("/a", 0);
+    a->subscribe("/shared", 0);
+    b->subscribe("/b", 0);
+    b->subscribe("/shared", 0);
+
+    std::thread arriving([&]
+                         { broker->inject(make_message("/a", "1")); });
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&]
+                { return entered; });
+    }
+
+    // Disconnecting a does not return while its callback is running
+    std::atomic<bool> detached{false};
+    bool returned_before_detached = false;
+    std::thread disconnecting([&]
+                              {
+                                  a->disconnect();
+                                  returned_before_detached = returned_a;
+                                  detached = true; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE(detached == false);
+
+    // The other transport keeps receiving meanwhile, no further callback reaches a
+    REQUIRE(broker->inject(make_message("/b", "2")));
+    REQUIRE(broker->inject(make_message("/shared", "3")));
+    REQUIRE(calls_b == 2);
+    REQUIRE(calls_a == 1);
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        released = true;
+    }
+    cv.notify_all();
+    arriving.join();
+    disconnecting.join();
+
+    REQUIRE(detached);
+    REQUIRE(returned_before_detached);
+    REQUIRE(connection->getSessionCount() == 1);
+
+    // Only the topics of b stay subscribed
+    auto subscribed = broker->getSubscriptions();
+    REQUIRE(subscribed.size() == 2);
+    REQUIRE(subscribed.count("/a") == 0);
+    REQUIRE(broker->inject(make_message("/shared", "4")));
+    REQUIRE(calls_b == 3);
+    REQUIRE(calls_a == 1);
+
+    b->disconnect();
+    REQUIRE(broker->isConnected() == false);
+}
+
+TEST_CASE("Detaching a transport reports topics failing to unsubscribe")
+{
+    auto broker = std::make_shared<FailingUnsubscribeTransport>();
+    auto connection = std::make_shared<SharedConnection>(broker);
+    auto a = std::make_shared<SharedTransport>(connection);
+    auto b = std::make_shared<SharedTransport>(connection);
+
+    a->connect();
+    b->connect();
+    a->subscribe("/a", 0);
+    b->subscribe("/b", 0);
+
+    // The transport is detached nevertheless, the connection stays open for the other one
+    REQUIRE_THROWS(a->disconnect());
+    REQUIRE(a->isConnected() == false);
+    REQUIRE(b->isConnected());
+    REQUIRE(connection->getSessionCount() == 1);
+
+    // Services close their transport regardless
+    Service service;
+    service.setTransport(std::make_shared<SharedTransport>(connection));
+    service.addSubscription(createSubscription("/service"));
+    service.connect();
+    service.prepareProcessing();
+    REQUIRE(connection->getSessionCount() == 2);
+    REQUIRE_NOTHROW(service.disconnect());
+    REQUIRE(connection->getSessionCount() == 1);
+}
+
+TEST_CASE("Services sharing a connection share its flow control")
+{
+    auto broker = std::make_shared<DeferredDeliveryTransport>();
+    std::size_t created = 0;
+    auto factory = [&broker, &created](config::Server::Pointer)
+    {
+        created++;
+        return broker;
+    };
+
+    auto server = createServer({{"url", "loopback-window"}, {"max-inflight", 4}});
+    Publish::Sampling sampling{SamplingModes::Async, 1};
+
+    Service a;
+    a.setTransport(ConnectionRegistry::acquire(server, factory));
+    a.connect();
+    auto publisher_a = std::make_shared<Publish>("/window/a", "uuid", sampling, Datatype::Number, 1, 1);
+    a.addPublishHandler(publisher_a);
+
+    Service b;
+    b.setTransport(ConnectionRegistry::acquire(server, factory));
+    b.connect();
+    auto publisher_b = std::make_shared<Publish>("/window/b", "uuid", sampling, Datatype::Number, 1, 1);
+    b.addPublishHandler(publisher_b);
+
+    for (int n = 0; n < 3; ++n)
+    {
+        publisher_a->addAsyncSample(static_cast<double>(n), n);
+        publisher_b->addAsyncSample(static_cast<double>(n), n);
+    }
+
+    // The payloads of both services never exceed the max-inflight of the client
+    a.publish();
+    b.publish();
+    REQUIRE(a.getFlowStatistics().in_flight[1] == 4);
+    REQUIRE(b.getFlowStatistics().in_flight[1] == 4);
+    REQUIRE(publisher_b->hasPayload());
+
+    REQUIRE(broker->completeDeliveries(true) == 4);
+    b.publish();
+    REQUIRE(publisher_b->hasPayload() == false);
+
+    // Other connection options require another connection, each applies its own limit
+    auto other = ConnectionRegistry::acquire(createServer({{"url", "loopback-window"}, {"max-inflight", 8}}), factory);
+    REQUIRE(created == 2);
+    REQUIRE(other->getFlowControl() != ConnectionRegistry::acquire(server, factory)->getFlowControl());
+    REQUIRE(other->getFlowControl()->getStatistics().window <= 8);
+
+    b.disconnect();
+    a.disconnect();
+}
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+//
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+
+//
+#include "resampling/Stream.h"
+#include "resampling/StreamClock.h"
+
+using namespace plugin::mqtt;
+
+TEST_CASE("Stream clock integer arithmetic")
+{
+    SECTION("Products exceeding 64 bit are divided exactly")
+    {
+        // A week in nanoseconds at 100 kHz overflows 64 bit
+        const std::uint64_t week_ns = 7ull * 24 * 3600 * 1000000000;
+        REQUIRE(StreamClock::mulDiv(week_ns, 100000, 1000000000) == 7ull * 24 * 3600 * 100000);
+        REQUIRE(StreamClock::mulDiv(std::numeric_limits<std::uint64_t>::max(), 3, 3) == std::numeric_limits<std::uint64_t>::max());
+        REQUIRE(StreamClock::mulDiv(10, 10, 3) == 33);
+    }
+    SECTION("Timestamps on the sample grid are not truncated")
+    {
+        StreamClock clock;
+        clock.setStartOfStream(0, 0, 1000000);
+
+        // 0.3 / 0.00001 evaluates to 29999.999... in double arithmetic
+        REQUIRE(clock.alignSamples(0.3, 100000) == 30000);
+        REQUIRE(clock.alignSamples(0.7, 100000) == 70000);
+        REQUIRE(clock.alignSeconds(0.3) == Catch::Approx(0.3));
+    }
+    SECTION("Oxygen ticks are mapped to the sample rate")
+    {
+        StreamClock clock;
+        clock.setStartOfStream(10, 30000000, 10000000);
+
+        REQUIRE(clock.alignSamples(10, 100000) == 300000);
+        REQUIRE(clock.alignSamples(11, 100000) == 400000);
+        REQUIRE(clock.alignSeconds(11) == Catch::Approx(4));
+    }
+}
+
+TEST_CASE("Stream clock stays aligned for a week at 100 kHz")
+{
+    const int sample_rate = 100000;
+    const std::uint64_t packet_size = 10000;
+    const std::uint64_t num_packets = 7ull * 24 * 3600 * sample_rate / packet_size;
+
+    // Publishers starting at zero, at an odd time and using unix time
+    for (const double start : {0.0, 12345.678, 1700000000.0})
+    {
+        auto domain = std::make_shared<ClockDomain>();
+        StreamClock clock(domain);
+        const std::uint64_t base_ticks = 123456789;
+        clock.setStartOfStream(start, base_ticks, 10000000);
+
+        const auto reference = clock.alignSamples(start, sample_rate);
+        REQUIRE(reference == base_ticks / 100);
+
+        // Every packet maps to its exact sample count, counting mismatches keeps the test fast
+        std::uint64_t mismatches = 0;
+        for (std::uint64_t p = 1; p <= num_packets; ++p)
+        {
+            const auto samples = p * packet_size;
+            const auto timestamp = start + samples / static_cast<double>(sample_rate);
+            if (clock.alignSamples(timestamp, sample_rate) != reference + samples)
+            {
+                mismatches++;
+            }
+        }
+        REQUIRE(mismatches == 0);
+
+        // A source joining the clock domain at the end of the week aligns identically
+        const auto end = start + num_packets * packet_size / static_cast<double>(sample_rate);
+        StreamClock shared(domain);
+        shared.setStartOfStream(end - 1, base_ticks + 7ull * 24 * 3600 * 10000000, 10000000);
+        REQUIRE(shared.alignSamples(end - 0.5, sample_rate) == clock.alignSamples(end - 0.5, sample_rate));
+        REQUIRE(clock.alignSamples(end, sample_rate) - clock.alignSamples(end - 0.5, sample_rate) == sample_rate / 2);
+    }
+}
+
+TEST_CASE("Sources of a clock domain")
+{
+    auto domain = std::make_shared<ClockDomain>();
+    StreamClock a(domain);
+    StreamClock b(domain);
+
+    // The first source sets the start of the domain, the second joins it
+    a.setStartOfStream(10, 1000, 1000);
+    b.setStartOfStream(12, 5000, 1000);
+    REQUIRE(domain->getSourceCount() == 2);
+    REQUIRE(a.alignSamples(12, 1000) == 3000);
+    REQUIRE(b.alignSamples(12, 1000) == 3000);
+    REQUIRE(b.alignSamples(12.0004, 1000) == a.alignSamples(12.0004, 1000));
+
+    SECTION("A source restarting keeps the start of the domain")
+    {
+        a.resetSartOfStream();
+        REQUIRE(domain->getStart().has_value());
+
+        a.setStartOfStream(13, 9999, 1000);
+        REQUIRE(a.alignSamples(13, 1000) == 4000);
+        REQUIRE(b.alignSamples(13, 1000) == 4000);
+    }
+    SECTION("A source re-anchors without moving the domain")
+    {
+        // The clock of the second source has been reset
+        b.reanchor(0.5, 6000, 1000);
+        REQUIRE(b.alignSamples(0.5, 1000) == 6000);
+        REQUIRE(b.alignSamples(1.5, 1000) == 7000);
+        REQUIRE(b.getSourceOffsetNanoseconds() == 14500000000);
+
+        REQUIRE(a.alignSamples(15, 1000) == 6000);
+        REQUIRE(a.getSourceOffsetNanoseconds() == 0);
+    }
+    SECTION("The start is dropped once all sources left")
+    {
+        a.resetSartOfStream();
+        b.resetSartOfStream();
+        REQUIRE(domain->getStart() == std::nullopt);
+
+        b.setStartOfStream(100, 2000, 1000);
+        REQUIRE(b.alignSamples(100, 1000) == 2000);
+    }
+}
+
+TEST_CASE("Streams of a clock domain stay sample-aligned")
+{
+    const int sample_rate = 1000;
+    auto domain = std::make_shared<ClockDomain>();
+    auto clock_a = std::make_shared<StreamClock>(domain);
+    auto clock_b = std::make_shared<StreamClock>(domain);
+    Stream a(clock_a, sample_rate);
+    Stream b(clock_b, sample_rate);
+
+    // Both sources sample a ramp of their common time, using different packet sizes and starting at different times
+    auto packet = [](double last, std::size_t size)
+    {
+        std::vector<double> samples;
+        for (std::size_t n = 0; n < size; ++n)
+        {
+            samples.push_back(last - (size - 1 - n) / static_cast<double>(sample_rate));
+        }
+        return samples;
+    };
+
+    std::vector<double> samples_a;
+    std::vector<double> samples_b;
+    for (int p = 1; p <= 100; ++p)
+    {
+        // A starts at 0.1 s, B at 0.3 s and arrives 20 ms later
+        const double last_a = 0.1 + p * 0.1 - 0.001;
+        const auto ticks = static_cast<std::uint64_t>(last_a * 1000) + 5;
+        a.append(packet(last_a, 100), last_a, ticks, 1000);
+
+        if (p > 2)
+        {
+            for (int q = 0; q < 2; ++q)
+            {
+                const double last_b = 0.3 + (2 * (p - 3) + q + 1) * 0.05 - 0.001;
+                b.append(packet(last_b, 50), last_b, ticks + 20, 1000);
+            }
+        }
+
+        auto out_a = a.getAndClearSamples();
+        auto out_b = b.getAndClearSamples();
+        samples_a.insert(samples_a.end(), out_a.begin(), out_a.end());
+        samples_b.insert(samples_b.end(), out_b.begin(), out_b.end());
+    }
+
+    // The samples of both sources carry the same time at the same sample index
+    const auto common = std::min(samples_a.size(), samples_b.size());
+    REQUIRE(common > 9000);
+
+    std::size_t compared = 0;
+    for (std::size_t n = 0; n < common; ++n)
+    {
+        if (std::isnan(samples_a[n]) || std::isnan(samples_b[n]))
+        {
+            continue;
+        }
+
+        REQUIRE(samples_a[n] == Catch::Approx(samples_b[n]).margin(0.1 / sample_rate));
+        compared++;
+    }
+    REQUIRE(compared > 9000);
+}
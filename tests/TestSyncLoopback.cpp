@@ -0,0 +1,629 @@
+#define M_PI 3.141592653589793238463
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <memory>
+#include <set>
+
+//
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+//
+#include "publish/Publish.h"
+#include "resampling/Preview.h"
+#include "subscription/decoding/CborSyncDecoder.h"
+
+//
+#include "nlohmann/json.hpp"
+
+using namespace plugin::mqtt;
+using nlohmann::json;
+
+#define SAMPLE_RATE 1000
+#define BASE_FREQUENCY 1000000
+
+class LoopbackStream
+{
+public:
+    LoopbackStream(int packet_size, double latency) : LoopbackStream(payload(packet_size), latency)
+    {
+    }
+
+    LoopbackStream(const Publish::Payload &payload, double latency, StreamBase::Recovery recovery = {false, GapFill::NaN}) : m_latency(latency),
+                                                                                                                          m_clock(std::make_shared<StreamClock>()),
+                                                                                                                          m_decoder(Datatype::Number, SAMPLE_RATE, m_clock, recovery, CborSyncDecoder::DEFAULT_REORDER_DEPTH),
+                                                                                                                          m_payload(payload),
+                                                                                                                          m_publish(std::make_unique<Publish>("/loopback", "uuid", sampling(), payload, 2))
+    {
+        m_decoder.prepareProcessing();
+    }
+
+    /**
+     * @brief Simulate a single Oxygen processing window on the publishing side
+     * and deliver all resulting payloads to the subscribing side
+     */
+    void process(std::size_t num_samples)
+    {
+        std::vector<value_t> values;
+        const auto start = m_published / static_cast<double>(SAMPLE_RATE);
+
+        for (std::size_t n = 0; n < num_samples; ++n)
+        {
+            values.push_back(signal(m_published + n));
+        }
+        m_published += num_samples;
+
+        m_publish->addSyncSamples(values, SAMPLE_RATE, start);
+
+        // All payloads leave the publisher at the end of the window and arrive after a given latency
+        const auto arrival_seconds = m_published / static_cast<double>(SAMPLE_RATE) + m_latency;
+        const auto arrival = Timestamp(static_cast<std::uint64_t>(arrival_seconds * BASE_FREQUENCY), BASE_FREQUENCY);
+
+        std::vector<std::string> payloads;
+        while (m_publish->hasPayload())
+        {
+            payloads.push_back(m_publish->pop());
+        }
+
+        if (m_delivery)
+        {
+            payloads = m_delivery(std::move(payloads));
+        }
+
+        for (const auto &payload : payloads)
+        {
+            m_packet_sizes.insert(json::from_cbor(payload)["data"].size());
+
+            auto sample = m_decoder.getValue(Timestamp(0, BASE_FREQUENCY), arrival, payload);
+            auto decoded = sample.pop_values<double>();
+            for (std::size_t n = 0; n < decoded.size(); ++n)
+            {
+                m_ticks.push_back(sample.time.ticks + n);
+            }
+            m_decoded.insert(m_decoded.end(), decoded.begin(), decoded.end());
+        }
+    }
+
+    /**
+     * @brief Emulate the broker delivering the payloads of a processing window, e.g. out of order
+     */
+    void setDelivery(std::function<std::vector<std::string>(std::vector<std::string>)> delivery)
+    {
+        m_delivery = std::move(delivery);
+    }
+
+    const CborSyncDecoder &decoder() const
+    {
+        return m_decoder;
+    }
+
+    void setPreview(Preview::Pointer preview)
+    {
+        m_decoder.setPreview(std::move(preview));
+    }
+
+    Publish &publisher()
+    {
+        return *m_publish;
+    }
+
+    /**
+     * @brief Restart the publisher after an outage, its sequence numbers start from 0 again
+     * @param num_samples Samples not published during the outage
+     */
+    void restart(std::size_t num_samples)
+    {
+        m_published += num_samples;
+        m_publish = std::make_unique<Publish>("/loopback", "uuid", sampling(), m_payload, 2);
+    }
+
+    /**
+     * @brief Get the sizes of all packets delivered so far
+     */
+    const std::set<std::size_t> &packetSizes() const
+    {
+        return m_packet_sizes;
+    }
+
+    static double signal(std::size_t idx)
+    {
+        return std::sin(2 * M_PI * idx / static_cast<double>(SAMPLE_RATE));
+    }
+
+    std::size_t published() const
+    {
+        return m_published;
+    }
+
+    const std::vector<double> &decoded() const
+    {
+        return m_decoded;
+    }
+
+    /**
+     * @brief Get the tick of every decoded sample
+     */
+    const std::vector<std::uint64_t> &ticks() const
+    {
+        return m_ticks;
+    }
+
+    static Publish::Payload payload(int packet_size)
+    {
+        Publish::Payload p;
+        p.datatype = Datatype::Number;
+        p.packet_size = packet_size;
+        p.layout = ChannelLayout::Columnar;
+        p.format = PayloadFormat::CborSync;
+        return p;
+    }
+
+private:
+    static Publish::Sampling sampling()
+    {
+        Publish::Sampling s;
+        s.mode = SamplingModes::Sync;
+        s.downsampling_factor = 1;
+        return s;
+    }
+
+    const double m_latency;
+    std::size_t m_published = 0;
+    std::vector<double> m_decoded;
+    std::vector<std::uint64_t> m_ticks;
+    std::set<std::size_t> m_packet_sizes;
+    std::function<std::vector<std::string>(std::vector<std::string>)> m_delivery;
+
+    StreamClock::Pointer m_clock;
+    CborSyncDecoder m_decoder;
+    Publish::Payload m_payload;
+    std::unique_ptr<Publish> m_publish;
+};
+
+TEST_CASE("Publish a sync-channel using the CBOR-Sync protocol")
+{
+    Publish::Sampling sampling;
+    sampling.downsampling_factor = 2;
+    sampling.mode = SamplingModes::Sync;
+
+    Publish::Payload payload;
+    payload.datatype = Datatype::Number;
+    payload.packet_size = 3;
+    payload.layout = ChannelLayout::Columnar;
+    payload.format = PayloadFormat::CborSync;
+
+    Publish publish("A Topic", "uuid", sampling, payload, 0);
+    publish.addSyncSamples({0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0}, 100, 1.0);
+    REQUIRE(publish.hasPayload());
+
+    // The timestamp refers to the last sample of the packet (sample 4 at 1.0 + 4/100 s)
+    auto j = json::from_cbor(publish.pop());
+    REQUIRE(j["data"] == json({0.0, 2.0, 4.0}));
+    REQUIRE(j["timestamp"].get<double>() == Catch::Approx(1.04));
+    REQUIRE(j["sample-rate"].get<double>() == Catch::Approx(50.0));
+
+    // Samples 6 and 8 are still buffered, the next packet ends with sample 10 of the next block
+    publish.addSyncSamples({9.0, 10.0, 11.0}, 100, 1.09);
+    REQUIRE(publish.hasPayload());
+
+    j = json::from_cbor(publish.pop());
+    REQUIRE(j["data"] == json({6.0, 8.0, 10.0}));
+    REQUIRE(j["timestamp"].get<double>() == Catch::Approx(1.10));
+    REQUIRE(j["idx"] == 1);
+}
+
+TEST_CASE("Loopback from Publish to the CBOR-Sync decoder")
+{
+    const double latency = 0.005;
+    LoopbackStream stream(50, latency);
+
+    for (int window = 0; window < 100; ++window)
+    {
+        stream.process(100);
+    }
+
+    // Samples are aligned with the arrival of the first packet: its last sample arrives 'latency' after the
+    // end of the first processing window, i.e. the decoded stream lags behind the published stream
+    const auto &decoded = stream.decoded();
+    const auto delay = 100 - 50 + latency * SAMPLE_RATE;
+    REQUIRE(decoded.size() == Catch::Approx(stream.published() + delay).margin(5));
+
+    std::size_t compared = 0;
+    for (std::size_t n = 0; n < decoded.size(); ++n)
+    {
+        if (std::isnan(decoded[n]))
+        {
+            continue;
+        }
+
+        const auto expected = std::sin(2 * M_PI * (n - delay) / static_cast<double>(SAMPLE_RATE));
+        REQUIRE(decoded[n] == Catch::Approx(expected).margin(0.02));
+        compared++;
+    }
+
+    REQUIRE(compared == Catch::Approx(stream.published()).margin(5));
+}
+
+TEST_CASE("Loopback of packets of varying size")
+{
+    const double latency = 0.005;
+    auto payload = LoopbackStream::payload(100);
+
+    // Samples of the first packet, published at the end of the first window
+    double first_packet = 0;
+
+    SECTION("Partial packets are published once their samples span the maximum latency")
+    {
+        payload.max_latency = 0.05;
+        first_packet = 60;
+    }
+    SECTION("Adaptive packets grow with the acknowledge latency of the broker")
+    {
+        payload.packet_size = 50;
+        payload.max_latency = 0.2;
+        payload.adaptive = true;
+        first_packet = 50;
+    }
+
+    LoopbackStream stream(payload, latency);
+
+    // Processing windows of varying length
+    const std::size_t windows[] = {60, 80, 100};
+    for (int window = 0; window < 150; ++window)
+    {
+        // The broker slows down, adaptive packets grow to 60 samples
+        if (window == 75)
+        {
+            stream.publisher().reportAckLatency(0.03);
+        }
+        stream.process(windows[window % 3]);
+    }
+    REQUIRE(stream.packetSizes().size() > 1);
+
+    // The stream follows the packets without re-anchoring
+    const auto statistics = stream.decoder().getStreamStatistics().value();
+    REQUIRE(statistics.resyncs == 0);
+    REQUIRE(statistics.unrecoverable == false);
+    REQUIRE(statistics.estimated_sampling_rate == SAMPLE_RATE);
+
+    const auto &decoded = stream.decoded();
+    const auto delay = 60 - first_packet + latency * SAMPLE_RATE;
+    REQUIRE(decoded.size() == Catch::Approx(stream.published() + delay).margin(50));
+
+    std::size_t compared = 0;
+    for (std::size_t n = 0; n < decoded.size(); ++n)
+    {
+        if (std::isnan(decoded[n]))
+        {
+            continue;
+        }
+
+        const auto expected = std::sin(2 * M_PI * (n - delay) / static_cast<double>(SAMPLE_RATE));
+        REQUIRE(decoded[n] == Catch::Approx(expected).margin(0.02));
+        compared++;
+    }
+
+    REQUIRE(compared == Catch::Approx(stream.published()).margin(50));
+}
+
+TEST_CASE("Loopback of a publisher restarting after an outage")
+{
+    const double latency = 0.005;
+    LoopbackStream stream(50, latency);
+
+    for (int window = 0; window < 50; ++window)
+    {
+        stream.process(100);
+    }
+
+    // No packet is lost according to the sequence numbers, the timestamps reveal the outage of 10 seconds
+    stream.restart(10000);
+    for (int window = 0; window < 50; ++window)
+    {
+        stream.process(100);
+    }
+
+    const auto statistics = stream.decoder().getStreamStatistics().value();
+    REQUIRE(statistics.lost_packets == 0);
+    REQUIRE(statistics.unrecoverable == false);
+
+    // The outage is filled with NaN instead of interpolating across it
+    const auto &decoded = stream.decoded();
+    const auto delay = 100 - 50 + latency * SAMPLE_RATE;
+    REQUIRE(decoded.size() == Catch::Approx(stream.published() + delay).margin(5));
+
+    std::size_t nan = 0;
+    for (std::size_t n = 0; n < decoded.size(); ++n)
+    {
+        if (std::isnan(decoded[n]))
+        {
+            nan++;
+            continue;
+        }
+
+        const auto expected = std::sin(2 * M_PI * (n - delay) / static_cast<double>(SAMPLE_RATE));
+        REQUIRE(decoded[n] == Catch::Approx(expected).margin(0.02));
+    }
+    REQUIRE(nan == Catch::Approx(10000 + delay).margin(5));
+}
+
+TEST_CASE("Loopback of a publisher resuming after an outage of hours")
+{
+    const double latency = 0.005;
+    LoopbackStream stream(LoopbackStream::payload(50), latency, {true, GapFill::NaN});
+
+    auto preview = std::make_shared<Preview>(SAMPLE_RATE, std::vector<int>{10});
+    stream.setPreview(preview);
+
+    for (int window = 0; window < 50; ++window)
+    {
+        stream.process(100);
+    }
+    const auto before = stream.decoded().size();
+
+    // Three hours at 1 kHz, filling the outage would write 10.8 million samples
+    const std::size_t outage = 3 * 3600 * SAMPLE_RATE;
+    stream.restart(outage);
+    for (int window = 0; window < 50; ++window)
+    {
+        stream.process(100);
+    }
+
+    const auto statistics = stream.decoder().getStreamStatistics().value();
+    REQUIRE(statistics.resyncs == 1);
+    REQUIRE(statistics.unrecoverable == false);
+    REQUIRE(statistics.nan_filled < 100);
+
+    // The outage is skipped, the samples continue at the current tick
+    const auto &decoded = stream.decoded();
+    const auto &ticks = stream.ticks();
+    const auto delay = 100 - 50 + latency * SAMPLE_RATE;
+    REQUIRE(decoded.size() == Catch::Approx(stream.published() - outage + delay).margin(5));
+    REQUIRE(ticks[before] > outage);
+
+    for (std::size_t n = before; n < decoded.size(); ++n)
+    {
+        if (n > before)
+        {
+            REQUIRE(ticks[n] == ticks[n - 1] + 1);
+        }
+
+        if (std::isnan(decoded[n]))
+        {
+            continue;
+        }
+
+        const auto expected = std::sin(2 * M_PI * (ticks[n] - delay) / static_cast<double>(SAMPLE_RATE));
+        REQUIRE(decoded[n] == Catch::Approx(expected).margin(0.02));
+    }
+
+    // The preview skips the outage as well, the blocks after it are taken separately
+    REQUIRE(preview->getPosition(0, Preview::Statistic::Mean) == 0);
+    REQUIRE(preview->getAndClearSamples(0, Preview::Statistic::Mean).size() == Catch::Approx(before / 100.0).margin(1));
+    REQUIRE(preview->getPosition(0, Preview::Statistic::Mean) == ticks[before] / 100);
+    REQUIRE(preview->getAndClearSamples(0, Preview::Statistic::Mean).size() == Catch::Approx((decoded.size() - before) / 100.0).margin(1));
+}
+
+TEST_CASE("Loopback with reordered, duplicated and lost packets")
+{
+    const double latency = 0.005;
+    LoopbackStream stream(25, latency);
+
+    // Every window of four packets arrives swapped and duplicated (QoS 1), packet 2 of window 50 is lost (QoS 0)
+    int window = 0;
+    stream.setDelivery([&window](std::vector<std::string> payloads)
+                       {
+                           std::vector<std::string> delivered = {payloads[1], payloads[0], payloads[0]};
+                           if (window++ != 50)
+                           {
+                               delivered.push_back(payloads[2]);
+                           }
+                           delivered.push_back(payloads[3]);
+                           delivered.push_back(payloads[3]);
+                           return delivered; });
+
+    for (int n = 0; n < 100; ++n)
+    {
+        stream.process(100);
+    }
+
+    const auto statistics = stream.decoder().getStreamStatistics().value();
+    // The first packet is dropped as it arrives after its successor, packets held back for the lost packet are not reordered
+    REQUIRE(statistics.reordered_packets == Catch::Approx(100).margin(5));
+    REQUIRE(statistics.dropped_packets == 201);
+    REQUIRE(statistics.lost_packets == 1);
+    REQUIRE(statistics.resyncs == 0);
+    REQUIRE(statistics.unrecoverable == false);
+
+    // The lost packet is replaced by NaN, all other samples are decoded in order
+    const auto &decoded = stream.decoded();
+    REQUIRE(decoded.size() == Catch::Approx(stream.published() + 100 - 25 + latency * SAMPLE_RATE).margin(50));
+
+    std::size_t nan = 0;
+    for (std::size_t n = 200; n < decoded.size(); ++n)
+    {
+        nan += std::isnan(decoded[n]) ? 1 : 0;
+    }
+    REQUIRE(nan == Catch::Approx(25).margin(2));
+}
+
+namespace
+{
+    /**
+     * @brief Publish bundled channels, each a sine of another frequency, and decode them using a single frame
+     */
+    std::vector<std::vector<double>> loopbackFrame(std::size_t num_channels, ChannelLayout layout, std::vector<std::string> subscribed)
+    {
+        Publish::Sampling sampling;
+        sampling.mode = SamplingModes::Sync;
+        sampling.downsampling_factor = 1;
+
+        Publish::Payload payload;
+        payload.datatype = Datatype::Number;
+        payload.packet_size = 50;
+        payload.layout = layout;
+        payload.format = PayloadFormat::CborSync;
+        for (std::size_t c = 0; c < num_channels; ++c)
+        {
+            payload.channels.push_back("ch" + std::to_string(c));
+        }
+
+        Publish publish("/frame", "uuid", sampling, payload, 0);
+        auto decoders = CborSyncDecoder::createFrameDecoders(Datatype::Number, SAMPLE_RATE, std::make_shared<StreamClock>(), {true, GapFill::NaN}, 8, subscribed);
+        for (auto &decoder : decoders)
+        {
+            decoder->prepareProcessing();
+        }
+
+        std::vector<std::vector<double>> decoded(decoders.size());
+        std::size_t published = 0;
+        for (int window = 0; window < 20; ++window)
+        {
+            std::vector<std::vector<value_t>> channels(num_channels);
+            for (std::size_t c = 0; c < num_channels; ++c)
+            {
+                for (std::size_t n = 0; n < 100; ++n)
+                {
+                    channels[c].push_back(std::sin(2 * M_PI * (c + 1) * (published + n) / static_cast<double>(SAMPLE_RATE)));
+                }
+            }
+            const auto start = published / static_cast<double>(SAMPLE_RATE);
+            published += 100;
+            publish.addSyncChannels(channels, SAMPLE_RATE, start);
+
+            const auto arrival = Timestamp(static_cast<std::uint64_t>(published / static_cast<double>(SAMPLE_RATE) * BASE_FREQUENCY), BASE_FREQUENCY);
+            while (publish.hasPayload())
+            {
+                const auto p = publish.pop();
+                for (std::size_t c = 0; c < decoders.size(); ++c)
+                {
+                    auto values = decoders[c]->getValue(Timestamp(0, BASE_FREQUENCY), arrival, p).pop_values<double>();
+                    decoded[c].insert(decoded[c].end(), values.begin(), values.end());
+                }
+            }
+        }
+
+        return decoded;
+    }
+}
+
+TEST_CASE("Loopback of several channels within a single frame")
+{
+    for (auto layout : {ChannelLayout::Columnar, ChannelLayout::Interleaved})
+    {
+        // Channels are located by their name, independent of their order within the frame
+        auto decoded = loopbackFrame(4, layout, {"ch3", "ch1"});
+        REQUIRE(decoded.size() == 2);
+        REQUIRE(decoded[0].size() == decoded[1].size());
+        REQUIRE(decoded[0].size() == Catch::Approx(2000).margin(60));
+
+        // All channels share the resampling positions, the first sample is aligned with the start of the stream
+        const auto delay = 50.0;
+        for (std::size_t n = 0; n < decoded[0].size(); ++n)
+        {
+            if (std::isnan(decoded[0][n]))
+            {
+                REQUIRE(std::isnan(decoded[1][n]));
+                continue;
+            }
+
+            REQUIRE(decoded[0][n] == Catch::Approx(std::sin(2 * M_PI * 4 * (n - delay) / SAMPLE_RATE)).margin(0.05));
+            REQUIRE(decoded[1][n] == Catch::Approx(std::sin(2 * M_PI * 2 * (n - delay) / SAMPLE_RATE)).margin(0.05));
+        }
+    }
+}
+
+TEST_CASE("A packet failing within a release does not drop the packets released after it")
+{
+    auto decoders = CborSyncDecoder::createFrameDecoders(Datatype::Number, SAMPLE_RATE, std::make_shared<StreamClock>(), {true, GapFill::NaN}, 8, {"a", "b"});
+    auto &decoder = *decoders.front();
+    decoder.prepareProcessing();
+
+    auto deliver = [&decoder](std::uint64_t idx, std::size_t size_a, std::size_t size_b, double timestamp)
+    {
+        json j;
+        j["timestamp"] = timestamp;
+        j["idx"] = idx;
+        j["channels"] = {"a", "b"};
+        j["data"] = {std::vector<double>(size_a, 1.0), std::vector<double>(size_b, 2.0)};
+
+        const auto cbor = json::to_cbor(j);
+        decoder.getValue(Timestamp(0, BASE_FREQUENCY), Timestamp(idx * 100000, BASE_FREQUENCY), std::string(cbor.begin(), cbor.end()));
+    };
+
+    // Packet 2 arrives last, packet 4 is malformed and the timestamp of packet 5 jumps backwards
+    deliver(1, 100, 100, 0.099);
+    deliver(3, 100, 100, 0.299);
+    deliver(4, 100, 50, 0.399);
+    deliver(5, 100, 100, 0.049);
+    REQUIRE(decoder.getStreamStatistics().value().resyncs == 0);
+
+    // The error of packet 4 is reported once packet 5 has been appended as well
+    REQUIRE_THROWS(deliver(2, 100, 100, 0.199));
+
+    const auto statistics = decoder.getStreamStatistics().value();
+    REQUIRE(statistics.resyncs == 1);
+    REQUIRE(statistics.reordered_packets == 1);
+    REQUIRE(statistics.lost_packets == 0);
+    REQUIRE(statistics.unrecoverable == false);
+}
+
+TEST_CASE("Decode raw counts of an integer sync stream")
+{
+    auto decoders = createCborSyncDecoders(SampleType::Int16, Datatype::Integer, SAMPLE_RATE, std::make_shared<StreamClock>(), {true, GapFill::NaN}, CborSyncDecoder::DEFAULT_REORDER_DEPTH, {});
+    REQUIRE(decoders.size() == 1);
+    auto &decoder = *decoders.front();
+    decoder.prepareProcessing();
+
+    std::vector<value_t> values;
+    for (int p = 1; p <= 20; ++p)
+    {
+        json j;
+        j["timestamp"] = p * 0.1 - 0.001;
+        j["data"] = std::vector<std::int16_t>(100, -1234);
+
+        const auto cbor = json::to_cbor(j);
+        auto sample = decoder.getValue(Timestamp(0, BASE_FREQUENCY), Timestamp(p * 100000, BASE_FREQUENCY), std::string(cbor.begin(), cbor.end()));
+        values.insert(values.end(), sample.values.begin(), sample.values.end());
+    }
+
+    // The counts pass the resampler unchanged
+    REQUIRE(values.size() == Catch::Approx(2000).margin(5));
+    for (const auto &v : values)
+    {
+        REQUIRE(std::get<int>(v) == -1234);
+    }
+
+    // Integer channels require integer samples
+    REQUIRE_THROWS(createCborSyncDecoders(SampleType::Float32, Datatype::Integer, SAMPLE_RATE, std::make_shared<StreamClock>(), {true, GapFill::NaN}, CborSyncDecoder::DEFAULT_REORDER_DEPTH, {}));
+}
+
+TEST_CASE("Decode a frame of 32 channels", "[.][benchmark]")
+{
+    std::vector<std::string> names;
+    for (int c = 0; c < 32; ++c)
+    {
+        names.push_back("ch" + std::to_string(c));
+    }
+
+    BENCHMARK("Loopback 32 channels, interleaved")
+    {
+        return loopbackFrame(32, ChannelLayout::Interleaved, names).size();
+    };
+}
+
+TEST_CASE("Loopback latency from Publish to the CBOR-Sync decoder", "[.][benchmark]")
+{
+    BENCHMARK_ADVANCED("Publish, encode and decode a packet of 1000 samples")(Catch::Benchmark::Chronometer meter)
+    {
+        LoopbackStream stream(1000, 0.005);
+        stream.process(1000);
+
+        meter.measure([&stream]
+                      { stream.process(1000); });
+    };
+}
@@ -0,0 +1,183 @@
+#include "LoadGenerator.h"
+#include "publish/encoding/CborSyncEncoder.h"
+#include "publish/encoding/TextJsonEncoder.h"
+
+//
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+//
+#include "fmt/core.h"
+
+using namespace plugin::mqtt;
+using namespace plugin::mqtt::tools;
+
+namespace
+{
+    constexpr double PI = 3.141592653589793238463;
+
+    // Frequency of the generated sine
+    constexpr double SIGNAL_FREQUENCY = 5.0;
+
+    inline std::shared_ptr<Encoder> createEncoder(PayloadFormat format)
+    {
+        switch (format)
+        {
+        case PayloadFormat::TextJson:
+            return std::make_shared<TextJsonEncoder>(Datatype::Number);
+        case PayloadFormat::CborSync:
+            return std::make_shared<CborSyncEncoder>(Datatype::Number);
+        }
+
+        throw std::invalid_argument("Payload format is unknown.");
+    }
+}
+
+LoadGenerator::LoadGenerator(Options options, Transport &transport) : m_options(options),
+                                                                      m_transport(transport),
+                                                                      m_sync_encoder(createEncoder(options.format)),
+                                                                      m_async_encoder(createEncoder(PayloadFormat::TextJson)),
+                                                                      m_random(options.seed)
+{
+    if (m_options.sample_rate <= 0 || m_options.packet_size <= 0 || m_options.async_rate <= 0)
+        throw std::invalid_argument("Rates and packet sizes must be positive.");
+
+    for (int n = 0; n < m_options.sync_topics; ++n)
+    {
+        m_topics.push_back({fmt::format("{}/sync/{}", m_options.prefix, n), SamplingModes::Sync, 0, n * PI / 8, 0.0});
+    }
+
+    for (int n = 0; n < m_options.async_topics; ++n)
+    {
+        m_topics.push_back({fmt::format("{}/async/{}", m_options.prefix, n), SamplingModes::Async, 0, n * PI / 8, 0.0});
+    }
+
+    for (std::size_t n = 0; n < m_topics.size(); ++n)
+    {
+        m_events.push({schedule(m_topics[n]), n});
+    }
+}
+
+double LoadGenerator::next() const
+{
+    return m_events.empty() ? 0.0 : m_events.top().due;
+}
+
+void LoadGenerator::step(double now)
+{
+    while (!m_events.empty() && m_events.top().due <= now)
+    {
+        auto event = m_events.top();
+        m_events.pop();
+
+        auto &topic = m_topics[event.topic];
+        publish(topic, event.due, now);
+
+        topic.idx++;
+        m_events.push({schedule(topic), event.topic});
+    }
+}
+
+void LoadGenerator::run(double duration, const std::atomic<bool> &stop)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    while (!stop && (duration <= 0 || next() < duration))
+    {
+        const std::chrono::duration<double> offset(next());
+        std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset));
+
+        const std::chrono::duration<double> now = std::chrono::steady_clock::now() - start;
+        step(now.count());
+    }
+}
+
+LoadGenerator::Statistics LoadGenerator::getStatistics() const
+{
+    return m_statistics;
+}
+
+double LoadGenerator::schedule(Topic &topic)
+{
+    double due = 0;
+    if (topic.mode == SamplingModes::Async)
+    {
+        due = (topic.idx + 1) / m_options.async_rate;
+    }
+    else
+    {
+        // A packet is sent once its last sample has been acquired using the (drifting) sender sample clock
+        const auto samples = (topic.idx + 1) * static_cast<double>(m_options.packet_size);
+        due = samples / senderRate();
+    }
+
+    if (m_options.jitter > 0)
+    {
+        due += std::uniform_real_distribution<double>(0.0, m_options.jitter)(m_random);
+    }
+
+    topic.last_due = std::max(topic.last_due, due);
+    return topic.last_due;
+}
+
+double LoadGenerator::senderRate() const
+{
+    return m_options.sample_rate * (1.0 + m_options.drift * 1e-6);
+}
+
+double LoadGenerator::signal(const Topic &topic, std::uint64_t sample) const
+{
+    return std::sin(2 * PI * SIGNAL_FREQUENCY * sample / m_options.sample_rate + topic.phase);
+}
+
+void LoadGenerator::publish(Topic &topic, double due, double now)
+{
+    m_statistics.max_lateness = std::max(m_statistics.max_lateness, now - due);
+
+    std::string payload;
+    std::size_t samples = 1;
+
+    if (topic.mode == SamplingModes::Sync)
+    {
+        if (m_options.loss > 0 && std::uniform_real_distribution<double>(0.0, 1.0)(m_random) < m_options.loss)
+        {
+            m_statistics.lost++;
+            return;
+        }
+
+        Encoder::SyncPacket packet;
+        packet.idx = topic.idx;
+        packet.sample_rate = m_options.sample_rate;
+        packet.layout = ChannelLayout::Columnar;
+        packet.data.resize(1);
+
+        const auto first = topic.idx * static_cast<std::uint64_t>(m_options.packet_size);
+        for (std::uint64_t n = first; n < first + m_options.packet_size; ++n)
+        {
+            packet.data.front().push_back(signal(topic, n));
+        }
+
+        // The last sample is timestamped by the reference clock, the drift shows up in the timestamps
+        packet.timestamp = (first + m_options.packet_size - 1) / senderRate();
+
+        payload = m_sync_encoder->encode(packet);
+        samples = m_options.packet_size;
+    }
+    else
+    {
+        const auto timestamp = (topic.idx + 1) / m_options.async_rate;
+        payload = m_async_encoder->encode(timestamp, signal(topic, topic.idx));
+    }
+
+    try
+    {
+        m_transport.publish(topic.name, payload, m_options.qos, [](bool) {});
+        m_statistics.packets++;
+        m_statistics.samples += samples;
+    }
+    catch (const std::exception &)
+    {
+        m_statistics.failed++;
+    }
+}
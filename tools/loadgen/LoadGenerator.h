@@ -0,0 +1,127 @@
+#pragma once
+
+//
+#include "Types.h"
+#include "publish/encoding/Encoder.h"
+#include "transport/Transport.h"
+
+//
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace plugin::mqtt::tools
+{
+    /**
+     * @brief Publish synthetic sync and async topics at given rates using the plugin encoders
+     * Sync topics emulate a sender with its own sample clock: packets can drift against the nominal sample rate,
+     * be delayed by a random jitter and be lost. Samples are timestamped by a reference clock (e.g. PTP), so the
+     * subscriber estimates the drifting rate from the timestamps.
+     */
+    class LoadGenerator
+    {
+    public:
+        struct Options
+        {
+            // Topics are named {prefix}/sync/{n} and {prefix}/async/{n}
+            std::string prefix = "/loadgen";
+
+            int sync_topics = 1;
+            int async_topics = 0;
+
+            // Sync topics
+            double sample_rate = 10000;
+            int packet_size = 1000;
+            PayloadFormat format = PayloadFormat::CborSync;
+
+            // Async topics, samples per second
+            double async_rate = 10;
+
+            // Deviation of the sender sample clock in ppm, the packets are sent and timestamped accordingly
+            double drift = 0;
+
+            // Maximum random delay of a packet in seconds
+            double jitter = 0;
+
+            // Probability of a packet to be lost
+            double loss = 0;
+
+            int qos = 0;
+            unsigned int seed = 0;
+        };
+
+        struct Statistics
+        {
+            std::uint64_t packets = 0;
+            std::uint64_t samples = 0;
+            std::uint64_t lost = 0;
+            std::uint64_t failed = 0;
+
+            // Largest delay of a packet behind its schedule (including jitter) in seconds
+            double max_lateness = 0;
+        };
+
+        LoadGenerator(Options options, Transport &transport);
+
+        /**
+         * @brief Publish everything scheduled up to the given time without waiting
+         * @param now Seconds since the generator started
+         */
+        void step(double now);
+
+        /**
+         * @brief Publish in real time for the given duration
+         * @param duration Seconds, runs until stopped if not positive
+         * @param stop Set to stop publishing
+         */
+        void run(double duration, const std::atomic<bool> &stop);
+
+        /**
+         * @brief Get the time of the next scheduled packet
+         * @return double Seconds since the generator started
+         */
+        double next() const;
+
+        Statistics getStatistics() const;
+
+    private:
+        struct Topic
+        {
+            std::string name;
+            SamplingModes mode;
+            std::uint64_t idx;
+            double phase;
+
+            // Packets of a topic are never reordered by jitter
+            double last_due;
+        };
+
+        struct Event
+        {
+            double due;
+            std::size_t topic;
+
+            bool operator>(const Event &other) const { return due > other.due; }
+        };
+
+        void publish(Topic &topic, double due, double now);
+        double schedule(Topic &topic);
+        double senderRate() const;
+        double signal(const Topic &topic, std::uint64_t sample) const;
+
+        Options m_options;
+        Transport &m_transport;
+        std::shared_ptr<Encoder> m_sync_encoder;
+        std::shared_ptr<Encoder> m_async_encoder;
+
+        std::vector<Topic> m_topics;
+        std::priority_queue<Event, std::vector<Event>, std::greater<Event>> m_events;
+
+        std::mt19937 m_random;
+        Statistics m_statistics;
+    };
+}
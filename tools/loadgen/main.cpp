@@ -0,0 +1,182 @@
+#include "LoadGenerator.h"
+#include "configuration/Server.h"
+#include "transport/LoopbackTransport.h"
+#include "transport/PahoTransport.h"
+
+//
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <thread>
+
+//
+#include "fmt/core.h"
+
+using namespace plugin::mqtt;
+using namespace plugin::mqtt::tools;
+
+namespace
+{
+    std::atomic<bool> stop(false);
+
+    void usage()
+    {
+        std::cout << "Usage: mqtt_loadgen [options]\n"
+                     "  --url <url>           Broker to publish to (default: tcp://127.0.0.1:1883)\n"
+                     "  --loopback            Publish to an in-process loopback transport instead of a broker\n"
+                     "  --fast                Publish as fast as possible instead of real time\n"
+                     "  --prefix <topic>      Topic prefix (default: /loadgen)\n"
+                     "  --sync <n>            Number of sync topics (default: 1)\n"
+                     "  --async <n>           Number of async topics (default: 0)\n"
+                     "  --rate <hz>           Sample rate of sync topics (default: 10000)\n"
+                     "  --packet-size <n>     Samples per sync packet (default: 1000)\n"
+                     "  --format <format>     Sync payload format cbor/json/sync or text/json (default: cbor/json/sync)\n"
+                     "  --async-rate <hz>     Samples per second of async topics (default: 10)\n"
+                     "  --drift <ppm>         Deviation of the sender sample clock (default: 0)\n"
+                     "  --jitter <ms>         Maximum random delay of a packet (default: 0)\n"
+                     "  --loss <percent>      Probability of a lost sync packet (default: 0)\n"
+                     "  --qos <qos>           MQTT quality of service (default: 0)\n"
+                     "  --seed <n>            Seed of the random generator (default: 0)\n"
+                     "  --duration <s>        Run for the given time, until interrupted if 0 (default: 10)\n";
+    }
+
+    PayloadFormat parseFormat(const std::string &format)
+    {
+        if (format == "cbor/json/sync")
+            return PayloadFormat::CborSync;
+        if (format == "text/json")
+            return PayloadFormat::TextJson;
+
+        throw std::invalid_argument("Unknown payload format " + format);
+    }
+
+    Transport::Pointer createTransport(const std::string &url)
+    {
+        json d;
+        d["servers"] = json::array({{{"url", url}}});
+        auto servers = d.get<config::Servers>();
+
+        auto transport = std::make_shared<PahoTransport>(servers.front());
+        transport->connect();
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!transport->isConnected() && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        if (!transport->isConnected())
+            throw std::runtime_error("Unable to connect to " + url);
+
+        return transport;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    LoadGenerator::Options options;
+    std::string url = "tcp://127.0.0.1:1883";
+    bool loopback = false;
+    bool fast = false;
+    double duration = 10;
+
+    try
+    {
+        for (int n = 1; n < argc; ++n)
+        {
+            const std::string arg = argv[n];
+            auto value = [&]() -> std::string
+            {
+                if (n + 1 >= argc)
+                    throw std::invalid_argument("Missing value for " + arg);
+                return argv[++n];
+            };
+
+            if (arg == "--url")
+                url = value();
+            else if (arg == "--loopback")
+                loopback = true;
+            else if (arg == "--fast")
+                fast = true;
+            else if (arg == "--prefix")
+                options.prefix = value();
+            else if (arg == "--sync")
+                options.sync_topics = std::stoi(value());
+            else if (arg == "--async")
+                options.async_topics = std::stoi(value());
+            else if (arg == "--rate")
+                options.sample_rate = std::stod(value());
+            else if (arg == "--packet-size")
+                options.packet_size = std::stoi(value());
+            else if (arg == "--format")
+                options.format = parseFormat(value());
+            else if (arg == "--async-rate")
+                options.async_rate = std::stod(value());
+            else if (arg == "--drift")
+                options.drift = std::stod(value());
+            else if (arg == "--jitter")
+                options.jitter = std::stod(value()) / 1000.0;
+            else if (arg == "--loss")
+                options.loss = std::stod(value()) / 100.0;
+            else if (arg == "--qos")
+                options.qos = std::stoi(value());
+            else if (arg == "--seed")
+                options.seed = static_cast<unsigned int>(std::stoul(value()));
+            else if (arg == "--duration")
+                duration = std::stod(value());
+            else
+            {
+                usage();
+                return arg == "--help" ? 0 : 1;
+            }
+        }
+
+        Transport::Pointer transport;
+        if (loopback)
+        {
+            transport = std::make_shared<LoopbackTransport>();
+            transport->connect();
+        }
+        else
+        {
+            transport = createTransport(url);
+        }
+
+        std::signal(SIGINT, [](int)
+                    { stop = true; });
+
+        LoadGenerator generator(options, *transport);
+
+        const auto start = std::chrono::steady_clock::now();
+        if (fast)
+        {
+            while (!stop && (duration <= 0 || generator.next() < duration))
+            {
+                generator.step(generator.next());
+            }
+        }
+        else
+        {
+            generator.run(duration, stop);
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        const auto statistics = generator.getStatistics();
+        fmt::print("Published {} packets ({} samples) in {:.3f} s: {:.0f} packets/s, {:.0f} samples/s\n",
+                   statistics.packets, statistics.samples, elapsed.count(),
+                   statistics.packets / elapsed.count(), statistics.samples / elapsed.count());
+        fmt::print("Lost: {}, failed: {}, max. lateness: {:.3f} ms\n",
+                   statistics.lost, statistics.failed, statistics.max_lateness * 1e3);
+
+        transport->disconnect();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}